@@ -114,6 +114,10 @@ BASE_SCRIPTS= [
     'key_import_export.py',
     'nodehandling.py',
     'reindex.py',
+    'txindex.py',
+    'coinstatsindex.py',
+    'compressblocks.py',
+    'txoutsetsnapshot.py',
     'addressindex.py',
     'spentindex.py',
     'timestampindex.py',
@@ -12,12 +12,15 @@
 #   getaddressdeltas
 #   getaddressutxos
 #   getaddressmempool
+#   importaddress (with -addressindexrescan)
 
 
 from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import JSONRPCException
 
 from test_framework.util import (
     assert_equal,
+    assert_raises_message,
     start_nodes,
     stop_nodes,
     connect_nodes,
@@ -61,7 +64,9 @@ class AddressIndexTest(BitcoinTestFramework):
         args_insight = base_args + ['-insightexplorer']
         # -lightwallet also causes addressindex to be enabled
         args_lightwallet = base_args + ['-lightwalletd']
-        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir, [args_insight] * 3 + [args_lightwallet])
+        # node2 also rescans imported addresses using the address index
+        args_rescan = args_insight + ['-addressindexrescan']
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir, [args_insight] * 2 + [args_rescan, args_lightwallet])
 
         connect_nodes(self.nodes[0], 1)
         connect_nodes(self.nodes[0], 2)
@@ -91,7 +96,7 @@ class AddressIndexTest(BitcoinTestFramework):
             return self.nodes[node_index].getaddressdeltas(params)
 
         # default received value is the balance value
-        def check_balance(node_index, address, expected_balance, expected_received=None):
+        def check_balance(node_index, address, expected_balance, expected_received=None, expected_txcount=None):
             if isinstance(address, list):
                 bal = self.nodes[node_index].getaddressbalance({'addresses': address})
             else:
@@ -100,6 +105,8 @@ class AddressIndexTest(BitcoinTestFramework):
             if expected_received is None:
                 expected_received = expected_balance
             assert_equal(bal['received'], expected_received)
+            if expected_txcount is not None:
+                assert_equal(bal['txcount'], expected_txcount)
 
         # begin test
 
@@ -124,8 +131,8 @@ class AddressIndexTest(BitcoinTestFramework):
         # Check that balances from mining are correct (105 blocks mined); in
         # regtest, all mining rewards from a single call to generate() are sent
         # to the same pair of addresses.
-        check_balance(1, addr_p2pkh, 105 * 10 * COIN)
-        check_balance(1, addr_p2sh, 105 * 2.5 * COIN)
+        check_balance(1, addr_p2pkh, 105 * 10 * COIN, expected_txcount=105)
+        check_balance(1, addr_p2sh, 105 * 2.5 * COIN, expected_txcount=105)
 
         # Multiple address arguments, results are the sum
         check_balance(1, [addr_p2sh, addr_p2pkh], 105 * 12.5 * COIN)
@@ -148,6 +155,42 @@ class AddressIndexTest(BitcoinTestFramework):
         height_txids = getaddresstxids(1, [addr_p2pkh, addr_p2sh], 1, 5)
         assert_equal(sorted(height_txids), sorted(unspent_txids))
 
+        # paging through results returns the same entries, in block order
+        def get_pages(method, params, key, limit):
+            results = []
+            params = dict(params, limit=limit)
+            while True:
+                page = method(params)
+                assert(len(page[key]) <= limit)
+                results += page[key]
+                if 'cursor' not in page:
+                    return results
+                assert_equal(len(page[key]), limit)
+                params['cursor'] = page['cursor']
+
+        both = {'addresses': [addr_p2pkh, addr_p2sh]}
+        all_txids = self.nodes[1].getaddresstxids(both)
+        assert_equal(len(all_txids), 105)
+        assert_equal(get_pages(self.nodes[1].getaddresstxids, both, 'txids', 10), all_txids)
+        assert_equal(get_pages(self.nodes[1].getaddresstxids, both, 'txids', 105), all_txids)
+
+        paged_deltas = get_pages(self.nodes[1].getaddressdeltas, both, 'deltas', 7)
+        assert_equal(len(paged_deltas), 2 * 105)
+        assert_equal(
+            [(d['height'], d['blockindex']) for d in paged_deltas],
+            sorted((d['height'], d['blockindex']) for d in paged_deltas))
+        assert_equal(
+            sorted((d['txid'], d['address']) for d in paged_deltas),
+            sorted((d['txid'], d['address']) for d in self.nodes[1].getaddressdeltas(both)))
+
+        paged_utxos = get_pages(self.nodes[1].getaddressutxos, both, 'utxos', 8)
+        assert_equal(
+            sorted((u['txid'], u['outputIndex']) for u in paged_utxos),
+            sorted((u['txid'], u['outputIndex']) for u in self.nodes[1].getaddressutxos(both)))
+
+        assert_raises_message(JSONRPCException, "Invalid cursor",
+            self.nodes[1].getaddresstxids, dict(both, limit=1, cursor='00'))
+
         # do some transfers, make sure balances are good
         txids_a1 = []
         addr1 = self.nodes[1].getnewaddress()
@@ -248,8 +291,8 @@ class AddressIndexTest(BitcoinTestFramework):
         for i in range(self.num_nodes):
             node = self.nodes[i]
             # the value 4 UTXO is no longer in our balance
-            check_balance(i, addr1, (expected - 4) * COIN, expected * COIN)
-            check_balance(i, addr2, 3 * COIN)
+            check_balance(i, addr1, (expected - 4) * COIN, expected * COIN, 6)
+            check_balance(i, addr2, 3 * COIN, expected_txcount=1)
 
             assert_equal(node.getblockcount(), 111)
             node.invalidateblock(tip['hash'])
@@ -258,8 +301,8 @@ class AddressIndexTest(BitcoinTestFramework):
             mempool = node.getaddressmempool({'addresses': [addr2, addr1]})
             assert_equal(len(mempool), 2)
 
-            check_balance(i, addr1, expected * COIN)
-            check_balance(i, addr2, 0)
+            check_balance(i, addr1, expected * COIN, expected_txcount=5)
+            check_balance(i, addr2, 0, expected_txcount=0)
 
         # now re-mine the addr1 to addr2 send
         self.nodes[0].generate(1)
@@ -385,6 +428,13 @@ class AddressIndexTest(BitcoinTestFramework):
         assert_equal(self.nodes[1].getaddresstxids(addr), [txid])
         check_balance(2, addr, 3 * COIN)
 
+        # Importing a watch-only address rescans only the blocks that the
+        # address index associates with it.
+        self.nodes[2].importaddress(addr)
+        watched = self.nodes[2].listunspent(1, 9999999, [addr])
+        assert_equal(sorted(u['amount'] for u in watched), [1, 2])
+        assert all(u['txid'] == txid for u in watched)
+
 
 if __name__ == '__main__':
     AddressIndexTest().main()
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+# Copyright (c) 2026 The Zcash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Test gettxoutsetinfo with hash_type muhash, backed by -coinstatsindex
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import JSONRPCException
+from test_framework.util import assert_equal, assert_raises_message, \
+    start_node, start_nodes, stop_node, wait_bitcoinds
+import time
+
+class CoinStatsIndexTest(BitcoinTestFramework):
+
+    def __init__(self):
+        super().__init__()
+        self.num_nodes = 2
+
+    def setup_network(self):
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir,
+            extra_args=[["-coinstatsindex"], []])
+        self.is_network_split = False
+
+    def restart(self, extra_args):
+        stop_node(self.nodes[0], 0)
+        wait_bitcoinds()
+        self.nodes[0] = start_node(0, self.options.tmpdir, ["-debug"] + extra_args)
+
+    def wait_for_stats(self, *args):
+        for _ in range(100):
+            try:
+                return self.nodes[0].gettxoutsetinfo("muhash", *args)
+            except JSONRPCException:
+                time.sleep(0.1)
+        return self.nodes[0].gettxoutsetinfo("muhash", *args)
+
+    def check_against_scan(self):
+        stats = self.wait_for_stats()
+        scan = self.nodes[0].gettxoutsetinfo()
+        for key in ['height', 'bestblock', 'txouts', 'total_amount']:
+            assert_equal(stats[key], scan[key])
+        assert_equal(len(stats['muhash']), 64)
+        assert('hash_serialized' not in stats)
+        return stats
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        assert_raises_message(JSONRPCException, "requires -coinstatsindex",
+            self.nodes[1].gettxoutsetinfo, "muhash")
+        assert_raises_message(JSONRPCException, "not a valid hash_type",
+            node.gettxoutsetinfo, "sha256")
+        assert_raises_message(JSONRPCException, "requires hash_type muhash",
+            node.gettxoutsetinfo, "hash_serialized", 100)
+
+        # The index is built in the background from the cached chain.
+        tip = self.check_against_scan()
+        assert_equal(tip['height'], 200)
+
+        # Statistics are kept for every block of the active chain.
+        genesis = node.gettxoutsetinfo("muhash", 0)
+        assert_equal(genesis['txouts'], 0)
+        assert_equal(genesis['total_amount'], 0)
+        assert_raises_message(JSONRPCException, "out of range",
+            node.gettxoutsetinfo, "muhash", 201)
+        before = node.gettxoutsetinfo("muhash", 199)
+        assert_equal(before['bestblock'], node.getblockhash(199))
+        assert(before['txouts'] < tip['txouts'])
+        assert(before['muhash'] != tip['muhash'])
+
+        # Disconnecting a block takes its outputs back out of the running hash.
+        node.invalidateblock(tip['bestblock'])
+        assert_equal(self.wait_for_stats(), before)
+        node.reconsiderblock(tip['bestblock'])
+        assert_equal(self.check_against_scan(), tip)
+
+        # New blocks are indexed as they connect.
+        node.generate(2)
+        self.check_against_scan()
+
+        # The index catches up with the blocks it missed while turned off,
+        # and keeps the statistics it already had.
+        self.restart([])
+        node = self.nodes[0]
+        node.generate(3)
+        self.restart(["-coinstatsindex"])
+        assert_equal(self.check_against_scan()['height'], 205)
+        assert_equal(self.nodes[0].gettxoutsetinfo("muhash", 200), tip)
+
+if __name__ == '__main__':
+    CoinStatsIndexTest().main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+# Copyright (c) 2026 The Zcash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Test that blocks stored with -compressblocks read back the same everywhere
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import JSONRPCException
+from test_framework.util import assert_equal, connect_nodes_bi, \
+    start_node, start_nodes, stop_node, sync_blocks, wait_bitcoinds
+import http.client
+import os
+import struct
+import time
+import urllib.parse
+
+DISK_RECORD_COMPRESSED = 0x80000000
+
+def count_records(path):
+    """Return the numbers of uncompressed and compressed records in a block file."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    magic = data[:4]
+    pos = 0
+    plain = compressed = 0
+    while pos + 8 <= len(data) and data[pos:pos+4] == magic:
+        size = struct.unpack('<I', data[pos+4:pos+8])[0]
+        if size & DISK_RECORD_COMPRESSED:
+            compressed += 1
+        else:
+            plain += 1
+        pos += 8 + (size & ~DISK_RECORD_COMPRESSED)
+    return plain, compressed
+
+def http_get(node, path):
+    url = urllib.parse.urlparse(node.url)
+    conn = http.client.HTTPConnection(url.hostname, url.port)
+    conn.request('GET', path)
+    response = conn.getresponse()
+    assert_equal(response.status, 200)
+    return response.read()
+
+class CompressBlocksTest(BitcoinTestFramework):
+
+    def __init__(self):
+        super().__init__()
+        self.num_nodes = 2
+
+    def setup_network(self):
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir, extra_args=[
+            ["-compressblocks", "-txindex"],
+            ["-allowdeprecated=getnewaddress"],
+        ])
+        connect_nodes_bi(self.nodes, 0, 1)
+        self.is_network_split = False
+
+    def blk_file(self, n):
+        return os.path.join(self.options.tmpdir, "node%d" % n, "regtest", "blocks", "blk00000.dat")
+
+    def wait_for_tx(self, txid):
+        for _ in range(100):
+            try:
+                return self.nodes[0].getrawtransaction(txid, 1)
+            except JSONRPCException:
+                time.sleep(0.1)
+        return self.nodes[0].getrawtransaction(txid, 1)
+
+    def check_blocks_match(self, start):
+        for height in range(start, self.nodes[1].getblockcount() + 1):
+            blockhash = self.nodes[1].getblockhash(height)
+            assert_equal(self.nodes[0].getblock(blockhash, 0), self.nodes[1].getblock(blockhash, 0))
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        # A block paying the same address many times compresses well, as
+        # does its undo data.
+        addr = self.nodes[1].getnewaddress()
+        txids = [self.nodes[1].sendtoaddress(addr, 1) for _ in range(10)]
+        self.nodes[1].generate(1)
+        self.nodes[1].generate(2)
+        sync_blocks(self.nodes)
+        self.check_blocks_match(190)
+
+        # The cached chain is stored uncompressed, and new blocks are
+        # compressed where that makes them smaller.
+        plain, compressed = count_records(self.blk_file(0))
+        assert(plain >= 201)
+        assert(compressed >= 1)
+        assert_equal(count_records(self.blk_file(1))[1], 0)
+
+        # Transactions are found by the txindex in compressed blocks.
+        for txid in txids:
+            assert_equal(self.wait_for_tx(txid)['blockhash'], self.nodes[1].getblockhash(201))
+
+        # REST serves the uncompressed block.
+        tip = node.getbestblockhash()
+        rawtip = node.getblock(tip, 0)
+        assert_equal(http_get(node, '/rest/block/%s.hex' % tip).decode('utf-8').strip(), rawtip)
+        assert_equal(http_get(node, '/rest/block/%s.bin' % tip).hex(), rawtip)
+        rawblocks = ''.join(node.getblock(node.getblockhash(h), 0) for h in range(199, 204))
+        assert_equal(http_get(node, '/rest/blocks/199/5.bin').hex(), rawblocks)
+
+        # Compressed undo data is read back when disconnecting blocks.
+        stats = node.gettxoutsetinfo()
+        node.invalidateblock(self.nodes[1].getblockhash(201))
+        assert_equal(node.getblockcount(), 200)
+        node.reconsiderblock(self.nodes[1].getblockhash(201))
+        assert_equal(node.getbestblockhash(), tip)
+        assert_equal(node.gettxoutsetinfo(), stats)
+
+        # Reindexing without -compressblocks reads the compressed blocks.
+        stop_node(node, 0)
+        wait_bitcoinds()
+        self.nodes[0] = start_node(0, self.options.tmpdir, ["-reindex"])
+        for _ in range(100):
+            if self.nodes[0].getblockcount() == 203:
+                break
+            time.sleep(0.1)
+        assert_equal(self.nodes[0].getbestblockhash(), tip)
+        assert_equal(self.nodes[0].gettxoutsetinfo(), stats)
+        self.check_blocks_match(0)
+
+if __name__ == '__main__':
+    CompressBlocksTest().main()
@@ -30,10 +30,10 @@ class BlockchainTest(BitcoinTestFramework):
         node = self.nodes[0]
 
         try:
-            node.gettxoutsetinfo(1)
+            node.gettxoutsetinfo("muhash", 1, 2)
         except JSONRPCException as e:
             errorString = e.error['message']
-        assert("Too many parameters for method `gettxoutsetinfo`. Needed exactly 0, but received 1" in errorString)
+        assert("Too many parameters for method `gettxoutsetinfo`. Needed at least 0 and at most 2, but received 3" in errorString)
 
 if __name__ == '__main__':
     BlockchainTest().main()
@@ -12,6 +12,7 @@ from test_framework.test_framework import BitcoinTestFramework
 from test_framework.util import assert_equal, str_to_b64str
 
 import http.client
+import json
 import urllib.parse
 
 class HTTPBasicsTest (BitcoinTestFramework):
@@ -95,6 +96,28 @@ class HTTPBasicsTest (BitcoinTestFramework):
         assert_equal(b'"error":null' in out1, True)
         assert_equal(conn.sock!=None, True) # connection must be closed because bitcoind should use keep-alive by default
 
+        # Batch elements are executed concurrently, but the replies must be
+        # returned in request order with errors reported per element.
+        batch = []
+        for i in range(50):
+            if i % 10 == 9:
+                batch.append({"method": "nosuchmethod", "id": i})
+            else:
+                batch.append({"method": "getblockhash", "params": [i % 10], "id": i})
+        conn = http.client.HTTPConnection(urlNode2.hostname, urlNode2.port)
+        conn.connect()
+        conn.request('POST', '/', json.dumps(batch), headers)
+        replies = json.loads(conn.getresponse().read().decode('utf8'))
+        assert_equal(len(replies), len(batch))
+        for i, reply in enumerate(replies):
+            assert_equal(reply['id'], i)
+            if i % 10 == 9:
+                assert_equal(reply['error']['code'], -32601)
+            else:
+                assert_equal(reply['error'], None)
+                assert_equal(reply['result'], self.nodes[2].getblockhash(i % 10))
+        conn.close()
+
         # Check excessive request size
         conn = http.client.HTTPConnection(urlNode2.hostname, urlNode2.port)
         conn.connect()
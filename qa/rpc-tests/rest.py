@@ -289,6 +289,32 @@ class RESTTest (BitcoinTestFramework):
         json_obj = json.loads(response_header_json_str)
         assert_equal(len(json_obj), 5) # now we should have 5 header objects
 
+        #################
+        # /rest/blocks/ #
+        #################
+
+        # a range of blocks is the concatenation of their raw serializations
+        height = self.nodes[0].getblock(bb_hash)['height']
+        expected = b''
+        for h in range(height, height + 5):
+            expected += hex_str_to_bytes(self.nodes[0].getblock(self.nodes[0].getblockhash(h), 0))
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height)+'/5'+self.FORMAT_SEPARATOR+"bin", True)
+        assert_equal(response.status, 200)
+        assert_equal(response.read(), expected)
+        assert_equal(response_str, expected[0:len(response_str)])
+
+        # the range is cut short at the tip
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height)+'/1000'+self.FORMAT_SEPARATOR+"bin", True)
+        assert_equal(response.status, 200)
+        assert_greater_than(len(response.read()), len(expected))
+
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height)+'/1001'+self.FORMAT_SEPARATOR+"bin", True)
+        assert_equal(response.status, 400)
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/100000/1'+self.FORMAT_SEPARATOR+"bin", True)
+        assert_equal(response.status, 404)
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height)+'/5'+self.FORMAT_SEPARATOR+"json", True)
+        assert_equal(response.status, 404)
+
         # do tx test
         tx_hash = block_json_obj['tx'][0]['txid'];
         json_string = http_get_call(url.hostname, url.port, '/rest/tx/'+tx_hash+self.FORMAT_SEPARATOR+"json")
@@ -47,6 +47,10 @@ Options:
        "getrawchangeaddress", "legacy_privacy", "wallettxvjoinsplit",
        "z_getbalance", "z_getnewaddress", "z_listaddresses"}
 
+  -blockcachesize=<n>
+       Keep up to <n> MiB of recently connected and frequently requested blocks
+       in memory, 0 to disable (default: 32)
+
   -blocknotify=<cmd>
        Execute command when the best block changes (%s in cmd is replaced by
        block hash)
@@ -64,6 +68,21 @@ Options:
   -checklevel=<n>
        How thorough the block verification of -checkblocks is (0-4, default: 3)
 
+  -checkcoinsinbackground
+       Run the level 3 and 4 checks of -checkblocks against the coin database
+       in the background once the node has started, rather than before
+       (default: 1)
+
+  -coinstatsindex
+       Maintain statistics on the UTXO set as of every block, used by
+       gettxoutsetinfo with hash_type muhash. The index is built in the
+       background when it is first enabled (default: 0)
+
+  -compressblocks
+       Compress blocks and undo data when writing them to disk. Block files
+       written without it are recompressed in the background, except in prune
+       mode (default: 0)
+
   -conf=<file>
        Specify configuration file. Relative paths will be prefixed by datadir
        location. (default: zcash.conf)
@@ -80,6 +99,11 @@ Options:
   -dbcache=<n>
        Set database cache size in megabytes (4 to 16384, default: 450)
 
+  -dbcompactafteribd
+       Compact the chainstate, block index and index databases once initial
+       block download finishes, rather than leaving LevelDB to compact them
+       while writing (default: 1)
+
   -debuglogfile=<file>
        Specify location of debug log file. Relative paths will be prefixed by a
        net-specific datadir location. (default: debug.log)
@@ -108,10 +132,10 @@ Options:
 
   -prune=<n>
        Reduce storage requirements by pruning (deleting) old blocks. This mode
-       disables wallet support and is incompatible with -txindex. Warning:
-       Reverting this setting requires re-downloading the entire blockchain.
-       (default: 0 = disable pruning blocks, >550 = target size in MiB to use
-       for block files)
+       disables wallet support and is incompatible with -txindex and
+       -coinstatsindex. Warning: Reverting this setting requires re-downloading
+       the entire blockchain. (default: 0 = disable pruning blocks, >550 =
+       target size in MiB to use for block files)
 
   -reindex-chainstate
        Rebuild chain state from the currently indexed blocks (implies -rescan)
@@ -130,7 +154,8 @@ Options:
 
   -txindex
        Maintain a full transaction index, used by the getrawtransaction rpc
-       call (default: 0)
+       call. The index is built in the background when it is first enabled
+       (default: 0)
 
 Connection options:
 
@@ -422,6 +447,10 @@ Debugging/Testing options:
 |       Reject peers that don't know about the current epoch (regtest-only)
 |       (default: 1)
 |
+|  -regtestassumeutxo=height:hash
+|       Accept a chainstate snapshot at the given height with the given hash in
+|       loadtxoutset (regtest-only)
+|
 |  -fundingstream=streamId:startHeight:endHeight:comma_delimited_addresses
 |       Use given addresses for block subsidy share paid to the funding stream
 |       with id <streamId> (regtest-only)
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+# Copyright (c) 2026 The Zcash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Test that -txindex can be turned on and off without -reindex
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import JSONRPCException
+from test_framework.util import assert_equal, assert_raises_message, \
+    start_node, stop_node, wait_bitcoinds
+import time
+
+class TxIndexTest(BitcoinTestFramework):
+
+    def __init__(self):
+        super().__init__()
+        self.cache_behavior = 'clean'
+        self.num_nodes = 1
+
+    def setup_network(self):
+        self.nodes = []
+        self.is_network_split = False
+        self.nodes.append(start_node(0, self.options.tmpdir))
+
+    def restart(self, extra_args):
+        stop_node(self.nodes[0], 0)
+        wait_bitcoinds()
+        self.nodes[0] = start_node(0, self.options.tmpdir, ["-debug"] + extra_args)
+
+    def wait_for_tx(self, txid):
+        for _ in range(100):
+            try:
+                return self.nodes[0].getrawtransaction(txid, 1)
+            except JSONRPCException:
+                time.sleep(0.1)
+        return self.nodes[0].getrawtransaction(txid, 1)
+
+    def run_test(self):
+        self.nodes[0].generate(10)
+        block = self.nodes[0].getblock(self.nodes[0].getblockhash(2))
+        txid = block['tx'][0]
+        assert_raises_message(JSONRPCException, "Use -txindex",
+            self.nodes[0].getrawtransaction, txid)
+
+        # Enabling the index builds it in the background.
+        self.restart(["-txindex"])
+        assert_equal(self.wait_for_tx(txid)['blockhash'], block['hash'])
+
+        # Once the index is synced, new blocks are indexed as they connect.
+        newblock = self.nodes[0].getblock(self.nodes[0].generate(1)[0])
+        tx = self.nodes[0].getrawtransaction(newblock['tx'][0], 1)
+        assert_equal(tx['blockhash'], newblock['hash'])
+
+        # The index can be turned off, and catches up with the blocks it
+        # missed when it is turned back on.
+        self.restart([])
+        self.nodes[0].generate(5)
+        lastblock = self.nodes[0].getblock(self.nodes[0].getbestblockhash())
+        self.restart(["-txindex"])
+        assert_equal(self.wait_for_tx(lastblock['tx'][0])['blockhash'], lastblock['hash'])
+        assert_equal(self.nodes[0].getrawtransaction(txid, 1)['blockhash'], block['hash'])
+
+if __name__ == '__main__':
+    TxIndexTest().main()
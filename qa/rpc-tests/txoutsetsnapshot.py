@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+# Copyright (c) 2026 The Zcash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Test dumptxoutset, loadtxoutset and -loadsnapshot
+#
+
+from test_framework.mininode import CBlockHeader, NodeConn, NodeConnCB, \
+    NetworkThread, msg_headers, msg_ping, msg_pong, mininode_lock
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import JSONRPCException
+from test_framework.util import assert_equal, assert_raises_message, \
+    assert_start_raises_init_error, connect_nodes_bi, initialize_datadir, \
+    hex_str_to_bytes, p2p_port, start_node, start_nodes, stop_node, \
+    sync_blocks
+from io import BytesIO
+import os
+import time
+
+SNAPSHOT_HEIGHT = 200
+
+class HeadersNode(NodeConnCB):
+    """A peer that announces headers, and never serves the blocks."""
+    def __init__(self):
+        NodeConnCB.__init__(self)
+        self.create_callback_map()
+        self.connection = None
+        self.ping_counter = 1
+        self.last_pong = msg_pong()
+
+    def add_connection(self, conn):
+        self.connection = conn
+
+    def wait_for_verack(self):
+        while True:
+            with mininode_lock:
+                if self.verack_received:
+                    return
+            time.sleep(0.05)
+
+    def on_pong(self, conn, message):
+        self.last_pong = message
+
+    def sync_with_ping(self, timeout=30):
+        self.connection.send_message(msg_ping(nonce=self.ping_counter))
+        received_pong = False
+        sleep_time = 0.05
+        while not received_pong and timeout > 0:
+            time.sleep(sleep_time)
+            timeout -= sleep_time
+            with mininode_lock:
+                if self.last_pong.nonce == self.ping_counter:
+                    received_pong = True
+        self.ping_counter += 1
+        return received_pong
+
+class TxOutSetSnapshotTest(BitcoinTestFramework):
+
+    def __init__(self):
+        super().__init__()
+        self.num_nodes = 1
+
+    def setup_network(self):
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir, extra_args=[["-debug"]])
+        self.is_network_split = False
+
+    def send_headers(self, peer, height):
+        node = self.nodes[0]
+        headers = []
+        for h in range(1, height + 1):
+            header = CBlockHeader()
+            header.deserialize(BytesIO(hex_str_to_bytes(
+                node.getblockheader(node.getblockhash(h), False))))
+            headers.append(header)
+        while headers:
+            message = msg_headers()
+            message.headers = headers[:160]
+            headers = headers[160:]
+            peer.connection.send_message(message)
+            assert(peer.sync_with_ping())
+
+    def run_test(self):
+        node = self.nodes[0]
+        assert_equal(node.getblockcount(), SNAPSHOT_HEIGHT)
+        path = os.path.join(self.options.tmpdir, "utxo.dat")
+
+        dump = node.dumptxoutset(path)
+        assert_equal(dump['path'], path)
+        assert_equal(dump['base_hash'], node.getbestblockhash())
+        assert_equal(dump['base_height'], SNAPSHOT_HEIGHT)
+        assert(dump['entries'] > 0)
+        assert_raises_message(JSONRPCException, "already exists",
+            node.dumptxoutset, path)
+
+        assert_raises_message(JSONRPCException, "is disabled",
+            node.loadtxoutset, path)
+        assumeutxo = "-regtestassumeutxo=%d:%s" % (SNAPSHOT_HEIGHT, dump['snapshot_hash'])
+        wrong = "-regtestassumeutxo=%d:%s" % (SNAPSHOT_HEIGHT, "00" * 32)
+        experimental = ["-experimentalfeatures", "-assumeutxo"]
+
+        # Give a new node the headers, but not the blocks, up to the snapshot.
+        initialize_datadir(self.options.tmpdir, 1)
+        self.nodes.append(start_node(1, self.options.tmpdir,
+            ["-debug", "-disablewallet", assumeutxo] + experimental))
+        peer = HeadersNode()
+        peer.add_connection(NodeConn('127.0.0.1', p2p_port(1), self.nodes[1], peer))
+        NetworkThread().start()
+        peer.wait_for_verack()
+        self.send_headers(peer, SNAPSHOT_HEIGHT)
+        assert_equal(self.nodes[1].getblockcount(), 0)
+        assert_equal(self.nodes[1].getblockheader(dump['base_hash'])['height'], SNAPSHOT_HEIGHT)
+
+        loaded = self.nodes[1].loadtxoutset(path)
+        assert_equal(loaded['base_hash'], dump['base_hash'])
+        assert_equal(loaded['base_height'], SNAPSHOT_HEIGHT)
+        assert_equal(loaded['entries'], dump['entries'])
+        assert_equal(loaded['tip_hash'], dump['base_hash'])
+        assert_equal(self.nodes[1].getblockcount(), SNAPSHOT_HEIGHT)
+        assert_equal(self.nodes[1].gettxoutsetinfo(), node.gettxoutsetinfo())
+        assert_raises_message(JSONRPCException, "before any blocks",
+            self.nodes[1].loadtxoutset, path)
+
+        # Blocks below the snapshot are not available.
+        assert_raises_message(JSONRPCException, "Can't read block",
+            self.nodes[1].getblock, node.getblockhash(SNAPSHOT_HEIGHT - 1))
+
+        # Blocks after the snapshot are downloaded and connected on top of it.
+        connect_nodes_bi(self.nodes, 0, 1)
+        node.generate(5)
+        sync_blocks(self.nodes)
+        assert_equal(self.nodes[1].getblockcount(), SNAPSHOT_HEIGHT + 5)
+        assert_equal(self.nodes[1].gettxoutsetinfo(), node.gettxoutsetinfo())
+        assert_equal(self.nodes[1].getblockchaininfo()['valuePools'],
+            node.getblockchaininfo()['valuePools'])
+
+        # Indexes and the wallet need the blocks below the snapshot.
+        stop_node(self.nodes[1], 1)
+        assert_start_raises_init_error(1, self.options.tmpdir, ["-disablewallet", "-txindex"] + experimental,
+            "loaded from a snapshot")
+        assert_start_raises_init_error(1, self.options.tmpdir, experimental,
+            "loaded from a snapshot")
+        assert_start_raises_init_error(1, self.options.tmpdir, ["-disablewallet"],
+            "have not been validated")
+
+        # The snapshot chainstate is kept across restarts.
+        self.nodes[1] = start_node(1, self.options.tmpdir, ["-debug", "-disablewallet"] + experimental)
+        assert_equal(self.nodes[1].getbestblockhash(), node.getbestblockhash())
+        assert_equal(self.nodes[1].gettxoutsetinfo(), node.gettxoutsetinfo())
+
+        # A snapshot is only loaded if its hash is committed to, and a wrong
+        # hash is refused before anything is changed.
+        initialize_datadir(self.options.tmpdir, 2)
+        self.nodes.append(start_node(2, self.options.tmpdir, ["-debug", "-disablewallet", wrong] + experimental))
+        assert_raises_message(JSONRPCException, "does not match",
+            self.nodes[2].loadtxoutset, path)
+        assert_equal(self.nodes[2].getblockcount(), 0)
+
+        # With -loadsnapshot, no block is downloaded until the headers chain
+        # reaches the snapshot's block and the snapshot is loaded.
+        initialize_datadir(self.options.tmpdir, 3)
+        self.nodes.append(start_node(3, self.options.tmpdir,
+            ["-debug", "-disablewallet", assumeutxo, "-loadsnapshot=" + path] + experimental))
+        assert_raises_message(JSONRPCException, "already waiting",
+            self.nodes[3].loadtxoutset, path)
+        connect_nodes_bi(self.nodes, 0, 3)
+        sync_blocks([node, self.nodes[3]])
+        assert_equal(self.nodes[3].getbestblockhash(), node.getbestblockhash())
+        assert_equal(self.nodes[3].gettxoutsetinfo(), node.gettxoutsetinfo())
+        assert_raises_message(JSONRPCException, "Can't read block",
+            self.nodes[3].getblock, node.getblockhash(SNAPSHOT_HEIGHT - 1))
+
+        # Restarting with the same snapshot keeps the chainstate.
+        stop_node(self.nodes[3], 3)
+        self.nodes[3] = start_node(3, self.options.tmpdir,
+            ["-debug", "-disablewallet", assumeutxo, "-loadsnapshot=" + path] + experimental)
+        assert_equal(self.nodes[3].getbestblockhash(), node.getbestblockhash())
+
+        # It is refused once blocks have been connected.
+        stop_node(self.nodes[2], 2)
+        self.nodes[2] = start_node(2, self.options.tmpdir, ["-debug", "-disablewallet"])
+        assert_raises_message(JSONRPCException, "is disabled",
+            self.nodes[2].loadtxoutset, path)
+        connect_nodes_bi(self.nodes, 0, 2)
+        sync_blocks([node, self.nodes[2]])
+        stop_node(self.nodes[2], 2)
+        assert_start_raises_init_error(2, self.options.tmpdir,
+            ["-disablewallet", assumeutxo, "-loadsnapshot=" + path], "requires -experimentalfeatures")
+        assert_start_raises_init_error(2, self.options.tmpdir,
+            ["-disablewallet", assumeutxo, "-loadsnapshot=" + path] + experimental, "before any blocks")
+        self.nodes[2] = start_node(2, self.options.tmpdir, ["-debug", "-disablewallet"])
+
+if __name__ == '__main__':
+    TxOutSetSnapshotTest().main()
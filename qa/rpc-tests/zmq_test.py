@@ -28,10 +28,14 @@ class ZMQTest(BitcoinTestFramework):
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashblock")
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashtx")
         self.zmqSubSocket.connect("tcp://127.0.0.1:%i" % self.port)
+        self.zmqSeqSocket = self.zmqContext.socket(zmq.SUB)
+        self.zmqSeqSocket.setsockopt(zmq.SUBSCRIBE, b"sequence")
+        self.zmqSeqSocket.connect("tcp://127.0.0.1:%i" % (self.port + 1))
         return start_nodes(self.num_nodes, self.options.tmpdir, extra_args=[
             [
                 '-zmqpubhashtx=tcp://127.0.0.1:'+str(self.port),
                 '-zmqpubhashblock=tcp://127.0.0.1:'+str(self.port),
+                '-zmqpubsequence=tcp://127.0.0.1:'+str(self.port + 1),
                 '-allowdeprecated=getnewaddress',
             ],
             [],
@@ -99,6 +103,29 @@ class ZMQTest(BitcoinTestFramework):
 
         assert_equal(hashRPC, hashZMQ) #blockhash from generate must be equal to the hash received over zmq
 
+        # The sequence topic reports each block connection and mempool change
+        # in order, with its own message sequence number.
+        def recv_sequence():
+            msg = self.zmqSeqSocket.recv_multipart()
+            assert_equal(msg[0], b"sequence")
+            body = msg[1]
+            mempoolSequence = None
+            if len(body) > 33:
+                mempoolSequence = struct.unpack('<Q', body[33:])[0]
+            msgSequence = struct.unpack('<I', msg[-1])[-1]
+            return (bytes_to_hex_str(body[:32]), body[32:33], mempoolSequence, msgSequence)
+
+        blockhashes = [self.nodes[0].getblockhash(h) for h in range(201, 201 + n + 1)]
+        for (i, blockhash) in enumerate(blockhashes):
+            assert_equal(recv_sequence(), (blockhash, b"C", None, i))
+        assert_equal(recv_sequence(), (hashRPC, b"A", 1, n + 1))
+
+        # Mining the transaction removes it from the mempool before the block
+        # is connected.
+        genhashes = self.nodes[0].generate(1)
+        assert_equal(recv_sequence(), (hashRPC, b"R", 2, n + 2))
+        assert_equal(recv_sequence(), (genhashes[0], b"C", None, n + 3))
+
 
 if __name__ == '__main__':
     ZMQTest ().main ()
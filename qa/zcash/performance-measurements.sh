@@ -206,6 +206,9 @@ case "$1" in
             createsaplingoutput)
                 zcash_rpc zcbenchmark createsaplingoutput 50
                 ;;
+            createsaplingbundle)
+                zcash_rpc zcbenchmark createsaplingbundle 5 "${@:3}"
+                ;;
             verifysaplingoutput)
                 zcash_rpc zcbenchmark verifysaplingoutput 1000
                 ;;
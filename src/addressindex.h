@@ -223,6 +223,33 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+// Running totals for one address over the confirmed address index, keyed by
+// CAddressIndexIteratorKey.
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+    int64_t txCount;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(txCount);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        txCount = 0;
+    }
+};
+
 struct CMempoolAddressDelta
 {
     int64_t time;
@@ -5,6 +5,8 @@
 #include "asyncrpcqueue.h"
 #include "util/system.h"
 
+#include <rust/metrics.h>
+
 static std::atomic<size_t> workerCounter(0);
 
 /**
@@ -53,8 +55,13 @@ void AsyncRPCQueue::run(size_t workerId) {
             }
 
             // Get operation id
-            key = operation_id_queue_.front();
+            auto entry = operation_id_queue_.front();
             operation_id_queue_.pop();
+            key = entry.first;
+            MetricsGauge("zcashd.asyncrpc.queue.depth", operation_id_queue_.size());
+            MetricsHistogram(
+                "zcashd.asyncrpc.queue.wait.seconds",
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - entry.second).count());
 
             // Search operation map
             AsyncRPCOperationMap::const_iterator iter = operation_map_.find(key);
@@ -68,7 +75,13 @@ void AsyncRPCQueue::run(size_t workerId) {
         } else if (operation->isCancelled()) {
             // skip cancelled operation
         } else {
+            MetricsIncrementGauge("zcashd.asyncrpc.workers.busy", 1);
+            auto start = std::chrono::steady_clock::now();
             operation->main();
+            MetricsHistogram(
+                "zcashd.asyncrpc.operation.seconds",
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            MetricsDecrementGauge("zcashd.asyncrpc.workers.busy", 1);
         }
     }
 }
@@ -94,7 +107,8 @@ void AsyncRPCQueue::addOperation(const std::shared_ptr<AsyncRPCOperation> &ptrOp
 
     AsyncRPCOperationId id = ptrOperation->getId();
     operation_map_.emplace(id, ptrOperation);
-    operation_id_queue_.push(id);
+    operation_id_queue_.push(std::make_pair(id, std::chrono::steady_clock::now()));
+    MetricsGauge("zcashd.asyncrpc.queue.depth", operation_id_queue_.size());
     this->condition_.notify_one();
 }
 
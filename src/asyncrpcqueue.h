@@ -21,6 +21,9 @@
 
 typedef std::unordered_map<AsyncRPCOperationId, std::shared_ptr<AsyncRPCOperation> > AsyncRPCOperationMap; 
 
+// An operation id waiting to be picked up by a worker, with the time it was queued.
+typedef std::pair<AsyncRPCOperationId, std::chrono::steady_clock::time_point> AsyncRPCQueueEntry;
+
 
 class AsyncRPCQueue {
 public:
@@ -61,7 +64,7 @@ private:
     std::atomic<bool> closed_;
     std::atomic<bool> finish_;
     AsyncRPCOperationMap operation_map_;
-    std::queue <AsyncRPCOperationId> operation_id_queue_;
+    std::queue <AsyncRPCQueueEntry> operation_id_queue_;
     std::vector<std::thread> workers_;
 };
 
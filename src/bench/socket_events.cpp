@@ -0,0 +1,86 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+#include "net.h"
+#include "netbase.h"
+#include "util/system.h"
+
+#include <cassert>
+#include <set>
+#include <vector>
+
+#ifndef WIN32
+
+#ifdef USE_EPOLL
+static const int NUM_LOOPBACK_PEERS = 4000;
+#else
+// select() cannot wait on descriptors at or above FD_SETSIZE.
+static const int NUM_LOOPBACK_PEERS = FD_SETSIZE / 2 - 16;
+#endif
+
+// Wait for one ready socket among thousands of connected loopback peers, as
+// ThreadSocketHandler does on a busy relay node.
+static void SocketEventsLoopbackPeers(benchmark::State& state)
+{
+    int nPeers = std::min(NUM_LOOPBACK_PEERS, (RaiseFileDescriptorLimit(2 * NUM_LOOPBACK_PEERS + 64) - 64) / 2);
+
+    SOCKET hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (hListen == INVALID_SOCKET ||
+        bind(hListen, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        listen(hListen, SOMAXCONN) == SOCKET_ERROR ||
+        getsockname(hListen, (struct sockaddr*)&addr, &len) == SOCKET_ERROR) {
+        CloseSocket(hListen);
+        return;
+    }
+
+    std::vector<SOCKET> vClient, vServer;
+    for (int i = 0; i < nPeers; i++) {
+        SOCKET hClient = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (hClient == INVALID_SOCKET || connect(hClient, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+            CloseSocket(hClient);
+            break;
+        }
+        SOCKET hServer = accept(hListen, nullptr, nullptr);
+        if (hServer == INVALID_SOCKET) {
+            CloseSocket(hClient);
+            break;
+        }
+        vClient.push_back(hClient);
+        vServer.push_back(hServer);
+    }
+
+    CSocketEvents socketEvents;
+    for (SOCKET hSocket : vServer) {
+        socketEvents.Add(hSocket, CSocketEvents::RECV);
+    }
+    size_t nPeer = 0;
+    assert(!vServer.empty());
+    char ch = 0;
+    std::set<SOCKET> recv_set, send_set, error_set;
+    while (state.KeepRunning()) {
+        // Make one peer readable, then wait on all of them.
+        nPeer = (nPeer + 1) % vServer.size();
+        send(vClient[nPeer], &ch, 1, MSG_NOSIGNAL);
+
+        socketEvents.Wait(recv_set, send_set, error_set, 1000);
+        assert(recv_set.count(vServer[nPeer]) == 1);
+        recv(vServer[nPeer], &ch, 1, 0);
+    }
+
+    for (SOCKET& hSocket : vClient) CloseSocket(hSocket);
+    for (SOCKET& hSocket : vServer) {
+        socketEvents.Remove(hSocket);
+        CloseSocket(hSocket);
+    }
+    CloseSocket(hListen);
+}
+
+BENCHMARK(SocketEventsLoopbackPeers);
+
+#endif // WIN32
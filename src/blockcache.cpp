@@ -0,0 +1,159 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "blockcache.h"
+
+#include "core_memusage.h"
+#include "memusage.h"
+#include "streams.h"
+#include "version.h"
+
+#include <algorithm>
+
+static size_t BlockUsage(const CBlock& block)
+{
+    return memusage::MallocUsage(sizeof(CBlock)) + RecursiveDynamicUsage(block);
+}
+
+static size_t RawUsage(const std::vector<uint8_t>& raw)
+{
+    return memusage::MallocUsage(sizeof(raw)) + memusage::DynamicUsage(raw);
+}
+
+CBlockCache::CBlockCache(size_t nMaxUsageIn) : nMaxUsage(nMaxUsageIn), nUsage(0)
+{
+}
+
+void CBlockCache::SetMaxUsage(size_t nMaxUsageIn)
+{
+    std::vector<Entry> vEvicted;
+    std::lock_guard<std::mutex> lock(cs);
+    nMaxUsage = nMaxUsageIn;
+    if (nMaxUsage == 0) {
+        recentMisses.clear();
+    }
+    Trim(vEvicted);
+}
+
+CBlockCache::BlockRef CBlockCache::Get(const uint256& hash)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapEntries.find(hash);
+    if (it == mapEntries.end()) {
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->block;
+}
+
+CBlockCache::RawBlockRef CBlockCache::GetRaw(const uint256& hash)
+{
+    BlockRef block;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        auto it = mapEntries.find(hash);
+        if (it == mapEntries.end()) {
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        if (it->second->raw) {
+            return it->second->raw;
+        }
+        block = it->second->block;
+    }
+
+    // Serialize the block without holding the lock, as other threads may be
+    // reading other blocks meanwhile.
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << *block;
+    RawBlockRef raw = std::make_shared<const std::vector<uint8_t>>(ss.begin(), ss.end());
+
+    std::vector<Entry> vEvicted;
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapEntries.find(hash);
+    if (it != mapEntries.end() && !it->second->raw) {
+        it->second->raw = raw;
+        it->second->nUsage += RawUsage(*raw);
+        nUsage += RawUsage(*raw);
+        Trim(vEvicted);
+    }
+    return raw;
+}
+
+void CBlockCache::Add(const BlockRef& block)
+{
+    uint256 hash = block->GetHash();
+    // The block, and the list and hash map nodes holding its entry.
+    size_t nEntryUsage = BlockUsage(*block) +
+        memusage::MallocUsage(sizeof(Entry) + 2 * sizeof(void*)) +
+        memusage::MallocUsage(sizeof(std::pair<const uint256, EntryList::iterator>) + sizeof(void*));
+
+    std::vector<Entry> vEvicted;
+    std::lock_guard<std::mutex> lock(cs);
+    if (nMaxUsage == 0) {
+        return;
+    }
+    auto it = mapEntries.find(hash);
+    if (it != mapEntries.end()) {
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+    entries.push_front(Entry{hash, block, nullptr, nEntryUsage});
+    mapEntries.emplace(hash, entries.begin());
+    nUsage += nEntryUsage;
+    Trim(vEvicted);
+}
+
+bool CBlockCache::RecordMiss(const uint256& hash)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (nMaxUsage == 0) {
+        return false;
+    }
+    auto it = std::find(recentMisses.begin(), recentMisses.end(), hash);
+    if (it != recentMisses.end()) {
+        recentMisses.erase(it);
+        return true;
+    }
+    recentMisses.push_front(hash);
+    if (recentMisses.size() > BLOCK_CACHE_RECENT_MISSES) {
+        recentMisses.pop_back();
+    }
+    return false;
+}
+
+void CBlockCache::Clear()
+{
+    EntryList cleared;
+    std::lock_guard<std::mutex> lock(cs);
+    cleared.swap(entries);
+    mapEntries.clear();
+    recentMisses.clear();
+    nUsage = 0;
+}
+
+size_t CBlockCache::Size() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return entries.size();
+}
+
+size_t CBlockCache::DynamicMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return nUsage;
+}
+
+void CBlockCache::Trim(std::vector<Entry>& vEvicted)
+{
+    // Evicted entries are handed back to the caller, so that the blocks they
+    // hold are freed after the lock is released.
+    while (nUsage > nMaxUsage && !entries.empty()) {
+        Entry& entry = entries.back();
+        mapEntries.erase(entry.hash);
+        nUsage -= entry.nUsage;
+        vEvicted.push_back(std::move(entry));
+        entries.pop_back();
+    }
+}
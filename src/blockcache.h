@@ -0,0 +1,103 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef ZCASH_BLOCKCACHE_H
+#define ZCASH_BLOCKCACHE_H
+
+#include "primitives/block.h"
+#include "uint256.h"
+
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/** Default for -blockcachesize, in MiB. */
+static const unsigned int DEFAULT_BLOCK_CACHE_SIZE = 32;
+/** Number of blocks read from disk that are remembered for admission. */
+static const size_t BLOCK_CACHE_RECENT_MISSES = 128;
+
+/**
+ * A memory-bounded cache of deserialized blocks, shared between everything
+ * that reads blocks: peers requesting them, the wallet and indexes catching
+ * up, ZMQ, REST and RPC. Blocks are immutable and identified by their hash,
+ * so entries never need to be invalidated; the least recently used entries
+ * are evicted when the cache is full.
+ *
+ * Blocks are added when they are connected, since they are then read by each
+ * of the above in turn. A block read from disk is only added if it was read
+ * once before within the last BLOCK_CACHE_RECENT_MISSES reads, so that a scan
+ * over the chain (a rescan, an index being built, a peer syncing from us)
+ * does not flush the blocks near the tip.
+ *
+ * The serialized block is kept alongside it once it has been asked for, for
+ * callers that would otherwise read the raw bytes from the block file.
+ */
+class CBlockCache
+{
+public:
+    typedef std::shared_ptr<const CBlock> BlockRef;
+    typedef std::shared_ptr<const std::vector<uint8_t>> RawBlockRef;
+
+    explicit CBlockCache(size_t nMaxUsageIn);
+
+    /** Set the memory limit in bytes, evicting entries if needed. Zero disables the cache. */
+    void SetMaxUsage(size_t nMaxUsageIn);
+
+    /** Return the block with the given hash, or nullptr if it is not cached. */
+    BlockRef Get(const uint256& hash);
+
+    /**
+     * Return the serialized block with the given hash, serializing and
+     * keeping it if only the block is cached, or nullptr if it is not cached.
+     */
+    RawBlockRef GetRaw(const uint256& hash);
+
+    /** Add a block, making it the most recently used entry. */
+    void Add(const BlockRef& block);
+
+    /**
+     * Record that the block with the given hash had to be read from disk.
+     * Returns true if it was read recently enough that it should be added.
+     */
+    bool RecordMiss(const uint256& hash);
+
+    void Clear();
+
+    size_t Size() const;
+    size_t DynamicMemoryUsage() const;
+
+private:
+    struct Entry
+    {
+        uint256 hash;
+        BlockRef block;
+        RawBlockRef raw;
+        size_t nUsage;
+    };
+
+    struct EntryHasher
+    {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    //! Evict least recently used entries into vEvicted until the cache is within its limit. Requires cs.
+    void Trim(std::vector<Entry>& vEvicted);
+
+    mutable std::mutex cs;
+    size_t nMaxUsage;
+    size_t nUsage;
+    //! Entries, most recently used first.
+    EntryList entries;
+    std::unordered_map<uint256, EntryList::iterator, EntryHasher> mapEntries;
+    //! Hashes of the blocks most recently read from disk and not added, newest first.
+    std::deque<uint256> recentMisses;
+};
+
+#endif // ZCASH_BLOCKCACHE_H
@@ -43,7 +43,7 @@ static CBlock CreateGenesisBlock(const char* pszTimestamp, const CScript& genesi
     genesis.nNonce   = nNonce;
     genesis.nSolution = nSolution;
     genesis.nVersion = nVersion;
-    genesis.vtx.push_back(txNew);
+    genesis.vtx.push_back(MakeTransactionRef(std::move(txNew)));
     genesis.hashPrevBlock.SetNull();
     genesis.hashMerkleRoot = BlockMerkleRoot(genesis);
     return genesis;
@@ -777,6 +777,11 @@ public:
         // Founders reward disabled for Zcents genesis.
         vFoundersRewardAddress.clear();
     }
+
+    void UpdateAssumeutxo(int nHeight, const uint256& hashSnapshot)
+    {
+        mapAssumeutxo[nHeight] = hashSnapshot;
+    }
 };
 
 static CRegTestParams regTestParams;
@@ -872,6 +877,11 @@ void UpdateOnetimeLockboxDisbursementParameters(
     regTestParams.UpdateOnetimeLockboxDisbursementParameters(idx, ld);
 }
 
+void UpdateRegtestAssumeutxo(int nHeight, const uint256& hashSnapshot)
+{
+    regTestParams.UpdateAssumeutxo(nHeight, hashSnapshot);
+}
+
 void UpdateRegtestPow(
     int64_t nPowMaxAdjustDown,
     int64_t nPowMaxAdjustUp,
@@ -35,6 +35,12 @@ struct CCheckpointData {
     double fTransactionsPerDay;
 };
 
+/**
+ * Hashes of the chainstate snapshots (as written by dumptxoutset) that may be
+ * loaded in place of validating the chain up to the snapshot's height.
+ */
+typedef std::map<int, uint256> MapAssumeutxo;
+
 /**
  * CChainParams defines various tweakable parameters of a given instance of the
  * Bitcoin system. There are three: the main network on which people trade goods
@@ -101,6 +107,7 @@ public:
     }
     const std::vector<SeedSpec6>& FixedSeeds() const { return vFixedSeeds; }
     const CCheckpointData& Checkpoints() const { return checkpointData; }
+    const MapAssumeutxo& Assumeutxo() const { return mapAssumeutxo; }
     /** Return the founder's reward address and script for a given block height */
     std::string GetFoundersRewardAddressAtHeight(int height) const;
     CScript GetFoundersRewardScriptAtHeight(int height) const;
@@ -127,6 +134,7 @@ protected:
     bool fMineBlocksOnDemand = false;
     bool fTestnetToBeDeprecatedFieldRPC = false;
     CCheckpointData checkpointData;
+    MapAssumeutxo mapAssumeutxo;
     std::vector<std::string> vFoundersRewardAddress;
 
     CAmount nSproutValuePoolCheckpointHeight = 0;
@@ -158,6 +166,11 @@ void SelectParams(const std::string& chain);
  */
 void UpdateNetworkUpgradeParameters(Consensus::UpgradeIndex idx, int nActivationHeight);
 
+/**
+ * Allows loading a chainstate snapshot with the given hash at the given height in regtest.
+ */
+void UpdateRegtestAssumeutxo(int nHeight, const uint256& hashSnapshot);
+
 void UpdateRegtestPow(
     int64_t nPowMaxAdjustDown,
     int64_t nPowMaxAdjustUp,
@@ -1023,6 +1023,25 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+void CCoinsViewCache::Reset() {
+    assert(!hasModifier);
+    hashBlock.SetNull();
+    hashSproutAnchor.SetNull();
+    hashSaplingAnchor.SetNull();
+    hashOrchardAnchor.SetNull();
+    cacheCoins.clear();
+    cacheSproutAnchors.clear();
+    cacheSaplingAnchors.clear();
+    cacheOrchardAnchors.clear();
+    cacheSproutNullifiers.clear();
+    cacheSaplingNullifiers.clear();
+    cacheOrchardNullifiers.clear();
+    historyCacheMap.clear();
+    cacheSaplingSubtrees.clear();
+    cacheOrchardSubtrees.clear();
+    cachedCoinsUsage = 0;
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
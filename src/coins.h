@@ -353,6 +353,7 @@ struct CCoinsStats
     uint64_t nTransactionOutputs;
     uint64_t nSerializedSize;
     uint256 hashSerialized;
+    uint256 hashMuHash;
     CAmount nTotalAmount;
 
     CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
@@ -740,6 +741,13 @@ public:
      */
     bool Flush();
 
+    /**
+     * Discard the state held by this cache without pushing it to its base,
+     * so that it is read from the base again. Used when the base has been
+     * replaced, as when a chainstate snapshot is loaded.
+     */
+    void Reset();
+
     //! Calculate the size of the cache (in number of transactions)
     unsigned int GetCacheSize() const;
 
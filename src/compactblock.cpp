@@ -0,0 +1,138 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "compactblock.h"
+
+#include "chain.h"
+
+#include <algorithm>
+#include <array>
+
+// Minimal protobuf encoding, covering the field types that compact blocks use.
+// Fields holding their default value (zero or empty) are omitted, as proto3
+// requires.
+
+enum ProtoWireType {
+    PROTO_VARINT = 0,
+    PROTO_LENGTH_DELIMITED = 2,
+};
+
+static void WriteVarint(std::vector<uint8_t>& out, uint64_t n)
+{
+    while (n >= 0x80) {
+        out.push_back((uint8_t)(n | 0x80));
+        n >>= 7;
+    }
+    out.push_back((uint8_t)n);
+}
+
+static void WriteTag(std::vector<uint8_t>& out, uint32_t nField, ProtoWireType type)
+{
+    WriteVarint(out, ((uint64_t)nField << 3) | type);
+}
+
+static void WriteUint(std::vector<uint8_t>& out, uint32_t nField, uint64_t n)
+{
+    if (n == 0)
+        return;
+    WriteTag(out, nField, PROTO_VARINT);
+    WriteVarint(out, n);
+}
+
+static void WriteBytes(std::vector<uint8_t>& out, uint32_t nField, const unsigned char* data, size_t nSize)
+{
+    if (nSize == 0)
+        return;
+    WriteTag(out, nField, PROTO_LENGTH_DELIMITED);
+    WriteVarint(out, nSize);
+    out.insert(out.end(), data, data + nSize);
+}
+
+static void WriteMessage(std::vector<uint8_t>& out, uint32_t nField, const std::vector<uint8_t>& msg)
+{
+    // Embedded messages are written even when empty, so that repeated
+    // fields keep their element count.
+    WriteTag(out, nField, PROTO_LENGTH_DELIMITED);
+    WriteVarint(out, msg.size());
+    out.insert(out.end(), msg.begin(), msg.end());
+}
+
+template<size_t N>
+static void WriteBytes(std::vector<uint8_t>& out, uint32_t nField, const std::array<unsigned char, N>& data, size_t nSize = N)
+{
+    WriteBytes(out, nField, data.data(), std::min(nSize, N));
+}
+
+static void WriteBytes(std::vector<uint8_t>& out, uint32_t nField, const uint256& hash)
+{
+    WriteBytes(out, nField, hash.begin(), hash.size());
+}
+
+static std::vector<uint8_t> CompactTx(const CTransaction& tx, uint64_t nIndex)
+{
+    std::vector<uint8_t> out;
+    WriteUint(out, 1, nIndex);             // index
+    WriteBytes(out, 2, tx.GetHash());      // hash
+    // The fee (field 3) is not known without the spent coins, and is omitted
+    // by lightwalletd as well.
+
+    for (const auto& spend : tx.GetSaplingSpends()) {
+        std::vector<uint8_t> msg;
+        WriteBytes(msg, 1, spend.nullifier());                        // nf
+        WriteMessage(out, 4, msg);                                    // spends
+    }
+    for (const auto& output : tx.GetSaplingOutputs()) {
+        std::vector<uint8_t> msg;
+        WriteBytes(msg, 1, output.cmu());                             // cmu
+        WriteBytes(msg, 2, output.ephemeral_key());                   // ephemeralKey
+        WriteBytes(msg, 3, output.enc_ciphertext(), COMPACT_NOTE_CIPHERTEXT_SIZE); // ciphertext
+        WriteMessage(out, 5, msg);                                    // outputs
+    }
+    for (const auto& action : tx.GetOrchardBundle().GetDetails()->actions()) {
+        std::vector<uint8_t> msg;
+        WriteBytes(msg, 1, action.nullifier());                       // nullifier
+        WriteBytes(msg, 2, action.cmx());                             // cmx
+        WriteBytes(msg, 3, action.ephemeral_key());                   // ephemeralKey
+        WriteBytes(msg, 4, action.enc_ciphertext(), COMPACT_NOTE_CIPHERTEXT_SIZE); // ciphertext
+        WriteMessage(out, 6, msg);                                    // actions
+    }
+    return out;
+}
+
+std::vector<uint8_t> BuildCompactBlock(
+    const CBlock& block,
+    const CBlockIndex* pindex,
+    uint64_t nSaplingTreeSize,
+    uint64_t nOrchardTreeSize)
+{
+    std::vector<uint8_t> out;
+    WriteUint(out, 1, COMPACT_BLOCK_PROTO_VERSION); // protoVersion
+    WriteUint(out, 2, pindex->nHeight);             // height
+    WriteBytes(out, 3, block.GetHash());            // hash
+    WriteBytes(out, 4, block.hashPrevBlock);        // prevHash
+    WriteUint(out, 5, block.nTime);                 // time
+    // The header (field 6) is not included, matching lightwalletd.
+
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (tx.GetSaplingSpendsCount() == 0 &&
+            tx.GetSaplingOutputsCount() == 0 &&
+            tx.GetOrchardBundle().GetNumActions() == 0) {
+            continue;
+        }
+        WriteMessage(out, 7, CompactTx(tx, i));     // vtx
+    }
+
+    std::vector<uint8_t> metadata;
+    WriteUint(metadata, 1, nSaplingTreeSize);       // saplingCommitmentTreeSize
+    WriteUint(metadata, 2, nOrchardTreeSize);       // orchardCommitmentTreeSize
+    WriteMessage(out, 8, metadata);                 // chainMetadata
+
+    return out;
+}
+
+void WriteCompactBlockLength(std::vector<uint8_t>& out, uint64_t nLength)
+{
+    WriteVarint(out, nLength);
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef ZCASH_COMPACTBLOCK_H
+#define ZCASH_COMPACTBLOCK_H
+
+#include "primitives/block.h"
+
+#include <cstdint>
+#include <vector>
+
+class CBlockIndex;
+
+/** Value of the protoVersion field of the compact blocks that are produced. */
+static const uint32_t COMPACT_BLOCK_PROTO_VERSION = 1;
+
+/** Number of bytes of each note ciphertext that is kept in a compact block. */
+static const size_t COMPACT_NOTE_CIPHERTEXT_SIZE = 52;
+
+/**
+ * Return the lightwalletd CompactBlock protobuf message (as defined in
+ * compact_formats.proto) for block, which is at pindex. As lightwalletd does,
+ * only transactions with Sapling spends or outputs, or Orchard actions, are
+ * included. The tree sizes are those of the note commitment trees after the
+ * block is connected.
+ */
+std::vector<uint8_t> BuildCompactBlock(
+    const CBlock& block,
+    const CBlockIndex* pindex,
+    uint64_t nSaplingTreeSize,
+    uint64_t nOrchardTreeSize);
+
+/** Append the length of a compact block, as a protobuf varint, to out. */
+void WriteCompactBlockLength(std::vector<uint8_t>& out, uint64_t nLength);
+
+#endif // ZCASH_COMPACTBLOCK_H
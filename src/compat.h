@@ -97,12 +97,18 @@ typedef int32_t ssize_t;
 #define THREAD_PRIORITY_ABOVE_NORMAL    (-2)
 #endif
 
+// On Linux, the P2P socket handler waits on sockets with epoll, and other
+// socket waits use poll(), so sockets are not limited to FD_SETSIZE.
+#if defined(HAVE_SYS_EPOLL_H) && !defined(WIN32)
+#define USE_EPOLL
+#endif
+
 #if HAVE_DECL_STRNLEN == 0
 size_t strnlen( const char *start, size_t max_len);
 #endif // HAVE_DECL_STRNLEN
 
 bool static inline IsSelectableSocket(SOCKET s) {
-#ifdef WIN32
+#if defined(WIN32) || defined(USE_EPOLL)
     return true;
 #else
     return (s < FD_SETSIZE);
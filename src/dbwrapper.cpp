@@ -13,15 +13,24 @@
 #include <leveldb/filter_policy.h>
 #include <memenv.h>
 #include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <sstream>
 
 #include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <rust/metrics.h>
+
+CDBCompactionManager dbcompaction;
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBTuning& tuning)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = leveldb::NewLRUCache(nCacheSize * tuning.nBlockCachePercent / 100);
+    options.write_buffer_size = nCacheSize * tuning.nWriteBufferPercent / 100; // up to two write buffers may be held in memory simultaneously
+    options.filter_policy = leveldb::NewBloomFilterPolicy(tuning.nBloomFilterBits);
     options.compression = leveldb::kNoCompression;
     options.max_open_files = 64;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
@@ -29,18 +38,22 @@ static leveldb::Options GetOptions(size_t nCacheSize)
         // on corruption in later versions.
         options.paranoid_checks = true;
     }
-    options.max_file_size = std::max(options.max_file_size, DBWRAPPER_MAX_FILE_SIZE);
+    options.max_file_size = std::max(options.max_file_size, tuning.nMaxFileSize);
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe)
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe,
+                       const CDBTuning& tuningIn) : psnapshot(NULL), tuning(tuningIn)
 {
     penv = NULL;
+    if (tuning.strName.empty()) {
+        tuning.strName = path.filename().string();
+    }
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, tuning);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -57,10 +70,28 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+    if (!fMemory) {
+        dbcompaction.Register(this);
+    }
+}
+
+CDBWrapper::CDBWrapper(const CDBWrapper& parent, const SnapshotTag&) :
+    penv(NULL), readoptions(parent.readoptions), iteroptions(parent.iteroptions),
+    pdb(parent.pdb), tuning(parent.tuning)
+{
+    psnapshot = pdb->GetSnapshot();
+    readoptions.snapshot = psnapshot;
+    iteroptions.snapshot = psnapshot;
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    if (psnapshot != NULL) {
+        // The database and its options belong to the parent.
+        pdb->ReleaseSnapshot(psnapshot);
+        return;
+    }
+    dbcompaction.Unregister(this);
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
@@ -73,6 +104,7 @@ CDBWrapper::~CDBWrapper()
 
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
+    assert(psnapshot == NULL);
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
     return true;
@@ -85,6 +117,108 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+bool CDBWrapper::GetLevelStats(std::vector<CDBLevelStats>& vStats) const
+{
+    std::string strStats;
+    if (!pdb->GetProperty("leveldb.stats", &strStats)) {
+        return false;
+    }
+    return dbwrapper_private::ParseLevelStats(strStats, vStats);
+}
+
+void CDBWrapper::CompactFull()
+{
+    pdb->CompactRange(NULL, NULL);
+}
+
+void CDBCompactionManager::Register(CDBWrapper* pdb)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    vDatabases.emplace_back(pdb, 0);
+}
+
+void CDBCompactionManager::Unregister(CDBWrapper* pdb)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    auto isDatabase = [pdb](const std::pair<CDBWrapper*, int>& entry) { return entry.first == pdb; };
+    // Only wait for this database; others may be opened, closed and
+    // compacted meanwhile.
+    cvCompacted.wait(lock, [&] {
+        auto it = std::find_if(vDatabases.begin(), vDatabases.end(), isDatabase);
+        return it == vDatabases.end() || it->second == 0;
+    });
+    vDatabases.erase(std::remove_if(vDatabases.begin(), vDatabases.end(), isDatabase), vDatabases.end());
+}
+
+void CDBCompactionManager::UpdateMetrics() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    for (const auto& entry : vDatabases) {
+        const CDBWrapper* pdb = entry.first;
+        std::vector<CDBLevelStats> vStats;
+        if (!pdb->GetLevelStats(vStats)) {
+            continue;
+        }
+        const std::string& strName = pdb->GetTuning().strName;
+        for (const CDBLevelStats& stats : vStats) {
+            std::string strLevel = std::to_string(stats.nLevel);
+            MetricsGauge("zcash.leveldb.files", stats.nFiles, "db", strName.c_str(), "level", strLevel.c_str());
+            MetricsGauge("zcash.leveldb.size.mb", stats.dSizeMB, "db", strName.c_str(), "level", strLevel.c_str());
+            MetricsGauge("zcash.leveldb.compaction.seconds", stats.dCompactionSeconds, "db", strName.c_str(), "level", strLevel.c_str());
+            MetricsGauge("zcash.leveldb.compaction.read.mb", stats.dReadMB, "db", strName.c_str(), "level", strLevel.c_str());
+            MetricsGauge("zcash.leveldb.compaction.written.mb", stats.dWriteMB, "db", strName.c_str(), "level", strLevel.c_str());
+        }
+    }
+}
+
+void CDBCompactionManager::CompactAfterIBD()
+{
+    // The lock is not held while a database is compacted, which can take
+    // minutes, so that metrics are still published and other databases can
+    // be opened and closed meanwhile.
+    std::vector<CDBWrapper*> vToCompact;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        for (const auto& entry : vDatabases) {
+            if (entry.first->GetTuning().fCompactAfterIBD) {
+                vToCompact.push_back(entry.first);
+            }
+        }
+    }
+
+    for (CDBWrapper* pdb : vToCompact) {
+        // Compacting a database cannot be interrupted, but we can stop
+        // between databases.
+        boost::this_thread::interruption_point();
+        {
+            // Skip a database that was closed since, and keep it open until
+            // it has been compacted otherwise.
+            std::lock_guard<std::mutex> lock(cs);
+            auto it = std::find_if(vDatabases.begin(), vDatabases.end(),
+                [pdb](const std::pair<CDBWrapper*, int>& entry) { return entry.first == pdb; });
+            if (it == vDatabases.end() || !pdb->GetTuning().fCompactAfterIBD) {
+                continue;
+            }
+            it->second++;
+        }
+        const std::string strName = pdb->GetTuning().strName;
+        LogPrintf("Compacting %s database\n", strName);
+        int64_t nStart = GetTimeMillis();
+        pdb->CompactFull();
+        LogPrintf("Compacted %s database in %dms\n", strName, GetTimeMillis() - nStart);
+        MetricsIncrementCounter("zcash.leveldb.compactions.full", "db", strName.c_str());
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            for (auto& entry : vDatabases) {
+                if (entry.first == pdb) {
+                    entry.second--;
+                }
+            }
+        }
+        cvCompacted.notify_all();
+    }
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
@@ -106,4 +240,26 @@ void HandleError(const leveldb::Status& status)
     throw dbwrapper_error("Unknown database error");
 }
 
+bool ParseLevelStats(const std::string& strStats, std::vector<CDBLevelStats>& vStats)
+{
+    vStats.clear();
+    std::istringstream ss(strStats);
+    std::string strLine;
+    bool fHeaderDone = false;
+    while (std::getline(ss, strLine)) {
+        if (!fHeaderDone) {
+            // The table follows a line of dashes.
+            fHeaderDone = !strLine.empty() && strLine.find_first_not_of('-') == std::string::npos;
+            continue;
+        }
+        CDBLevelStats stats;
+        if (sscanf(strLine.c_str(), "%d %d %lf %lf %lf %lf", &stats.nLevel, &stats.nFiles,
+                   &stats.dSizeMB, &stats.dCompactionSeconds, &stats.dReadMB, &stats.dWriteMB) != 6) {
+            return false;
+        }
+        vStats.push_back(stats);
+    }
+    return fHeaderDone;
+}
+
 };
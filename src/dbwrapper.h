@@ -16,9 +16,61 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 static const size_t DBWRAPPER_MAX_FILE_SIZE = 32 << 20; // 32 MiB
+/** Default for -dbcompactafteribd */
+static const bool DEFAULT_DB_COMPACT_AFTER_IBD = true;
+
+/**
+ * Per-database LevelDB settings. The cache given to a database is split
+ * between LevelDB's block cache and its write buffer, of which up to two may
+ * be held in memory at once. A larger write buffer means fewer, larger level
+ * 0 tables are written during bulk writes, and so fewer level 0 compactions.
+ */
+struct CDBTuning
+{
+    //! Name of the database in logs and metrics; defaults to its directory name.
+    std::string strName;
+    //! Share of the cache used as block cache, in percent.
+    int nBlockCachePercent = 50;
+    //! Share of the cache used by each write buffer, in percent.
+    int nWriteBufferPercent = 25;
+    int nBloomFilterBits = 10;
+    size_t nMaxFileSize = DBWRAPPER_MAX_FILE_SIZE;
+    //! Whether to compact the whole database once initial block download finishes.
+    bool fCompactAfterIBD = false;
+
+    CDBTuning() {}
+    explicit CDBTuning(const std::string& strNameIn) : strName(strNameIn) {}
+
+    /** Settings for databases that are written in large batches while syncing. */
+    static CDBTuning WriteHeavy(const std::string& strNameIn)
+    {
+        CDBTuning tuning(strNameIn);
+        tuning.nBlockCachePercent = 25;
+        tuning.nWriteBufferPercent = 37;
+        tuning.fCompactAfterIBD = true;
+        return tuning;
+    }
+};
+
+/** Per-level statistics reported by LevelDB's "leveldb.stats" property. */
+struct CDBLevelStats
+{
+    int nLevel;
+    int nFiles;
+    double dSizeMB;
+    //! Cumulative time spent compacting into this level, and the data read and written doing so.
+    double dCompactionSeconds;
+    double dReadMB;
+    double dWriteMB;
+};
 
 class dbwrapper_error : public std::runtime_error
 {
@@ -36,6 +88,9 @@ namespace dbwrapper_private {
  */
 void HandleError(const leveldb::Status& status);
 
+/** Parse the table reported by the "leveldb.stats" property. */
+bool ParseLevelStats(const std::string& strStats, std::vector<CDBLevelStats>& vStats);
+
 };
 
 /** Batch of changes queued to be written to a CDBWrapper */
@@ -53,6 +108,11 @@ public:
      */
     CDBBatch(const CDBWrapper &_parent) : parent(_parent) { };
 
+    void Clear()
+    {
+        batch.Clear();
+    }
+
     template <typename K, typename V>
     void Write(const K& key, const V& value)
     {
@@ -79,6 +139,19 @@ public:
 
         batch.Delete(slKey);
     }
+
+    //! Write or erase a key and value as they are stored, as read with
+    //! CDBIterator::GetKeyBytes and GetValueBytes.
+    void WriteBytes(const std::vector<unsigned char>& key, const std::vector<unsigned char>& value)
+    {
+        batch.Put(leveldb::Slice((const char*)key.data(), key.size()),
+                  leveldb::Slice((const char*)value.data(), value.size()));
+    }
+
+    void EraseBytes(const std::vector<unsigned char>& key)
+    {
+        batch.Delete(leveldb::Slice((const char*)key.data(), key.size()));
+    }
 };
 
 class CDBIterator
@@ -137,6 +210,17 @@ public:
         return piter->value().size();
     }
 
+    //! The key and value as they are stored, for copying entries verbatim.
+    std::vector<unsigned char> GetKeyBytes() {
+        leveldb::Slice slKey = piter->key();
+        return std::vector<unsigned char>(slKey.data(), slKey.data() + slKey.size());
+    }
+
+    std::vector<unsigned char> GetValueBytes() {
+        leveldb::Slice slValue = piter->value();
+        return std::vector<unsigned char>(slValue.data(), slValue.data() + slValue.size());
+    }
+
 };
 
 class CDBWrapper
@@ -163,14 +247,31 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! the snapshot read from, if this is a read-only view of another database
+    const leveldb::Snapshot* psnapshot;
+
+    //! settings the database was opened with
+    CDBTuning tuning;
+
 public:
+    //! Selects the constructor opening a snapshot of another database
+    struct SnapshotTag {};
+
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
      * @param[in] nCacheSize  Configures various leveldb cache settings.
      * @param[in] fMemory     If true, use leveldb's memory environment.
      * @param[in] fWipe       If true, remove all existing data.
+     * @param[in] tuningIn    How to split the cache, and whether to compact after IBD.
+     */
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false,
+               const CDBTuning& tuningIn = CDBTuning());
+
+    /**
+     * Open a read-only view of @p parent as it is now, which later writes to
+     * @p parent do not change. @p parent must outlive the view.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CDBWrapper(const CDBWrapper& parent, const SnapshotTag&);
     ~CDBWrapper();
 
     template <typename K, typename V>
@@ -256,7 +357,48 @@ public:
      * Return true if the database managed by this class contains no entries.
      */
     bool IsEmpty();
+
+    const CDBTuning& GetTuning() const { return tuning; }
+
+    /** Read LevelDB's per-level table and compaction statistics. */
+    bool GetLevelStats(std::vector<CDBLevelStats>& vStats) const;
+
+    /** Compact the whole database. This can take minutes on a large database. */
+    void CompactFull();
 };
 
+/**
+ * Tracks the open on-disk databases, so that their compaction statistics can
+ * be published as metrics, and so that those written in bulk during initial
+ * block download can be compacted once it finishes rather than leaving that
+ * work to stall writes later.
+ */
+class CDBCompactionManager
+{
+private:
+    mutable std::mutex cs;
+    //! Signalled when a database has been compacted.
+    std::condition_variable cvCompacted;
+    //! The open databases, in the order they were opened, each with the
+    //! number of compactions of it in progress. A database is not closed
+    //! while it is being compacted.
+    std::vector<std::pair<CDBWrapper*, int>> vDatabases;
+
+public:
+    void Register(CDBWrapper* pdb);
+    void Unregister(CDBWrapper* pdb);
+
+    /** Publish the statistics of every database as metrics. */
+    void UpdateMetrics() const;
+
+    /**
+     * Compact each database that asked to be compacted after initial block
+     * download. The calling thread may be interrupted between databases.
+     */
+    void CompactAfterIBD();
+};
+
+extern CDBCompactionManager dbcompaction;
+
 #endif // BITCOIN_DBWRAPPER_H
 
@@ -11,6 +11,7 @@ bool fExperimentalDeveloperSetPoolSizeZero = false;
 bool fExperimentalPaymentDisclosure = false;
 bool fExperimentalInsightExplorer = false;
 bool fExperimentalLightWalletd = false;
+bool fExperimentalAssumeUtxo = false;
 
 std::optional<std::string> InitExperimentalMode()
 {
@@ -20,6 +21,7 @@ std::optional<std::string> InitExperimentalMode()
     fExperimentalPaymentDisclosure = GetBoolArg("-paymentdisclosure", false);
     fExperimentalInsightExplorer = GetBoolArg("-insightexplorer", false);
     fExperimentalLightWalletd  = GetBoolArg("-lightwalletd", false);
+    fExperimentalAssumeUtxo = GetBoolArg("-assumeutxo", false);
 
     // Fail if user has set experimental options without the global flag
     if (!fExperimentalMode) {
@@ -33,6 +35,8 @@ std::optional<std::string> InitExperimentalMode()
             return _("Insight explorer requires -experimentalfeatures.");
         } else if (fExperimentalLightWalletd) {
             return _("Light Walletd requires -experimentalfeatures.");
+        } else if (fExperimentalAssumeUtxo) {
+            return _("Loading chainstate snapshots requires -experimentalfeatures.");
         }
     }
     return std::nullopt;
@@ -51,6 +55,8 @@ std::vector<std::string> GetExperimentalFeatures()
         experimentalfeatures.push_back("insightexplorer");
     if (fExperimentalLightWalletd)
         experimentalfeatures.push_back("lightwalletd");
+    if (fExperimentalAssumeUtxo)
+        experimentalfeatures.push_back("assumeutxo");
 
     return experimentalfeatures;
 }
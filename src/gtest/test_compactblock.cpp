@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include "chain.h"
+#include "compactblock.h"
+#include "primitives/block.h"
+#include "util/strencodings.h"
+
+TEST(CompactBlock, OmitsTransparentOnlyTransactions) {
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 0;
+
+    CBlock block;
+    block.hashPrevBlock = uint256S("01");
+    block.nTime = 1000;
+    block.vtx.push_back(MakeTransactionRef(mtx));
+
+    CBlockIndex index;
+    index.nHeight = 5;
+
+    auto hash = block.GetHash();
+    std::string expected =
+        "0801"                                          // protoVersion = 1
+        "1005"                                          // height = 5
+        "1a20" + HexStr(hash.begin(), hash.end()) +     // hash
+        "2220" + HexStr(block.hashPrevBlock.begin(), block.hashPrevBlock.end()) + // prevHash
+        "28e807"                                        // time = 1000
+        "420308ac02";                                   // chainMetadata { saplingCommitmentTreeSize = 300 }
+
+    auto compactBlock = BuildCompactBlock(block, &index, 300, 0);
+    EXPECT_EQ(HexStr(compactBlock.begin(), compactBlock.end()), expected);
+}
+
+TEST(CompactBlock, LengthIsVarint) {
+    std::vector<uint8_t> out;
+    WriteCompactBlockLength(out, 0x7f);
+    WriteCompactBlockLength(out, 300);
+    EXPECT_EQ(HexStr(out.begin(), out.end()), "7fac02");
+}
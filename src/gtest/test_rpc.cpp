@@ -107,3 +107,31 @@ TEST(rpc, ParseHeightArg) {
     ASSERT_THROW(parseHeightArg("-0x15", 21), UniValue);
     ASSERT_THROW(parseHeightArg("", 21), UniValue);
 }
+
+TEST(rpc, JSONRPCReplyStreamMatchesReply) {
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("hash", "00ab\"\\\n");
+    result.pushKV("height", 1391);
+    result.pushKV("flag", true);
+    result.pushKV("none", NullUniValue);
+    UniValue arr(UniValue::VARR);
+    for (int i = 0; i < 1000; i++) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("n", i);
+        entry.pushKV("empty", UniValue(UniValue::VARR));
+        arr.push_back(entry);
+    }
+    result.pushKV("entries", arr);
+    result.pushKV("obj", UniValue(UniValue::VOBJ));
+
+    for (size_t nChunkSize : {1, 100, 1 << 20}) {
+        std::string streamed;
+        size_t nChunks = 0;
+        JSONRPCReplyStream(result, UniValue(7), nChunkSize, [&](const std::string& chunk) {
+            streamed += chunk;
+            nChunks++;
+        });
+        EXPECT_EQ(JSONRPCReply(result, NullUniValue, UniValue(7)), streamed);
+        EXPECT_EQ(nChunkSize == (1 << 20), nChunks == 1);
+    }
+}
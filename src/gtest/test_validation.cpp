@@ -329,14 +329,14 @@ TEST(Validation, ReceivedBlockTransactions) {
 
     // Create a fake genesis block
     CBlock block1;
-    block1.vtx.push_back(GetValidSproutReceive(sk, 5, true));
+    block1.vtx.push_back(MakeTransactionRef(GetValidSproutReceive(sk, 5, true)));
     block1.hashMerkleRoot = BlockMerkleRoot(block1);
     CBlockIndex fakeIndex1 {block1};
 
     // Create a fake child block
     CBlock block2;
     block2.hashPrevBlock = block1.GetHash();
-    block2.vtx.push_back(GetValidSproutReceive(sk, 10, true));
+    block2.vtx.push_back(MakeTransactionRef(GetValidSproutReceive(sk, 10, true)));
     block2.hashMerkleRoot = BlockMerkleRoot(block2);
     CBlockIndex fakeIndex2 {block2};
     fakeIndex2.pprev = &fakeIndex1;
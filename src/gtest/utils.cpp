@@ -38,7 +38,6 @@ void LoadProofParameters() {
 #ifdef ENABLE_WALLET
 
 void LoadGlobalWallet() {
-    CCoinsViewDB *pcoinsdbview;
     bool fFirstRun;
 
     // someone else might have initialized the bitdb, and we need fDbEnvInit to be false for MakeMock
@@ -180,6 +180,19 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 
             UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
 
+            // Large results are written out in pieces as they are serialized,
+            // instead of first being built as one string.
+            const CRPCCommand *pcmd = tableRPC[jreq.strMethod];
+            if (pcmd && pcmd->streamReply) {
+                req->WriteHeader("Content-Type", "application/json");
+                req->WriteReplyStart(HTTP_OK);
+                JSONRPCReplyStream(result, jreq.id, JSONRPC_STREAM_CHUNK_SIZE, [req](const std::string& chunk) {
+                    req->WriteReplyChunk(chunk);
+                });
+                req->WriteReplyEnd();
+                return true;
+            }
+
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
 
@@ -13,7 +13,10 @@
 #include "sync.h"
 #include "ui_interface.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <deque>
+#include <mutex>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -40,6 +43,8 @@
 
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
+//! Maximum number of chunks of a streamed reply not yet written to the client
+static const int MAX_PENDING_REPLY_CHUNKS = 4;
 
 /** HTTP request work item */
 class HTTPWorkItem : public HTTPClosure
@@ -144,6 +149,8 @@ struct evhttp* eventHTTP = 0;
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Seconds a streamed reply waits for the client to read earlier chunks
+static int nReplyChunkTimeout = DEFAULT_HTTP_SERVER_TIMEOUT;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -394,7 +401,8 @@ bool InitHTTPServer()
         return false;
     }
 
-    evhttp_set_timeout(http, GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+    nReplyChunkTimeout = GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT);
+    evhttp_set_timeout(http, nReplyChunkTimeout);
     evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
     evhttp_set_max_body_size(http, MAX_SIZE);
     evhttp_set_gencb(http, http_request_cb, NULL);
@@ -520,12 +528,16 @@ void HTTPEvent::trigger(struct timeval* tv)
         evtimer_add(ev, tv); // trigger after timeval passed
 }
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
-                                                       replySent(false)
+                                                       replySent(false),
+                                                       replyStarted(false)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (replyStarted && !replySent) {
+        LogPrintf("%s: Unfinished streamed reply\n", __func__);
+        WriteReplyEnd();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
@@ -571,6 +583,72 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+/** Release a buffer added to an evbuffer by reference by WriteReplyFromFiles. */
+static void ReleaseReplyData(const void* data, size_t datalen, void* extra)
+{
+    delete static_cast<std::shared_ptr<const std::vector<uint8_t>>*>(extra);
+}
+
+void HTTPRequest::WriteReplyFromFiles(int nStatus, const std::vector<FileRange>& ranges)
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    bool fOk = true;
+    // Index of the first range whose descriptor has not been handed over to
+    // a file segment yet.
+    size_t nUnowned = 0;
+    while (nUnowned < ranges.size()) {
+        if (ranges[nUnowned].data) {
+            // The buffer holds a reference to the data until it is sent.
+            auto pdata = new std::shared_ptr<const std::vector<uint8_t>>(ranges[nUnowned].data);
+            fOk = evbuffer_add_reference(evb, (*pdata)->data(), (*pdata)->size(), ReleaseReplyData, pdata) == 0;
+            if (!fOk) {
+                delete pdata;
+                break;
+            }
+            nUnowned++;
+            continue;
+        }
+        // Consecutive ranges on the same descriptor are added from a single
+        // segment, which closes the descriptor once all of them are sent.
+        const int fd = ranges[nUnowned].fd;
+        size_t nEnd = nUnowned;
+        int64_t nBegin = ranges[nUnowned].nOffset;
+        int64_t nLast = nBegin;
+        for (; nEnd < ranges.size() && ranges[nEnd].fd == fd; nEnd++) {
+            nBegin = std::min(nBegin, ranges[nEnd].nOffset);
+            nLast = std::max(nLast, ranges[nEnd].nOffset + ranges[nEnd].nLength);
+        }
+        struct evbuffer_file_segment* seg = evbuffer_file_segment_new(fd, nBegin, nLast - nBegin, EVBUF_FS_CLOSE_ON_FREE);
+        if (!seg) {
+            fOk = false;
+            break;
+        }
+        for (size_t j = nUnowned; j < nEnd && fOk; j++) {
+            fOk = evbuffer_add_file_segment(evb, seg, ranges[j].nOffset - nBegin, ranges[j].nLength) == 0;
+        }
+        // Drop our reference; the buffer holds its own for every range added.
+        evbuffer_file_segment_free(seg);
+        nUnowned = nEnd;
+        if (!fOk)
+            break;
+    }
+    if (!fOk) {
+        LogPrintf("%s: adding the reply body failed\n", __func__);
+        for (size_t j = nUnowned; j < ranges.size(); j++) {
+            if (ranges[j].fd >= 0 && (j == nUnowned || ranges[j].fd != ranges[j - 1].fd))
+                close(ranges[j].fd);
+        }
+        // Draining releases the segments, which closes their descriptors, and
+        // the buffers added by reference.
+        evbuffer_drain(evb, evbuffer_get_length(evb));
+        WriteReply(HTTP_INTERNAL, "Failed to read block files");
+        return;
+    }
+    WriteReply(nStatus);
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -603,6 +681,110 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+/**
+ * Chunks of a streamed reply that have been queued but not yet written to the
+ * client. The worker producing the reply waits while too many are pending.
+ */
+struct HTTPReplyStream
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    //! Chunks queued by the worker and not yet written to the connection.
+    int nPending = 0;
+    //! Chunks handed to the connection since its output was last drained.
+    int nHanded = 0;
+    //! Set once the client has gone away or stopped reading.
+    bool fClosed = false;
+};
+
+/** Called on the main http thread when the connection's output buffer has been written out. */
+static void http_reply_chunk_drained_cb(struct evhttp_connection* conn, void* arg)
+{
+    HTTPReplyStream* stream = static_cast<HTTPReplyStream*>(arg);
+    std::lock_guard<std::mutex> lock(stream->cs);
+    stream->nPending -= stream->nHanded;
+    stream->nHanded = 0;
+    stream->cond.notify_all();
+}
+
+void HTTPRequest::WriteReplyStart(int nStatus)
+{
+    assert(!replySent && !replyStarted && req);
+    replyStream = std::make_shared<HTTPReplyStream>();
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+    });
+    ev->trigger(0);
+    replyStarted = true;
+}
+
+void HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(replyStarted && !replySent && req);
+    if (strChunk.empty())
+        return;
+    auto stream = replyStream;
+    {
+        std::unique_lock<std::mutex> lock(stream->cs);
+        // Wait for the client to read earlier chunks before queueing another.
+        if (!stream->cond.wait_for(lock, std::chrono::seconds(nReplyChunkTimeout), [&stream] {
+                return stream->fClosed || stream->nPending < MAX_PENDING_REPLY_CHUNKS;
+            })) {
+            LogPrint("http", "%s: client stopped reading a streamed reply\n", __func__);
+            stream->fClosed = true;
+        }
+        if (stream->fClosed)
+            return;
+        stream->nPending++;
+    }
+    // Events triggered from this thread run on the main http thread in the
+    // order they were triggered, so chunks are sent in order after the start.
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, evb, stream]{
+        std::unique_lock<std::mutex> lock(stream->cs);
+        if (!evhttp_request_get_connection(req_copy)) {
+            stream->fClosed = true;
+            stream->cond.notify_all();
+        } else {
+            stream->nHanded++;
+            lock.unlock();
+            // The connection calls back once its output has been written out.
+            // The stream outlives that, as it is also held by the event that
+            // ends the reply, which replaces the callback.
+            evhttp_send_reply_chunk_with_cb(req_copy, evb, http_reply_chunk_drained_cb, stream.get());
+        }
+        evbuffer_free(evb);
+    });
+    ev->trigger(0);
+}
+
+void HTTPRequest::WriteReplyEnd()
+{
+    assert(replyStarted && !replySent && req);
+    auto req_copy = req;
+    auto stream = std::move(replyStream);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, stream]{
+        evhttp_send_reply_end(req_copy);
+        // Re-enable reading from the socket, as in WriteReply.
+        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+            if (conn) {
+                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+                if (bev) {
+                    bufferevent_enable(bev, EV_READ | EV_WRITE);
+                }
+            }
+        }
+    });
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
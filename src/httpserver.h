@@ -9,6 +9,8 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -18,6 +20,7 @@ struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPReplyStream;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -114,6 +117,61 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     virtual void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * A range of an open file to be sent as part of a reply body, or, if data
+     * is set, bytes in memory to be sent instead (fd is then -1).
+     */
+    struct FileRange {
+        int fd;
+        int64_t nOffset;
+        int64_t nLength;
+        std::shared_ptr<const std::vector<uint8_t>> data;
+    };
+
+    /**
+     * Write HTTP reply with a body consisting of the given file ranges, in
+     * order. The data is handed to libevent by descriptor, which sends it with
+     * sendfile() or mmap() where available instead of copying it through a
+     * user-space buffer. Takes ownership of (and eventually closes) every
+     * descriptor in ranges. Consecutive ranges may share a descriptor, which
+     * is then closed once. Ranges in memory are added by reference, and are
+     * kept alive until they have been sent.
+     *
+     * @note Can be called only once, in place of WriteReply.
+     */
+    virtual void WriteReplyFromFiles(int nStatus, const std::vector<FileRange>& ranges);
+
+    /**
+     * Start a streamed HTTP reply with status nStatus. The body is sent in
+     * pieces with WriteReplyChunk, using chunked transfer encoding where the
+     * client supports it, and the reply is completed with WriteReplyEnd.
+     *
+     * @note Use this instead of WriteReply, after any calls to WriteHeader.
+     */
+    virtual void WriteReplyStart(int nStatus);
+
+    /**
+     * Send the next piece of a reply started with WriteReplyStart. Blocks
+     * while earlier pieces are still waiting to be written to the client, so
+     * that a slow client holds back the caller rather than letting the reply
+     * pile up in memory. Pieces are dropped once the client has gone away or
+     * stopped reading for the server timeout.
+     */
+    virtual void WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * Complete a reply started with WriteReplyStart.
+     *
+     * @note As with WriteReply, this gives the request back to the main
+     * thread; do not call any other HTTPRequest methods after calling this.
+     */
+    virtual void WriteReplyEnd();
+
+private:
+    bool replyStarted;
+    //! Flow control for a reply started with WriteReplyStart.
+    std::shared_ptr<HTTPReplyStream> replyStream;
 };
 
 /** Event handler closure.
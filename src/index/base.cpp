@@ -0,0 +1,392 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "index/base.h"
+
+#include "chainparams.h"
+#include "init.h"
+#include "main.h"
+#include "txdb.h"
+#include "ui_interface.h"
+#include "undo.h"
+#include "util/system.h"
+#include "warnings.h"
+
+static const char DB_BEST_BLOCK = 'B';
+static const char DB_LEGACY_MIGRATION = 'L';
+
+static const int64_t SYNC_LOG_INTERVAL = 30; // seconds
+
+/** Number of legacy entries moved per batch. */
+static const size_t LEGACY_MIGRATION_BATCH_SIZE = 10000;
+
+template<typename... Args>
+static void FatalError(const char* fmt, const Args&... args)
+{
+    std::string strMessage = tfm::format(fmt, args...);
+    SetMiscWarning(strMessage, GetTime());
+    LogError("index", "*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(
+        strprintf(_("Error: A fatal internal error occurred, see %s for details"), GetDebugLogPath()),
+        "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+}
+
+BaseIndex::DB::DB(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe) :
+    CDBWrapper(path, nCacheSize, fMemory, fWipe, CDBTuning::WriteHeavy(path.filename().string()))
+{}
+
+bool BaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
+{
+    bool success = Read(DB_BEST_BLOCK, locator);
+    if (!success) {
+        locator.SetNull();
+    }
+    return success;
+}
+
+BaseIndex::~BaseIndex()
+{
+    Interrupt();
+    Stop();
+}
+
+bool BaseIndex::Init()
+{
+    CBlockLocator locator;
+    GetDB().ReadBestBlock(locator);
+
+    LOCK(cs_main);
+    const std::vector<char> prefixes = GetLegacyPrefixes();
+    if (!prefixes.empty()) {
+        uint256 hashLegacyBest;
+        if (GetDB().Exists(DB_LEGACY_MIGRATION)) {
+            m_legacy_copy = true;
+        } else if (pblocktree->HasLegacyIndexEntries(prefixes)) {
+            if (locator.IsNull() && pblocktree->ReadLegacyIndexBestBlock(hashLegacyBest) &&
+                mapBlockIndex.count(hashLegacyBest)) {
+                // Take over the entries written by an older version instead
+                // of building the index again, starting from the block they
+                // are in sync with.
+                locator = chainActive.GetLocator(mapBlockIndex[hashLegacyBest]);
+                CDBBatch batch(GetDB());
+                batch.Write(DB_BEST_BLOCK, locator);
+                batch.Write(DB_LEGACY_MIGRATION, '1');
+                if (!GetDB().WriteBatch(batch, true)) {
+                    return error("%s: Failed to start copying the legacy entries of %s", __func__, GetName());
+                }
+                m_legacy_copy = true;
+            } else {
+                m_legacy_copy = false;
+            }
+        }
+    }
+
+    if (locator.IsNull()) {
+        m_best_block_index = nullptr;
+    } else if (mapBlockIndex.count(locator.vHave[0])) {
+        // Resume from the block the index was written for, even if a reorg
+        // while we were down took it off the active chain; ThreadSync then
+        // rewinds the index to the fork point.
+        m_best_block_index = mapBlockIndex[locator.vHave[0]];
+    } else {
+        m_best_block_index = FindForkInGlobalIndex(chainActive, locator);
+    }
+    m_synced = !m_legacy_copy.value_or(false) && m_best_block_index.load() == chainActive.Tip();
+    return true;
+}
+
+bool BaseIndex::ReadBlockUndo(const CBlock& block, const CBlockIndex* pindex, CBlockUndo& blockundo)
+{
+    CBlockFileReader reader;
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        pos = pindex->GetUndoPos();
+    }
+    if (pos.IsNull() || !UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash())) {
+        return error("%s: Failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: Block %s and undo data inconsistent", __func__, pindex->GetBlockHash().ToString());
+    }
+    return true;
+}
+
+bool BaseIndex::MigrateLegacyData()
+{
+    const bool fCopy = *m_legacy_copy;
+    size_t nMoved = 0;
+    for (char prefix : GetLegacyPrefixes()) {
+        std::unique_ptr<CDBIterator> pcursor(pblocktree->NewIterator());
+        CDBBatch batch(GetDB());
+        CDBBatch batchLegacy(*pblocktree);
+        // The entries are written to the index before they are erased from
+        // the block index database, so an interrupted copy is resumed.
+        auto flush = [&]() {
+            if (fCopy && !GetDB().WriteBatch(batch)) {
+                return false;
+            }
+            if (!pblocktree->WriteBatch(batchLegacy)) {
+                return false;
+            }
+            batch.Clear();
+            batchLegacy.Clear();
+            return true;
+        };
+
+        pcursor->Seek(prefix);
+        size_t nBatch = 0;
+        while (pcursor->Valid()) {
+            std::vector<unsigned char> key = pcursor->GetKeyBytes();
+            if (key.empty() || key[0] != (unsigned char)prefix) {
+                break;
+            }
+            if (fCopy) {
+                batch.WriteBytes(key, pcursor->GetValueBytes());
+            }
+            batchLegacy.EraseBytes(key);
+            nMoved++;
+            pcursor->Next();
+
+            if (++nBatch == LEGACY_MIGRATION_BATCH_SIZE) {
+                if (!flush()) {
+                    return error("%s: Failed to move the legacy entries of %s", __func__, GetName());
+                }
+                nBatch = 0;
+                if (m_interrupt || ShutdownRequested()) {
+                    LogPrintf("%s: %s is interrupted after moving %u legacy entries\n", __func__, GetName(), nMoved);
+                    return true;
+                }
+            }
+        }
+        if (!flush()) {
+            return error("%s: Failed to move the legacy entries of %s", __func__, GetName());
+        }
+    }
+
+    if (fCopy) {
+        if (!FinishLegacyMigration() || !GetDB().Erase(DB_LEGACY_MIGRATION, true)) {
+            return error("%s: Failed to finish copying the legacy entries of %s", __func__, GetName());
+        }
+    }
+    if (!pblocktree->HasLegacyIndexEntries()) {
+        pblocktree->EraseLegacyIndexBestBlock();
+    }
+    LogPrintf("%s: %s %u entries from the block index database into %s\n", __func__,
+        fCopy ? "copied" : "erased", nMoved, GetName());
+    m_legacy_copy.reset();
+    return true;
+}
+
+bool BaseIndex::Commit(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(GetDB());
+    if (!WriteBlock(batch, block, pindex)) {
+        return false;
+    }
+    {
+        LOCK(cs_main);
+        batch.Write(DB_BEST_BLOCK, chainActive.GetLocator(pindex));
+    }
+    return GetDB().WriteBatch(batch);
+}
+
+bool BaseIndex::Uncommit(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(GetDB());
+    if (!EraseBlock(batch, block, pindex)) {
+        return false;
+    }
+    if (pindex->pprev) {
+        LOCK(cs_main);
+        batch.Write(DB_BEST_BLOCK, chainActive.GetLocator(pindex->pprev));
+    } else {
+        batch.Erase(DB_BEST_BLOCK);
+    }
+    return GetDB().WriteBatch(batch);
+}
+
+void BaseIndex::ThreadSync()
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    if (m_legacy_copy) {
+        if (!MigrateLegacyData()) {
+            FatalError("%s: Failed to move the legacy entries of %s", __func__, GetName());
+            return;
+        }
+        if (m_legacy_copy) {
+            return;
+        }
+    }
+
+    const CBlockIndex* pindex = m_best_block_index.load();
+    if (!m_synced) {
+        int64_t nLastLogTime = 0;
+        while (true) {
+            if (m_interrupt || ShutdownRequested()) {
+                LogPrintf("%s: %s is interrupted at height %d\n", __func__, GetName(), pindex ? pindex->nHeight : -1);
+                return;
+            }
+
+            // Step back off any blocks that a reorg has disconnected since we
+            // indexed them, then forward along the active chain.
+            bool fDisconnected = false;
+            {
+                LOCK(cs_main);
+                if (pindex && !chainActive.Contains(pindex)) {
+                    fDisconnected = true;
+                } else {
+                    const CBlockIndex* pindexNext = pindex ? chainActive.Next(pindex) : chainActive.Genesis();
+                    if (!pindexNext) {
+                        m_best_block_index = pindex;
+                        m_synced = true;
+                        break;
+                    }
+                    pindex = pindexNext;
+                }
+            }
+
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, consensusParams)) {
+                FatalError("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+                return;
+            }
+            if (fDisconnected) {
+                if (!Uncommit(block, pindex)) {
+                    FatalError("%s: Failed to rewind index %s past block %s", __func__, GetName(), pindex->GetBlockHash().ToString());
+                    return;
+                }
+                pindex = pindex->pprev;
+            } else if (!Commit(block, pindex)) {
+                FatalError("%s: Failed to write block %s to index %s", __func__, pindex->GetBlockHash().ToString(), GetName());
+                return;
+            }
+            m_best_block_index = pindex;
+
+            int64_t nNow = GetTime();
+            if (nLastLogTime + SYNC_LOG_INTERVAL < nNow) {
+                LogPrintf("Syncing %s with block chain from height %d\n", GetName(), pindex ? pindex->nHeight : -1);
+                nLastLogTime = nNow;
+            }
+        }
+    }
+
+    if (pindex) {
+        LogPrintf("%s is enabled at height %d\n", GetName(), pindex->nHeight);
+    } else {
+        LogPrintf("%s is enabled\n", GetName());
+    }
+}
+
+void BaseIndex::BlockConnected(const CBlockIndex *pindex)
+{
+    if (!m_synced) {
+        return;
+    }
+
+    const CBlockIndex* pindexBest = m_best_block_index.load();
+    if (pindexBest && pindexBest->GetAncestor(pindex->nHeight) == pindex) {
+        // The sync thread indexed this block before the notification was
+        // processed.
+        return;
+    }
+    if (pindexBest ? pindex->pprev != pindexBest : pindex->nHeight != 0) {
+        // This can happen just after the sync thread catches up, if blocks
+        // of a branch it has already stepped off are still queued.
+        LogPrintf("%s: WARNING: Block %s does not connect to the best block of %s (%s); not updating index\n",
+            __func__, pindex->GetBlockHash().ToString(), GetName(),
+            pindexBest ? pindexBest->GetBlockHash().ToString() : "none");
+        return;
+    }
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+        FatalError("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        return;
+    }
+    if (!Commit(block, pindex)) {
+        FatalError("%s: Failed to write block %s to index %s", __func__, pindex->GetBlockHash().ToString(), GetName());
+        return;
+    }
+    m_best_block_index = pindex;
+}
+
+void BaseIndex::BlockDisconnected(const CBlockIndex *pindex)
+{
+    if (!m_synced || pindex != m_best_block_index.load()) {
+        return;
+    }
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+        FatalError("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        return;
+    }
+    if (!Uncommit(block, pindex)) {
+        FatalError("%s: Failed to rewind index %s past block %s", __func__, GetName(), pindex->GetBlockHash().ToString());
+        return;
+    }
+    m_best_block_index = pindex->pprev;
+}
+
+bool BaseIndex::BlockUntilSyncedToCurrentChain()
+{
+    AssertLockNotHeld(cs_main);
+
+    if (!m_synced) {
+        return false;
+    }
+
+    {
+        // Skip the queue-draining stuff if we know we're caught up with
+        // chainActive.Tip().
+        LOCK(cs_main);
+        const CBlockIndex* pindexTip = chainActive.Tip();
+        const CBlockIndex* pindexBest = m_best_block_index.load();
+        if (pindexTip && pindexBest && pindexBest->GetAncestor(pindexTip->nHeight) == pindexTip) {
+            return true;
+        }
+    }
+
+    LogPrintf("%s: %s is catching up on block notifications\n", __func__, GetName());
+    SyncWithValidationInterfaceQueue();
+    return true;
+}
+
+int BaseIndex::GetBestHeight() const
+{
+    const CBlockIndex* pindexBest = m_best_block_index.load();
+    return pindexBest ? pindexBest->nHeight : -1;
+}
+
+void BaseIndex::Interrupt()
+{
+    m_interrupt = true;
+}
+
+bool BaseIndex::Start()
+{
+    // Need to register this ValidationInterface before running Init(), so that
+    // callbacks are not missed if Init sets m_synced to true.
+    RegisterValidationInterfaceAsync(this);
+    if (!Init()) {
+        FatalError("%s: %s failed to initialize", __func__, GetName());
+        return false;
+    }
+
+    m_thread_sync = std::thread(&TraceThread<std::function<void()>>, GetName(),
+        std::function<void()>([this] { ThreadSync(); }));
+    return true;
+}
+
+void BaseIndex::Stop()
+{
+    UnregisterValidationInterface(this);
+
+    if (m_thread_sync.joinable()) {
+        m_thread_sync.join();
+    }
+}
@@ -0,0 +1,143 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_INDEX_BASE_H
+#define BITCOIN_INDEX_BASE_H
+
+#include "dbwrapper.h"
+#include "primitives/block.h"
+#include "validationinterface.h"
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CBlockIndex;
+class CBlockUndo;
+
+/**
+ * Base class for indexes of blockchain data that are kept in their own
+ * database. An index records the block it is synced to, so it can be enabled
+ * at any time: on startup it catches up with the active chain in a background
+ * thread, reading blocks from disk, and then follows the tip through
+ * BlockConnected and BlockDisconnected notifications. Index entries and the
+ * best block locator are written in the same batch, so the index is always
+ * consistent with the block it records.
+ *
+ * Indexes that older versions kept in the block index database copy those
+ * entries into their own database in the background, before catching up.
+ */
+class BaseIndex : public CValidationInterface
+{
+protected:
+    class DB : public CDBWrapper
+    {
+    public:
+        DB(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+        /// Read the locator of the block that the index is in sync with.
+        bool ReadBestBlock(CBlockLocator& locator) const;
+    };
+
+private:
+    /// Whether the index is in sync with the main chain. The flag is flipped
+    /// from false to true once, after which notifications update the index.
+    std::atomic<bool> m_synced{false};
+
+    /// The last block in the chain that the index is in sync with.
+    std::atomic<const CBlockIndex*> m_best_block_index{nullptr};
+
+    std::thread m_thread_sync;
+    std::atomic<bool> m_interrupt{false};
+
+    /// Set if entries of this index that older versions kept in the block
+    /// index database are left there: true if they are still to be copied
+    /// into the index, false if the index was built without them and they
+    /// only need to be erased.
+    std::optional<bool> m_legacy_copy;
+
+    /// Move the entries under GetLegacyPrefixes() out of the block index
+    /// database, copying them into this index if m_legacy_copy is true.
+    /// Returns early, leaving m_legacy_copy set, if interrupted.
+    bool MigrateLegacyData();
+
+    /// Sync the index with the block index starting from the current best
+    /// block. Intended to be run in its own thread, m_thread_sync.
+    void ThreadSync();
+
+    /// Write the index entries for a block and advance the best block
+    /// locator to it, in one batch.
+    bool Commit(const CBlock& block, const CBlockIndex* pindex);
+
+    /// Undo the index entries for the best block, and move the best block
+    /// locator back to its parent, in one batch.
+    bool Uncommit(const CBlock& block, const CBlockIndex* pindex);
+
+protected:
+    void BlockConnected(const CBlockIndex *pindex) override;
+    void BlockDisconnected(const CBlockIndex *pindex) override;
+
+    /// Initialize internal state from the database and block index.
+    virtual bool Init();
+
+    /// Add the index entries for a block to the batch.
+    virtual bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) = 0;
+
+    /// Add the removal of the index entries for a block that is being
+    /// disconnected from the active chain to the batch. Indexes whose entries
+    /// stay valid for blocks outside the active chain can leave this as is.
+    virtual bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) { return true; }
+
+    virtual DB& GetDB() const = 0;
+
+    /// Key prefixes under which older versions kept the entries of this index
+    /// in the block index database. The entries are copied verbatim, so the
+    /// index must keep them under the same keys.
+    virtual std::vector<char> GetLegacyPrefixes() const { return {}; }
+
+    /// Called once the legacy entries have been copied into the index, before
+    /// it catches up with the chain.
+    virtual bool FinishLegacyMigration() { return true; }
+
+    /// Read the undo data of a block, for indexes of the outputs it spends.
+    static bool ReadBlockUndo(const CBlock& block, const CBlockIndex* pindex, CBlockUndo& blockundo);
+
+    /// The last block that the index is in sync with, or nullptr.
+    const CBlockIndex* CurrentIndex() const { return m_best_block_index.load(); }
+
+    /// Get the name of the index for display in logs.
+    virtual const char* GetName() const = 0;
+
+public:
+    /// Destructor interrupts sync thread if running and blocks until it exits.
+    virtual ~BaseIndex();
+
+    /// Blocks the current thread until the index is caught up to the current
+    /// state of the block chain. This only blocks if the index has gotten in
+    /// sync once and only needs to process blocks in the validation interface
+    /// queue. If the index is catching up from far behind, this method does
+    /// not block and immediately returns false. Must not be called with
+    /// cs_main held.
+    bool BlockUntilSyncedToCurrentChain();
+
+    /// Whether the index has caught up with the active chain.
+    bool IsSynced() const { return m_synced; }
+
+    /// The height of the last block that the index is in sync with, or -1.
+    int GetBestHeight() const;
+
+    void Interrupt();
+
+    /// Start initializes the sync state and registers the instance as a
+    /// ValidationInterface so that it stays in sync with blockchain updates.
+    bool Start();
+
+    /// Stops the instance from staying in sync with blockchain updates.
+    void Stop();
+};
+
+#endif // BITCOIN_INDEX_BASE_H
@@ -0,0 +1,211 @@
+// Copyright (c) 2020-2021 The Bitcoin Core developers
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "index/coinstatsindex.h"
+
+#include "coins.h"
+#include "main.h"
+#include "undo.h"
+#include "util/system.h"
+
+static const char DB_BLOCK_HEIGHT = 't';
+static const char DB_MUHASH = 'M';
+
+std::unique_ptr<CoinStatsIndex> g_coinstatsindex;
+
+namespace {
+
+/** The statistics recorded for each block of the active chain. */
+struct DBVal {
+    uint256 hashBlock;
+    uint256 muhash;
+    uint64_t transaction_output_count;
+    CAmount total_amount;
+
+    DBVal() : transaction_output_count(0), total_amount(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashBlock);
+        READWRITE(muhash);
+        READWRITE(transaction_output_count);
+        READWRITE(total_amount);
+    }
+};
+
+/** The MuHash element for an unspent output is its outpoint and txout. */
+void ApplyCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const CTxOut& txout, bool fInsert)
+{
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << outpoint << txout;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(ss.data());
+    if (fInsert) {
+        muhash.Insert(data, ss.size());
+    } else {
+        muhash.Remove(data, ss.size());
+    }
+}
+
+} // anon namespace
+
+/**
+ * Access to the coinstats index database (indexes/coinstats/)
+ *
+ * The database stores the statistics of every block of the active chain by
+ * height, along with the running MuHash of the best block, which cannot be
+ * recovered from its finalized hash.
+ */
+class CoinStatsIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    bool ReadStats(int nHeight, DBVal& val) const;
+};
+
+CoinStatsIndex::DB::DB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "coinstats", nCacheSize, fMemory, fWipe)
+{}
+
+bool CoinStatsIndex::DB::ReadStats(int nHeight, DBVal& val) const
+{
+    return Read(std::make_pair(DB_BLOCK_HEIGHT, nHeight), val);
+}
+
+CoinStatsIndex::CoinStatsIndex(size_t nCacheSize, bool fMemory, bool fWipe)
+    : m_db(new CoinStatsIndex::DB(nCacheSize, fMemory, fWipe))
+{}
+
+CoinStatsIndex::~CoinStatsIndex() {}
+
+bool CoinStatsIndex::Init()
+{
+    if (!BaseIndex::Init()) {
+        return false;
+    }
+
+    const CBlockIndex* pindex = CurrentIndex();
+    if (!pindex) {
+        return true;
+    }
+
+    DBVal val;
+    if (!m_db->Read(DB_MUHASH, m_muhash) || !m_db->ReadStats(pindex->nHeight, val) ||
+        val.hashBlock != pindex->GetBlockHash()) {
+        return error("%s: Cannot read the statistics of best block %s; the index may be corrupted",
+            __func__, pindex->GetBlockHash().ToString());
+    }
+
+    uint256 muhash;
+    m_muhash.Finalize(muhash);
+    if (muhash != val.muhash) {
+        return error("%s: The running MuHash does not match best block %s; the index may be corrupted",
+            __func__, pindex->GetBlockHash().ToString());
+    }
+    m_transaction_output_count = val.transaction_output_count;
+    m_total_amount = val.total_amount;
+    return true;
+}
+
+bool CoinStatsIndex::ApplyBlock(const CBlock& block, const CBlockIndex* pindex, bool fConnect)
+{
+    // The outputs of the genesis block are not added to the UTXO set.
+    if (pindex->nHeight == 0) {
+        return true;
+    }
+
+    CBlockUndo blockundo;
+    if (!ReadBlockUndo(block, pindex, blockundo)) {
+        return false;
+    }
+
+    // Connecting inserts the outputs a block creates and removes the ones it
+    // spends; disconnecting does the opposite. Outputs created and spent in
+    // the same block cancel out either way.
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+        for (size_t j = 0; j < tx.vout.size(); j++) {
+            const CTxOut& out = tx.vout[j];
+            if (out.scriptPubKey.IsUnspendable()) {
+                continue;
+            }
+            ApplyCoinHash(m_muhash, COutPoint(txid, j), out, fConnect);
+            if (fConnect) {
+                m_transaction_output_count++;
+                m_total_amount += out.nValue;
+            } else {
+                m_transaction_output_count--;
+                m_total_amount -= out.nValue;
+            }
+        }
+
+        if (i == 0) {
+            continue;
+        }
+        const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+        if (txundo.vprevout.size() != tx.vin.size()) {
+            return error("%s: Transaction %s and undo data inconsistent", __func__, txid.ToString());
+        }
+        for (size_t j = 0; j < tx.vin.size(); j++) {
+            const CTxOut& prev = txundo.vprevout[j].txout;
+            ApplyCoinHash(m_muhash, tx.vin[j].prevout, prev, !fConnect);
+            if (fConnect) {
+                m_transaction_output_count--;
+                m_total_amount -= prev.nValue;
+            } else {
+                m_transaction_output_count++;
+                m_total_amount += prev.nValue;
+            }
+        }
+    }
+    return true;
+}
+
+bool CoinStatsIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    if (!ApplyBlock(block, pindex, true)) {
+        return false;
+    }
+
+    DBVal val;
+    val.hashBlock = pindex->GetBlockHash();
+    m_muhash.Finalize(val.muhash);
+    val.transaction_output_count = m_transaction_output_count;
+    val.total_amount = m_total_amount;
+    batch.Write(std::make_pair(DB_BLOCK_HEIGHT, pindex->nHeight), val);
+    batch.Write(DB_MUHASH, m_muhash);
+    return true;
+}
+
+bool CoinStatsIndex::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    if (!ApplyBlock(block, pindex, false)) {
+        return false;
+    }
+
+    batch.Erase(std::make_pair(DB_BLOCK_HEIGHT, pindex->nHeight));
+    batch.Write(DB_MUHASH, m_muhash);
+    return true;
+}
+
+BaseIndex::DB& CoinStatsIndex::GetDB() const { return *m_db; }
+
+bool CoinStatsIndex::LookUpStats(const CBlockIndex* pindex, CCoinsStats& stats) const
+{
+    DBVal val;
+    if (!m_db->ReadStats(pindex->nHeight, val) || val.hashBlock != pindex->GetBlockHash()) {
+        return false;
+    }
+
+    stats.nHeight = pindex->nHeight;
+    stats.hashBlock = val.hashBlock;
+    stats.nTransactionOutputs = val.transaction_output_count;
+    stats.nTotalAmount = val.total_amount;
+    stats.hashMuHash = val.muhash;
+    return true;
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2020-2021 The Bitcoin Core developers
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_INDEX_COINSTATSINDEX_H
+#define BITCOIN_INDEX_COINSTATSINDEX_H
+
+#include "amount.h"
+#include "crypto/muhash.h"
+#include "index/base.h"
+
+#include <memory>
+
+struct CCoinsStats;
+
+/**
+ * CoinStatsIndex maintains statistics on the UTXO set as of every block of
+ * the active chain (indexes/coinstats/): the number of unspent transparent
+ * outputs, their total value, and a MuHash3072 multiset hash over them. The
+ * running hash is updated from each block and its undo data, with an output
+ * inserted when it is created and removed when it is spent, so looking up the
+ * statistics does not need to scan the chain state.
+ */
+class CoinStatsIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// Running statistics as of the best block of the index.
+    MuHash3072 m_muhash;
+    uint64_t m_transaction_output_count{0};
+    CAmount m_total_amount{0};
+
+    /// Apply the outputs created and spent by a block to the running
+    /// statistics, or revert them if fConnect is false.
+    bool ApplyBlock(const CBlock& block, const CBlockIndex* pindex, bool fConnect);
+
+protected:
+    bool Init() override;
+
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "coinstatsindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit CoinStatsIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~CoinStatsIndex() override;
+
+    /// Look up the UTXO set statistics as of a block of the active chain.
+    /// Fills in the height, block hash, output count, total amount and
+    /// MuHash of stats. Returns false if the block has not been indexed.
+    bool LookUpStats(const CBlockIndex* pindex, CCoinsStats& stats) const;
+};
+
+/// The global UTXO set statistics index. May be null.
+extern std::unique_ptr<CoinStatsIndex> g_coinstatsindex;
+
+#endif // BITCOIN_INDEX_COINSTATSINDEX_H
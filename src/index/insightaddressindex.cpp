@@ -0,0 +1,587 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "index/insightaddressindex.h"
+
+#include "main.h"
+#include "undo.h"
+#include "util/system.h"
+
+#include <map>
+#include <set>
+#include <tuple>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+using namespace std;
+
+static const char DB_ADDRESSINDEX = 'd';
+static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSBALANCE = 'v';
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+/**
+ * Access to the address index database (indexes/address/)
+ *
+ * The keys are those that the index was kept under in the block index
+ * database, so the entries written by older versions can be copied over.
+ */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    void WriteAddressIndex(CDBBatch &batch, const std::vector<CAddressIndexDbEntry> &vect);
+    void EraseAddressIndex(CDBBatch &batch, const std::vector<CAddressIndexDbEntry> &vect);
+    void UpdateAddressUnspentIndex(CDBBatch &batch, const std::vector<CAddressUnspentDbEntry> &vect);
+    bool ReadAddressIndex(const uint160& addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0);
+    bool ReadAddressUnspentIndex(const uint160& addressHash, int type, std::vector<CAddressUnspentDbEntry> &vect);
+    bool ReadAddressBalance(const uint160& addressHash, int type, CAddressBalanceValue &value) const;
+    //! Compute the address balances from the address index
+    bool BuildAddressBalanceIndex();
+
+private:
+    //! Apply the balance changes of address index entries being written or erased
+    void UpdateAddressBalances(CDBBatch &batch, const std::vector<CAddressIndexDbEntry> &vect, bool fErase);
+};
+
+AddressIndex::DB::DB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "address", nCacheSize, fMemory, fWipe)
+{}
+
+// https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-81e4f16a1b5d5b7ca25351a63d07cb80R183
+void AddressIndex::DB::UpdateAddressUnspentIndex(CDBBatch &batch, const std::vector<CAddressUnspentDbEntry> &vect)
+{
+    for (std::vector<CAddressUnspentDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+        } else {
+            batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+        }
+    }
+}
+
+bool AddressIndex::DB::ReadAddressUnspentIndex(const uint160& addressHash, int type, std::vector<CAddressUnspentDbEntry> &unspentOutputs)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressUnspentKey> key;
+        if (!(pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash))
+            break;
+        CAddressUnspentValue nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address unspent value");
+        unspentOutputs.push_back(make_pair(key.second, nValue));
+        pcursor->Next();
+    }
+    return true;
+}
+
+void AddressIndex::DB::WriteAddressIndex(CDBBatch &batch, const std::vector<CAddressIndexDbEntry> &vect) {
+    UpdateAddressBalances(batch, vect, false);
+    for (std::vector<CAddressIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+}
+
+void AddressIndex::DB::EraseAddressIndex(CDBBatch &batch, const std::vector<CAddressIndexDbEntry> &vect) {
+    UpdateAddressBalances(batch, vect, true);
+    for (std::vector<CAddressIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
+}
+
+void AddressIndex::DB::UpdateAddressBalances(CDBBatch &batch, const std::vector<CAddressIndexDbEntry> &vect, bool fErase) {
+    std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> mapDeltas;
+    std::set<std::tuple<unsigned int, uint160, uint256>> setTxs;
+    for (const CAddressIndexDbEntry& entry : vect) {
+        // A block can be connected again after an unclean shutdown, so only
+        // count entries that this batch adds to (or removes from) the index.
+        if (Exists(make_pair(DB_ADDRESSINDEX, entry.first)) != fErase)
+            continue;
+        const CAddressIndexKey& key = entry.first;
+        CAddressBalanceValue& delta = mapDeltas[std::make_pair(key.type, key.hashBytes)];
+        delta.balance += entry.second;
+        if (entry.second > 0)
+            delta.received += entry.second;
+        if (setTxs.insert(std::make_tuple(key.type, key.hashBytes, key.txhash)).second)
+            delta.txCount++;
+    }
+
+    for (const auto& it : mapDeltas) {
+        CAddressIndexIteratorKey key(it.first.first, it.first.second);
+        CAddressBalanceValue value;
+        Read(make_pair(DB_ADDRESSBALANCE, key), value);
+        if (fErase) {
+            value.balance -= it.second.balance;
+            value.received -= it.second.received;
+            value.txCount -= it.second.txCount;
+        } else {
+            value.balance += it.second.balance;
+            value.received += it.second.received;
+            value.txCount += it.second.txCount;
+        }
+        if (value.txCount > 0)
+            batch.Write(make_pair(DB_ADDRESSBALANCE, key), value);
+        else
+            batch.Erase(make_pair(DB_ADDRESSBALANCE, key));
+    }
+}
+
+bool AddressIndex::DB::ReadAddressBalance(const uint160& addressHash, int type, CAddressBalanceValue &value) const {
+    if (!Read(make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), value))
+        value.SetNull();
+    return true;
+}
+
+bool AddressIndex::DB::BuildAddressBalanceIndex() {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+    size_t nAddresses = 0;
+
+    // Entries are ordered by address, then by height and position in the
+    // block, so each address and each of its transactions is one run.
+    std::optional<CAddressIndexIteratorKey> current;
+    CAddressBalanceValue value;
+    uint256 lastTxHash;
+    auto flush = [&]() {
+        if (!current)
+            return true;
+        batch.Write(make_pair(DB_ADDRESSBALANCE, *current), value);
+        if (++nAddresses % 10000 == 0) {
+            if (!WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+        return true;
+    };
+
+    pcursor->Seek(DB_ADDRESSINDEX);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressIndexKey> key;
+        if (!(pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX))
+            break;
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address index value");
+
+        if (!current || current->type != key.second.type || current->hashBytes != key.second.hashBytes) {
+            if (!flush())
+                return false;
+            current = CAddressIndexIteratorKey(key.second.type, key.second.hashBytes);
+            value.SetNull();
+            lastTxHash.SetNull();
+        }
+        value.balance += nValue;
+        if (nValue > 0)
+            value.received += nValue;
+        if (key.second.txhash != lastTxHash) {
+            value.txCount++;
+            lastTxHash = key.second.txhash;
+        }
+        pcursor->Next();
+    }
+    if (!flush())
+        return false;
+    LogPrintf("%s: built balances for %u addresses\n", __func__, nAddresses);
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::ReadAddressIndex(
+        const uint160& addressHash, int type,
+        std::vector<CAddressIndexDbEntry> &addressIndex,
+        int start, int end)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (start > 0 && end > 0) {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
+    } else {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        if (!(pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash))
+            break;
+        if (end > 0 && key.second.blockHeight > end)
+            break;
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address index value");
+        addressIndex.push_back(make_pair(key.second, nValue));
+        pcursor->Next();
+    }
+    return true;
+}
+
+AddressIndex::AddressIndex(size_t nCacheSize, bool fMemory, bool fWipe)
+    : m_db(new AddressIndex::DB(nCacheSize, fMemory, fWipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+bool AddressIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    // The transactions of the genesis block are not connected.
+    if (pindex->nHeight == 0) {
+        return true;
+    }
+
+    CBlockUndo blockundo;
+    if (!ReadBlockUndo(block, pindex, blockundo)) {
+        return false;
+    }
+
+    std::vector<CAddressIndexDbEntry> addressIndex;
+    std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction &tx = *block.vtx[i];
+        const uint256 hash = tx.GetHash();
+
+        // https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-7ec3c68a81efff79b6ca22ac1f1eabbaR2597
+        if (i > 0) {
+            const CTxUndo &txundo = blockundo.vtxundo[i-1];
+            if (txundo.vprevout.size() != tx.vin.size()) {
+                return error("%s: Transaction %s and undo data inconsistent", __func__, hash.ToString());
+            }
+            for (unsigned int j = 0; j < tx.vin.size(); j++) {
+                const CTxIn &input = tx.vin[j];
+                const CTxOut &prevout = txundo.vprevout[j].txout;
+                CScript::ScriptType scriptType = prevout.scriptPubKey.GetType();
+                if (scriptType != CScript::UNKNOWN) {
+                    uint160 const addrHash = prevout.scriptPubKey.AddressHash();
+
+                    // record spending activity
+                    addressIndex.push_back(make_pair(
+                        CAddressIndexKey(scriptType, addrHash, pindex->nHeight, i, hash, j, true),
+                        prevout.nValue * -1));
+
+                    // remove address from unspent index
+                    addressUnspentIndex.push_back(make_pair(
+                        CAddressUnspentKey(scriptType, addrHash, input.prevout.hash, input.prevout.n),
+                        CAddressUnspentValue()));
+                }
+            }
+        }
+
+        // https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-7ec3c68a81efff79b6ca22ac1f1eabbaR2656
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut &out = tx.vout[k];
+            CScript::ScriptType scriptType = out.scriptPubKey.GetType();
+            if (scriptType != CScript::UNKNOWN) {
+                uint160 const addrHash = out.scriptPubKey.AddressHash();
+
+                // record receiving activity
+                addressIndex.push_back(make_pair(
+                    CAddressIndexKey(scriptType, addrHash, pindex->nHeight, i, hash, k, false),
+                    out.nValue));
+
+                // record unspent output
+                addressUnspentIndex.push_back(make_pair(
+                    CAddressUnspentKey(scriptType, addrHash, hash, k),
+                    CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
+            }
+        }
+    }
+
+    m_db->WriteAddressIndex(batch, addressIndex);
+    m_db->UpdateAddressUnspentIndex(batch, addressUnspentIndex);
+    return true;
+}
+
+bool AddressIndex::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    if (pindex->nHeight == 0) {
+        return true;
+    }
+
+    CBlockUndo blockundo;
+    if (!ReadBlockUndo(block, pindex, blockundo)) {
+        return false;
+    }
+
+    // Transactions are undone in reverse order, so that an output created
+    // and spent in the same block ends up removed from the unspent index.
+    std::vector<CAddressIndexDbEntry> addressIndex;
+    std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
+    for (int i = block.vtx.size() - 1; i >= 0; i--) {
+        const CTransaction &tx = *block.vtx[i];
+        const uint256 hash = tx.GetHash();
+
+        // https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-7ec3c68a81efff79b6ca22ac1f1eabbaR2236
+        for (unsigned int k = tx.vout.size(); k-- > 0;) {
+            const CTxOut &out = tx.vout[k];
+            CScript::ScriptType scriptType = out.scriptPubKey.GetType();
+            if (scriptType != CScript::UNKNOWN) {
+                uint160 const addrHash = out.scriptPubKey.AddressHash();
+
+                // undo receiving activity
+                addressIndex.push_back(make_pair(
+                    CAddressIndexKey(scriptType, addrHash, pindex->nHeight, i, hash, k, false),
+                    out.nValue));
+
+                // undo unspent index
+                addressUnspentIndex.push_back(make_pair(
+                    CAddressUnspentKey(scriptType, addrHash, hash, k),
+                    CAddressUnspentValue()));
+            }
+        }
+
+        // https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-7ec3c68a81efff79b6ca22ac1f1eabbaR2304
+        if (i > 0) {
+            const CTxUndo &txundo = blockundo.vtxundo[i-1];
+            if (txundo.vprevout.size() != tx.vin.size()) {
+                return error("%s: Transaction %s and undo data inconsistent", __func__, hash.ToString());
+            }
+            for (unsigned int j = tx.vin.size(); j-- > 0;) {
+                const CTxIn &input = tx.vin[j];
+                const CTxInUndo &undo = txundo.vprevout[j];
+                const CTxOut &prevout = undo.txout;
+                CScript::ScriptType scriptType = prevout.scriptPubKey.GetType();
+                if (scriptType != CScript::UNKNOWN) {
+                    uint160 const addrHash = prevout.scriptPubKey.AddressHash();
+
+                    // undo spending activity
+                    addressIndex.push_back(make_pair(
+                        CAddressIndexKey(scriptType, addrHash, pindex->nHeight, i, hash, j, true),
+                        prevout.nValue * -1));
+
+                    // restore unspent index
+                    addressUnspentIndex.push_back(make_pair(
+                        CAddressUnspentKey(scriptType, addrHash, input.prevout.hash, input.prevout.n),
+                        CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
+                }
+            }
+        }
+    }
+
+    m_db->EraseAddressIndex(batch, addressIndex);
+    m_db->UpdateAddressUnspentIndex(batch, addressUnspentIndex);
+    return true;
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+std::vector<char> AddressIndex::GetLegacyPrefixes() const
+{
+    return {DB_ADDRESSINDEX, DB_ADDRESSUNSPENTINDEX, DB_ADDRESSBALANCE};
+}
+
+bool AddressIndex::FinishLegacyMigration()
+{
+    // Older versions kept balances only once they had built them at startup.
+    bool fAddressBalanceIndex = false;
+    pblocktree->ReadFlag("addressbalanceindex", fAddressBalanceIndex);
+    if (fAddressBalanceIndex) {
+        return true;
+    }
+    return m_db->BuildAddressBalanceIndex();
+}
+
+bool AddressIndex::FindAddressIndex(const uint160& addressHash, int type,
+                                    std::vector<CAddressIndexDbEntry>& addressIndex,
+                                    int start, int end) const
+{
+    return m_db->ReadAddressIndex(addressHash, type, addressIndex, start, end);
+}
+
+bool AddressIndex::FindAddressUnspent(const uint160& addressHash, int type,
+                                      std::vector<CAddressUnspentDbEntry>& unspentOutputs) const
+{
+    return m_db->ReadAddressUnspentIndex(addressHash, type, unspentOutputs);
+}
+
+bool AddressIndex::FindAddressBalance(const uint160& addressHash, int type, CAddressBalanceValue& balance) const
+{
+    return m_db->ReadAddressBalance(addressHash, type, balance);
+}
+
+struct CAddressIndexCursor::Stream
+{
+    std::unique_ptr<CDBIterator> pcursor;
+    std::pair<uint160, int> address;
+    CAddressIndexDbEntry entry;
+    std::string mergeKey;
+};
+
+// Entries of one address are kept in LevelDB in the order of the part of
+// their key after the address, so order entries of different addresses by
+// that part first, and then by address.
+static std::string AddressIndexMergeKey(const CAddressIndexKey& key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << key;
+    std::string str(ss.begin(), ss.end());
+    const size_t nAddressSize = ::GetSerializeSize(CAddressIndexIteratorKey(), SER_DISK, CLIENT_VERSION);
+    return str.substr(nAddressSize) + str.substr(0, nAddressSize);
+}
+
+CAddressIndexCursor::CAddressIndexCursor(
+        const AddressIndex& index, const std::vector<std::pair<uint160, int>>& addresses,
+        int start, int endIn, const CAddressIndexKey* after) : end(endIn)
+{
+    std::string afterKey;
+    if (after)
+        afterKey = AddressIndexMergeKey(*after);
+
+    std::set<std::pair<uint160, int>> setSeen;
+    for (const auto& address : addresses) {
+        if (!setSeen.insert(address).second)
+            continue;
+        std::unique_ptr<Stream> stream(new Stream());
+        stream->pcursor.reset(index.m_db->NewIterator());
+        stream->address = address;
+        if (after && after->blockHeight >= start) {
+            stream->pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexKey(
+                address.second, address.first, after->blockHeight, after->txindex,
+                after->txhash, after->index, after->spending)));
+        } else if (start > 0) {
+            stream->pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(address.second, address.first, start)));
+        } else {
+            stream->pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(address.second, address.first)));
+        }
+
+        bool fValid = Load(*stream);
+        while (fValid && after && stream->mergeKey <= afterKey) {
+            stream->pcursor->Next();
+            fValid = Load(*stream);
+        }
+        if (fValid)
+            heap.push_back(stream.get());
+        streams.push_back(std::move(stream));
+    }
+    std::make_heap(heap.begin(), heap.end(), StreamGreater);
+}
+
+CAddressIndexCursor::~CAddressIndexCursor() {}
+
+bool CAddressIndexCursor::StreamGreater(const Stream* a, const Stream* b)
+{
+    return a->mergeKey > b->mergeKey;
+}
+
+bool CAddressIndexCursor::Load(Stream& stream)
+{
+    boost::this_thread::interruption_point();
+    if (!stream.pcursor->Valid())
+        return false;
+    std::pair<char, CAddressIndexKey> key;
+    if (!(stream.pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX &&
+          key.second.hashBytes == stream.address.first && (int)key.second.type == stream.address.second))
+        return false;
+    if (end > 0 && key.second.blockHeight > end)
+        return false;
+    CAmount nValue;
+    if (!stream.pcursor->GetValue(nValue))
+        throw dbwrapper_error("failed to get address index value");
+    stream.entry = make_pair(key.second, nValue);
+    stream.mergeKey = AddressIndexMergeKey(key.second);
+    return true;
+}
+
+bool CAddressIndexCursor::Valid() const
+{
+    return !heap.empty();
+}
+
+const CAddressIndexDbEntry& CAddressIndexCursor::GetEntry() const
+{
+    assert(Valid());
+    return heap.front()->entry;
+}
+
+void CAddressIndexCursor::Next()
+{
+    assert(Valid());
+    std::pop_heap(heap.begin(), heap.end(), StreamGreater);
+    Stream* stream = heap.back();
+    stream->pcursor->Next();
+    if (Load(*stream)) {
+        std::push_heap(heap.begin(), heap.end(), StreamGreater);
+    } else {
+        heap.pop_back();
+    }
+}
+
+CAddressUnspentCursor::CAddressUnspentCursor(
+        const AddressIndex& index, const std::vector<std::pair<uint160, int>>& addressesIn,
+        const CAddressUnspentKey* after) :
+    nAddress(0), pcursor(index.m_db->NewIterator()), entry(new CAddressUnspentDbEntry())
+{
+    std::set<std::pair<uint160, int>> setSeen;
+    for (const auto& address : addressesIn) {
+        if (setSeen.insert(address).second)
+            addresses.push_back(address);
+    }
+
+    if (!after) {
+        if (Valid())
+            Seek(CAddressUnspentKey(addresses[0].second, addresses[0].first, uint256(), 0));
+        Load();
+        return;
+    }
+
+    const auto address = std::make_pair(after->hashBytes, (int)after->type);
+    nAddress = std::find(addresses.begin(), addresses.end(), address) - addresses.begin();
+    if (!Valid())
+        return;
+    Seek(*after);
+    if (Load() && entry->first.hashBytes == after->hashBytes && entry->first.type == after->type &&
+            entry->first.txhash == after->txhash && entry->first.index == after->index) {
+        Next();
+    }
+}
+
+CAddressUnspentCursor::~CAddressUnspentCursor() {}
+
+void CAddressUnspentCursor::Seek(const CAddressUnspentKey& key)
+{
+    pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, key));
+}
+
+bool CAddressUnspentCursor::Load()
+{
+    while (Valid()) {
+        boost::this_thread::interruption_point();
+        const auto& address = addresses[nAddress];
+        std::pair<char, CAddressUnspentKey> key;
+        if (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX &&
+                key.second.hashBytes == address.first && (int)key.second.type == address.second) {
+            CAddressUnspentValue value;
+            if (!pcursor->GetValue(value))
+                throw dbwrapper_error("failed to get address unspent value");
+            *entry = make_pair(key.second, value);
+            return true;
+        }
+        if (++nAddress < addresses.size())
+            Seek(CAddressUnspentKey(addresses[nAddress].second, addresses[nAddress].first, uint256(), 0));
+    }
+    return false;
+}
+
+bool CAddressUnspentCursor::Valid() const
+{
+    return nAddress < addresses.size();
+}
+
+const CAddressUnspentDbEntry& CAddressUnspentCursor::GetEntry() const
+{
+    assert(Valid());
+    return *entry;
+}
+
+void CAddressUnspentCursor::Next()
+{
+    assert(Valid());
+    pcursor->Next();
+    Load();
+}
+
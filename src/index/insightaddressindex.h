@@ -0,0 +1,135 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_INDEX_INSIGHTADDRESSINDEX_H
+#define BITCOIN_INDEX_INSIGHTADDRESSINDEX_H
+
+#include "addressindex.h"
+#include "index/base.h"
+#include "txdb.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * AddressIndex records the transparent activity of every address in the
+ * active chain (indexes/address/), for the insight explorer and lightwalletd
+ * RPCs: an entry for every output received and spent, the unspent outputs of
+ * each address, and each address's balance. Spent outputs are read from the
+ * undo data of a block.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    friend class CAddressIndexCursor;
+    friend class CAddressUnspentCursor;
+
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+    std::vector<char> GetLegacyPrefixes() const override;
+
+    bool FinishLegacyMigration() override;
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Append the entries of an address to addressIndex, in the height range
+    /// [start, end] if both are given.
+    bool FindAddressIndex(const uint160& addressHash, int type,
+                          std::vector<CAddressIndexDbEntry>& addressIndex,
+                          int start = 0, int end = 0) const;
+
+    /// Append the unspent outputs of an address to unspentOutputs.
+    bool FindAddressUnspent(const uint160& addressHash, int type,
+                            std::vector<CAddressUnspentDbEntry>& unspentOutputs) const;
+
+    /// Look up the balance of an address, which is null if it has no entries.
+    bool FindAddressBalance(const uint160& addressHash, int type, CAddressBalanceValue& balance) const;
+};
+
+/// The global address index, used by the insight explorer RPCs. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+/**
+ * Streams the address index entries of a set of addresses in the order of
+ * the blocks and transactions they come from, by merging one LevelDB iterator
+ * per address, so memory use does not depend on how many entries the
+ * addresses have. Entries of the same transaction come out together. Each
+ * entry sorts after the one before it, so a query can be resumed from the
+ * last entry it returned.
+ */
+class CAddressIndexCursor
+{
+public:
+    /**
+     * Position the cursor at the first entry in the height range [start, end]
+     * (where 0 means unbounded) that sorts after `after`, if given.
+     */
+    CAddressIndexCursor(const AddressIndex& index, const std::vector<std::pair<uint160, int>>& addresses,
+                        int start, int end, const CAddressIndexKey* after = nullptr);
+    ~CAddressIndexCursor();
+
+    bool Valid() const;
+    const CAddressIndexDbEntry& GetEntry() const;
+    void Next();
+
+private:
+    struct Stream;
+    std::vector<std::unique_ptr<Stream>> streams;
+    //! Min-heap of the streams that still have entries
+    std::vector<Stream*> heap;
+    int end;
+
+    static bool StreamGreater(const Stream* a, const Stream* b);
+    bool Load(Stream& stream);
+};
+
+/**
+ * Streams the unspent outputs of a set of addresses in the order of the
+ * unspent index, by address and then by outpoint. This is not height order,
+ * but needs no sorting, and can be resumed from the last output returned.
+ */
+class CAddressUnspentCursor
+{
+public:
+    /**
+     * Position the cursor at the first output of the first address, or just
+     * after `after` if given. Returns an invalid cursor if `after` is not an
+     * output of one of the addresses.
+     */
+    CAddressUnspentCursor(const AddressIndex& index, const std::vector<std::pair<uint160, int>>& addresses,
+                          const CAddressUnspentKey* after = nullptr);
+    ~CAddressUnspentCursor();
+
+    bool Valid() const;
+    const CAddressUnspentDbEntry& GetEntry() const;
+    void Next();
+
+private:
+    std::vector<std::pair<uint160, int>> addresses;
+    size_t nAddress;
+    std::unique_ptr<CDBIterator> pcursor;
+    std::unique_ptr<CAddressUnspentDbEntry> entry;
+
+    void Seek(const CAddressUnspentKey& key);
+    bool Load();
+};
+
+#endif // BITCOIN_INDEX_INSIGHTADDRESSINDEX_H
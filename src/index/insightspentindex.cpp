@@ -0,0 +1,115 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "index/insightspentindex.h"
+
+#include "main.h"
+#include "txdb.h"
+#include "undo.h"
+#include "util/system.h"
+
+static const char DB_SPENTINDEX = 'p';
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+/**
+ * Access to the spent index database (indexes/spent/)
+ *
+ * The keys are those that the index was kept under in the block index
+ * database, so the entries written by older versions can be copied over.
+ */
+class SpentIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    bool ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value) const;
+    void UpdateSpentIndex(CDBBatch &batch, const std::vector<CSpentIndexDbEntry> &vect);
+};
+
+SpentIndex::DB::DB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "spent", nCacheSize, fMemory, fWipe)
+{}
+
+bool SpentIndex::DB::ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value) const {
+    return Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
+
+void SpentIndex::DB::UpdateSpentIndex(CDBBatch &batch, const std::vector<CSpentIndexDbEntry> &vect) {
+    for (std::vector<CSpentIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
+        } else {
+            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
+        }
+    }
+}
+
+SpentIndex::SpentIndex(size_t nCacheSize, bool fMemory, bool fWipe)
+    : m_db(new SpentIndex::DB(nCacheSize, fMemory, fWipe))
+{}
+
+SpentIndex::~SpentIndex() {}
+
+bool SpentIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    // The transactions of the genesis block are not connected.
+    if (pindex->nHeight == 0) {
+        return true;
+    }
+
+    CBlockUndo blockundo;
+    if (!ReadBlockUndo(block, pindex, blockundo)) {
+        return false;
+    }
+
+    std::vector<CSpentIndexDbEntry> spentIndex;
+    for (unsigned int i = 1; i < block.vtx.size(); i++) {
+        const CTransaction &tx = *block.vtx[i];
+        const CTxUndo &txundo = blockundo.vtxundo[i-1];
+        if (txundo.vprevout.size() != tx.vin.size()) {
+            return error("%s: Transaction %s and undo data inconsistent", __func__, tx.GetHash().ToString());
+        }
+        for (unsigned int j = 0; j < tx.vin.size(); j++) {
+            const CTxIn &input = tx.vin[j];
+            const CTxOut &prevout = txundo.vprevout[j].txout;
+            // Add the spent index to determine the txid and input that spent an output
+            // and to find the amount and address from an input.
+            // If we do not recognize the script type, we still add an entry to the
+            // spentindex db, with a script type of 0 and addrhash of all zeroes.
+            spentIndex.push_back(std::make_pair(
+                CSpentIndexKey(input.prevout.hash, input.prevout.n),
+                CSpentIndexValue(tx.GetHash(), j, pindex->nHeight, prevout.nValue,
+                    prevout.scriptPubKey.GetType(), prevout.scriptPubKey.AddressHash())));
+        }
+    }
+
+    m_db->UpdateSpentIndex(batch, spentIndex);
+    return true;
+}
+
+bool SpentIndex::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    std::vector<CSpentIndexDbEntry> spentIndex;
+    for (unsigned int i = 1; i < block.vtx.size(); i++) {
+        for (const CTxIn &input : block.vtx[i]->vin) {
+            // undo and delete the spent index
+            spentIndex.push_back(std::make_pair(
+                CSpentIndexKey(input.prevout.hash, input.prevout.n),
+                CSpentIndexValue()));
+        }
+    }
+
+    m_db->UpdateSpentIndex(batch, spentIndex);
+    return true;
+}
+
+BaseIndex::DB& SpentIndex::GetDB() const { return *m_db; }
+
+std::vector<char> SpentIndex::GetLegacyPrefixes() const { return {DB_SPENTINDEX}; }
+
+bool SpentIndex::FindSpent(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    return m_db->ReadSpentIndex(key, value);
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_INDEX_INSIGHTSPENTINDEX_H
+#define BITCOIN_INDEX_INSIGHTSPENTINDEX_H
+
+#include "index/base.h"
+#include "spentindex.h"
+
+#include <memory>
+
+/**
+ * SpentIndex records, for every transparent output spent in the active chain,
+ * the input that spends it along with the amount and address of the output
+ * (indexes/spent/), for the insight explorer RPCs. Spent outputs are read
+ * from the undo data of a block.
+ */
+class SpentIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "spentindex"; }
+
+    std::vector<char> GetLegacyPrefixes() const override;
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~SpentIndex() override;
+
+    /// Look up the input that spends an output in the active chain.
+    bool FindSpent(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+};
+
+/// The global spent index, used by the insight explorer RPCs. May be null.
+extern std::unique_ptr<SpentIndex> g_spentindex;
+
+#endif // BITCOIN_INDEX_INSIGHTSPENTINDEX_H
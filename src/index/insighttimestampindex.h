@@ -0,0 +1,56 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_INDEX_INSIGHTTIMESTAMPINDEX_H
+#define BITCOIN_INDEX_INSIGHTTIMESTAMPINDEX_H
+
+#include "index/base.h"
+#include "timestampindex.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * TimestampIndex records the blocks of the chain by logical timestamp
+ * (indexes/timestamp/), for the insight explorer RPCs. The logical timestamp
+ * of a block is its time, or one more than that of its parent if that is not
+ * earlier. Entries of blocks that are disconnected are kept, so lookups can
+ * include blocks outside the active chain.
+ */
+class TimestampIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "timestampindex"; }
+
+    std::vector<char> GetLegacyPrefixes() const override;
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit TimestampIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~TimestampIndex() override;
+
+    /// Append the hashes and logical timestamps of the blocks with a logical
+    /// timestamp in [low, high) to hashes, leaving out blocks that are not in
+    /// the active chain if fActiveOnly. Requires cs_main.
+    bool FindBlockHashes(unsigned int high, unsigned int low, bool fActiveOnly,
+                         std::vector<std::pair<uint256, unsigned int>>& hashes) const;
+};
+
+/// The global timestamp index, used by the insight explorer RPCs. May be null.
+extern std::unique_ptr<TimestampIndex> g_timestampindex;
+
+#endif // BITCOIN_INDEX_INSIGHTTIMESTAMPINDEX_H
@@ -0,0 +1,129 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "index/txindex.h"
+
+#include "main.h"
+#include "txdb.h"
+#include "util/system.h"
+
+static const char DB_TXINDEX = 't';
+
+std::unique_ptr<TxIndex> g_txindex;
+
+/**
+ * Access to the txindex database (indexes/txindex/)
+ *
+ * The database stores a block locator of the chain the database is synced to
+ * so that the TxIndex can efficiently determine the point it last stopped at.
+ * A locator is used instead of a simple hash of the chain tip because blocks
+ * and block index entries may not be flushed to disk until after this database
+ * is updated.
+ */
+class TxIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /// Read the disk location of the transaction data with the given hash.
+    /// Returns false if the transaction hash is not indexed.
+    bool ReadTxPos(const uint256& txid, CDiskTxPos& pos) const;
+};
+
+TxIndex::DB::DB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "txindex", nCacheSize, fMemory, fWipe)
+{}
+
+bool TxIndex::DB::ReadTxPos(const uint256 &txid, CDiskTxPos& pos) const
+{
+    return Read(std::make_pair(DB_TXINDEX, txid), pos);
+}
+
+TxIndex::TxIndex(size_t nCacheSize, bool fMemory, bool fWipe)
+    : m_db(new TxIndex::DB(nCacheSize, fMemory, fWipe))
+{}
+
+TxIndex::~TxIndex() {}
+
+/**
+ * Write the positions of a block's transactions, stored at blockPos. The
+ * offsets are into the serialized block, before any compression.
+ */
+static void WriteTxPositions(CDBBatch& batch, const CBlock& block, const CDiskBlockPos& blockPos)
+{
+    CDiskTxPos pos(blockPos, GetSizeOfCompactSize(block.vtx.size()));
+    for (const CTransactionRef& ptx : block.vtx) {
+        const CTransaction& tx = *ptx;
+        batch.Write(std::make_pair(DB_TXINDEX, tx.GetHash()), pos);
+        pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+    }
+}
+
+bool TxIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    WriteTxPositions(batch, block, pindex->GetBlockPos());
+    return true;
+}
+
+BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
+
+std::vector<char> TxIndex::GetLegacyPrefixes() const { return {DB_TXINDEX}; }
+
+bool TxIndex::MoveBlock(const CBlock& block, const CBlockIndex* pindex, const CDiskBlockPos& pos)
+{
+    const CBlockIndex* pindexBest = CurrentIndex();
+    if (!pindexBest || pindexBest->GetAncestor(pindex->nHeight) != pindex) {
+        return true;
+    }
+
+    CDBBatch batch(*m_db);
+    WriteTxPositions(batch, block, pos);
+    return m_db->WriteBatch(batch, true);
+}
+
+bool TxIndex::FindTx(const uint256& txid, uint256& hashBlock, CTransaction& tx) const
+{
+    CBlockFileReader reader;
+    CDiskTxPos postx;
+    if (!m_db->ReadTxPos(txid, postx)) {
+        return false;
+    }
+
+    unsigned int nSize;
+    bool fCompressed;
+    CAutoFile file(OpenRawBlock(postx, Params().MessageStart(), nSize, fCompressed), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        return error("%s: OpenRawBlock failed", __func__);
+    }
+    CBlockHeader header;
+    try {
+        if (fCompressed) {
+            // The offset is into the uncompressed block, so the whole block
+            // has to be read.
+            file.fclose();
+            std::vector<uint8_t> rawBlock;
+            if (!ReadRawBlockFromDisk(rawBlock, postx, Params().MessageStart())) {
+                return error("%s: ReadRawBlockFromDisk failed", __func__);
+            }
+            CDataStream ss(rawBlock, SER_DISK, CLIENT_VERSION);
+            ss >> header;
+            ss.ignore(postx.nTxOffset);
+            ss >> tx;
+        } else {
+            file >> header;
+            if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) {
+                return error("%s: fseek(...) failed", __func__);
+            }
+            file >> tx;
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    if (tx.GetHash() != txid) {
+        return error("%s: txid mismatch", __func__);
+    }
+    hashBlock = header.GetHash();
+    return true;
+}
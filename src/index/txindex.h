@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_INDEX_TXINDEX_H
+#define BITCOIN_INDEX_TXINDEX_H
+
+#include "index/base.h"
+
+#include <memory>
+
+class CTransaction;
+struct CDiskBlockPos;
+class uint256;
+
+/**
+ * TxIndex is used to look up transactions included in the blockchain by hash.
+ * The index is written to a LevelDB database (indexes/txindex/) and records
+ * the filesystem location of each transaction by transaction hash.
+ */
+class TxIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "txindex"; }
+
+    std::vector<char> GetLegacyPrefixes() const override;
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit TxIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~TxIndex() override;
+
+    /// Look up a transaction by hash.
+    ///
+    /// @param[in]   txid      The hash of the transaction to be returned.
+    /// @param[out]  hashBlock The hash of the block the transaction is found in.
+    /// @param[out]  tx        The transaction itself.
+    /// @return  true if transaction is found, false otherwise
+    bool FindTx(const uint256& txid, uint256& hashBlock, CTransaction& tx) const;
+
+    /// Point the entries of a block's transactions at a new copy of the block
+    /// stored at pos, if the block has been indexed. The entries are synced to
+    /// disk before returning, so the old copy may then be deleted.
+    bool MoveBlock(const CBlock& block, const CBlockIndex* pindex, const CDiskBlockPos& pos);
+};
+
+/// The global transaction index, used in GetTransaction. May be null.
+extern std::unique_ptr<TxIndex> g_txindex;
+
+#endif // BITCOIN_INDEX_TXINDEX_H
@@ -21,6 +21,11 @@
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "index/coinstatsindex.h"
+#include "index/insightaddressindex.h"
+#include "index/insightspentindex.h"
+#include "index/insighttimestampindex.h"
+#include "index/txindex.h"
 #include "key.h"
 #ifdef ENABLE_MINING
 #include "key_io.h"
@@ -38,6 +43,7 @@
 #include "scheduler.h"
 #include "txdb.h"
 #include "torcontrol.h"
+#include "transaction_builder.h"
 #include "ui_interface.h"
 #include "util/system.h"
 #include "util/moneystr.h"
@@ -67,6 +73,7 @@
 
 #if ENABLE_ZMQ
 #include "zmq/zmqnotificationinterface.h"
+#include "zmq/zmqpublishnotifier.h"
 #endif
 
 #include <rust/bridge.h>
@@ -172,7 +179,6 @@ public:
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
-static CCoinsViewDB *pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
 
 void Interrupt(boost::thread_group& threadGroup)
@@ -182,6 +188,21 @@ void Interrupt(boost::thread_group& threadGroup)
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    if (g_txindex) {
+        g_txindex->Interrupt();
+    }
+    if (g_coinstatsindex) {
+        g_coinstatsindex->Interrupt();
+    }
+    if (g_addressindex) {
+        g_addressindex->Interrupt();
+    }
+    if (g_spentindex) {
+        g_spentindex->Interrupt();
+    }
+    if (g_timestampindex) {
+        g_timestampindex->Interrupt();
+    }
     threadGroup.interrupt_all();
 }
 
@@ -216,6 +237,26 @@ void Shutdown()
     StopNode();
     StopTorControl();
     UnregisterNodeSignals(GetNodeSignals());
+    if (g_txindex) {
+        g_txindex->Stop();
+        g_txindex.reset();
+    }
+    if (g_coinstatsindex) {
+        g_coinstatsindex->Stop();
+        g_coinstatsindex.reset();
+    }
+    if (g_addressindex) {
+        g_addressindex->Stop();
+        g_addressindex.reset();
+    }
+    if (g_spentindex) {
+        g_spentindex->Stop();
+        g_spentindex.reset();
+    }
+    if (g_timestampindex) {
+        g_timestampindex->Stop();
+        g_timestampindex.reset();
+    }
 
     {
         LOCK(cs_main);
@@ -230,6 +271,9 @@ void Shutdown()
         pcoinsdbview = NULL;
         delete pblocktree;
         pblocktree = NULL;
+        delete pcompactblocks;
+        pcompactblocks = NULL;
+        blockcache.Clear();
     }
 #ifdef ENABLE_WALLET
     if (pwalletMain)
@@ -252,6 +296,7 @@ void Shutdown()
     }
 #endif
     UnregisterAllValidationInterfaces();
+    UnregisterBackgroundSignalScheduler();
 #ifdef ENABLE_WALLET
     delete pwalletMain;
     pwalletMain = NULL;
@@ -327,11 +372,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
     strUsage += HelpMessageOpt("-allowdeprecated=<feature>", strprintf(_("Explicitly allow the use of the specified deprecated feature. Multiple instances of this parameter are permitted; values for <feature> must be selected from among {%s}"), GetAllowableDeprecatedFeatures()));
+    strUsage += HelpMessageOpt("-blockcachesize=<n>", strprintf(_("Keep up to <n> MiB of recently connected and frequently requested blocks in memory, 0 to disable (default: %u)"), DEFAULT_BLOCK_CACHE_SIZE));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to reject transactions from network peers. Automatic broadcast and rebroadcast of any transactions from inbound peers is disabled, unless '-whitelistforcerelay' is '1', in which case whitelisted peers' transactions will be relayed. RPC transactions are not affected. (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
+    strUsage += HelpMessageOpt("-checkcoinsinbackground", strprintf(_("Run the level 3 and 4 checks of -checkblocks against the coin database in the background once the node has started, rather than before (default: %u)"), DEFAULT_CHECK_COINS_IN_BACKGROUND));
+    strUsage += HelpMessageOpt("-coinstatsindex", strprintf(_("Maintain statistics on the UTXO set as of every block, used by gettxoutsetinfo with hash_type muhash. The index is built in the background when it is first enabled (default: %u)"), DEFAULT_COINSTATSINDEX));
+    strUsage += HelpMessageOpt("-compressblocks", strprintf(_("Compress blocks and undo data when writing them to disk. Block files written without it are recompressed in the background, except in prune mode (default: %u)"), DEFAULT_COMPRESS_BLOCKS));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND)
     {
@@ -342,17 +391,20 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory (this path cannot use '~')"));
     strUsage += HelpMessageOpt("-paramsdir=<dir>", _("Specify Zcash network parameters directory"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbcompactafteribd", strprintf(_("Compact the chainstate, block index and index databases once initial block download finishes, rather than leaving LevelDB to compact them while writing (default: %u)"), DEFAULT_DB_COMPACT_AFTER_IBD));
     strUsage += HelpMessageOpt("-debuglogfile=<file>", strprintf(_("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)"), DEFAULT_DEBUGLOGFILE));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
     strUsage += HelpMessageOpt("-ibdskiptxverification", strprintf(_("Skip transaction verification during initial block download up to the last checkpoint height. Incompatible with flags that disable checkpoints. (default = %u)"), DEFAULT_IBD_SKIP_TX_VERIFICATION));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
+    if (showDebug)
+        strUsage += HelpMessageOpt("-loadsnapshot=<file>", "Load the chainstate from a snapshot written with dumptxoutset once the headers chain reaches its block, without downloading or validating the blocks below it. The blocks below it are never validated. Its hash must be committed to in the chain parameters. Experimental: requires -experimentalfeatures -assumeutxo, -disablewallet and no index");
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
-    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by pruning (deleting) old blocks. This mode disables wallet support and is incompatible with -txindex. "
+    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by pruning (deleting) old blocks. This mode disables wallet support and is incompatible with -txindex and -coinstatsindex. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
 #ifdef ENABLE_WALLET
@@ -362,11 +414,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-reindex-chainstate", _("Rebuild chain state from the currently indexed blocks"));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild chain state and block index from the blk*.dat files on disk"));
 #endif
+    strUsage += HelpMessageOpt("-saplingproverthreads=<n>", strprintf(_("Set the number of threads used to create Sapling proofs when building transactions (0 = auto, default: %d)"), DEFAULT_SAPLING_PROVER_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
     strUsage += HelpMessageOpt("-txexpirynotify=<cmd>", _("Execute command when transaction expires (%s in cmd is replaced by transaction id)"));
-    strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call. The index is built in the background when it is first enabled (default: %u)"), DEFAULT_TXINDEX));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
@@ -384,6 +437,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
+    strUsage += HelpMessageOpt("-msghandlerthreads=<n>", strprintf(_("Set the number of threads processing messages from peers; each peer is handled by one thread at a time (1 to %d, default: %d)"), MAX_MESSAGE_HANDLER_THREADS, DEFAULT_MESSAGE_HANDLER_THREADS));
     strUsage += HelpMessageOpt("-mempoolevictionmemoryminutes=<n>", strprintf(_("The number of minutes before allowing rejected transactions to re-enter the mempool. (default: %u)"), DEFAULT_MEMPOOL_EVICTION_MEMORY_MINUTES));
     strUsage += HelpMessageOpt("-mempooltxcostlimit=<n>",strprintf(_("An upper bound on the maximum size in bytes of all transactions in the mempool. (default: %s)"), DEFAULT_MEMPOOL_TOTAL_COST_LIMIT));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
@@ -417,6 +471,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawtxbatch=<n>", strprintf(_("Publish up to <n> queued transactions in one rawtx message (default: %u)"), DEFAULT_ZMQ_RAWTX_BATCH));
+    strUsage += HelpMessageOpt("-zmqpubsequence=<address>", _("Enable publish hash block and tx sequence in <address>"));
+    strUsage += HelpMessageOpt("-zmqqueuesize=<n>", strprintf(_("Maximum number of messages waiting to be published; further messages are dropped (default: %u)"), DEFAULT_ZMQ_QUEUE_SIZE));
 #endif
 
     strUsage += HelpMessageGroup(_("Monitoring options:"));
@@ -447,6 +504,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-nuparams=hexBranchId:activationHeight", "Use given activation height for specified network upgrade (regtest-only)");
         strUsage += HelpMessageOpt("-nurejectoldversions", strprintf("Reject peers that don't know about the current epoch (regtest-only) (default: %u)", DEFAULT_NU_REJECT_OLD_VERSIONS));
+        strUsage += HelpMessageOpt("-regtestassumeutxo=height:hash", "Accept a chainstate snapshot at the given height with the given hash in loadtxoutset (regtest-only)");
         strUsage += HelpMessageOpt(
                 "-fundingstream=streamId:startHeight:endHeight:comma_delimited_addresses",
                 "Use given addresses for block subsidy share paid to the funding stream with id <streamId> (regtest-only)");
@@ -525,8 +583,9 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
-    // Disabled until we can lock notes and also tune performance of the prover which by default uses multiple threads
-    //strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls (default: %d)"), 1));
+    strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls (default: %d)"), DEFAULT_RPC_ASYNC_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchthreads=<n>", strprintf(_("Set the number of threads shared by JSON-RPC batch requests; 0 executes batches sequentially (default: %d)"), DEFAULT_RPC_BATCH_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchconcurrency=<n>", strprintf(_("Set the maximum number of elements of one JSON-RPC batch request that are executed at once (default: %d)"), DEFAULT_RPC_BATCH_CONCURRENCY));
 
     if (mode == HMM_BITCOIND) {
         strUsage += HelpMessageGroup(_("Metrics Options (only if -daemon and -printtoconsole are not set):"));
@@ -751,29 +810,30 @@ void ThreadImport(std::vector<fs::path> vImportFiles, const CChainParams& chainp
     // -reindex
     if (fReindex) {
         nSizeReindexed = 0;  // will be modified inside LoadExternalBlockFile
-        // Find the summary size of all block files first
-        int nFile = 0;
+        // Recompressing the block files (see ThreadRecompressBlockFiles)
+        // deletes the files it has moved the blocks out of, so the numbering
+        // can have gaps. Find the last block file, and the summary size of all
+        // block files, first.
+        int nLastFile = -1;
         size_t fullSize = 0;
-        while (true) {
-            CDiskBlockPos pos(nFile, 0);
-            fs::path blkFile = GetBlockPosFilename(pos, "blk");
-            if (!fs::exists(blkFile))
-                break; // No block files left to reindex
-            nFile++;
-            fullSize += fs::file_size(blkFile);
+        for (fs::directory_iterator it(GetDataDir() / "blocks"); it != fs::directory_iterator(); it++) {
+            const std::string filename = it->path().filename().string();
+            if (fs::is_regular_file(*it) && filename.length() == 12 &&
+                filename.substr(0, 3) == "blk" && filename.substr(8, 4) == ".dat") {
+                nLastFile = std::max(nLastFile, atoi(filename.substr(3, 5)));
+                fullSize += fs::file_size(it->path());
+            }
         }
         nFullSizeToReindex = std::max<size_t>(1, fullSize);
-        nFile = 0;
-        while (true) {
+        for (int nFile = 0; nFile <= nLastFile; nFile++) {
             CDiskBlockPos pos(nFile, 0);
             if (!fs::exists(GetBlockPosFilename(pos, "blk")))
-                break; // No block files left to reindex
+                continue; // Deleted after its blocks were moved
             FILE *file = OpenBlockFile(pos, true);
             if (!file)
                 break; // This error is logged in OpenBlockFile
             LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
             LoadExternalBlockFile(chainparams, file, &pos);
-            nFile++;
         }
         pblocktree->WriteReindexing(false);
         fReindex = false;
@@ -1066,6 +1126,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Set up global Rayon threadpool.
     init::rayon_threadpool();
 
+    // Set up the threadpool on which Sapling spend and output proofs are created.
+    int nSaplingProverThreads = GetArg("-saplingproverthreads", DEFAULT_SAPLING_PROVER_THREADS);
+    if (nSaplingProverThreads < 0) {
+        return InitError(_("-saplingproverthreads must not be negative."));
+    }
+    init::sapling_prover_threadpool(nSaplingProverThreads);
+
     // ********************************************************* Step 2: parameter interactions
     const CChainParams& chainparams = Params();
 
@@ -1081,6 +1148,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (GetArg("-prune", 0)) {
         if (GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX))
+            return InitError(_("Prune mode is incompatible with -coinstatsindex."));
 #ifdef ENABLE_WALLET
         if (GetBoolArg("-rescan", false)) {
             return InitError(_("Rescans are not possible in pruned mode. You will need to use -reindex which will download the whole blockchain again."));
@@ -1154,6 +1223,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fIBDSkipTxVerification = GetBoolArg("-ibdskiptxverification", DEFAULT_IBD_SKIP_TX_VERIFICATION);
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fCompressBlocks = GetBoolArg("-compressblocks", DEFAULT_COMPRESS_BLOCKS);
 
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -1191,6 +1261,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nConnectTimeout <= 0)
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
 
+    if (GetArg("-rpcasyncthreads", DEFAULT_RPC_ASYNC_THREADS) < 1)
+        return InitError(strprintf(_("Invalid value for -rpcasyncthreads=<n>: '%s'. Must be at least 1."), mapArgs["-rpcasyncthreads"]));
+    if (GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS) < 0)
+        return InitError(strprintf(_("Invalid value for -rpcbatchthreads=<n>: '%s'. Must not be negative."), mapArgs["-rpcbatchthreads"]));
+    if (GetArg("-rpcbatchconcurrency", DEFAULT_RPC_BATCH_CONCURRENCY) < 1)
+        return InitError(strprintf(_("Invalid value for -rpcbatchconcurrency=<n>: '%s'. Must be at least 1."), mapArgs["-rpcbatchconcurrency"]));
+
     // Fee rate in zatoshis per 1000 bytes required for mempool acceptance and relay.
     // TODO(update when ZIP 317 is implemented):
     // If you are mining, be careful setting this. If you set it too low then a
@@ -1325,6 +1402,21 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
+    if (!mapMultiArgs["-regtestassumeutxo"].empty()) {
+        if (chainparams.NetworkIDString() != "regtest") {
+            return InitError("-regtestassumeutxo may only be set on regtest.");
+        }
+        for (const std::string& strSnapshot : mapMultiArgs["-regtestassumeutxo"]) {
+            std::vector<std::string> vSnapshotParams;
+            boost::split(vSnapshotParams, strSnapshot, boost::is_any_of(":"));
+            int nHeight;
+            if (vSnapshotParams.size() != 2 || !ParseInt32(vSnapshotParams[0], &nHeight) || nHeight <= 0 || !IsHex(vSnapshotParams[1]) || vSnapshotParams[1].size() != 64) {
+                return InitError("-regtestassumeutxo malformed, expecting height:hash");
+            }
+            UpdateRegtestAssumeutxo(nHeight, uint256S(vSnapshotParams[1]));
+        }
+    }
+
     if (!mapMultiArgs["-fundingstream"].empty()) {
         // Allow overriding network upgrade parameters for testing
         if (chainparams.NetworkIDString() != "regtest") {
@@ -1506,6 +1598,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    RegisterBackgroundSignalScheduler(scheduler);
 
     // Count uptime
     MarkStartTime();
@@ -1698,7 +1791,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     pzmqNotificationInterface = CZMQNotificationInterface::CreateWithArguments(mapArgs);
 
     if (pzmqNotificationInterface) {
-        RegisterValidationInterface(pzmqNotificationInterface);
+        RegisterValidationInterfaceAsync(pzmqNotificationInterface);
     }
 #endif
     if (mapArgs.count("-maxuploadtarget")) {
@@ -1711,6 +1804,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     fReindex = GetBoolArg("-reindex", false);
     bool fReindexChainState = GetBoolArg("-reindex-chainstate", false);
+    int nCheckLevel = GetArg("-checklevel", DEFAULT_CHECKLEVEL);
+    int nCheckDepth = GetArg("-checkblocks", DEFAULT_CHECKBLOCKS);
+    bool fCheckCoinsInBackground = GetBoolArg("-checkcoinsinbackground", DEFAULT_CHECK_COINS_IN_BACKGROUND);
 
     fs::create_directories(GetDataDir() / "blocks");
 
@@ -1718,27 +1814,90 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nTotalCache = (GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greater than nMaxDbcache
-    int64_t nBlockTreeDBCache = nTotalCache / 8;
-    if (nBlockTreeDBCache > (1 << 21) && !GetBoolArg("-txindex", DEFAULT_TXINDEX))
-        nBlockTreeDBCache = (1 << 21); // block tree db cache shouldn't be larger than 2 MiB
+    int64_t nBlockTreeDBCache = std::min(nTotalCache / 8, (int64_t)(1 << 21)); // block tree db cache shouldn't be larger than 2 MiB
 
     // https://github.com/bitpay/bitcoin/commit/c91d78b578a8700a45be936cb5bb0931df8f4b87#diff-c865a8939105e6350a50af02766291b7R1233
     if (GetBoolArg("-insightexplorer", false)) {
         if (!GetBoolArg("-txindex", false)) {
             return InitError(_("-insightexplorer requires -txindex."));
         }
-        // increase cache if additional indices are needed
-        nBlockTreeDBCache = nTotalCache * 3 / 4;
     }
+    // insightexplorer and lightwalletd
+    fAddressIndex = fExperimentalInsightExplorer || fExperimentalLightWalletd;
+    fSpentIndex = fExperimentalInsightExplorer;
+    fTimestampIndex = fExperimentalInsightExplorer;
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nTxIndexCache = 0;
+    if (GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+        nTxIndexCache = nTotalCache / 8;
+        nTotalCache -= nTxIndexCache;
+    }
+    // The coinstats index writes one small record per block.
+    int64_t nCoinStatsIndexCache = 0;
+    if (GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX)) {
+        nCoinStatsIndexCache = std::min(nTotalCache / 8, (int64_t)(1 << 23));
+        nTotalCache -= nCoinStatsIndexCache;
+    }
+    // The address index takes most of what the block index database used to
+    // be given for the insight explorer indexes; the spent index is keyed by
+    // outpoint, and the timestamp index is small.
+    int64_t nAddressIndexCache = 0;
+    int64_t nSpentIndexCache = 0;
+    int64_t nTimestampIndexCache = 0;
+    if (fAddressIndex) {
+        nAddressIndexCache = fSpentIndex ? nTotalCache * 3 / 8 : nTotalCache / 2;
+        nTotalCache -= nAddressIndexCache;
+    }
+    if (fSpentIndex) {
+        nSpentIndexCache = nTotalCache / 2;
+        nTotalCache -= nSpentIndexCache;
+    }
+    if (fTimestampIndex) {
+        nTimestampIndexCache = std::min(nTotalCache / 8, (int64_t)(1 << 23));
+        nTotalCache -= nTimestampIndexCache;
+    }
+    // The compact block store is written once per block and read sequentially
+    // by lightwalletd, so it only needs a small cache.
+    int64_t nCompactBlockDBCache = 0;
+    if (fExperimentalLightWalletd) {
+        nCompactBlockDBCache = std::min(nTotalCache / 8, (int64_t)(1 << 23));
+        nTotalCache -= nCompactBlockDBCache;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+        LogPrintf("* Using %.1fMiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX)) {
+        LogPrintf("* Using %.1fMiB for coinstats index database\n", nCoinStatsIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (fAddressIndex) {
+        LogPrintf("* Using %.1fMiB for address index database\n", nAddressIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (fSpentIndex) {
+        LogPrintf("* Using %.1fMiB for spent index database\n", nSpentIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (fTimestampIndex) {
+        LogPrintf("* Using %.1fMiB for timestamp index database\n", nTimestampIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (fExperimentalLightWalletd) {
+        LogPrintf("* Using %.1fMiB for compact block database\n", nCompactBlockDBCache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
 
+    // The block cache is not part of -dbcache, as it only holds blocks that
+    // would otherwise be read from the block files.
+    int64_t nBlockCacheSize = GetArg("-blockcachesize", DEFAULT_BLOCK_CACHE_SIZE);
+    if (nBlockCacheSize < 0) {
+        return InitError(_("-blockcachesize must not be negative"));
+    }
+    blockcache.SetMaxUsage((size_t)nBlockCacheSize << 20);
+    LogPrintf("* Using %.1fMiB for block cache\n", nBlockCacheSize * 1.0);
+
     bool clearWitnessCaches = false;
 
     bool fLoaded = false;
@@ -1756,8 +1915,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pcoinsdbview;
                 delete pcoinscatcher;
                 delete pblocktree;
+                delete pcompactblocks;
+                pcompactblocks = NULL;
 
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
+                if (fExperimentalLightWalletd) {
+                    pcompactblocks = new CCompactBlockDB(nCompactBlockDBCache, false, fReindex);
+                }
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex || fReindexChainState);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
@@ -1785,20 +1949,18 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
-                // Check for changed -txindex state
-                if (fTxIndex != GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
-                    // TODO: Recommend `-reindex-chainstate` instead of
-                    //      `-reindex` after #5964 and/or #5977 are fixed.
-                    strLoadError = _("You need to rebuild the database using -reindex to change -txindex");
-                    break;
-                }
-
-                // Check for changed -insightexplorer state
-                bool fInsightExplorerPreviouslySet = false;
-                pblocktree->ReadFlag("insightexplorer", fInsightExplorerPreviouslySet);
-                if (fExperimentalInsightExplorer != fInsightExplorerPreviouslySet) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -insightexplorer");
-                    break;
+                // The transaction and insight explorer indexes used to be
+                // kept in the block index database. Remember the block the old
+                // entries are in sync with, before any block is connected, so
+                // that the indexes can copy them in the background instead of
+                // being built again.
+                uint256 hashLegacyIndexBest;
+                if (!pblocktree->ReadLegacyIndexBestBlock(hashLegacyIndexBest) &&
+                    chainActive.Tip() != nullptr && pblocktree->HasLegacyIndexEntries()) {
+                    if (!pblocktree->WriteLegacyIndexBestBlock(chainActive.Tip()->GetBlockHash())) {
+                        strLoadError = _("Error reading from database, shutting down.");
+                        break;
+                    }
                 }
 
                 // Check for changed -lightwalletd state
@@ -1816,6 +1978,25 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // The blocks below a snapshot's base are never validated, so
+                // keeping such a chainstate must be asked for explicitly.
+                if (pindexSnapshotBase != NULL && !fExperimentalAssumeUtxo) {
+                    strLoadError = _("The chainstate was loaded from a snapshot, and the blocks below it have not been validated. Restart with -experimentalfeatures -assumeutxo to keep using it, or rebuild the database using -reindex");
+                    break;
+                }
+
+                // A chainstate loaded from a snapshot has no blocks below the
+                // snapshot's base, so anything that needs them requires a reindex.
+                if (pindexSnapshotBase != NULL &&
+                    (fReindexChainState ||
+                     GetBoolArg("-txindex", DEFAULT_TXINDEX) ||
+                     GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX) ||
+                     fExperimentalInsightExplorer ||
+                     fExperimentalLightWalletd)) {
+                    strLoadError = _("The chainstate was loaded from a snapshot and has no blocks below it. You need to rebuild the database using -reindex to use -reindex-chainstate or an index. This will redownload the entire blockchain");
+                    break;
+                }
+
                 if (!fReindex && chainActive.Tip() != NULL) {
                     uiInterface.InitMessage(_("Rewinding blocks if needed..."));
                     if (!RewindBlockIndex(chainparams, clearWitnessCaches)) {
@@ -1841,8 +2022,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     }
                 }
 
-                if (!CVerifyDB().VerifyDB(chainparams, pcoinsdbview, GetArg("-checklevel", DEFAULT_CHECKLEVEL),
-                              GetArg("-checkblocks", DEFAULT_CHECKBLOCKS))) {
+                if (!CVerifyDB().VerifyDB(chainparams, pcoinsdbview,
+                              fCheckCoinsInBackground ? std::min(nCheckLevel, 2) : nCheckLevel, nCheckDepth)) {
                     strLoadError = _("Corrupted block database detected");
                     break;
                 }
@@ -1926,6 +2107,39 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
     LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
 
+    // The transaction, coinstats and insight explorer indexes catch up with
+    // the chain in the background, so they can be enabled at any time.
+    if (GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+        g_txindex.reset(new TxIndex(nTxIndexCache, false, fReindex));
+        if (!g_txindex->Start()) {
+            return false;
+        }
+    }
+    if (GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX)) {
+        g_coinstatsindex.reset(new CoinStatsIndex(nCoinStatsIndexCache, false, fReindex));
+        if (!g_coinstatsindex->Start()) {
+            return false;
+        }
+    }
+    if (fAddressIndex) {
+        g_addressindex.reset(new AddressIndex(nAddressIndexCache, false, fReindex));
+        if (!g_addressindex->Start()) {
+            return false;
+        }
+    }
+    if (fSpentIndex) {
+        g_spentindex.reset(new SpentIndex(nSpentIndexCache, false, fReindex));
+        if (!g_spentindex->Start()) {
+            return false;
+        }
+    }
+    if (fTimestampIndex) {
+        g_timestampindex.reset(new TimestampIndex(nTimestampIndexCache, false, fReindex));
+        if (!g_timestampindex->Start()) {
+            return false;
+        }
+    }
+
     // ********************************************************* Step 8: load wallet
 #ifdef ENABLE_WALLET
     if (fDisableWallet) {
@@ -1998,6 +2212,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // ********************************************************* Step 9: data directory maintenance
 
+    // a chainstate loaded from a snapshot cannot serve the blocks below it
+    if (pindexSnapshotBase != NULL) {
+        LogPrintf("Unsetting NODE_NETWORK on a chainstate loaded from a snapshot\n");
+        nLocalServices &= ~NODE_NETWORK;
+    }
+
     // if pruning, unset the service bit and perform the initial blockstore prune
     // after any wallet rescanning has taken place.
     if (fPruneMode) {
@@ -2035,8 +2255,59 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             vImportFiles.push_back(strFile);
     }
 
+    // -loadsnapshot=
+    if (mapArgs.count("-loadsnapshot")) {
+        if (!fExperimentalAssumeUtxo)
+            return InitError(_("-loadsnapshot requires -experimentalfeatures -assumeutxo"));
+        fs::path pathSnapshot = fs::absolute(GetArg("-loadsnapshot", ""), GetDataDir());
+        CSnapshotMetadata metadata;
+        try {
+            CAutoFile filein(fsbridge::fopen(pathSnapshot, "rb"), SER_DISK, CLIENT_VERSION);
+            if (filein.IsNull())
+                return InitError(strprintf(_("Cannot open the snapshot %s"), pathSnapshot.string()));
+            filein >> metadata;
+        } catch (const std::exception& e) {
+            return InitError(strprintf(_("Cannot read the snapshot %s: %s"), pathSnapshot.string(), e.what()));
+        }
+
+        LOCK(cs_main);
+        if (pindexSnapshotBase != NULL) {
+            if (pindexSnapshotBase->GetBlockHash() != metadata.hashBlock)
+                return InitError(_("The chainstate was already loaded from a different snapshot"));
+            LogPrintf("The chainstate was already loaded from %s\n", pathSnapshot.string());
+        } else {
+            if (chainActive.Height() > 0)
+                return InitError(_("A snapshot can only be loaded before any blocks have been connected. You need to rebuild the database using -reindex to use -loadsnapshot"));
+#ifdef ENABLE_WALLET
+            if (pwalletMain)
+                return InitError(_("A snapshot cannot be loaded with a wallet. Use -disablewallet with -loadsnapshot"));
+#endif
+            if (GetBoolArg("-txindex", DEFAULT_TXINDEX) ||
+                GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX) ||
+                fExperimentalInsightExplorer ||
+                fExperimentalLightWalletd)
+                return InitError(_("A snapshot cannot be loaded with an index enabled"));
+            if (!chainparams.Assumeutxo().count(metadata.nHeight))
+                return InitError(strprintf(_("No snapshot is known at height %d"), metadata.nHeight));
+
+            // Blocks are not downloaded until the snapshot is loaded.
+            fSnapshotPending = true;
+            threadGroup.create_thread(boost::bind(&ThreadLoadSnapshot, boost::cref(chainparams), pathSnapshot, metadata.hashBlock));
+        }
+    }
+
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles, chainparams));
 
+    // Pruned block files are deleted rather than rewritten.
+    if (fCompressBlocks && !fPruneMode)
+        threadGroup.create_thread(boost::bind(&ThreadRecompressBlockFiles, boost::cref(chainparams)));
+
+    threadGroup.create_thread(boost::bind(&ThreadDatabaseMaintenance, boost::cref(chainparams)));
+
+    // Nothing was checked at startup if the chainstate is being rebuilt.
+    if (fCheckCoinsInBackground && nCheckLevel >= 3 && !fReindex && !fReindexChainState)
+        threadGroup.create_thread(boost::bind(&ThreadVerifyCoins, boost::cref(chainparams), nCheckLevel, nCheckDepth));
+
     // Wait for genesis block to be processed
     {
         WAIT_LOCK(g_genesis_wait_mutex, lock);
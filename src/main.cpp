@@ -12,13 +12,20 @@
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "compactblock.h"
 #include "consensus/consensus.h"
 #include "consensus/funding.h"
 #include "consensus/merkle.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
+#include "crypto/common.h"
 #include "deprecation.h"
 #include "experimental_features.h"
+#include "index/coinstatsindex.h"
+#include "index/insightaddressindex.h"
+#include "index/insightspentindex.h"
+#include "index/insighttimestampindex.h"
+#include "index/txindex.h"
 #include "init.h"
 #include "key_io.h"
 #include "merkleblock.h"
@@ -31,6 +38,7 @@
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "undo.h"
+#include "util/lz4.h"
 #include "util/system.h"
 #include "util/moneystr.h"
 #include "validationinterface.h"
@@ -42,6 +50,7 @@
 #include <algorithm>
 #include <atomic>
 #include <sstream>
+#include <thread>
 #include <variant>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -88,14 +97,16 @@ int g_best_block_height;
 int nScriptCheckThreads = 0;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
-bool fTxIndex = false;
 bool fAddressIndex = false;     // insightexplorer || lightwalletd
 bool fSpentIndex = false;       // insightexplorer
 bool fTimestampIndex = false;   // insightexplorer
 bool fHavePruned = false;
 bool fPruneMode = false;
+CBlockIndex *pindexSnapshotBase = NULL;
+std::atomic_bool fSnapshotPending(false);
 int32_t nPreferredTxVersion = DEFAULT_PREFERRED_TX_VERSION;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
+bool fCompressBlocks = DEFAULT_COMPRESS_BLOCKS;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 bool fIBDSkipTxVerification = DEFAULT_IBD_SKIP_TX_VERIFICATION;
@@ -124,7 +135,7 @@ struct IteratorComparator
 };
 
 struct COrphanTx {
-    CTransaction tx;
+    CTransactionRef tx;
     NodeId fromPeer;
     int64_t nTimeExpire;
 };
@@ -138,6 +149,7 @@ void EraseOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
  */
 static bool IsSuperMajority(int minVersion, const CBlockIndex* pstart, unsigned nRequired, const Consensus::Params& consensusParams);
 static void CheckBlockIndex(const Consensus::Params& consensusParams);
+static void PublishPruneHeight();
 
 /** Constant stuff for coinbase transactions we create: */
 CScript COINBASE_FLAGS;
@@ -236,6 +248,16 @@ namespace {
      */
     bool fCheckForPruning = false;
 
+    /**
+     * Readers of the block files that have looked up, or are about to look up,
+     * a position without cs_main (see CBlockFileReader), and the files that
+     * recompression has moved every block out of, which are deleted once no
+     * reader is left.
+     */
+    CCriticalSection cs_BlockFileReaders;
+    int nBlockFileReaders = 0;
+    std::set<int> setBlockFilesToRemove;
+
     /**
      * Every received block is assigned a unique and increasing identifier, so we
      * know which one to give priority in case of a fork.
@@ -654,16 +676,20 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
     return chain.Genesis();
 }
 
+CCoinsViewDB *pcoinsdbview = NULL;
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
+CCompactBlockDB *pcompactblocks = NULL;
+CBlockCache blockcache((size_t)DEFAULT_BLOCK_CACHE_SIZE << 20);
 
 //////////////////////////////////////////////////////////////////////////////
 //
 // mapOrphanTransactions
 //
 
-bool AddOrphanTx(const CTransaction& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+bool AddOrphanTx(const CTransactionRef& ptx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
+    const CTransaction& tx = *ptx;
     // See doc/book/src/design/p2p-data-propagation.md for why mapOrphanTransactions uses
     // txid to index transactions instead of wtxid.
     uint256 hash = tx.GetHash();
@@ -684,7 +710,7 @@ bool AddOrphanTx(const CTransaction& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(c
         return false;
     }
 
-    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME});
+    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{ptx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME});
     assert(ret.second);
     for (const CTxIn& txin : tx.vin) {
         mapOrphanTransactionsByPrev[txin.prevout].insert(ret.first);
@@ -700,7 +726,7 @@ int static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.find(hash);
     if (it == mapOrphanTransactions.end())
         return 0;
-    for (const CTxIn& txin : it->second.tx.vin)
+    for (const CTxIn& txin : it->second.tx->vin)
     {
         auto itPrev = mapOrphanTransactionsByPrev.find(txin.prevout);
         if (itPrev == mapOrphanTransactionsByPrev.end())
@@ -722,7 +748,7 @@ void EraseOrphansFor(NodeId peer)
         map<uint256, COrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
         if (maybeErase->second.fromPeer == peer)
         {
-            nErased += EraseOrphanTx(maybeErase->second.tx.GetHash());
+            nErased += EraseOrphanTx(maybeErase->second.tx->GetHash());
         }
     }
     if (nErased > 0) LogPrint("mempool", "Erased %d orphan tx from peer %d\n", nErased, peer);
@@ -744,7 +770,7 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) EXCLUSIVE_LOCKS_REQUIRE
         {
             map<uint256, COrphanTx>::iterator maybeErase = iter++;
             if (maybeErase->second.nTimeExpire <= nNow) {
-                nErased += EraseOrphanTx(maybeErase->second.tx.GetHash());
+                nErased += EraseOrphanTx(maybeErase->second.tx->GetHash());
             } else {
                 nMinExpTime = std::min(maybeErase->second.nTimeExpire, nMinExpTime);
             }
@@ -1775,10 +1801,11 @@ std::string FormatStateMessage(const CValidationState &state)
 
 bool AcceptToMemoryPool(
         const CChainParams& chainparams,
-        CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
+        CTxMemPool& pool, CValidationState &state, const CTransactionRef &ptx, bool fLimitFree,
         bool* pfMissingInputs, bool fRejectAbsurdFee)
 {
     AssertLockHeld(cs_main);
+    const CTransaction& tx = *ptx;
     LOCK(pool.cs); // mempool "read lock" (held through pool.addUnchecked())
     if (pfMissingInputs) {
         *pfMissingInputs = false;
@@ -1924,7 +1951,7 @@ bool AcceptToMemoryPool(
         // For v1-v4 transactions, we don't yet know if the transaction commits
         // to consensusBranchId, but if the entry gets added to the mempool, then
         // it has passed ContextualCheckInputs and therefore this is correct.
-        CTxMemPoolEntry entry(tx, nFees, GetTime(), chainActive.Height(), pool.HasNoInputsOf(tx), fSpendsCoinbase, nSigOps, consensusBranchId);
+        CTxMemPoolEntry entry(ptx, nFees, GetTime(), chainActive.Height(), pool.HasNoInputsOf(tx), fSpendsCoinbase, nSigOps, consensusBranchId);
         unsigned int nSize = entry.GetTxSize();
 
         // No transactions are allowed with modified fee below the minimum relay fee,
@@ -2062,14 +2089,22 @@ bool AcceptToMemoryPool(
     return true;
 }
 
+bool AcceptToMemoryPool(
+        const CChainParams& chainparams,
+        CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
+        bool* pfMissingInputs, bool fRejectAbsurdFee)
+{
+    return AcceptToMemoryPool(chainparams, pool, state, MakeTransactionRef(tx), fLimitFree, pfMissingInputs, fRejectAbsurdFee);
+}
+
 bool GetTimestampIndex(unsigned int high, unsigned int low, bool fActiveOnly,
     std::vector<std::pair<uint256, unsigned int> > &hashes)
 {
-    if (!fTimestampIndex) {
+    if (!fTimestampIndex || !g_timestampindex) {
         LogPrint("rpc", "Timestamp index not enabled");
         return false;
     }
-    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes)) {
+    if (!g_timestampindex->FindBlockHashes(high, low, fActiveOnly, hashes)) {
         LogPrint("rpc", "Unable to get hashes for timestamps");
         return false;
     }
@@ -2079,14 +2114,14 @@ bool GetTimestampIndex(unsigned int high, unsigned int low, bool fActiveOnly,
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 {
     AssertLockHeld(cs_main);
-    if (!fSpentIndex) {
+    if (!fSpentIndex || !g_spentindex) {
         LogPrint("rpc", "Spent index not enabled");
         return false;
     }
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!pblocktree->ReadSpentIndex(key, value)) {
+    if (!g_spentindex->FindSpent(key, value)) {
         LogPrint("rpc", "Unable to get spent index information");
         return false;
     }
@@ -2097,11 +2132,11 @@ bool GetAddressIndex(const uint160& addressHash, int type,
                      std::vector<CAddressIndexDbEntry>& addressIndex,
                      int start, int end)
 {
-    if (!fAddressIndex) {
+    if (!fAddressIndex || !g_addressindex) {
         LogPrint("rpc", "address index not enabled");
         return false;
     }
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end)) {
+    if (!g_addressindex->FindAddressIndex(addressHash, type, addressIndex, start, end)) {
         LogPrint("rpc", "unable to get txids for address");
         return false;
     }
@@ -2111,17 +2146,31 @@ bool GetAddressIndex(const uint160& addressHash, int type,
 bool GetAddressUnspent(const uint160& addressHash, int type,
                        std::vector<CAddressUnspentDbEntry>& unspentOutputs)
 {
-    if (!fAddressIndex) {
+    if (!fAddressIndex || !g_addressindex) {
         LogPrint("rpc", "address index not enabled");
         return false;
     }
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs)) {
+    if (!g_addressindex->FindAddressUnspent(addressHash, type, unspentOutputs)) {
         LogPrint("rpc", "unable to get txids for address");
         return false;
     }
     return true;
 }
 
+bool GetAddressBalance(const uint160& addressHash, int type,
+                       CAddressBalanceValue& balance)
+{
+    if (!fAddressIndex || !g_addressindex) {
+        LogPrint("rpc", "address index not enabled");
+        return false;
+    }
+    if (!g_addressindex->FindAddressBalance(addressHash, type, balance)) {
+        LogPrint("rpc", "unable to get balance for address");
+        return false;
+    }
+    return true;
+}
+
 /**
  * Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock.
  * If blockIndex is provided, the transaction is fetched from the corresponding block.
@@ -2140,28 +2189,13 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, const Consensus::P
             return true;
         }
 
-        if (fTxIndex) {
-            CDiskTxPos postx;
-            if (pblocktree->ReadTxIndex(hash, postx)) {
-                CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-                if (file.IsNull())
-                    return error("%s: OpenBlockFile failed", __func__);
-                CBlockHeader header;
-                try {
-                    file >> header;
-                    fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                    file >> txOut;
-                } catch (const std::exception& e) {
-                    return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-                }
-                hashBlock = header.GetHash();
-                if (txOut.GetHash() != hash)
-                    return error("%s: txid mismatch", __func__);
+        if (g_txindex) {
+            if (g_txindex->FindTx(hash, hashBlock, txOut))
                 return true;
-            }
 
-            // transaction not found in index, nothing more can be done
-            return false;
+            // transaction not found in a synced index, nothing more can be done
+            if (g_txindex->IsSynced())
+                return false;
         }
 
         if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
@@ -2180,7 +2214,8 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, const Consensus::P
     if (pindexSlow) {
         CBlock block;
         if (ReadBlockFromDisk(block, pindexSlow, consensusParams)) {
-            for (const CTransaction &tx : block.vtx) {
+            for (const CTransactionRef& ptx : block.vtx) {
+                const CTransaction& tx = *ptx;
                 if (tx.GetHash() == hash) {
                     txOut = tx;
                     hashBlock = pindexSlow->GetBlockHash();
@@ -2198,7 +2233,82 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, const Consensus::P
 // CBlock and CBlockIndex
 //
 
-bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+/**
+ * Serialize obj as the payload of a block or undo file record, compressed if
+ * -compressblocks is set and that makes it smaller. Returns the size field of
+ * the record header.
+ */
+template <typename T>
+static unsigned int EncodeDiskRecord(const T& obj, std::vector<unsigned char>& record)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << obj;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(ss.data());
+    if (fCompressBlocks) {
+        std::vector<unsigned char> compressed;
+        CompressLZ4(data, ss.size(), compressed);
+        if (compressed.size() + sizeof(uint32_t) < ss.size()) {
+            record.resize(sizeof(uint32_t));
+            WriteLE32(record.data(), ss.size());
+            record.insert(record.end(), compressed.begin(), compressed.end());
+            return record.size() | DISK_RECORD_COMPRESSED;
+        }
+    }
+    record.assign(data, data + ss.size());
+    return record.size();
+}
+
+/**
+ * Read the LZ4 frame of a compressed record payload of nSize bytes from s and
+ * decompress it into data. Throws if the frame is corrupt or would decompress
+ * to more than nMaxSize bytes.
+ */
+template <typename Stream, typename Vector>
+static void ReadCompressedRecord(Stream& s, unsigned int nSize, unsigned int nMaxSize, Vector& data)
+{
+    if (nSize < sizeof(uint32_t) || nSize > nMaxSize)
+        throw std::ios_base::failure("ReadCompressedRecord: invalid record size");
+    std::vector<unsigned char> frame(nSize);
+    s.read((char*)frame.data(), nSize);
+    uint32_t nRawSize = ReadLE32(frame.data());
+    if (nRawSize > nMaxSize)
+        throw std::ios_base::failure("ReadCompressedRecord: uncompressed size too large");
+    data.resize(nRawSize);
+    if (!DecompressLZ4(frame.data() + sizeof(uint32_t), nSize - sizeof(uint32_t), (unsigned char*)data.data(), nRawSize))
+        throw std::ios_base::failure("ReadCompressedRecord: corrupt compressed data");
+}
+
+/**
+ * Open a block or undo file at the header of the record whose payload is at
+ * pos, and read the size field of the header, leaving the file positioned at
+ * the payload. Returns NULL if the header cannot be read.
+ */
+static FILE* OpenDiskRecord(const CDiskBlockPos& pos, bool fUndo, unsigned int& nSize)
+{
+    const unsigned int nHeaderSize = CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t);
+    if (pos.IsNull() || pos.nPos < nHeaderSize)
+        return NULL;
+
+    CDiskBlockPos hpos(pos.nFile, pos.nPos - nHeaderSize);
+    CAutoFile filein(fUndo ? OpenUndoFile(hpos, true) : OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return NULL;
+    try {
+        filein.ignore(CMessageHeader::MESSAGE_START_SIZE);
+        filein >> nSize;
+    } catch (const std::exception& e) {
+        error("%s: Read from %s file failed: %s for %s", __func__, fUndo ? "undo" : "block", e.what(), pos.ToString());
+        return NULL;
+    }
+    return filein.release();
+}
+
+unsigned int EncodeBlockRecord(const CBlock& block, std::vector<unsigned char>& record)
+{
+    return EncodeDiskRecord(block, record);
+}
+
+bool WriteBlockToDisk(const std::vector<unsigned char>& record, unsigned int nSize, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
     CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
@@ -2206,7 +2316,6 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
         return error("WriteBlockToDisk: OpenBlockFile failed");
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(fileout, block);
     fileout << FLATDATA(messageStart) << nSize;
 
     // Write block
@@ -2214,7 +2323,7 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     if (fileOutPos < 0)
         return error("WriteBlockToDisk: ftell failed");
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    fileout.write((const char*)record.data(), record.size());
 
     return true;
 }
@@ -2224,13 +2333,20 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
     block.SetNull();
 
     // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    unsigned int nSize = 0;
+    CAutoFile filein(OpenDiskRecord(pos, false, nSize), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
     // Read block
     try {
-        filein >> block;
+        if (nSize & DISK_RECORD_COMPRESSED) {
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            ReadCompressedRecord(filein, nSize & ~DISK_RECORD_COMPRESSED, MAX_BLOCK_SIZE, ss);
+            ss >> block;
+        } else {
+            filein >> block;
+        }
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -2251,11 +2367,197 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
                 pindex->ToString(), pindex->GetBlockPos().ToString());
     }
 
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams))
+    std::shared_ptr<const CBlock> pblock = blockcache.Get(pindex->GetBlockHash());
+    if (pblock) {
+        MetricsIncrementCounter("zcash.blockcache.hits");
+        block = *pblock;
+        return true;
+    }
+    MetricsIncrementCounter("zcash.blockcache.misses");
+
+    // Callers that don't hold cs_main may race with the block being moved.
+    CBlockFileReader reader;
+    const CDiskBlockPos pos = pindex->GetBlockPos();
+    if (!ReadBlockFromDisk(block, pos, consensusParams))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
-                pindex->ToString(), pindex->GetBlockPos().ToString());
+                pindex->ToString(), pos.ToString());
+    if (blockcache.RecordMiss(pindex->GetBlockHash()))
+        blockcache.Add(std::make_shared<const CBlock>(block));
+    return true;
+}
+
+std::shared_ptr<const CBlock> ReadSharedBlockFromDisk(const uint256& hash, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+{
+    std::shared_ptr<const CBlock> pblock = blockcache.Get(hash);
+    if (pblock) {
+        MetricsIncrementCounter("zcash.blockcache.hits");
+        return pblock;
+    }
+    MetricsIncrementCounter("zcash.blockcache.misses");
+
+    auto pblockRead = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(*pblockRead, pos, consensusParams) || pblockRead->GetHash() != hash)
+        return nullptr;
+    pblock = pblockRead;
+    if (blockcache.RecordMiss(hash))
+        blockcache.Add(pblock);
+    return pblock;
+}
+
+static void RemoveBlockFile(int nFile)
+{
+    // A file that is still open cannot be deleted on every platform; it is
+    // then left behind, and deleted the next time the node starts.
+    CDiskBlockPos pos(nFile, 0);
+    boost::system::error_code ec;
+    fs::remove(GetBlockPosFilename(pos, "blk"), ec);
+    fs::remove(GetBlockPosFilename(pos, "rev"), ec);
+    if (ec)
+        LogPrintf("%s: Failed to delete blk/rev (%05u): %s\n", __func__, nFile, ec.message());
+}
+
+CBlockFileReader::CBlockFileReader()
+{
+    LOCK(cs_BlockFileReaders);
+    nBlockFileReaders++;
+}
+
+CBlockFileReader::~CBlockFileReader()
+{
+    std::set<int> setToRemove;
+    {
+        LOCK(cs_BlockFileReaders);
+        if (--nBlockFileReaders == 0)
+            setToRemove.swap(setBlockFilesToRemove);
+    }
+    for (int nFile : setToRemove)
+        RemoveBlockFile(nFile);
+}
+
+/**
+ * Delete a block file that nothing in the block index or the transaction
+ * index refers to any more, once every reader that may have looked up a
+ * position in it before then is done.
+ */
+static void RemoveBlockFileWhenUnread(int nFile)
+{
+    {
+        LOCK(cs_BlockFileReaders);
+        if (nBlockFileReaders > 0) {
+            setBlockFilesToRemove.insert(nFile);
+            return;
+        }
+    }
+    RemoveBlockFile(nFile);
+}
+
+FILE* OpenRawBlock(const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, unsigned int& nSize, bool& fCompressed)
+{
+    // Blocks are stored after a record header of the message start and size.
+    const unsigned int nHeaderSize = CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t);
+    if (pos.IsNull() || pos.nPos < nHeaderSize) {
+        error("%s: invalid block position %s", __func__, pos.ToString());
+        return NULL;
+    }
+
+    CDiskBlockPos hpos(pos.nFile, pos.nPos - nHeaderSize);
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+        return NULL;
+    }
+
+    try {
+        CMessageHeader::MessageStartChars blk_start;
+        filein >> FLATDATA(blk_start) >> nSize;
+        if (memcmp(blk_start, messageStart, CMessageHeader::MESSAGE_START_SIZE) != 0) {
+            error("%s: Block magic mismatch for %s", __func__, pos.ToString());
+            return NULL;
+        }
+        fCompressed = (nSize & DISK_RECORD_COMPRESSED) != 0;
+        nSize &= ~DISK_RECORD_COMPRESSED;
+        if (nSize > MAX_BLOCK_SIZE) {
+            error("%s: Block data is larger than maximum deserialization size for %s", __func__, pos.ToString());
+            return NULL;
+        }
+    } catch (const std::exception& e) {
+        error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+        return NULL;
+    }
+
+    return filein.release();
+}
+
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    unsigned int nSize;
+    bool fCompressed;
+    CAutoFile filein(OpenRawBlock(pos, messageStart, nSize, fCompressed), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return false;
+
+    try {
+        if (fCompressed) {
+            ReadCompressedRecord(filein, nSize, MAX_BLOCK_SIZE, block);
+        } else {
+            block.resize(nSize);
+            filein.read((char*)block.data(), nSize);
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const uint256& hash, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    // A block read as raw bytes is not added to the cache on a miss, as that
+    // would mean deserializing it; the blocks these are asked for, near the
+    // tip, are there anyway.
+    CBlockCache::RawBlockRef raw = blockcache.GetRaw(hash);
+    if (raw) {
+        MetricsIncrementCounter("zcash.blockcache.hits");
+        block.assign(raw->begin(), raw->end());
+        return true;
+    }
+    MetricsIncrementCounter("zcash.blockcache.misses");
+    return ReadRawBlockFromDisk(block, pos, messageStart);
+}
+
+bool GetCompactBlock(const CBlockIndex* pindex, std::vector<uint8_t>& data, const Consensus::Params& consensusParams)
+{
+    AssertLockHeld(cs_main);
+
+    // The store is keyed by height, and the entry records the hash of the
+    // block it was built from, so an entry for a block that has since been
+    // reorged out is treated as a miss.
+    if (pcompactblocks && pcompactblocks->ReadCompactBlock(pindex->nHeight, pindex->GetBlockHash(), data)) {
+        MetricsIncrementCounter("zcash.compactblocks.hits");
+        return true;
+    }
+    MetricsIncrementCounter("zcash.compactblocks.misses");
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, consensusParams))
+        return false;
+
+    // The note commitment tree sizes after this block, as in getblock.
+    uint64_t nSaplingTreeSize = 0;
+    SaplingMerkleTree saplingTree;
+    if (pcoinsTip->GetSaplingAnchorAt(pindex->hashFinalSaplingRoot, saplingTree))
+        nSaplingTreeSize = saplingTree.size();
+    uint64_t nOrchardTreeSize = 0;
+    OrchardMerkleFrontier orchardTree;
+    if (pcoinsTip->GetOrchardAnchorAt(pindex->hashFinalOrchardRoot, orchardTree))
+        nOrchardTreeSize = orchardTree.size();
+
+    data = BuildCompactBlock(block, pindex, nSaplingTreeSize, nOrchardTreeSize);
+
+    // Only blocks in the active chain own their height's entry.
+    if (pcompactblocks && chainActive.Contains(pindex))
+        pcompactblocks->WriteCompactBlock(pindex->nHeight, pindex->GetBlockHash(), data);
     return true;
 }
 
@@ -2699,7 +3001,11 @@ bool ContextualCheckInputs(
 
 namespace {
 
-bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+/**
+ * Write undo data encoded by EncodeDiskRecord, followed by a checksum of the
+ * uncompressed data that commits to the hash of the block's parent.
+ */
+bool UndoWriteToDisk(const CBlockUndo& blockundo, const std::vector<unsigned char>& record, unsigned int nSize, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
     CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
@@ -2707,7 +3013,6 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
         return error("%s: OpenUndoFile failed", __func__);
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(fileout, blockundo);
     fileout << FLATDATA(messageStart) << nSize;
 
     // Write undo data
@@ -2715,7 +3020,7 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     if (fileOutPos < 0)
         return error("%s: ftell failed", __func__);
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+    fileout.write((const char*)record.data(), record.size());
 
     // calculate & write checksum
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
@@ -2726,17 +3031,26 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
+} // anon namespace
+
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
     // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    unsigned int nSize = 0;
+    CAutoFile filein(OpenDiskRecord(pos, true, nSize), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("%s: OpenBlockFile failed", __func__);
 
     // Read block
     uint256 hashChecksum;
     try {
-        filein >> blockundo;
+        if (nSize & DISK_RECORD_COMPRESSED) {
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            ReadCompressedRecord(filein, nSize & ~DISK_RECORD_COMPRESSED, MAX_SIZE, ss);
+            ss >> blockundo;
+        } else {
+            filein >> blockundo;
+        }
         filein >> hashChecksum;
     }
     catch (const std::exception& e) {
@@ -2753,8 +3067,6 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
     return true;
 }
 
-} // anon namespace
-
 /**
  * Apply the undo operation of a CTxInUndo to the given chain state.
  * @param undo The undo object.
@@ -2797,7 +3109,7 @@ enum DisconnectResult
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When UNCLEAN or FAILED is returned, view is left in an indeterminate state.
- *  The addressIndex and spentIndex will be updated if requested.
+ *  The compact block store will be updated if requested.
  */
 static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& state,
     const CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams,
@@ -2822,37 +3134,12 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
         error("DisconnectBlock(): block and undo data inconsistent");
         return DISCONNECT_FAILED;
     }
-    std::vector<CAddressIndexDbEntry> addressIndex;
-    std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
-    std::vector<CSpentIndexDbEntry> spentIndex;
 
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
-        const CTransaction &tx = block.vtx[i];
+        const CTransaction &tx = *block.vtx[i];
         uint256 const hash = tx.GetHash();
 
-        // insightexplorer
-        // https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-7ec3c68a81efff79b6ca22ac1f1eabbaR2236
-        if (fAddressIndex && updateIndices) {
-            for (unsigned int k = tx.vout.size(); k-- > 0;) {
-                const CTxOut &out = tx.vout[k];
-                CScript::ScriptType scriptType = out.scriptPubKey.GetType();
-                if (scriptType != CScript::UNKNOWN) {
-                    uint160 const addrHash = out.scriptPubKey.AddressHash();
-
-                    // undo receiving activity
-                    addressIndex.push_back(make_pair(
-                        CAddressIndexKey(scriptType, addrHash, pindex->nHeight, i, hash, k, false),
-                        out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(make_pair(
-                        CAddressUnspentKey(scriptType, addrHash, hash, k),
-                        CAddressUnspentValue()));
-                }
-            }
-        }
-
         // Check that all outputs are available and match the outputs in the block itself
         // exactly.
         {
@@ -2887,34 +3174,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
                 const CTxInUndo &undo = txundo.vprevout[j];
                 if (!ApplyTxInUndo(undo, view, out))
                     fClean = false;
-
-                // insightexplorer
-                // https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-7ec3c68a81efff79b6ca22ac1f1eabbaR2304
-                const CTxIn input = tx.vin[j];
-                if (fAddressIndex && updateIndices) {
-                    const CTxOut &prevout = view.GetOutputFor(input);
-                    CScript::ScriptType scriptType = prevout.scriptPubKey.GetType();
-                    if (scriptType != CScript::UNKNOWN) {
-                        uint160 const addrHash = prevout.scriptPubKey.AddressHash();
-
-                        // undo spending activity
-                        addressIndex.push_back(make_pair(
-                            CAddressIndexKey(scriptType, addrHash, pindex->nHeight, i, hash, j, true),
-                            prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(make_pair(
-                            CAddressUnspentKey(scriptType, addrHash, input.prevout.hash, input.prevout.n),
-                            CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
-                    }
-                }
-                // insightexplorer
-                if (fSpentIndex && updateIndices) {
-                    // undo and delete the spent index
-                    spentIndex.push_back(make_pair(
-                        CSpentIndexKey(input.prevout.hash, input.prevout.n),
-                        CSpentIndexValue()));
-                }
             }
         }
     }
@@ -2977,21 +3236,10 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    // insightexplorer
-    if (fAddressIndex && updateIndices) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            AbortNode(state, "Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            AbortNode(state, "Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-    // insightexplorer
-    if (fSpentIndex && updateIndices) {
-        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
-            AbortNode(state, "Failed to write transaction index");
+    // lightwalletd
+    if (pcompactblocks && updateIndices) {
+        if (!pcompactblocks->EraseCompactBlock(pindex->nHeight)) {
+            AbortNode(state, "Failed to delete compact block");
             return DISCONNECT_FAILED;
         }
     }
@@ -3190,7 +3438,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     // Do not allow blocks that contain transactions which 'overwrite' older transactions,
     // unless those are already completely spent.
-    for (const CTransaction& tx : block.vtx) {
+    for (const CTransactionRef& ptx : block.vtx) {
+        const CTransaction& tx = *ptx;
         const CCoins* coins = view.AccessCoins(tx.GetHash());
         if (coins && !coins->IsPruned())
             return state.DoS(100, error("%s: tried to overwrite transaction", __func__),
@@ -3210,14 +3459,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     CAmount nFees = 0;
     int nInputs = 0;
     unsigned int nSigOps = 0;
-    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
-    vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
-    std::vector<CAddressIndexDbEntry> addressIndex;
-    std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
-    std::vector<CSpentIndexDbEntry> spentIndex;
-
     // Construct the incremental merkle tree at the current
     // block position,
     auto old_sprout_tree_root = view.GetBestAnchor(SPROUT);
@@ -3278,7 +3520,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
-        const CTransaction &tx = block.vtx[i];
+        const CTransaction &tx = *block.vtx[i];
         const uint256 hash = tx.GetHash();
 
         nInputs += tx.vin.size();
@@ -3316,44 +3558,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 auto itByPrev = mapOrphanTransactionsByPrev.find(tx.vin[j].prevout);
                 if (itByPrev == mapOrphanTransactionsByPrev.end()) continue;
                 for (auto mi = itByPrev->second.begin(); mi != itByPrev->second.end(); ++mi) {
-                    const CTransaction& orphanTx = (*mi)->second.tx;
+                    const CTransaction& orphanTx = *(*mi)->second.tx;
                     const uint256& orphanHash = orphanTx.GetHash();
                     vOrphanErase.push_back(orphanHash);
                 }
             }
 
-            // insightexplorer
-            // https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-7ec3c68a81efff79b6ca22ac1f1eabbaR2597
-            if (fAddressIndex || fSpentIndex) {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = allPrevOutputs[j];
-                    CScript::ScriptType scriptType = prevout.scriptPubKey.GetType();
-                    const uint160 addrHash = prevout.scriptPubKey.AddressHash();
-                    if (fAddressIndex && scriptType != CScript::UNKNOWN) {
-                        // record spending activity
-                        addressIndex.push_back(make_pair(
-                            CAddressIndexKey(scriptType, addrHash, pindex->nHeight, i, hash, j, true),
-                            prevout.nValue * -1));
-
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(make_pair(
-                            CAddressUnspentKey(scriptType, addrHash, input.prevout.hash, input.prevout.n),
-                            CAddressUnspentValue()));
-                    }
-                    if (fSpentIndex) {
-                        // Add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input.
-                        // If we do not recognize the script type, we still add an entry to the
-                        // spentindex db, with a script type of 0 and addrhash of all zeroes.
-                        spentIndex.push_back(make_pair(
-                            CSpentIndexKey(input.prevout.hash, input.prevout.n),
-                            CSpentIndexValue(hash, j, pindex->nHeight, prevout.nValue, scriptType, addrHash)));
-                    }
-                }
-            }
-
             // Add in sigops done by pay-to-script-hash inputs;
             // this is to prevent a "rogue miner" from creating
             // an incredibly-expensive-to-validate block.
@@ -3409,28 +3619,6 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 FormatStateMessage(state));
         }
 
-        // insightexplorer
-        // https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-7ec3c68a81efff79b6ca22ac1f1eabbaR2656
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-                CScript::ScriptType scriptType = out.scriptPubKey.GetType();
-                if (scriptType != CScript::UNKNOWN) {
-                    uint160 const addrHash = out.scriptPubKey.AddressHash();
-
-                    // record receiving activity
-                    addressIndex.push_back(make_pair(
-                        CAddressIndexKey(scriptType, addrHash, pindex->nHeight, i, hash, k, false),
-                        out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(make_pair(
-                        CAddressUnspentKey(scriptType, addrHash, hash, k),
-                        CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                }
-            }
-        }
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -3497,9 +3685,6 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (tx.GetOrchardBundle().IsPresent()) {
             total_orchard_tx += 1;
         }
-
-        vPos.push_back(std::make_pair(tx.GetHash(), pos));
-        pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
     }
 
     // Derive the various block commitments.
@@ -3646,7 +3831,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     int64_t nTime1 = GetTimeMicros(); nTimeConnect += nTime1 - nTimeStart;
     LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs-1), nTimeConnect * 0.000001);
 
-    CAmount cbTotalOutputValue = block.vtx[0].GetValueOut() + pindex->nLockboxValue;
+    CAmount cbTotalOutputValue = block.vtx[0]->GetValueOut() + pindex->nLockboxValue;
     CAmount cbTotalInputValue = consensusParams.GetBlockSubsidy(pindex->nHeight) + nFees;
     if (cbTotalOutputValue > cbTotalInputValue) {
         return state.DoS(100,
@@ -3714,10 +3899,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if (pindex->GetUndoPos().IsNull() || !pindex->IsValid(BLOCK_VALID_SCRIPTS))
     {
         if (pindex->GetUndoPos().IsNull()) {
+            std::vector<unsigned char> record;
+            unsigned int nSize = EncodeDiskRecord(blockundo, record);
             CDiskBlockPos _pos;
-            if (!FindUndoPos(state, pindex->nFile, _pos, ::GetSerializeSize(blockundo, SER_DISK, CLIENT_VERSION) + 40))
+            if (!FindUndoPos(state, pindex->nFile, _pos, record.size() + 40))
                 return error("%s: FindUndoPos failed", __func__);
-            if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
+            if (!UndoWriteToDisk(blockundo, record, nSize, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
                 return AbortNode(state, "Failed to write undo data");
 
             // update nUndoPos in block index
@@ -3740,45 +3927,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         setDirtyBlockIndex.insert(pindex);
     }
 
-    if (fTxIndex)
-        if (!pblocktree->WriteTxIndex(vPos))
-            return AbortNode(state, "Failed to write transaction index");
-
-    // START insightexplorer
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-    }
-    if (fSpentIndex) {
-        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
-            return AbortNode(state, "Failed to write spent index");
-        }
-    }
-    if (fTimestampIndex) {
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
-
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+    // lightwalletd
+    if (pcompactblocks) {
+        auto compactBlock = BuildCompactBlock(block, pindex, sapling_tree.size(), orchard_tree.size());
+        if (!pcompactblocks->WriteCompactBlock(pindex->nHeight, pindex->GetBlockHash(), compactBlock)) {
+            return AbortNode(state, "Failed to write compact block");
         }
-
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
     }
-    // END insightexplorer
 
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
@@ -3805,6 +3960,45 @@ enum FlushStateMode {
     FLUSH_STATE_ALWAYS
 };
 
+/**
+ * Flush block and undo data to disk, then write the dirty block file
+ * information and block index entries.
+ */
+static bool WriteBlockIndexToDisk(CValidationState& state)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_LastBlockFile);
+
+    // Depend on nMinDiskSpace to ensure we can write block index
+    if (!CheckDiskSpace(0))
+        return state.Error("out of disk space");
+    // First make sure all block and undo data is flushed to disk.
+    FlushBlockFile();
+    // Then update all block file information (which may refer to block and undo files).
+    std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
+    vFiles.reserve(setDirtyFileInfo.size());
+    for (set<int>::iterator it = setDirtyFileInfo.begin(); it != setDirtyFileInfo.end(); ) {
+        vFiles.push_back(make_pair(*it, &vinfoBlockFile[*it]));
+        it = setDirtyFileInfo.erase(it);
+    }
+    std::vector<CBlockIndex*> vBlocks;
+    vBlocks.reserve(setDirtyBlockIndex.size());
+    for (set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
+        vBlocks.push_back(*it);
+        it = setDirtyBlockIndex.erase(it);
+    }
+    if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
+        return AbortNode(state, "Files to write to block index database");
+    }
+    // Now that we have written the block indices to the database, we do not
+    // need to store solutions for these CBlockIndex objects in memory.
+    // cs_main must be held here.
+    for (CBlockIndex *pblockindex : vBlocks) {
+        pblockindex->TrimSolution();
+    }
+    return true;
+}
+
 /**
  * Update the on-disk chain state.
  * The caches and indexes are flushed depending on the mode we're called with
@@ -3853,38 +4047,13 @@ bool static FlushStateToDisk(
     bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
     // Write blocks and block index to disk.
     if (fDoFullFlush || fPeriodicWrite) {
-        // Depend on nMinDiskSpace to ensure we can write block index
-        if (!CheckDiskSpace(0))
-            return state.Error("out of disk space");
-        // First make sure all block and undo data is flushed to disk.
-        FlushBlockFile();
-        // Then update all block file information (which may refer to block and undo files).
-        {
-            std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
-            vFiles.reserve(setDirtyFileInfo.size());
-            for (set<int>::iterator it = setDirtyFileInfo.begin(); it != setDirtyFileInfo.end(); ) {
-                vFiles.push_back(make_pair(*it, &vinfoBlockFile[*it]));
-                it = setDirtyFileInfo.erase(it);
-            }
-            std::vector<CBlockIndex*> vBlocks;
-            vBlocks.reserve(setDirtyBlockIndex.size());
-            for (set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
-                vBlocks.push_back(*it);
-                it = setDirtyBlockIndex.erase(it);
-            }
-            if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
-                return AbortNode(state, "Files to write to block index database");
-            }
-            // Now that we have written the block indices to the database, we do not
-            // need to store solutions for these CBlockIndex objects in memory.
-            // cs_main must be held here.
-            for (CBlockIndex *pblockindex : vBlocks) {
-                pblockindex->TrimSolution();
-            }
-        }
+        if (!WriteBlockIndexToDisk(state))
+            return false;
         // Finally remove any pruned files
-        if (fFlushForPrune)
+        if (fFlushForPrune) {
             UnlinkPrunedFiles(setFilesToPrune);
+            PublishPruneHeight();
+        }
         nLastWrite = nNow;
     }
     // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -4013,9 +4182,110 @@ struct PoolMetrics {
         }                                        \
     } while (0)
 
+static std::shared_ptr<const CChainTipSnapshot> g_chain_tip_snapshot;
+
+/**
+ * Lowest height from which every block in the active chain has its data, if
+ * pruning is enabled, or -1 if it has not been found yet. It is found once by
+ * walking back from the tip, and then raised as block files are pruned.
+ */
+static int nChainPruneHeight GUARDED_BY(cs_main) = -1;
+
+/** Publish a snapshot of the current chain tip for GetChainTipSnapshot. */
+static void PublishChainTipSnapshot(const CChainParams& chainParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+
+    auto snapshot = std::make_shared<CChainTipSnapshot>();
+    CBlockIndex* pindex = chainActive.Tip();
+    if (pindex) {
+        snapshot->pindex = pindex;
+        snapshot->nHeight = pindex->nHeight;
+        snapshot->hash = pindex->GetBlockHash();
+        snapshot->nMedianTimePast = pindex->GetMedianTimePast();
+        snapshot->fInitialBlockDownload = IsInitialBlockDownload(chainParams.GetConsensus());
+
+        // The Sprout tree only changes in blocks with JoinSplits, so it is
+        // only read from the coins view when its anchor has changed.
+        auto previous = std::atomic_load(&g_chain_tip_snapshot);
+        snapshot->hashSproutAnchor = pcoinsTip->GetBestAnchor(SPROUT);
+        if (previous && previous->pindex && previous->hashSproutAnchor == snapshot->hashSproutAnchor) {
+            snapshot->nSproutCommitments = previous->nSproutCommitments;
+        } else {
+            SproutMerkleTree tree;
+            pcoinsTip->GetSproutAnchorAt(snapshot->hashSproutAnchor, tree);
+            snapshot->nSproutCommitments = tree.size();
+        }
+
+        if (fPruneMode) {
+            if (nChainPruneHeight < 0) {
+                CBlockIndex* block = pindex;
+                while (block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA))
+                    block = block->pprev;
+                nChainPruneHeight = block->nHeight;
+            }
+            snapshot->nPruneHeight = nChainPruneHeight;
+        }
+    }
+    snapshot->nBestHeaderHeight = pindexBestHeader ? pindexBestHeader->nHeight : -1;
+
+    std::atomic_store(&g_chain_tip_snapshot, std::shared_ptr<const CChainTipSnapshot>(std::move(snapshot)));
+}
+
+/** Republish the chain tip snapshot after pindexBestHeader has advanced. */
+static void PublishBestHeader(const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+
+    auto previous = std::atomic_load(&g_chain_tip_snapshot);
+    if (!previous) {
+        // The next GetChainTipSnapshot will publish a complete snapshot.
+        return;
+    }
+    auto snapshot = std::make_shared<CChainTipSnapshot>(*previous);
+    snapshot->nBestHeaderHeight = pindexBestHeader ? pindexBestHeader->nHeight : -1;
+    if (snapshot->pindex) {
+        snapshot->fInitialBlockDownload = IsInitialBlockDownload(consensusParams);
+    }
+
+    std::atomic_store(&g_chain_tip_snapshot, std::shared_ptr<const CChainTipSnapshot>(std::move(snapshot)));
+}
+
+/** Republish the chain tip snapshot after block files have been pruned. */
+static void PublishPruneHeight() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+
+    auto previous = std::atomic_load(&g_chain_tip_snapshot);
+    if (!previous || !previous->nPruneHeight.has_value() || nChainPruneHeight < 0) {
+        // The next GetChainTipSnapshot will publish a complete snapshot.
+        return;
+    }
+    auto snapshot = std::make_shared<CChainTipSnapshot>(*previous);
+    snapshot->nPruneHeight = nChainPruneHeight;
+
+    std::atomic_store(&g_chain_tip_snapshot, std::shared_ptr<const CChainTipSnapshot>(std::move(snapshot)));
+}
+
+std::shared_ptr<const CChainTipSnapshot> GetChainTipSnapshot()
+{
+    auto snapshot = std::atomic_load(&g_chain_tip_snapshot);
+    if (!snapshot) {
+        // Nothing has been published since the block index was (un)loaded.
+        LOCK(cs_main);
+        snapshot = std::atomic_load(&g_chain_tip_snapshot);
+        if (!snapshot) {
+            PublishChainTipSnapshot(Params());
+            snapshot = std::atomic_load(&g_chain_tip_snapshot);
+        }
+    }
+    return snapshot;
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
     chainActive.SetTip(pindexNew);
+    PublishChainTipSnapshot(chainParams);
 
     // New best block
     nTimeBestReceived = GetTime();
@@ -4078,7 +4348,7 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
     int64_t nStart = GetTimeMicros();
     {
         CCoinsViewCache view(pcoinsTip);
-        // insightexplorer: update indices (true)
+        // lightwalletd: update the compact block store (true)
         if (DisconnectBlock(block, state, pindexDelete, view, chainparams, true) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         assert(view.Flush());
@@ -4094,11 +4364,12 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
     if (!fBare) {
         // Resurrect mempool transactions from the disconnected block.
         std::vector<uint256> vHashUpdate;
-        for (const CTransaction &tx : block.vtx) {
+        for (const CTransactionRef &ptx : block.vtx) {
+            const CTransaction &tx = *ptx;
             // ignore validation errors in resurrected transactions
             list<CTransaction> removed;
             CValidationState stateDummy;
-            if (tx.IsCoinBase() || !AcceptToMemoryPool(chainparams, mempool, stateDummy, tx, false, NULL)) {
+            if (tx.IsCoinBase() || !AcceptToMemoryPool(chainparams, mempool, stateDummy, ptx, false, NULL)) {
                 mempool.remove(tx, removed, true);
             } else if (mempool.exists(tx.GetHash())) {
                 vHashUpdate.push_back(tx.GetHash());
@@ -4129,6 +4400,7 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
 
     // Update chainActive and related variables.
     UpdateTip(pindexDelete->pprev, chainparams);
+    GetMainSignals().BlockDisconnected(pindexDelete);
 
     // Updates to connected wallets are triggered by ThreadNotifyWallets
 
@@ -4191,6 +4463,13 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
 
     // Update chainActive & related variables.
     UpdateTip(pindexNew, chainparams);
+    GetMainSignals().BlockConnected(pindexNew);
+
+    // The wallet, indexes, notifiers and peers each read the new tip soon
+    // after it is connected. Nothing reads the blocks connected during
+    // initial block download, so those are not copied into the cache.
+    if (!IsInitialBlockDownload(chainparams.GetConsensus()))
+        blockcache.Add(std::make_shared<const CBlock>(*pblock));
 
     // Cache the conflicted transactions for subsequent notification.
     // Updates to connected wallets are triggered by ThreadNotifyWallets
@@ -4656,8 +4935,10 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const Consensus::Params&
     }
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
     pindexNew->RaiseValidity(BLOCK_VALID_TREE);
-    if (pindexBestHeader == NULL || pindexBestHeader->nChainWork < pindexNew->nChainWork)
+    if (pindexBestHeader == NULL || pindexBestHeader->nChainWork < pindexNew->nChainWork) {
         pindexBestHeader = pindexNew;
+        PublishBestHeader(consensusParams);
+    }
 
     setDirtyBlockIndex.insert(pindexNew);
 
@@ -4731,7 +5012,8 @@ void SetChainPoolValues(
     }
     LogPrint("valuepool", "%s: Lockbox value is %d at height %d", __func__, lockboxValue, pindex->nHeight);
 
-    for (auto tx : block.vtx) {
+    for (const CTransactionRef& ptx : block.vtx) {
+        const CTransaction& tx = *ptx;
         // For the genesis block only, compute the chain supply delta and the transparent
         // output total.
         if (pindex->pprev == nullptr) {
@@ -4779,6 +5061,82 @@ void SetChainPoolValues(
     pindex->nChainLockboxValue = std::nullopt;
 }
 
+/**
+ * Set the transaction count and the value pools of the chain up to a block
+ * whose parent has them set, and to any of its descendants that were waiting
+ * for it, and make them candidates for the active chain tip.
+ */
+static void LinkBlockTransactions(CBlockIndex *pindexFirst, const CChainParams& chainparams)
+{
+    deque<CBlockIndex*> queue;
+    queue.push_back(pindexFirst);
+
+    // Recursively process any descendant blocks that now may be eligible to be connected.
+    while (!queue.empty()) {
+        CBlockIndex *pindex = queue.front();
+        queue.pop_front();
+        pindex->nChainTx = (pindex->pprev ? pindex->pprev->nChainTx : 0) + pindex->nTx;
+
+        if (pindex->pprev) {
+            // Transparent value and chain total supply are added to the
+            // block index only in `ConnectBlock`, because that's the only
+            // place that we have a valid coins view with which to compute
+            // the transparent input value and fees.
+
+            // Calculate the block's effect on the Sprout chain value pool balance.
+            if (pindex->pprev->nChainSproutValue && pindex->nSproutValue) {
+                pindex->nChainSproutValue = *pindex->pprev->nChainSproutValue + *pindex->nSproutValue;
+            } else {
+                pindex->nChainSproutValue = std::nullopt;
+            }
+
+            // Calculate the block's effect on the Sapling chain value pool balance.
+            if (pindex->pprev->nChainSaplingValue) {
+                pindex->nChainSaplingValue = *pindex->pprev->nChainSaplingValue + pindex->nSaplingValue;
+            } else {
+                pindex->nChainSaplingValue = std::nullopt;
+            }
+
+            // Calculate the block's effect on the Orchard chain value pool balance.
+            if (pindex->pprev->nChainOrchardValue) {
+                pindex->nChainOrchardValue = *pindex->pprev->nChainOrchardValue + pindex->nOrchardValue;
+            } else {
+                pindex->nChainOrchardValue = std::nullopt;
+            }
+
+            // Calculate the block's effect on the Lockbox balance
+            if (pindex->pprev->nChainLockboxValue) {
+                pindex->nChainLockboxValue = *pindex->pprev->nChainLockboxValue + pindex->nLockboxValue;
+            } else {
+                pindex->nChainLockboxValue = std::nullopt;
+            }
+        } else {
+            pindex->nChainTotalSupply = pindex->nChainSupplyDelta;
+            pindex->nChainTransparentValue = pindex->nTransparentValue;
+            pindex->nChainSproutValue = pindex->nSproutValue;
+            pindex->nChainSaplingValue = pindex->nSaplingValue;
+            pindex->nChainOrchardValue = pindex->nOrchardValue;
+            pindex->nChainLockboxValue = pindex->nLockboxValue;
+        }
+
+        // Fall back to hardcoded Sprout value pool balance
+        FallbackSproutValuePoolBalance(pindex, chainparams);
+
+        {
+            LOCK(cs_nBlockSequenceId);
+            pindex->nSequenceId = nBlockSequenceId++;
+        }
+        if (chainActive.Tip() == NULL || !setBlockIndexCandidates.value_comp()(pindex, chainActive.Tip())) {
+            setBlockIndexCandidates.insert(pindex);
+        }
+        std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapBlocksUnlinked.equal_range(pindex);
+        while (range.first != range.second) {
+            queue.push_back(range.first->second);
+            range.first = mapBlocksUnlinked.erase(range.first);
+        }
+    }
+}
+
 /**
  * Mark a block as having its data received and checked (up to BLOCK_VALID_TRANSACTIONS).
  * The caller is expected to mark `pindexNew` as dirty by adding it to `setDirtyBlockIndex`.
@@ -4801,73 +5159,7 @@ bool ReceivedBlockTransactions(
 
     if (pindexNew->pprev == NULL || pindexNew->pprev->nChainTx) {
         // If pindexNew is the genesis block or all parents are BLOCK_VALID_TRANSACTIONS.
-        deque<CBlockIndex*> queue;
-        queue.push_back(pindexNew);
-
-        // Recursively process any descendant blocks that now may be eligible to be connected.
-        while (!queue.empty()) {
-            CBlockIndex *pindex = queue.front();
-            queue.pop_front();
-            pindex->nChainTx = (pindex->pprev ? pindex->pprev->nChainTx : 0) + pindex->nTx;
-
-            if (pindex->pprev) {
-                // Transparent value and chain total supply are added to the
-                // block index only in `ConnectBlock`, because that's the only
-                // place that we have a valid coins view with which to compute
-                // the transparent input value and fees.
-
-                // Calculate the block's effect on the Sprout chain value pool balance.
-                if (pindex->pprev->nChainSproutValue && pindex->nSproutValue) {
-                    pindex->nChainSproutValue = *pindex->pprev->nChainSproutValue + *pindex->nSproutValue;
-                } else {
-                    pindex->nChainSproutValue = std::nullopt;
-                }
-
-                // Calculate the block's effect on the Sapling chain value pool balance.
-                if (pindex->pprev->nChainSaplingValue) {
-                    pindex->nChainSaplingValue = *pindex->pprev->nChainSaplingValue + pindex->nSaplingValue;
-                } else {
-                    pindex->nChainSaplingValue = std::nullopt;
-                }
-
-                // Calculate the block's effect on the Orchard chain value pool balance.
-                if (pindex->pprev->nChainOrchardValue) {
-                    pindex->nChainOrchardValue = *pindex->pprev->nChainOrchardValue + pindex->nOrchardValue;
-                } else {
-                    pindex->nChainOrchardValue = std::nullopt;
-                }
-
-                // Calculate the block's effect on the Lockbox balance
-                if (pindex->pprev->nChainLockboxValue) {
-                    pindex->nChainLockboxValue = *pindex->pprev->nChainLockboxValue + pindex->nLockboxValue;
-                } else {
-                    pindex->nChainLockboxValue = std::nullopt;
-                }
-            } else {
-                pindex->nChainTotalSupply = pindex->nChainSupplyDelta;
-                pindex->nChainTransparentValue = pindex->nTransparentValue;
-                pindex->nChainSproutValue = pindex->nSproutValue;
-                pindex->nChainSaplingValue = pindex->nSaplingValue;
-                pindex->nChainOrchardValue = pindex->nOrchardValue;
-                pindex->nChainLockboxValue = pindex->nLockboxValue;
-            }
-
-            // Fall back to hardcoded Sprout value pool balance
-            FallbackSproutValuePoolBalance(pindex, chainparams);
-
-            {
-                LOCK(cs_nBlockSequenceId);
-                pindex->nSequenceId = nBlockSequenceId++;
-            }
-            if (chainActive.Tip() == NULL || !setBlockIndexCandidates.value_comp()(pindex, chainActive.Tip())) {
-                setBlockIndexCandidates.insert(pindex);
-            }
-            std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapBlocksUnlinked.equal_range(pindex);
-            while (range.first != range.second) {
-                queue.push_back(range.first->second);
-                range.first = mapBlocksUnlinked.erase(range.first);
-            }
-        }
+        LinkBlockTransactions(pindexNew, chainparams);
     } else {
         if (pindexNew->pprev && pindexNew->pprev->IsValid(BLOCK_VALID_TREE)) {
             mapBlocksUnlinked.insert(std::make_pair(pindexNew->pprev, pindexNew));
@@ -5039,11 +5331,11 @@ bool CheckBlock(const CBlock& block,
                          REJECT_INVALID, "bad-blk-length");
 
     // First transaction must be coinbase, the rest must not be
-    if (block.vtx.empty() || !block.vtx[0].IsCoinBase())
+    if (block.vtx.empty() || !block.vtx[0]->IsCoinBase())
         return state.DoS(100, error("CheckBlock(): first tx is not coinbase"),
                          REJECT_INVALID, "bad-cb-missing");
     for (unsigned int i = 1; i < block.vtx.size(); i++)
-        if (block.vtx[i].IsCoinBase())
+        if (block.vtx[i]->IsCoinBase())
             return state.DoS(100, error("CheckBlock(): more than one coinbase"),
                              REJECT_INVALID, "bad-cb-multiple");
 
@@ -5051,16 +5343,16 @@ bool CheckBlock(const CBlock& block,
     if (!fCheckTransactions) return true;
 
     // Check transactions
-    for (const CTransaction& tx : block.vtx)
-        if (!CheckTransaction(tx, state, verifier))
+    for (const auto& tx : block.vtx)
+        if (!CheckTransaction(*tx, state, verifier))
             return error("CheckBlock(): CheckTransaction of %s failed with %s",
-                tx.GetHash().ToString(),
+                tx->GetHash().ToString(),
                 FormatStateMessage(state));
 
     unsigned int nSigOps = 0;
-    for (const CTransaction& tx : block.vtx)
+    for (const auto& tx : block.vtx)
     {
-        nSigOps += GetLegacySigOpCount(tx);
+        nSigOps += GetLegacySigOpCount(*tx);
     }
     if (nSigOps > MAX_BLOCK_SIGOPS)
         return state.DoS(100, error("CheckBlock(): out-of-bounds SigOpCount"),
@@ -5148,7 +5440,8 @@ bool ContextualCheckBlock(
 
     if (fCheckTransactions) {
         // Check that all transactions are finalized
-        for (const CTransaction& tx : block.vtx) {
+        for (const CTransactionRef& ptx : block.vtx) {
+            const CTransaction& tx = *ptx;
 
             // Check transaction contextually against consensus rules at block height
             if (!ContextualCheckTransaction(tx, state, chainparams, nHeight, true)) {
@@ -5173,8 +5466,8 @@ bool ContextualCheckBlock(
     if (nHeight > 0)
     {
         CScript expect = CScript() << nHeight;
-        if (block.vtx[0].vin[0].scriptSig.size() < expect.size() ||
-            !std::equal(expect.begin(), expect.end(), block.vtx[0].vin[0].scriptSig.begin())) {
+        if (block.vtx[0]->vin[0].scriptSig.size() < expect.size() ||
+            !std::equal(expect.begin(), expect.end(), block.vtx[0]->vin[0].scriptSig.begin())) {
             return state.DoS(100, error("%s: block height mismatch in coinbase", __func__),
                              REJECT_INVALID, "bad-cb-height");
         }
@@ -5183,7 +5476,7 @@ bool ContextualCheckBlock(
     // ZIP 203: From NU5 onwards, nExpiryHeight is set to the block height in coinbase
     // transactions.
     if (consensusParams.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_NU5)) {
-        if (block.vtx[0].nExpiryHeight != nHeight) {
+        if (block.vtx[0]->nExpiryHeight != nHeight) {
             return state.DoS(100, error("%s: block height mismatch in nExpiryHeight", __func__),
                              REJECT_INVALID, "bad-cb-height");
         }
@@ -5296,15 +5589,17 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, const CCha
 
     // Write block to history file
     try {
-        unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+        // A block being reindexed is already on disk, so is not encoded again.
+        std::vector<unsigned char> record;
+        unsigned int nSize = dbp != NULL ? ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION) : EncodeBlockRecord(block, record);
         CDiskBlockPos blockPos;
         if (dbp != NULL)
             blockPos = *dbp;
-        if (!FindBlockPos(state, blockPos, nBlockSize+8, nHeight, block.GetBlockTime(), dbp != NULL))
+        if (!FindBlockPos(state, blockPos, (nSize & ~DISK_RECORD_COMPRESSED)+8, nHeight, block.GetBlockTime(), dbp != NULL))
             return error("AcceptBlock(): FindBlockPos failed");
 
         if (dbp == NULL) {
-            if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart())) {
+            if (!WriteBlockToDisk(record, nSize, blockPos, chainparams.MessageStart())) {
                 AbortNode(state, "Failed to write block");
             }
         }
@@ -5416,12 +5711,23 @@ uint64_t CalculateCurrentUsage()
     return retval;
 }
 
+uint64_t GetBlockFilesSize()
+{
+    LOCK(cs_LastBlockFile);
+    return CalculateCurrentUsage();
+}
+
 /* Prune a block file (modify associated database entries)*/
 void PruneOneBlockFile(const int fileNumber)
 {
+    AssertLockHeld(cs_main);
+
     for (BlockMap::iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end(); ++it) {
         CBlockIndex* pindex = it->second;
         if (pindex->nFile == fileNumber) {
+            if (nChainPruneHeight >= 0 && chainActive.Contains(pindex)) {
+                nChainPruneHeight = std::max(nChainPruneHeight, pindex->nHeight + 1);
+            }
             pindex->nStatus &= ~BLOCK_HAVE_DATA;
             pindex->nStatus &= ~BLOCK_HAVE_UNDO;
             pindex->nFile = 0;
@@ -5459,6 +5765,255 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
     }
 }
 
+/**
+ * Move the blocks stored in block file nFile, with their undo data, to the
+ * end of the block files, compressing them, and then delete the file. Files
+ * that would shrink by less than 1/16 are left alone. Returns false if the
+ * file could not be finished, in which case it will be tried again.
+ *
+ * Copies of the blocks are written and flushed before the block index and
+ * transaction index are pointed at them, and the file is deleted only once
+ * nothing refers to it and no reader that may have looked up a block in it
+ * is left (see CBlockFileReader), so an interruption at any point leaves
+ * every block readable.
+ */
+static bool RecompressBlockFile(const CChainParams& chainparams, int nFile)
+{
+    // Collect the blocks stored in the file in the order they were written.
+    std::vector<std::pair<unsigned int, CBlockIndex*>> vBlocks;
+    {
+        LOCK(cs_main);
+        for (const auto& entry : mapBlockIndex) {
+            CBlockIndex* pindex = entry.second;
+            if (pindex->nFile == nFile && (pindex->nStatus & BLOCK_HAVE_DATA))
+                vBlocks.push_back(std::make_pair(pindex->nDataPos, pindex));
+        }
+    }
+    std::sort(vBlocks.begin(), vBlocks.end());
+    if (vBlocks.empty())
+        return true;
+
+    // Estimate the savings from the blocks alone before rewriting anything.
+    // Blocks that are already compressed count at their stored size.
+    uint64_t nStoredSize = 0;
+    uint64_t nEncodedSize = 0;
+    for (const auto& item : vBlocks) {
+        boost::this_thread::interruption_point();
+        unsigned int nSize;
+        bool fCompressed;
+        CAutoFile filein(OpenRawBlock(CDiskBlockPos(nFile, item.first), chainparams.MessageStart(), nSize, fCompressed), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("%s: Failed to read block %s", __func__, item.second->GetBlockHash().ToString());
+        nStoredSize += nSize;
+        if (fCompressed) {
+            nEncodedSize += nSize;
+            continue;
+        }
+        std::vector<unsigned char> rawBlock(nSize);
+        try {
+            filein.read((char*)rawBlock.data(), nSize);
+        } catch (const std::exception& e) {
+            return error("%s: Failed to read block %s: %s", __func__, item.second->GetBlockHash().ToString(), e.what());
+        }
+        std::vector<unsigned char> compressed;
+        CompressLZ4(rawBlock.data(), rawBlock.size(), compressed);
+        nEncodedSize += std::min<uint64_t>(nSize, compressed.size() + sizeof(uint32_t));
+    }
+    if (nStoredSize - nEncodedSize < nStoredSize / 16) {
+        LogPrintf("%s: Leaving blk%05u.dat uncompressed\n", __func__, nFile);
+        return true;
+    }
+
+    for (const auto& item : vBlocks) {
+        boost::this_thread::interruption_point();
+        CBlockIndex* pindex = item.second;
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, CDiskBlockPos(nFile, item.first), chainparams.GetConsensus()))
+            return error("%s: Failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        bool fHaveUndo;
+        CDiskBlockPos undoPos;
+        {
+            LOCK(cs_main);
+            fHaveUndo = (pindex->nStatus & BLOCK_HAVE_UNDO) != 0;
+            undoPos = pindex->GetUndoPos();
+        }
+        CBlockUndo blockundo;
+        if (fHaveUndo && !UndoReadFromDisk(blockundo, undoPos, pindex->pprev->GetBlockHash()))
+            return error("%s: Failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+
+        std::vector<unsigned char> blockRecord;
+        unsigned int nBlockSize = EncodeBlockRecord(block, blockRecord);
+        std::vector<unsigned char> undoRecord;
+        unsigned int nUndoSize = fHaveUndo ? EncodeDiskRecord(blockundo, undoRecord) : 0;
+
+        CDiskBlockPos newPos;
+        CDiskBlockPos newUndoPos;
+        {
+            LOCK(cs_main);
+            CValidationState state;
+            if (!FindBlockPos(state, newPos, blockRecord.size() + 8, pindex->nHeight, block.GetBlockTime()) ||
+                !WriteBlockToDisk(blockRecord, nBlockSize, newPos, chainparams.MessageStart()))
+                return error("%s: Failed to write block %s", __func__, pindex->GetBlockHash().ToString());
+            if (fHaveUndo) {
+                if (!FindUndoPos(state, newPos.nFile, newUndoPos, undoRecord.size() + 40) ||
+                    !UndoWriteToDisk(blockundo, undoRecord, nUndoSize, newUndoPos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
+                    return error("%s: Failed to write undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+            }
+        }
+
+        // The transaction index is synced to disk, so the copy has to be
+        // there first.
+        FlushBlockFile();
+        if (g_txindex && !g_txindex->MoveBlock(block, pindex, newPos))
+            return error("%s: Failed to update txindex for block %s", __func__, pindex->GetBlockHash().ToString());
+
+        {
+            LOCK(cs_main);
+            // If undo data was written for the block in the meantime, keep
+            // the original copy, which then stays referenced.
+            if (pindex->nFile == nFile && pindex->nDataPos == item.first &&
+                ((pindex->nStatus & BLOCK_HAVE_UNDO) != 0) == fHaveUndo) {
+                pindex->nFile = newPos.nFile;
+                pindex->nDataPos = newPos.nPos;
+                pindex->nUndoPos = fHaveUndo ? newUndoPos.nPos : 0;
+                setDirtyBlockIndex.insert(pindex);
+                continue;
+            }
+        }
+        if (g_txindex && !g_txindex->MoveBlock(block, pindex, CDiskBlockPos(nFile, item.first)))
+            return error("%s: Failed to update txindex for block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    {
+        LOCK2(cs_main, cs_LastBlockFile);
+        CValidationState state;
+        if (!WriteBlockIndexToDisk(state))
+            return false;
+        for (const auto& entry : mapBlockIndex) {
+            const CBlockIndex* pindex = entry.second;
+            if (pindex->nFile == nFile && (pindex->nStatus & (BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO)))
+                return false;
+        }
+        vinfoBlockFile[nFile].SetNull();
+        setDirtyFileInfo.insert(nFile);
+        if (!WriteBlockIndexToDisk(state))
+            return false;
+    }
+
+    RemoveBlockFileWhenUnread(nFile);
+    LogPrintf("Recompressed blk/rev (%05u): %u blocks, %u bytes to %u bytes\n",
+        nFile, vBlocks.size(), nStoredSize, nEncodedSize);
+    MetricsIncrementCounter("zcash.blockfiles.recompressed");
+    return true;
+}
+
+void ThreadRecompressBlockFiles(const CChainParams& chainparams)
+{
+    RenameThread("zcash-recompress");
+
+    int nFile = 0;
+    pblocktree->ReadRecompressFile(nFile);
+
+    // A file that was still being read when the node stopped was not deleted.
+    {
+        LOCK(cs_LastBlockFile);
+        for (int n = 0; n < nFile && n < (int)vinfoBlockFile.size(); n++) {
+            if (vinfoBlockFile[n].nBlocks == 0 && fs::exists(GetBlockPosFilename(CDiskBlockPos(n, 0), "blk")))
+                RemoveBlockFileWhenUnread(n);
+        }
+    }
+
+    while (true) {
+        MilliSleep(RECOMPRESS_BLOCK_FILES_INTERVAL * 1000);
+
+        // Leave the block files alone while they are being written in bulk,
+        // and until the indexes have caught up: the transaction index refers
+        // to blocks by position, and an index that is catching up reads old
+        // blocks without holding cs_main.
+        if (fImporting || fReindex || IsInitialBlockDownload(chainparams.GetConsensus()))
+            continue;
+        if (g_txindex && !g_txindex->BlockUntilSyncedToCurrentChain())
+            continue;
+        if (g_coinstatsindex && !g_coinstatsindex->BlockUntilSyncedToCurrentChain())
+            continue;
+        if (g_addressindex && !g_addressindex->BlockUntilSyncedToCurrentChain())
+            continue;
+        if (g_spentindex && !g_spentindex->BlockUntilSyncedToCurrentChain())
+            continue;
+        if (g_timestampindex && !g_timestampindex->BlockUntilSyncedToCurrentChain())
+            continue;
+
+        // The last block file is still being appended to.
+        int nLastFile;
+        {
+            LOCK(cs_LastBlockFile);
+            nLastFile = nLastBlockFile;
+        }
+        while (nFile < nLastFile && RecompressBlockFile(chainparams, nFile)) {
+            nFile++;
+            pblocktree->WriteRecompressFile(nFile);
+        }
+    }
+}
+
+void ThreadLoadSnapshot(const CChainParams& chainparams, const fs::path& path, const uint256& hashBlock)
+{
+    RenameThread("zcash-snapshot");
+
+    LogPrintf("%s: Waiting for the headers chain to reach block %s\n", __func__, hashBlock.GetHex());
+    while (true) {
+        {
+            LOCK(cs_main);
+            BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+            if (mi != mapBlockIndex.end() && pindexBestHeader != NULL &&
+                pindexBestHeader->GetAncestor(mi->second->nHeight) == mi->second)
+                break;
+        }
+        MilliSleep(1000);
+    }
+
+    CValidationState state;
+    CSnapshotMetadata metadata;
+    uint64_t nEntries = 0;
+    if (LoadChainstateSnapshot(state, chainparams, path, metadata, nEntries)) {
+        LogPrintf("%s: Loaded %u entries at height %d from %s\n", __func__, nEntries, metadata.nHeight, path.string());
+        fSnapshotPending = false;
+        ActivateBestChain(state, chainparams);
+    } else if (!ShutdownRequested()) {
+        // Failures after the chainstate was changed have already shut the
+        // node down; otherwise it is unchanged, but the node was asked not to
+        // build it from genesis.
+        AbortNode(state, strprintf("Failed to load the chainstate snapshot: %s", state.GetRejectReason()));
+    }
+}
+
+void ThreadDatabaseMaintenance(const CChainParams& chainparams)
+{
+    RenameThread("zcash-dbmaint");
+
+    // Only compact after initial block download done by this run, not every
+    // time the node restarts.
+    bool fCompact = GetBoolArg("-dbcompactafteribd", DEFAULT_DB_COMPACT_AFTER_IBD);
+    bool fSawIBD = false;
+    while (true) {
+        MilliSleep(DATABASE_STATS_INTERVAL * 1000);
+        dbcompaction.UpdateMetrics();
+
+        if (!fCompact)
+            continue;
+        if (fImporting || fReindex || IsInitialBlockDownload(chainparams.GetConsensus())) {
+            fSawIBD = true;
+            continue;
+        }
+        if (fSawIBD) {
+            dbcompaction.CompactAfterIBD();
+            dbcompaction.UpdateMetrics();
+            fCompact = false;
+        }
+    }
+}
+
 /* Calculate the block/rev files that should be deleted to remain under target*/
 void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight)
 {
@@ -5574,11 +6129,37 @@ CBlockIndex * InsertBlockIndex(const uint256& hash)
     return pindexNew;
 }
 
+/**
+ * Set the values of a snapshot's base block that are otherwise computed from
+ * those of its ancestors.
+ */
+static void SetSnapshotChainValues(CBlockIndex* pindex, const CSnapshotMetadata& metadata, const Consensus::Params& consensusParams)
+{
+    pindex->nCachedBranchId = CurrentEpochBranchId(pindex->nHeight, consensusParams);
+    pindex->nChainTx = metadata.nChainTx;
+    pindex->nChainTotalSupply = metadata.nChainTotalSupply;
+    pindex->nChainTransparentValue = metadata.nChainTransparentValue;
+    pindex->nChainSproutValue = metadata.nChainSproutValue;
+    pindex->nChainSaplingValue = metadata.nChainSaplingValue;
+    pindex->nChainOrchardValue = metadata.nChainOrchardValue;
+    pindex->nChainLockboxValue = metadata.nChainLockboxValue;
+}
+
 bool static LoadBlockIndexDB(const CChainParams& chainparams)
 {
     if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex, chainparams))
         return false;
 
+    // Check whether the chainstate was loaded from a snapshot
+    CSnapshotMetadata snapshot;
+    if (pblocktree->ReadSnapshot(snapshot)) {
+        BlockMap::iterator it = mapBlockIndex.find(snapshot.hashBlock);
+        if (it == mapBlockIndex.end())
+            return error("LoadBlockIndexDB(): snapshot base block %s not found", snapshot.hashBlock.ToString());
+        pindexSnapshotBase = it->second;
+        LogPrintf("LoadBlockIndexDB(): chainstate was loaded from a snapshot at height %d\n", snapshot.nHeight);
+    }
+
     // Calculate nChainWork
     vector<pair<int, CBlockIndex*> > vSortedByHeight;
     vSortedByHeight.reserve(mapBlockIndex.size());
@@ -5594,7 +6175,9 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
         // We can link the chain of blocks for which we've received transactions at some point.
         // Pruned nodes may have deleted the block.
-        if (pindex->nTx > 0) {
+        if (pindex == pindexSnapshotBase) {
+            SetSnapshotChainValues(pindex, snapshot, chainparams.GetConsensus());
+        } else if (pindex->nTx > 0) {
             if (pindex->pprev) {
                 if (pindex->pprev->nChainTx) {
                     pindex->nChainTx = pindex->pprev->nChainTx + pindex->nTx;
@@ -5734,26 +6317,11 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadReindexing(fReindexing);
     if(fReindexing) fReindex = true;
 
-    // Check whether we have a transaction index
-    pblocktree->ReadFlag("txindex", fTxIndex);
-    LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
-
-    // insightexplorer and lightwalletd
-    // Check whether block explorer features are enabled
-    bool fInsightExplorer = false;
+    // lightwalletd
+    // Check whether the compact block store is enabled
     bool fLightWalletd = false;
-    pblocktree->ReadFlag("insightexplorer", fInsightExplorer);
     pblocktree->ReadFlag("lightwalletd", fLightWalletd);
-    LogPrintf("%s: insight explorer %s\n", __func__, fInsightExplorer ? "enabled" : "disabled");
     LogPrintf("%s: light wallet daemon %s\n", __func__, fLightWalletd ? "enabled" : "disabled");
-    if (fInsightExplorer) {
-        fAddressIndex = true;
-        fSpentIndex = true;
-        fTimestampIndex = true;
-    }
-    else if (fLightWalletd) {
-        fAddressIndex = true;
-    }
 
     // Fill in-memory data
     for (const std::pair<uint256, CBlockIndex*>& item : mapBlockIndex)
@@ -5776,6 +6344,7 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     chainActive.SetTip(it->second);
     // Set hashFinalSproutRoot for the end of best chain
     it->second->hashFinalSproutRoot = pcoinsTip->GetBestAnchor(SPROUT);
+    PublishChainTipSnapshot(chainparams);
 
     PruneBlockIndexCandidates();
 
@@ -5789,6 +6358,169 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     return true;
 }
 
+bool DumpChainstateSnapshot(const fs::path& path, CSnapshotMetadata& metadata, uint256& hashSnapshot, uint64_t& nEntries)
+{
+    // The records are read from a snapshot of the database, which later
+    // flushes do not change, so the lock is only needed until it is taken.
+    std::unique_ptr<CCoinsViewDB> pcoinsSnapshot;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        CBlockIndex* pindex = chainActive.Tip();
+        if (pindex == NULL || pcoinsdbview->GetBestBlock() != pindex->GetBlockHash())
+            return error("%s: the chainstate database is not at the chain tip", __func__);
+        metadata = CSnapshotMetadata(pindex);
+        pcoinsSnapshot.reset(new CCoinsViewDB(*pcoinsdbview, CDBWrapper::SnapshotTag()));
+    }
+
+    fs::path pathTmp = path.string() + ".incomplete";
+    CAutoFile fileout(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: failed to open %s", __func__, pathTmp.string());
+
+    CHashWriter hasher(SER_GETHASH, 0);
+    nEntries = 0;
+    try {
+        fileout << metadata;
+        hasher << metadata;
+        bool fComplete = pcoinsSnapshot->ForEachSnapshotRecord([&](const CSnapshotRecord& record) {
+            if (ShutdownRequested())
+                return false;
+            fileout << record;
+            hasher << record;
+            nEntries++;
+            return true;
+        });
+        if (!fComplete)
+            return error("%s: interrupted by shutdown", __func__);
+        CSnapshotRecord end;
+        fileout << end;
+        hasher << end;
+    } catch (const std::exception& e) {
+        return error("%s: failed to write %s: %s", __func__, pathTmp.string(), e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, path))
+        return error("%s: failed to rename %s", __func__, pathTmp.string());
+
+    hashSnapshot = hasher.GetHash();
+    LogPrintf("%s: wrote %u entries at height %d to %s, hash %s\n", __func__,
+        nEntries, metadata.nHeight, path.string(), hashSnapshot.GetHex());
+    return true;
+}
+
+bool LoadChainstateSnapshot(CValidationState& state, const CChainParams& chainparams, const fs::path& path, CSnapshotMetadata& metadata, uint64_t& nEntries)
+{
+    // Hash the whole snapshot before changing anything, and check it against
+    // the hash committed to in the chain parameters for its height.
+    {
+        CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return state.Error(strprintf("failed to open %s", path.string()));
+        CHashWriter hasher(SER_GETHASH, 0);
+        try {
+            filein >> metadata;
+            hasher << metadata;
+            if (metadata.nVersion != CSnapshotMetadata::CURRENT_VERSION)
+                return state.Error(strprintf("unsupported snapshot version %d", metadata.nVersion));
+            while (true) {
+                if (ShutdownRequested())
+                    return state.Error("interrupted by shutdown");
+                CSnapshotRecord record;
+                filein >> record;
+                hasher << record;
+                if (record.nType == CSnapshotRecord::END)
+                    break;
+            }
+        } catch (const std::exception& e) {
+            return state.Error(strprintf("failed to read %s: %s", path.string(), e.what()));
+        }
+
+        const MapAssumeutxo& mapAssumeutxo = chainparams.Assumeutxo();
+        auto it = mapAssumeutxo.find(metadata.nHeight);
+        if (it == mapAssumeutxo.end())
+            return state.Error(strprintf("no snapshot is known at height %d", metadata.nHeight));
+        uint256 hashSnapshot = hasher.GetHash();
+        if (hashSnapshot != it->second)
+            return state.Error(strprintf("snapshot hash %s does not match the expected %s",
+                hashSnapshot.GetHex(), it->second.GetHex()));
+    }
+
+    LOCK(cs_main);
+    if (chainActive.Height() > 0)
+        return state.Error("a snapshot can only be loaded before any blocks have been connected");
+    BlockMap::iterator mi = mapBlockIndex.find(metadata.hashBlock);
+    if (mi == mapBlockIndex.end() || pindexBestHeader == NULL)
+        return state.Error("the headers chain does not yet include the snapshot's block");
+    CBlockIndex* pindex = mi->second;
+    if (pindex->nHeight != metadata.nHeight || pindexBestHeader->GetAncestor(pindex->nHeight) != pindex)
+        return state.Error("the snapshot's block is not in the best headers chain");
+    if (pindex->nStatus & BLOCK_FAILED_MASK)
+        return state.Error("the snapshot's block is invalid");
+
+    if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_ALWAYS))
+        return false;
+    mempool.clear();
+
+    // Once the chainstate database has been changed, failing leaves it
+    // unusable until it is rebuilt with -reindex-chainstate.
+    try {
+        CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return state.Error(strprintf("failed to open %s", path.string()));
+        CSnapshotMetadata skipped;
+        filein >> skipped;
+        if (!pcoinsdbview->LoadSnapshot(filein, nEntries))
+            return AbortNode(state, "Failed to load the chainstate snapshot");
+    } catch (const std::exception& e) {
+        return AbortNode(state, strprintf("Failed to load the chainstate snapshot: %s", e.what()));
+    }
+    pcoinsTip->Reset();
+    if (pcoinsTip->GetBestBlock() != metadata.hashBlock)
+        return AbortNode(state, "The loaded chainstate is not at the snapshot's block");
+
+    // The base block is connected without its ancestors, so the values that
+    // would be computed from them are taken from the snapshot.
+    SetSnapshotChainValues(pindex, metadata, chainparams.GetConsensus());
+    pindex->hashFinalSproutRoot = pcoinsTip->GetBestAnchor(SPROUT);
+    pindex->hashFinalSaplingRoot = metadata.hashFinalSaplingRoot;
+    pindex->hashFinalOrchardRoot = metadata.hashFinalOrchardRoot;
+    pindex->hashChainHistoryRoot = metadata.hashChainHistoryRoot;
+    pindex->hashAuthDataRoot = metadata.hashAuthDataRoot;
+    pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+    setDirtyBlockIndex.insert(pindex);
+    pindexSnapshotBase = pindex;
+    if (!pblocktree->WriteSnapshot(metadata))
+        return AbortNode(state, "Failed to write the chainstate snapshot metadata");
+
+    chainActive.SetTip(pindex);
+    // The blocks below the snapshot base have no data.
+    nChainPruneHeight = -1;
+    PublishChainTipSnapshot(chainparams);
+    setBlockIndexCandidates.insert(pindex);
+    PruneBlockIndexCandidates();
+
+    // Blocks after the base that were received before it could be linked.
+    std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapBlocksUnlinked.equal_range(pindex);
+    std::vector<CBlockIndex*> vChildren;
+    for (auto it = range.first; it != range.second; ++it) {
+        vChildren.push_back(it->second);
+    }
+    mapBlocksUnlinked.erase(range.first, range.second);
+    for (CBlockIndex* pindexChild : vChildren) {
+        LinkBlockTransactions(pindexChild, chainparams);
+    }
+
+    // Blocks below the base are not available to serve to peers.
+    nLocalServices &= ~NODE_NETWORK;
+
+    LogPrintf("%s: loaded %u entries, chain tip is now %s at height %d\n", __func__,
+        nEntries, pindex->GetBlockHash().ToString(), pindex->nHeight);
+    return FlushStateToDisk(chainparams, state, FLUSH_STATE_ALWAYS);
+}
+
 CVerifyDB::CVerifyDB()
 {
     uiInterface.ShowProgress(_("Verifying blocks..."), 0);
@@ -5800,6 +6532,15 @@ CVerifyDB::~CVerifyDB()
 }
 
 bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth)
+{
+    if (!VerifyBlocks(chainparams, nCheckLevel, nCheckDepth))
+        return false;
+    if (nCheckLevel < 3 || ShutdownRequested())
+        return true;
+    return VerifyCoins(chainparams, coinsview, nCheckLevel, nCheckDepth);
+}
+
+bool CVerifyDB::VerifyBlocks(const CChainParams& chainparams, int nCheckLevel, int nCheckDepth)
 {
     LOCK(cs_main);
     if (chainActive.Tip() == NULL || chainActive.Tip()->pprev == NULL)
@@ -5810,87 +6551,231 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         nCheckDepth = 1000000000; // suffices until the year 19000
     if (nCheckDepth > chainActive.Height())
         nCheckDepth = chainActive.Height();
+    nCheckLevel = std::max(0, std::min(2, nCheckLevel));
+
+    // The checks only read the block index entries, which do not change while
+    // cs_main is held here, and do not take cs_main themselves. Whether a
+    // block's transactions are checked depends on IsInitialBlockDownload,
+    // which does take it, so that is decided up front.
+    struct BlockToCheck {
+        const CBlockIndex* pindex;
+        bool fCheckTransactions;
+    };
+    std::vector<BlockToCheck> vBlocks;
+    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
+    {
+        if (pindex->nHeight < chainActive.Height()-nCheckDepth)
+            break;
+        // There is no data for the blocks up to the base of a chainstate snapshot.
+        if (pindexSnapshotBase && pindex->nHeight <= pindexSnapshotBase->nHeight)
+            break;
+        vBlocks.push_back({pindex, ShouldCheckTransactions(chainparams, pindex)});
+    }
+    if (vBlocks.empty())
+        return true;
+
+    size_t nThreads = std::min<size_t>(std::max(GetNumCores(), 1), vBlocks.size());
+    LogPrintf("Verifying last %i blocks at level %i on %u threads\n", vBlocks.size(), nCheckLevel, nThreads);
+    int64_t nStart = GetTimeMillis();
+
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> nDone(0);
+    std::atomic<bool> fFailed(false);
+    auto worker = [&]() {
+        auto verifier = ProofVerifier::Disabled(); // No need to verify JoinSplits twice
+        for (size_t i = next++; i < vBlocks.size() && !fFailed && !ShutdownRequested(); i = next++) {
+            const CBlockIndex* pindex = vBlocks[i].pindex;
+            CBlock block;
+            // check level 0: read from disk
+            if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+                fFailed = true;
+                error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+                break;
+            }
+
+            // check level 1: verify block validity
+            CValidationState state;
+            if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams, verifier, true, true, vBlocks[i].fCheckTransactions)) {
+                fFailed = true;
+                error("VerifyDB(): *** found bad block at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+                break;
+            }
+
+            // check level 2: verify undo validity
+            if (nCheckLevel >= 2) {
+                CBlockUndo undo;
+                CDiskBlockPos pos = pindex->GetUndoPos();
+                if (!pos.IsNull() && !UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash())) {
+                    fFailed = true;
+                    error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+                    break;
+                }
+            }
+
+            // Only the thread that completes a percent reports it.
+            size_t n = ++nDone;
+            int nPercent = n * 100 / vBlocks.size();
+            if (nPercent != (int)((n - 1) * 100 / vBlocks.size())) {
+                uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, nPercent)));
+                if (nPercent % 10 == 0)
+                    LogPrintf("Verifying blocks... %d%%\n", nPercent);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (fFailed)
+        return false;
+    if (ShutdownRequested())
+        return true;
+    LogPrintf("Verified %u blocks in %dms\n", nDone.load(), GetTimeMillis() - nStart);
+    return true;
+}
+
+bool CVerifyDB::VerifyCoins(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth)
+{
+    // The blocks are checked against the block coinsview is at, which need not
+    // remain the tip: only the reads of the chain and each block's disconnect
+    // and reconnect take cs_main, so that a check against a snapshot of the
+    // coin database does not stall the node.
+    CBlockIndex* pindexTip;
+    size_t nTipCacheUsage;
+    {
+        LOCK(cs_main);
+        if (chainActive.Tip() == NULL || chainActive.Tip()->pprev == NULL)
+            return true;
+        BlockMap::iterator mi = mapBlockIndex.find(coinsview->GetBestBlock());
+        if (mi == mapBlockIndex.end())
+            return error("VerifyDB(): *** coin database is at an unknown block");
+        pindexTip = mi->second;
+        nTipCacheUsage = pcoinsTip->DynamicMemoryUsage();
+    }
+    if (pindexTip->pprev == NULL)
+        return true;
+    const int nTipHeight = pindexTip->nHeight;
+
+    if (nCheckDepth <= 0)
+        nCheckDepth = 1000000000; // suffices until the year 19000
+    if (nCheckDepth > nTipHeight)
+        nCheckDepth = nTipHeight;
     nCheckLevel = std::max(0, std::min(4, nCheckLevel));
-    LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
+    if (nCheckLevel < 3)
+        return true;
+    LogPrintf("Verifying coin database against the last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
     CCoinsViewCache coins(coinsview);
-    CBlockIndex* pindexState = chainActive.Tip();
+    CBlockIndex* pindexState = pindexTip;
     CBlockIndex* pindexFailure = NULL;
+    std::vector<CBlockIndex*> vDisconnected;
     int nGoodTransactions = 0;
     CValidationState state;
 
-    // Flags used to permit skipping checks for efficiency
-    auto verifier = ProofVerifier::Disabled(); // No need to verify JoinSplits twice
-    bool fCheckTransactions = true;
-
-    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
+    // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
+    for (CBlockIndex* pindex = pindexTip; pindex && pindex->pprev; pindex = pindex->pprev)
     {
         boost::this_thread::interruption_point();
-        uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
-        if (pindex->nHeight < chainActive.Height()-nCheckDepth)
+        uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(nTipHeight - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
+        if (pindex->nHeight < nTipHeight-nCheckDepth)
+            break;
+        if ((coins.DynamicMemoryUsage() + nTipCacheUsage) > nCoinCacheUsage)
             break;
 
-        CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
-            return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-
-        // check level 1: verify block validity
-        fCheckTransactions = ShouldCheckTransactions(chainparams, pindex);
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams, verifier, true, true, fCheckTransactions))
-            return error("VerifyDB(): *** found bad block at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-
-        // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
-            CDiskBlockPos pos = pindex->GetUndoPos();
-            if (!pos.IsNull()) {
-                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash()))
-                    return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-            }
-        }
-
-        // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
-            // insightexplorer: do not update indices (false)
-            DisconnectResult res = DisconnectBlock(block, state, pindex, coins, chainparams, false);
-            if (res == DISCONNECT_FAILED) {
-                return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-            }
-            pindexState = pindex->pprev;
-            if (res == DISCONNECT_UNCLEAN) {
-                nGoodTransactions = 0;
-                pindexFailure = pindex;
-            } else {
-                nGoodTransactions += block.vtx.size();
+        DisconnectResult res;
+        size_t nTx;
+        {
+            LOCK(cs_main);
+            if (pindexSnapshotBase && pindex->nHeight <= pindexSnapshotBase->nHeight)
+                break;
+            // The lock is released between blocks, so pruning may have
+            // removed blocks that were still to be checked.
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA) || !(pindex->nStatus & BLOCK_HAVE_UNDO)) {
+                LogPrintf("VerifyDB(): block %d has been pruned, checking the blocks above it only\n", pindex->nHeight);
+                break;
             }
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
+                return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            // lightwalletd: do not update the compact block store (false)
+            res = DisconnectBlock(block, state, pindex, coins, chainparams, false);
+            nTx = block.vtx.size();
+        }
+        if (res == DISCONNECT_FAILED) {
+            return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+        }
+        pindexState = pindex->pprev;
+        vDisconnected.push_back(pindex);
+        if (res == DISCONNECT_UNCLEAN) {
+            nGoodTransactions = 0;
+            pindexFailure = pindex;
+        } else {
+            nGoodTransactions += nTx;
         }
 
         if (ShutdownRequested())
             return true;
     }
     if (pindexFailure)
-        return error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", chainActive.Height() - pindexFailure->nHeight + 1, nGoodTransactions);
+        return error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", nTipHeight - pindexFailure->nHeight + 1, nGoodTransactions);
 
     // check level 4: try reconnecting blocks
     if (nCheckLevel >= 4) {
-        CBlockIndex *pindex = pindexState;
-        while (pindex != chainActive.Tip()) {
+        for (auto it = vDisconnected.rbegin(); it != vDisconnected.rend(); ++it) {
+            CBlockIndex* pindex = *it;
             boost::this_thread::interruption_point();
-            uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, 100 - (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * 50))));
-            pindex = chainActive.Next(pindex);
+            uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, 100 - (int)(((double)(nTipHeight - pindex->nHeight)) / (double)nCheckDepth * 50))));
+            LOCK(cs_main);
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                LogPrintf("VerifyDB(): block %d has been pruned, ending the check\n", pindex->nHeight);
+                return true;
+            }
             CBlock block;
             if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
                 return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
             if (!ConnectBlock(block, state, pindex, coins, chainparams))
                 return error("VerifyDB(): *** found unconnectable block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            if (ShutdownRequested())
+                return true;
         }
     }
 
-    LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", chainActive.Height() - pindexState->nHeight, nGoodTransactions);
+    LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", nTipHeight - pindexState->nHeight, nGoodTransactions);
 
     return true;
 }
 
+void ThreadVerifyCoins(const CChainParams& chainparams, int nCheckLevel, int nCheckDepth)
+{
+    RenameThread("zcash-verifydb");
+
+    bool fVerified;
+    try {
+        // The checks read a snapshot of the chainstate database, taken once
+        // it has been brought up to the tip that blocks may have been
+        // connected to since startup, so that later flushes do not change it.
+        std::unique_ptr<CCoinsViewDB> pcoinsSnapshot;
+        {
+            LOCK(cs_main);
+            FlushStateToDisk();
+            pcoinsSnapshot.reset(new CCoinsViewDB(*pcoinsdbview, CDBWrapper::SnapshotTag()));
+        }
+        fVerified = CVerifyDB().VerifyCoins(chainparams, pcoinsSnapshot.get(), nCheckLevel, nCheckDepth);
+    } catch (const boost::thread_interrupted&) {
+        LogPrintf("%s: interrupted by shutdown\n", __func__);
+        throw;
+    }
+    if (!fVerified) {
+        AbortNode("Corrupted block database detected",
+            _("Error: Corrupted block database detected. Restart with -reindex to rebuild it."));
+    }
+}
+
 bool RegenerateSubtrees(ShieldedType type, const Consensus::Params& consensusParams)
 {
     AssertLockHeld(cs_main);
@@ -6053,7 +6938,8 @@ bool RegenerateSubtrees(ShieldedType type, const Consensus::Params& consensusPar
         auto pushSapling = [&]() {
             SaplingMerkleTree sapling_tree;
             assert(pcoinsTip->GetSaplingAnchorAt(pindex->pprev->hashFinalSaplingRoot, sapling_tree));
-            for (const CTransaction &tx : block.vtx) {
+            for (const CTransactionRef& ptx : block.vtx) {
+                const CTransaction& tx = *ptx;
                 for (const auto &outputDescription : tx.GetSaplingOutputs()) {
                     sapling_tree.append(uint256::FromRawBytes(outputDescription.cmu()));
 
@@ -6074,7 +6960,8 @@ bool RegenerateSubtrees(ShieldedType type, const Consensus::Params& consensusPar
         auto pushOrchard = [&]() {
             OrchardMerkleFrontier orchard_tree;
             assert(pcoinsTip->GetOrchardAnchorAt(pindex->pprev->hashFinalOrchardRoot, orchard_tree));
-            for (const CTransaction &tx : block.vtx) {
+            for (const CTransactionRef& ptx : block.vtx) {
+                const CTransaction& tx = *ptx;
                 if (tx.GetOrchardBundle().IsPresent()) {
                     try {
                         auto appendResult = orchard_tree.AppendBundle(tx.GetOrchardBundle());
@@ -6122,6 +7009,11 @@ bool RewindBlockIndex(const CChainParams& chainparams, bool& clearWitnessCaches)
     // - BLOCK_ACTIVATES_UPGRADE is set only on blocks that activate upgrades.
     // - nCachedBranchId for each block matches what we expect.
     auto sufficientlyValidated = [&chainparams](const CBlockIndex* pindex) {
+        // The chain up to the base of a chainstate snapshot is committed to
+        // by the snapshot's hash in the chain parameters.
+        if (pindexSnapshotBase && pindexSnapshotBase->GetAncestor(pindex->nHeight) == pindex) {
+            return true;
+        }
         const Consensus::Params& consensus = chainparams.GetConsensus();
         bool fFlagSet = pindex->nStatus & BLOCK_ACTIVATES_UPGRADE;
         bool fFlagExpected = IsActivationHeightForAnyUpgrade(pindex->nHeight, consensus);
@@ -6282,6 +7174,8 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    std::atomic_store(&g_chain_tip_snapshot, std::shared_ptr<const CChainTipSnapshot>());
+    nChainPruneHeight = -1;
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
@@ -6306,6 +7200,7 @@ void UnloadBlockIndex()
     }
     mapBlockIndex.clear();
     fHavePruned = false;
+    pindexSnapshotBase = NULL;
 }
 
 bool LoadBlockIndex()
@@ -6327,21 +7222,8 @@ bool InitBlockIndex(const CChainParams& chainparams)
     if (chainActive.Genesis() != NULL)
         return true;
 
-    // Use the provided setting for -txindex in the new database
-    fTxIndex = GetBoolArg("-txindex", DEFAULT_TXINDEX);
-    pblocktree->WriteFlag("txindex", fTxIndex);
-
-    // Use the provided setting for -insightexplorer or -lightwalletd in the new database
-    pblocktree->WriteFlag("insightexplorer", fExperimentalInsightExplorer);
+    // Use the provided setting for -lightwalletd in the new database
     pblocktree->WriteFlag("lightwalletd", fExperimentalLightWalletd);
-    if (fExperimentalInsightExplorer) {
-        fAddressIndex = true;
-        fSpentIndex = true;
-        fTimestampIndex = true;
-    }
-    else if (fExperimentalLightWalletd) {
-        fAddressIndex = true;
-    }
 
     LogPrintf("Initializing databases...\n");
 
@@ -6350,12 +7232,13 @@ bool InitBlockIndex(const CChainParams& chainparams)
         try {
             CBlock &block = const_cast<CBlock&>(chainparams.GenesisBlock());
             // Start new block file
-            unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+            std::vector<unsigned char> record;
+            unsigned int nSize = EncodeBlockRecord(block, record);
             CDiskBlockPos blockPos;
             CValidationState state;
-            if (!FindBlockPos(state, blockPos, nBlockSize+8, 0, block.GetBlockTime()))
+            if (!FindBlockPos(state, blockPos, record.size()+8, 0, block.GetBlockTime()))
                 return error("LoadBlockIndex(): FindBlockPos failed");
-            if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
+            if (!WriteBlockToDisk(record, nSize, blockPos, chainparams.MessageStart()))
                 return error("LoadBlockIndex(): writing genesis block to disk failed");
             CBlockIndex *pindex = AddToBlockIndex(block, chainparams.GetConsensus());
             SetChainPoolValues(chainparams, block, pindex);
@@ -6400,6 +7283,7 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
             nRewind++; // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
             unsigned int nSize = 0;
+            bool fCompressed = false;
             try {
                 // locate a header
                 unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
@@ -6410,7 +7294,9 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                     continue;
                 // read size
                 blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
+                fCompressed = (nSize & DISK_RECORD_COMPRESSED) != 0;
+                nSize &= ~DISK_RECORD_COMPRESSED;
+                if (nSize < (fCompressed ? sizeof(uint32_t) : 80) || nSize > MAX_BLOCK_SIZE)
                     continue;
             } catch (const std::exception&) {
                 // no valid block header found; don't complain
@@ -6424,7 +7310,13 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                 blkdat.SetLimit(nBlockPos + nSize);
                 blkdat.SetPos(nBlockPos);
                 CBlock block;
-                blkdat >> block;
+                if (fCompressed) {
+                    CDataStream ss(SER_DISK, CLIENT_VERSION);
+                    ReadCompressedRecord(blkdat, nSize, MAX_BLOCK_SIZE, ss);
+                    ss >> block;
+                } else {
+                    blkdat >> block;
+                }
                 nRewind = blkdat.GetPos();
 
                 // detect out of order blocks, and store them for later
@@ -6503,6 +7395,12 @@ void static CheckBlockIndex(const Consensus::Params& consensusParams)
 
     LOCK(cs_main);
 
+    // The blocks up to the base of a chainstate snapshot were never received,
+    // which the checks below do not allow for.
+    if (pindexSnapshotBase) {
+        return;
+    }
+
     // During a reindex, we read the genesis block and call CheckBlockIndex before ActivateBestChain,
     // so we have the genesis block in mapBlockIndex but no active chain.  (A few of the tests when
     // iterating the block tree require that chainActive has been initialized.)
@@ -6735,6 +7633,35 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     return true;
 }
 
+/**
+ * Build the "block" message for a block from its serialized form in the block
+ * cache, reading it from disk on a miss. When a new tip is announced, many
+ * peers request the same block at once; it is then serialized only once.
+ */
+static CSerializedNetMsgRef GetSerializedBlockMsg(const uint256& hash, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+{
+    CBlockCache::RawBlockRef raw = blockcache.GetRaw(hash);
+    if (raw) {
+        MetricsIncrementCounter("zcash.blockcache.hits");
+    } else {
+        // This adds the block to the cache if it was read recently.
+        std::shared_ptr<const CBlock> pblock = ReadSharedBlockFromDisk(hash, pos, consensusParams);
+        if (!pblock) {
+            return nullptr;
+        }
+        raw = blockcache.GetRaw(hash);
+        if (!raw) {
+            return SerializeNetMsg("block", *pblock);
+        }
+    }
+
+    CPublicDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss.reserve(CMessageHeader::HEADER_SIZE + raw->size());
+    ss << CMessageHeader(Params().MessageStart(), "block", 0);
+    ss.write((const char*)raw->data(), raw->size());
+    return FinalizeNetMsg(ss);
+}
+
 void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParams)
 {
     int currentHeight = GetHeight();
@@ -6743,8 +7670,9 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 
     vector<CInv> vNotFound;
 
-    LOCK(cs_main);
-
+    // cs_main is only held while looking up what to send. Blocks are read
+    // from disk and pushed without it, so that serving blocks to one peer
+    // does not stall validation or message handling for other peers.
     while (it != pfrom->vRecvGetData.end()) {
         // Don't bother if send buffer is too full to respond anyway
         if (pfrom->nSendSize >= SendBufferSize())
@@ -6758,59 +7686,83 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
             if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
             {
                 bool send = false;
-                BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
-                if (mi != mapBlockIndex.end())
+                CDiskBlockPos blockPos;
+                CBlockFileReader reader;
                 {
-                    if (chainActive.Contains(mi->second)) {
-                        send = true;
-                    } else {
-                        static const int nOneMonth = 30 * 24 * 60 * 60;
-                        // To prevent fingerprinting attacks, only send blocks outside of the active
-                        // chain if they are valid, and no more than a month older (both in time, and in
-                        // best equivalent proof of work) than the best header chain we know about.
-                        send = mi->second->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
-                            (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
-                            (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, consensusParams) < nOneMonth);
-                        if (!send) {
-                            LogPrintf("%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+                    LOCK(cs_main);
+                    BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+                    if (mi != mapBlockIndex.end())
+                    {
+                        if (chainActive.Contains(mi->second)) {
+                            send = true;
+                        } else {
+                            static const int nOneMonth = 30 * 24 * 60 * 60;
+                            // To prevent fingerprinting attacks, only send blocks outside of the active
+                            // chain if they are valid, and no more than a month older (both in time, and in
+                            // best equivalent proof of work) than the best header chain we know about.
+                            send = mi->second->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
+                                (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
+                                (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, consensusParams) < nOneMonth);
+                            if (!send) {
+                                LogPrintf("%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+                            }
                         }
                     }
-                }
-                // disconnect node in case we have reached the outbound limit for serving historical blocks
-                // never disconnect whitelisted nodes
-                static const int nOneWeek = 7 * 24 * 60 * 60; // assume > 1 week = historical
-                if (send && CNode::OutboundTargetReached(consensusParams.PoWTargetSpacing(currentHeight), true) && (
-                        (
-                            (pindexBestHeader != NULL) &&
-                            (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() > nOneWeek)
-                        ) || inv.type == MSG_FILTERED_BLOCK
-                    ) && !pfrom->fWhitelisted)
-                {
-                    LogPrint("net", "historical block serving limit reached, disconnect peer=%d\n", pfrom->GetId());
+                    // disconnect node in case we have reached the outbound limit for serving historical blocks
+                    // never disconnect whitelisted nodes
+                    static const int nOneWeek = 7 * 24 * 60 * 60; // assume > 1 week = historical
+                    if (send && CNode::OutboundTargetReached(consensusParams.PoWTargetSpacing(currentHeight), true) && (
+                            (
+                                (pindexBestHeader != NULL) &&
+                                (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() > nOneWeek)
+                            ) || inv.type == MSG_FILTERED_BLOCK
+                        ) && !pfrom->fWhitelisted)
+                    {
+                        LogPrint("net", "historical block serving limit reached, disconnect peer=%d\n", pfrom->GetId());
 
-                    //disconnect node
-                    pfrom->fDisconnect = true;
-                    send = false;
+                        //disconnect node
+                        pfrom->fDisconnect = true;
+                        send = false;
+                    }
+                    // Pruned nodes may have deleted the block, so check whether
+                    // it's available before trying to send.
+                    send = send && (mi->second->nStatus & BLOCK_HAVE_DATA);
+                    if (send) {
+                        blockPos = mi->second->GetBlockPos();
+                    }
                 }
-                // Pruned nodes may have deleted the block, so check whether
-                // it's available before trying to send.
-                if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
+                if (send)
                 {
-                    // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
-                        assert(!"cannot load block from disk");
                     if (inv.type == MSG_BLOCK)
-                        pfrom->PushMessage("block", block);
+                    {
+                        // Serve the block from the block cache, reading it from
+                        // disk only on a miss.
+                        CSerializedNetMsgRef msg = GetSerializedBlockMsg(inv.hash, blockPos, consensusParams);
+                        if (!msg) {
+                            // The block file may have been pruned since we looked it up.
+                            LogPrint("net", "cannot load block %s from disk, disconnect peer=%d\n", inv.hash.ToString(), pfrom->GetId());
+                            pfrom->fDisconnect = true;
+                            break;
+                        }
+                        pfrom->PushSerializedMessage("block", msg);
+                    }
                     else // MSG_FILTERED_BLOCK)
                     {
+                        // Send block from disk
+                        std::shared_ptr<const CBlock> pblock = ReadSharedBlockFromDisk(inv.hash, blockPos, consensusParams);
+                        if (!pblock) {
+                            // The block file may have been pruned since we looked it up.
+                            LogPrint("net", "cannot load block %s from disk, disconnect peer=%d\n", inv.hash.ToString(), pfrom->GetId());
+                            pfrom->fDisconnect = true;
+                            break;
+                        }
                         bool send = false;
                         CMerkleBlock merkleBlock;
                         {
                             LOCK(pfrom->cs_filter);
                             if (pfrom->pfilter) {
                                 send = true;
-                                merkleBlock = CMerkleBlock(block, *pfrom->pfilter);
+                                merkleBlock = CMerkleBlock(*pblock, *pfrom->pfilter);
                             }
                         }
                         if (send) {
@@ -6823,7 +7775,7 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                             // however we MUST always provide at least what the remote peer needs
                             typedef std::pair<unsigned int, uint256> PairType;
                             for (PairType& pair : merkleBlock.vMatchedTxn)
-                                pfrom->PushMessage("tx", block.vtx[pair.first]);
+                                pfrom->PushMessage("tx", pblock->vtx[pair.first]);
                         }
                         // else
                             // no response
@@ -6836,7 +7788,10 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                         // and we want it right after the last block so they don't
                         // wait for other stuff first.
                         vector<CInv> vInv;
-                        vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
+                        {
+                            LOCK(cs_main);
+                            vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
+                        }
                         pfrom->PushMessage("inv", vInv);
                         pfrom->hashContinue.SetNull();
                     }
@@ -6844,6 +7799,7 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
             }
             else if (inv.type == MSG_TX || inv.type == MSG_WTX)
             {
+                LOCK(cs_main);
                 // Send stream from relay memory
                 bool push = false;
                 auto mi = mapRelay.find(inv.hash);
@@ -6921,7 +7877,8 @@ void static ProcessOrphanTx(const CChainParams& chainparams, std::set<uint256>&
         auto orphan_it = mapOrphanTransactions.find(orphanHash);
         if (orphan_it == mapOrphanTransactions.end()) continue;
 
-        const CTransaction& orphanTx = orphan_it->second.tx;
+        const CTransactionRef porphanTx = orphan_it->second.tx;
+        const CTransaction& orphanTx = *porphanTx;
         NodeId fromPeer = orphan_it->second.fromPeer;
         bool fMissingInputs2 = false;
         // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
@@ -6930,7 +7887,7 @@ void static ProcessOrphanTx(const CChainParams& chainparams, std::set<uint256>&
         CValidationState stateDummy;
 
         if (setMisbehaving.count(fromPeer)) continue;
-        if (AcceptToMemoryPool(chainparams, mempool, stateDummy, orphanTx, true, &fMissingInputs2))
+        if (AcceptToMemoryPool(chainparams, mempool, stateDummy, porphanTx, true, &fMissingInputs2))
         {
             LogPrint("mempool", "   accepted orphan tx %s\n", orphanHash.ToString());
             RelayTransaction(orphanTx);
@@ -7343,7 +8300,7 @@ bool static ProcessMessage(const CChainParams& chainparams, CNode* pfrom, string
 
             if (inv.type == MSG_BLOCK) {
                 UpdateBlockAvailability(pfrom->GetId(), inv.hash);
-                if (!fAlreadyHave && !fImporting && !fReindex && !mapBlocksInFlight.count(inv.hash)) {
+                if (!fAlreadyHave && !fImporting && !fReindex && !fSnapshotPending && !mapBlocksInFlight.count(inv.hash)) {
                     // Headers-first is the primary method of announcement on
                     // the network. If a node fell back to sending blocks by inv,
                     // it's probably for a re-org. The final block hash
@@ -7490,8 +8447,9 @@ bool static ProcessMessage(const CChainParams& chainparams, CNode* pfrom, string
             return true;
         }
 
-        CTransaction tx;
-        vRecv >> tx;
+        CTransactionRef ptx;
+        vRecv >> ptx;
+        const CTransaction& tx = *ptx;
 
         const uint256& txid = tx.GetHash();
         const WTxId& wtxid = tx.GetWTxId();
@@ -7510,7 +8468,7 @@ bool static ProcessMessage(const CChainParams& chainparams, CNode* pfrom, string
         // because for pre-v5 transactions wtxid.authDigest is set to the same
         // placeholder as is used for the CInv.hashAux field for MSG_TX.
         if (!AlreadyHave(CInv(MSG_WTX, txid, wtxid.authDigest)) &&
-            AcceptToMemoryPool(chainparams, mempool, state, tx, true, &fMissingInputs))
+            AcceptToMemoryPool(chainparams, mempool, state, ptx, true, &fMissingInputs))
         {
             mempool.check(pcoinsTip);
             RelayTransaction(tx);
@@ -7550,7 +8508,7 @@ bool static ProcessMessage(const CChainParams& chainparams, CNode* pfrom, string
                     pfrom->AddKnownTxId(inv.hash);
                     if (!AlreadyHave(inv)) pfrom->AskFor(inv);
                 }
-                AddOrphanTx(tx, pfrom->GetId());
+                AddOrphanTx(ptx, pfrom->GetId());
 
                 // DoS prevention: do not allow mapOrphanTransactions and
                 // mapOrphanTransactionsByPrev to grow unbounded.
@@ -7679,7 +8637,7 @@ bool static ProcessMessage(const CChainParams& chainparams, CNode* pfrom, string
         NotifyHeaderTip(chainparams.GetConsensus());
     }
 
-    else if (strCommand == "block" && !fImporting && !fReindex) // Ignore blocks received while importing
+    else if (strCommand == "block" && !fImporting && !fReindex && !fSnapshotPending) // Ignore blocks received while importing, or before a snapshot is loaded
     {
         CBlock block;
         vRecv >> block;
@@ -7722,7 +8680,10 @@ bool static ProcessMessage(const CChainParams& chainparams, CNode* pfrom, string
         }
         pfrom->fSentAddr = true;
 
-        pfrom->vAddrToSend.clear();
+        {
+            LOCK(pfrom->cs_vAddrToSend);
+            pfrom->vAddrToSend.clear();
+        }
         vector<CAddress> vAddr = addrman.GetAddr();
         FastRandomContext insecure_rand;
         for (const CAddress &addr : vAddr)
@@ -8090,8 +9051,10 @@ bool ProcessMessages(const CChainParams& chainparams, CNode* pfrom)
     }
 
     // In case the connection got shut down, its receive buffer was wiped
-    if (!pfrom->fDisconnect)
+    if (!pfrom->fDisconnect) {
         pfrom->vRecvMsg.erase(pfrom->vRecvMsg.begin(), it);
+        pfrom->UpdateRecvPause();
+    }
 
     return fOk;
 }
@@ -8165,9 +9128,14 @@ bool SendMessages(const Consensus::Params& params, CNode* pto)
         //
         if (pto->nNextAddrSend < nNow) {
             pto->nNextAddrSend = PoissonNextSend(nNow, AVG_ADDRESS_BROADCAST_INTERVAL);
+            vector<CAddress> vAddrToSend;
+            {
+                LOCK(pto->cs_vAddrToSend);
+                vAddrToSend.swap(pto->vAddrToSend);
+            }
             vector<CAddress> vAddr;
-            vAddr.reserve(pto->vAddrToSend.size());
-            for (const CAddress& addr : pto->vAddrToSend)
+            vAddr.reserve(vAddrToSend.size());
+            for (const CAddress& addr : vAddrToSend)
             {
                 if (pto->AddAddressIfNotAlreadyKnown(addr))
                 {
@@ -8180,7 +9148,6 @@ bool SendMessages(const Consensus::Params& params, CNode* pto)
                     }
                 }
             }
-            pto->vAddrToSend.clear();
             if (!vAddr.empty())
                 pto->PushMessage("addr", vAddr);
         }
@@ -8409,7 +9376,7 @@ bool SendMessages(const Consensus::Params& params, CNode* pto)
         // Message: getdata (blocks)
         //
         vector<CInv> vGetData;
-        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload(params)) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        if (!pto->fDisconnect && !pto->fClient && !fSnapshotPending && (fFetch || !IsInitialBlockDownload(params)) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
             vector<CBlockIndex*> vToDownload;
             NodeId staller = -1;
             FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
@@ -12,6 +12,7 @@
 #endif
 
 #include "amount.h"
+#include "blockcache.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "coins.h"
@@ -50,6 +51,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CBloomFilter;
 class CChainParams;
 class CInv;
@@ -103,6 +105,8 @@ static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
+/** Set in the size field of a blk?????.dat or rev?????.dat record whose payload is LZ4-compressed */
+static const unsigned int DISK_RECORD_COMPRESSED = 0x80000000;
 
 /** Maximum number of script-checking threads allowed */
 static const int MAX_SCRIPTCHECK_THREADS = 16;
@@ -124,6 +128,10 @@ static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Time to wait (in seconds) between checks for block files to recompress. */
+static const unsigned int RECOMPRESS_BLOCK_FILES_INTERVAL = 60;
+/** Time to wait (in seconds) between publishing database statistics. */
+static const unsigned int DATABASE_STATS_INTERVAL = 60;
 /** Time to wait (in seconds) between writing wallet witness data to disk. */
 static const unsigned int WITNESS_WRITE_INTERVAL = 10 * 60;
 /** Number of updates between writing wallet witness data to disk. */
@@ -148,6 +156,8 @@ static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_IBD_SKIP_TX_VERIFICATION = false;
 static const bool DEFAULT_TXINDEX = false;
+static const bool DEFAULT_COINSTATSINDEX = false;
+static const bool DEFAULT_COMPRESS_BLOCKS = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 
 /** Default for -nurejectoldversions */
@@ -187,10 +197,39 @@ extern std::condition_variable g_best_block_cv;
 extern int g_best_block_height;
 extern uint256 g_best_block;
 
+/**
+ * An immutable summary of the active chain tip. A new snapshot is published
+ * each time the tip or the best header changes, so that RPC calls which only
+ * report on the tip can read it without waiting for cs_main, which is held
+ * for the whole of ConnectBlock.
+ *
+ * pindex may be dereferenced without cs_main for fields that do not change
+ * once a block is connected (hash, height, nBits, nTime, nChainTx, chain
+ * value pools, and pprev). Values that depend on other state protected by
+ * cs_main are copied into the snapshot when it is published.
+ */
+struct CChainTipSnapshot
+{
+    CBlockIndex* pindex = nullptr;
+    int nHeight = -1;
+    uint256 hash;
+    int64_t nMedianTimePast = 0;
+    //! Height of pindexBestHeader when the snapshot was published.
+    int nBestHeaderHeight = -1;
+    bool fInitialBlockDownload = true;
+    //! Sprout anchor at the tip, and the number of commitments in its tree.
+    uint256 hashSproutAnchor;
+    uint64_t nSproutCommitments = 0;
+    //! Lowest height with block data, if pruning is enabled.
+    std::optional<int> nPruneHeight;
+};
+
+/** Return the most recently published chain tip snapshot. Never returns null. */
+std::shared_ptr<const CChainTipSnapshot> GetChainTipSnapshot();
+
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
 extern int nScriptCheckThreads;
-extern bool fTxIndex;
 
 // The following flags enable specific indices (DB tables), but are not exposed as
 // separate command-line options; instead they are enabled by experimental feature "-insightexplorer"
@@ -207,6 +246,8 @@ extern bool fTimestampIndex;
 // END insightexplorer
 
 extern bool fIsBareMultisigStd;
+/** Whether blocks and undo data are compressed when written to disk. */
+extern bool fCompressBlocks;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
 extern bool fIBDSkipTxVerification;
@@ -241,8 +282,22 @@ extern uint64_t nPruneTarget;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
 static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 
+/**
+ * The base block of the snapshot the chainstate was loaded from, or NULL. No
+ * block up to and including it has data (protected by cs_main).
+ */
+extern CBlockIndex *pindexSnapshotBase;
+/**
+ * Set while -loadsnapshot waits for the headers chain to reach the snapshot's
+ * block. No blocks are downloaded or accepted from peers meanwhile, so that
+ * none is connected before the snapshot is loaded.
+ */
+extern std::atomic_bool fSnapshotPending;
+
 static const signed int DEFAULT_CHECKBLOCKS = MIN_BLOCKS_TO_KEEP;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
+/** Default for -checkcoinsinbackground */
+static const bool DEFAULT_CHECK_COINS_IN_BACKGROUND = true;
 
 /** Prefer to create v4 transactions. */
 static const int32_t DEFAULT_PREFERRED_TX_VERSION = ZIP225_TX_VERSION;
@@ -338,6 +393,26 @@ void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight
  */
 void UnlinkPrunedFiles(std::set<int>& setFilesToPrune);
 
+/**
+ * With -compressblocks, compress the blocks and undo data in block files
+ * written before it was set, one file at a time, oldest first. Each file's
+ * blocks are moved to the end of the block files and the file is deleted.
+ */
+void ThreadRecompressBlockFiles(const CChainParams& chainparams);
+
+/**
+ * With -loadsnapshot, wait for the headers chain to reach the snapshot's block,
+ * then load the snapshot and resume downloading blocks on top of it.
+ */
+void ThreadLoadSnapshot(const CChainParams& chainparams, const fs::path& path, const uint256& hashBlock);
+
+/**
+ * Publish database statistics as metrics and, with -dbcompactafteribd,
+ * compact the databases written during initial block download once it
+ * finishes.
+ */
+void ThreadDatabaseMaintenance(const CChainParams& chainparams);
+
 /** Create a new block index entry for a given block hash */
 CBlockIndex * InsertBlockIndex(const uint256& hash);
 /** Get statistics from node state */
@@ -350,6 +425,11 @@ void FlushStateToDisk();
 void PruneAndFlush();
 
 /** (try to) add transaction to memory pool **/
+bool AcceptToMemoryPool(
+        const CChainParams& chainparams,
+        CTxMemPool& pool, CValidationState &state, const CTransactionRef &ptx, bool fLimitFree,
+        bool* pfMissingInputs, bool fRejectAbsurdFee=false);
+/** As above, for callers that do not hold the transaction by reference; it is copied. */
 bool AcceptToMemoryPool(
         const CChainParams& chainparams,
         CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
@@ -542,13 +622,61 @@ bool GetAddressIndex(const uint160& addressHash, int type,
         int start = 0, int end = 0);
 bool GetAddressUnspent(const uint160& addressHash, int type,
         std::vector<CAddressUnspentDbEntry>& unspentOutputs);
+bool GetAddressBalance(const uint160& addressHash, int type,
+        CAddressBalanceValue& balance);
 bool GetTimestampIndex(unsigned int high, unsigned int low, bool fActiveOnly,
     std::vector<std::pair<uint256, unsigned int> > &hashes);
 
-/** Functions for disk access for blocks */
-bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
+/**
+ * Functions for disk access for blocks
+ *
+ * Each block is stored in a record of the message start, a size field and
+ * the payload, and its position points at the payload. If -compressblocks is
+ * set, a payload that compresses is stored as an LZ4 frame (the uncompressed
+ * length as a little-endian uint32, then an LZ4 block) and the size field has
+ * DISK_RECORD_COMPRESSED set. Blocks are read transparently either way.
+ */
+/** Serialize a block for writing to disk. Returns the size field of its record. */
+unsigned int EncodeBlockRecord(const CBlock& block, std::vector<unsigned char>& record);
+/** Write a record encoded by EncodeBlockRecord, setting pos to where its payload was written. */
+bool WriteBlockToDisk(const std::vector<unsigned char>& record, unsigned int nSize, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
+/** Read the block at pindex, from the block cache if it is there. */
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/**
+ * Return the block with the given hash stored at pos, shared with the block
+ * cache, or nullptr if it cannot be read or does not have that hash.
+ */
+std::shared_ptr<const CBlock> ReadSharedBlockFromDisk(const uint256& hash, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
+/**
+ * Open the block file containing the block stored at pos, positioned at the
+ * start of the record's payload, set nSize to the length of the payload and
+ * fCompressed to whether it is compressed. The caller owns the returned file.
+ * Returns NULL if the record header preceding the block does not match.
+ */
+FILE* OpenRawBlock(const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, unsigned int& nSize, bool& fCompressed);
+/** Read the serialized block stored at pos without deserializing it, decompressing it if needed. */
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
+/** As above, but serve the block with the given hash from the block cache if it is there. */
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const uint256& hash, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
+/** Read the undo data stored at pos, checking it against the hash of the block's parent. */
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock);
+
+/**
+ * Keeps the block files from being deleted by ThreadRecompressBlockFiles while
+ * it is alive. Code that looks up the position of a block or its undo data and
+ * then reads it without holding cs_main creates one before the lookup, and
+ * keeps it until the file is open.
+ */
+class CBlockFileReader
+{
+public:
+    CBlockFileReader();
+    ~CBlockFileReader();
+
+    CBlockFileReader(const CBlockFileReader&) = delete;
+    CBlockFileReader& operator=(const CBlockFileReader&) = delete;
+};
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -625,14 +753,51 @@ bool RegenerateSubtrees(ShieldedType type, const Consensus::Params& consensusPar
  */
 bool RewindBlockIndex(const CChainParams& chainparams, bool& clearWitnessCaches);
 
+/**
+ * Write the chainstate as of the active chain tip to a snapshot file, and
+ * return its metadata and hash (dumptxoutset).
+ */
+bool DumpChainstateSnapshot(const fs::path& path, CSnapshotMetadata& metadata, uint256& hashSnapshot, uint64_t& nEntries);
+
+/**
+ * Replace the chainstate of a node that has not connected any block after
+ * genesis by a snapshot, if its hash is committed to in the chain parameters,
+ * and make the snapshot's base block the active chain tip (-loadsnapshot and
+ * loadtxoutset), which are experimental. The blocks before the base are never
+ * downloaded or validated.
+ */
+bool LoadChainstateSnapshot(CValidationState& state, const CChainParams& chainparams, const fs::path& path, CSnapshotMetadata& metadata, uint64_t& nEntries);
+
 /** RAII wrapper for VerifyDB: Verify consistency of the block and coin databases */
 class CVerifyDB {
 public:
     CVerifyDB();
     ~CVerifyDB();
     bool VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth);
+
+    /**
+     * Check levels 0 to 2: that the last nCheckDepth blocks of the active
+     * chain can be read, are valid, and have readable undo data. The blocks
+     * are independent, so they are checked on all available cores.
+     */
+    bool VerifyBlocks(const CChainParams& chainparams, int nCheckLevel, int nCheckDepth);
+
+    /**
+     * Check levels 3 and 4: that disconnecting the last blocks of the active
+     * chain from coinsview in memory, and reconnecting them, is consistent.
+     * The blocks are disconnected one after another from the block coinsview
+     * is at, taking cs_main for each block rather than for the whole check.
+     */
+    bool VerifyCoins(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth);
 };
 
+/**
+ * Run the level 3 and 4 checks of VerifyDB against a snapshot of the
+ * chainstate database once the node has started, and shut the node down if
+ * they fail. They are abandoned if the node shuts down first.
+ */
+void ThreadVerifyCoins(const CChainParams& chainparams, int nCheckLevel, int nCheckDepth);
+
 /** Find the last common block between the parameter chain and a locator. */
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator);
 
@@ -645,12 +810,31 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex);
 /** The currently-connected chain of blocks (protected by cs_main). */
 extern CChain chainActive;
 
+/** Global variable that points to the coins database (protected by cs_main) */
+extern CCoinsViewDB *pcoinsdbview;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/**
+ * Global variable that points to the lightwalletd compact block store, or NULL
+ * if -lightwalletd is not enabled (protected by cs_main)
+ */
+extern CCompactBlockDB *pcompactblocks;
+
+/** Cache of recently connected and frequently read blocks, sized by -blockcachesize */
+extern CBlockCache blockcache;
+
+/**
+ * Return the lightwalletd compact block for a block in the block index. It is
+ * served from the compact block store when possible, and otherwise rebuilt from
+ * the block on disk and stored. Requires cs_main.
+ */
+bool GetCompactBlock(const CBlockIndex* pindex, std::vector<uint8_t>& data, const Consensus::Params& consensusParams);
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
@@ -671,6 +855,8 @@ static const unsigned int REJECT_ALREADY_KNOWN = 0x101;
 static const unsigned int REJECT_CONFLICT = 0x102;
 
 uint64_t CalculateCurrentUsage();
+/** Return the total size of the block and undo files, without requiring cs_main. */
+uint64_t GetBlockFilesSize();
 
 /**
  * Return a CMutableTransaction with contextual default values based on set of consensus rules at nHeight. The expiryDelta will
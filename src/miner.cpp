@@ -311,7 +311,7 @@ CBlockTemplate* BlockAssembler::CreateNewBlock(
     pblock = &pblocktemplate->block; // pointer for convenience
 
     // Add dummy coinbase tx as first transaction
-    pblock->vtx.push_back(CTransaction());
+    pblock->vtx.push_back(MakeTransactionRef());
     pblocktemplate->vTxFees.push_back(-1); // updated at end
     pblocktemplate->vTxSigOps.push_back(-1); // updated at end
 
@@ -376,15 +376,15 @@ CBlockTemplate* BlockAssembler::CreateNewBlock(
 
     // Create coinbase tx
     if (next_cb_mtx) {
-        pblock->vtx[0] = *next_cb_mtx;
+        pblock->vtx[0] = MakeTransactionRef(*next_cb_mtx);
     } else {
-        pblock->vtx[0] = CreateCoinbaseTransaction(chainparams, nFees, minerAddress, nHeight);
+        pblock->vtx[0] = MakeTransactionRef(CreateCoinbaseTransaction(chainparams, nFees, minerAddress, nHeight));
     }
     pblocktemplate->vTxFees[0] = -nFees;
 
     // Update the Sapling commitment tree.
-    for (const CTransaction& tx : pblock->vtx) {
-        for (const auto& odesc : tx.GetSaplingOutputs()) {
+    for (const auto& tx : pblock->vtx) {
+        for (const auto& odesc : tx->GetSaplingOutputs()) {
             sapling_tree.append(uint256::FromRawBytes(odesc.cmu()));
         }
     }
@@ -439,7 +439,7 @@ CBlockTemplate* BlockAssembler::CreateNewBlock(
     UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
     pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
     pblock->nSolution.clear();
-    pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
+    pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(*pblock->vtx[0]);
 
     CValidationState state;
     if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, true)) {
@@ -554,7 +554,7 @@ bool BlockAssembler::TestForBlock(CTxMemPool::txiter iter)
 
 void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
 {
-    pblock->vtx.push_back(iter->GetTx());
+    pblock->vtx.push_back(iter->GetSharedTx());
     pblocktemplate->vTxFees.push_back(iter->GetFee());
     pblocktemplate->vTxSigOps.push_back(iter->GetSigOpCount());
     nBlockSize += iter->GetTxSize();
@@ -749,11 +749,11 @@ void IncrementExtraNonce(
     }
     ++nExtraNonce;
     unsigned int nHeight = pindexPrev->nHeight+1; // Height first in coinbase required for block.version=2
-    CMutableTransaction txCoinbase(pblock->vtx[0]);
+    CMutableTransaction txCoinbase(*pblock->vtx[0]);
     txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
     assert(txCoinbase.vin[0].scriptSig.size() <= 100);
 
-    pblock->vtx[0] = txCoinbase;
+    pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
     if (consensusParams.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_NU5)) {
         pblocktemplate->hashAuthDataRoot = pblock->BuildAuthDataMerkleTree();
@@ -766,7 +766,7 @@ void IncrementExtraNonce(
 static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainparams)
 {
     LogPrintf("%s\n", pblock->ToString());
-    LogPrintf("generated %s\n", FormatMoney(pblock->vtx[0].vout[0].nValue));
+    LogPrintf("generated %s\n", FormatMoney(pblock->vtx[0]->vout[0].nValue));
 
     // Found a solution
     {
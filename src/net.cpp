@@ -29,6 +29,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #include <boost/thread.hpp>
 
 #include <math.h>
@@ -67,6 +71,8 @@ static bool vfLimited[NET_MAX] = {};
 static CNode* pnodeLocalHost = NULL;
 uint64_t nLocalHostNonce = 0;
 static std::vector<ListenSocket> vhListenSocket;
+// Created by StartNode; sockets are added and removed as they are opened and closed.
+static std::unique_ptr<CSocketEvents> socketEvents;
 CAddrMan addrman;
 int nMaxConnections = DEFAULT_MAX_PEER_CONNECTIONS;
 bool fAddressesInitialized = false;
@@ -437,6 +443,8 @@ void CNode::CloseSocketDisconnect()
         LOCK(cs_hSocket);
         if (hSocket != INVALID_SOCKET) {
             LogPrint("net", "disconnecting peer=%d\n", id);
+            if (socketEvents)
+                socketEvents->Remove(hSocket);
             CloseSocket(hSocket);
         }
     }
@@ -753,9 +761,10 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
             MetricsCounter(
                 "zcash.net.in.bytes", msg.hdr.nMessageSize,
                 "command", strCommand.c_str());
-            messageHandlerCondition.notify_one();
+            messageHandlerCondition.notify_all();
         }
     }
+    UpdateRecvPause();
 
     return true;
 }
@@ -815,20 +824,40 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 
 
 
+// Maximum number of queued messages to pass to a single sendmsg() call.
+static const size_t MAX_SEND_IOVECS = 64;
+
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode *pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    auto it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end()) {
-        const CSerializeData &data = *it;
-        assert(data.size() > pnode->nSendOffset);
-        int nBytes = 0;
+        assert((*it)->size() > pnode->nSendOffset);
+        ssize_t nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            const CSerializedNetMsg& data = **it;
+            nBytes = send(pnode->hSocket, (const char*)&data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // Gather as many queued messages as possible into one system call.
+            struct iovec iov[MAX_SEND_IOVECS];
+            size_t nIov = 0;
+            size_t nOffset = pnode->nSendOffset;
+            for (auto itIov = it; itIov != pnode->vSendMsg.end() && nIov < MAX_SEND_IOVECS; ++itIov) {
+                iov[nIov].iov_base = const_cast<char*>((*itIov)->data()) + nOffset;
+                iov[nIov].iov_len = (*itIov)->size() - nOffset;
+                nOffset = 0;
+                nIov++;
+            }
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nIov;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetTime();
@@ -836,13 +865,21 @@ void SocketSendData(CNode *pnode)
                 LOCK(pnode->cs_vSend);
                 pnode->nSendBytes += nBytes;
             }
-            pnode->nSendOffset += nBytes;
             pnode->RecordBytesSent(nBytes);
-            if (pnode->nSendOffset == data.size()) {
+            // Advance past every message that was sent in full.
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                size_t nLeft = (*it)->size() - pnode->nSendOffset;
+                if (nRemaining < nLeft) {
+                    pnode->nSendOffset += nRemaining;
+                    break;
+                }
+                nRemaining -= nLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
+                pnode->nSendSize -= (*it)->size();
                 it++;
-            } else {
+            }
+            if (pnode->nSendOffset != 0) {
                 // could not send full message; stop sending more
                 break;
             }
@@ -866,6 +903,24 @@ void SocketSendData(CNode *pnode)
         assert(pnode->nSendSize == 0);
     }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
+    pnode->fWantSend = !pnode->vSendMsg.empty();
+    pnode->UpdateSocketEvents();
+}
+
+CSerializedNetMsgRef FinalizeNetMsg(CPublicDataStream& ss)
+{
+    // Set the size
+    unsigned int nSize = ss.size() - CMessageHeader::HEADER_SIZE;
+    WriteLE32((uint8_t*)&ss[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
+
+    // Set the checksum
+    uint256 hash = Hash(ss.begin() + CMessageHeader::HEADER_SIZE, ss.end());
+    assert(ss.size () >= CMessageHeader::CHECKSUM_OFFSET + CMessageHeader::CHECKSUM_SIZE);
+    memcpy((char*)&ss[CMessageHeader::CHECKSUM_OFFSET], hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+
+    auto msg = std::make_shared<CSerializedNetMsg>();
+    ss.MoveAndClear(*msg);
+    return msg;
 }
 
 static list<CNode*> vNodesDisconnected;
@@ -1092,6 +1147,205 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
     }
 }
 
+#ifdef USE_EPOLL
+
+// Maximum number of ready sockets returned by one epoll_wait call. Readiness is
+// level-triggered, so any others are returned by the next call.
+static const int MAX_EPOLL_EVENTS = 1024;
+
+static uint32_t ToEpollEvents(uint32_t nEvents)
+{
+    return ((nEvents & CSocketEvents::RECV) ? EPOLLIN : 0) |
+           ((nEvents & CSocketEvents::SEND) ? EPOLLOUT : 0);
+}
+
+CSocketEvents::CSocketEvents()
+{
+    hEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (hEpoll == -1) {
+        throw std::runtime_error(strprintf("epoll_create1 failed: %s", NetworkErrorString(errno)));
+    }
+}
+
+CSocketEvents::~CSocketEvents()
+{
+    close(hEpoll);
+}
+
+bool CSocketEvents::Add(SOCKET hSocket, uint32_t nEvents)
+{
+    struct epoll_event event = {};
+    event.events = ToEpollEvents(nEvents);
+    event.data.fd = hSocket;
+    if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hSocket, &event) == -1) {
+        LogPrint("net", "epoll_ctl failed to add socket %d: %s\n", hSocket, NetworkErrorString(errno));
+        return false;
+    }
+    return true;
+}
+
+bool CSocketEvents::Modify(SOCKET hSocket, uint32_t nEvents)
+{
+    struct epoll_event event = {};
+    event.events = ToEpollEvents(nEvents);
+    event.data.fd = hSocket;
+    if (epoll_ctl(hEpoll, EPOLL_CTL_MOD, hSocket, &event) == -1) {
+        LogPrint("net", "epoll_ctl failed to modify socket %d: %s\n", hSocket, NetworkErrorString(errno));
+        return false;
+    }
+    return true;
+}
+
+void CSocketEvents::Remove(SOCKET hSocket)
+{
+    epoll_ctl(hEpoll, EPOLL_CTL_DEL, hSocket, nullptr);
+}
+
+bool CSocketEvents::Wait(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, int nTimeoutMillis)
+{
+    recv_set.clear();
+    send_set.clear();
+    error_set.clear();
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int nEvents = epoll_wait(hEpoll, events, MAX_EPOLL_EVENTS, nTimeoutMillis);
+    if (nEvents == -1) {
+        return false;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        SOCKET hSocket = events[i].data.fd;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            error_set.insert(hSocket);
+        }
+        if (events[i].events & EPOLLIN) {
+            recv_set.insert(hSocket);
+        }
+        if (events[i].events & EPOLLOUT) {
+            send_set.insert(hSocket);
+        }
+    }
+    return true;
+}
+
+#else
+
+CSocketEvents::CSocketEvents() {}
+
+CSocketEvents::~CSocketEvents() {}
+
+bool CSocketEvents::Add(SOCKET hSocket, uint32_t nEvents)
+{
+    LOCK(cs);
+    mapInterest[hSocket] = nEvents;
+    return true;
+}
+
+bool CSocketEvents::Modify(SOCKET hSocket, uint32_t nEvents)
+{
+    LOCK(cs);
+    auto it = mapInterest.find(hSocket);
+    if (it == mapInterest.end()) {
+        return false;
+    }
+    it->second = nEvents;
+    return true;
+}
+
+void CSocketEvents::Remove(SOCKET hSocket)
+{
+    LOCK(cs);
+    mapInterest.erase(hSocket);
+}
+
+bool CSocketEvents::Wait(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, int nTimeoutMillis)
+{
+    recv_set.clear();
+    send_set.clear();
+    error_set.clear();
+
+    struct timeval timeout = MillisToTimeval(nTimeoutMillis);
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+    std::vector<SOCKET> vSockets;
+    {
+        LOCK(cs);
+        for (const auto& [hSocket, nEvents] : mapInterest) {
+            if (nEvents & RECV) FD_SET(hSocket, &fdsetRecv);
+            if (nEvents & SEND) FD_SET(hSocket, &fdsetSend);
+            FD_SET(hSocket, &fdsetError);
+            hSocketMax = max(hSocketMax, hSocket);
+            have_fds = true;
+            vSockets.push_back(hSocket);
+        }
+    }
+
+    if (!have_fds) {
+        // select() fails on Windows when there is nothing to wait on.
+        MilliSleep(nTimeoutMillis);
+        return true;
+    }
+
+    int nSelect = select(hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (nSelect == SOCKET_ERROR) {
+        return false;
+    }
+
+    for (SOCKET hSocket : vSockets) {
+        if (FD_ISSET(hSocket, &fdsetRecv)) recv_set.insert(hSocket);
+        if (FD_ISSET(hSocket, &fdsetSend)) send_set.insert(hSocket);
+        if (FD_ISSET(hSocket, &fdsetError)) error_set.insert(hSocket);
+    }
+    return true;
+}
+
+#endif // USE_EPOLL
+
+/**
+ * Decide which socket events to wait for on this peer's socket:
+ * - If there is data to send, wait for sending data. As this only happens
+ *   when optimistic write failed, we choose to first drain the write buffer
+ *   in this case before receiving more. This avoids needlessly queueing
+ *   received data, if the remote peer is not themselves receiving data. This
+ *   means properly utilizing TCP flow control signaling.
+ * - Otherwise, if there is no (complete) message in the receive buffer, or
+ *   there is space left in the buffer, wait for receiving data.
+ * - (if neither of the above applies, there is certainly one message in the
+ *   receiver buffer ready to be processed).
+ * Together, that means that at least one of the following is always possible,
+ * so we don't deadlock:
+ * - We send some data.
+ * - We wait for data to be received (and disconnect after timeout).
+ * - We process a message in the buffer (message handler thread).
+ *
+ * This is called whenever fWantSend or fPauseRecv changes, so the events
+ * registered for the socket are only updated when they change.
+ */
+void CNode::UpdateSocketEvents()
+{
+    LOCK(cs_hSocket);
+    if (hSocket == INVALID_SOCKET || !socketEvents)
+        return;
+    uint32_t nEvents = fWantSend ? CSocketEvents::SEND : (fPauseRecv ? 0 : CSocketEvents::RECV);
+    if (nEvents != nSocketEvents && socketEvents->Modify(hSocket, nEvents))
+        nSocketEvents = nEvents;
+}
+
+void CNode::UpdateRecvPause()
+{
+    AssertLockHeld(cs_vRecvMsg);
+    fPauseRecv = !vRecvMsg.empty() && vRecvMsg.front().complete() &&
+        GetTotalRecvSize() > ReceiveFloodSize();
+    UpdateSocketEvents();
+}
+
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
@@ -1166,103 +1420,27 @@ void ThreadSocketHandler()
         }
 
         //
-        // Find which sockets have data to receive
+        // Find which sockets are ready
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
+        std::set<SOCKET> recv_set, send_set, error_set;
 
+        // frequency to check for disconnected peers and timeouts
+        static const int SOCKET_WAIT_MILLIS = 50;
+        if (!socketEvents->Wait(recv_set, send_set, error_set, SOCKET_WAIT_MILLIS))
         {
-            LOCK(cs_vNodes);
-            for (CNode* pnode : vNodes)
-            {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signaling.
-                // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
-                // * (if neither of the above applies, there is certainly one message
-                //   in the receiver buffer ready to be processed).
-                // Together, that means that at least one of the following is always possible,
-                // so we don't deadlock:
-                // * We send some data.
-                // * We wait for data to be received (and disconnect after timeout).
-                // * We process a message in the buffer (message handler thread).
-
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
-
-                bool select_recv;
-                {
-                    TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                    select_recv = lockRecv && (
-                        pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
-                        pnode->GetTotalRecvSize() <= ReceiveFloodSize());
-                }
-
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
-        }
-
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        boost::this_thread::interruption_point();
-
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
+            int nErr = WSAGetLastError();
+            if (nErr != WSAEINTR)
                 LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec/1000);
+            MilliSleep(SOCKET_WAIT_MILLIS);
         }
+        boost::this_thread::interruption_point();
 
         //
         // Accept new connections
         //
         for (const ListenSocket& hListenSocket : vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket) > 0)
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1294,9 +1472,9 @@ void ThreadSocketHandler()
                 LOCK(pnode->cs_hSocket);
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                recvSet = recv_set.count(pnode->hSocket) > 0;
+                sendSet = send_set.count(pnode->hSocket) > 0;
+                errorSet = error_set.count(pnode->hSocket) > 0;
             }
             if (recvSet || errorSet)
             {
@@ -1681,7 +1859,12 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant *grantOu
 }
 
 
-void ThreadMessageHandler()
+/**
+ * Process messages from, and send messages to, peers. Several of these
+ * threads may run at once (-msghandlerthreads); each claims a peer before
+ * processing it, so a slow peer only holds up its own thread.
+ */
+void ThreadMessageHandler(int nThread, int nThreads)
 {
     const CChainParams& chainparams = Params();
     boost::mutex condition_mutex;
@@ -1701,11 +1884,24 @@ void ThreadMessageHandler()
 
         bool fSleep = true;
 
-        for (CNode* pnode : vNodesCopy)
+        // Start each thread at a different peer so that they spread out.
+        size_t nNodes = vNodesCopy.size();
+        size_t nStart = nNodes * nThread / nThreads;
+        for (size_t i = 0; i < nNodes; i++)
         {
+            CNode* pnode = vNodesCopy[(nStart + i) % nNodes];
             if (pnode->fDisconnect)
                 continue;
 
+            // Skip peers that another message handler thread is processing.
+            bool fExpected = false;
+            if (!pnode->fInMessageHandler.compare_exchange_strong(fExpected, true))
+                continue;
+            struct ReleasePeer {
+                CNode* pnode;
+                ~ReleasePeer() { pnode->fInMessageHandler = false; }
+            } releasePeer{pnode};
+
             auto spanGuard = pnode->span.Enter();
 
             // Receive messages
@@ -1944,6 +2140,12 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     fAddressesInitialized = true;
 
+    if (!socketEvents) {
+        socketEvents.reset(new CSocketEvents());
+        for (const ListenSocket& hListenSocket : vhListenSocket)
+            socketEvents->Add(hListenSocket.socket, CSocketEvents::RECV);
+    }
+
     if (semOutbound == NULL) {
         // initialize semaphore
         int nMaxOutbound = std::min(MAX_OUTBOUND_CONNECTIONS, nMaxConnections);
@@ -1975,7 +2177,11 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
         threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "opencon", &ThreadOpenConnections));
 
     // Process messages
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    int nMessageHandlerThreads = std::max(1, std::min((int)GetArg("-msghandlerthreads", DEFAULT_MESSAGE_HANDLER_THREADS), MAX_MESSAGE_HANDLER_THREADS));
+    for (int i = 0; i < nMessageHandlerThreads; i++) {
+        threadGroup.create_thread(boost::bind(&TraceThread<std::function<void()>>, "msghand",
+            std::function<void()>(std::bind(&ThreadMessageHandler, i, nMessageHandlerThreads))));
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(&DumpData, DUMP_ADDRESSES_INTERVAL);
@@ -2173,21 +2379,21 @@ void CNode::Fuzz(int nChance)
     case 0:
         // xor a random byte with a random value:
         if (!ssSend.empty()) {
-            CDataStream::size_type pos = GetRand(ssSend.size());
+            CPublicDataStream::size_type pos = GetRand(ssSend.size());
             ssSend[pos] ^= (unsigned char)(GetRand(256));
         }
         break;
     case 1:
         // delete a random byte:
         if (!ssSend.empty()) {
-            CDataStream::size_type pos = GetRand(ssSend.size());
+            CPublicDataStream::size_type pos = GetRand(ssSend.size());
             ssSend.erase(ssSend.begin()+pos);
         }
         break;
     case 2:
         // insert a random byte at a random position
         {
-            CDataStream::size_type pos = GetRand(ssSend.size());
+            CPublicDataStream::size_type pos = GetRand(ssSend.size());
             char ch = (char)GetRand(256);
             ssSend.insert(ssSend.begin()+pos, ch);
         }
@@ -2227,9 +2433,13 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     fNetworkNode = false;
     fSuccessfullyConnected = false;
     fDisconnect = false;
+    fInMessageHandler = false;
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
+    fWantSend = false;
+    fPauseRecv = false;
+    nSocketEvents = 0;
     hashContinue = uint256();
     nStartingHeight = -1;
     fSendMempool = false;
@@ -2258,6 +2468,9 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     auto spanGuard = span.Enter();
     LogPrint("net", "Added connection");
 
+    if (hSocket != INVALID_SOCKET && socketEvents && socketEvents->Add(hSocket, CSocketEvents::RECV))
+        nSocketEvents = CSocketEvents::RECV;
+
     // Be shy and don't send version until we hear
     if (hSocket != INVALID_SOCKET && !fInbound)
         PushVersion();
@@ -2267,6 +2480,8 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
 
 CNode::~CNode()
 {
+    if (hSocket != INVALID_SOCKET && socketEvents)
+        socketEvents->Remove(hSocket);
     CloseSocket(hSocket);
 
     if (pfilter)
@@ -2362,30 +2577,39 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
         LEAVE_CRITICAL_SECTION(cs_vSend);
         return;
     }
-    // Set the size
-    unsigned int nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
-    WriteLE32((uint8_t*)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
 
-    // Set the checksum
-    uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
-    assert(ssSend.size () >= CMessageHeader::CHECKSUM_OFFSET + CMessageHeader::CHECKSUM_SIZE);
-    memcpy((char*)&ssSend[CMessageHeader::CHECKSUM_OFFSET], hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CSerializedNetMsgRef msg = FinalizeNetMsg(ssSend);
+    LogPrint("net", "(%d bytes) peer=%d\n", msg->size() - CMessageHeader::HEADER_SIZE, id);
+
+    QueueSendMsg(msg, strSendCommand);
+    strSendCommand.clear();
+
+    LEAVE_CRITICAL_SECTION(cs_vSend);
+}
 
-    LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
+void CNode::PushSerializedMessage(const char* pszCommand, const CSerializedNetMsgRef& msg)
+{
+    std::string strCommand = SanitizeString(pszCommand);
+    LOCK(cs_vSend);
+    MetricsIncrementCounter("zcash.net.out.messages", "command", strCommand.c_str());
+    LogPrint("net", "sending: %s (%d bytes) peer=%d\n", strCommand, msg->size() - CMessageHeader::HEADER_SIZE, id);
+    QueueSendMsg(msg, strCommand);
+}
 
-    std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-    ssSend.GetAndClear(*it);
-    nSendSize += (*it).size();
+void CNode::QueueSendMsg(const CSerializedNetMsgRef& msg, const std::string& strCommand)
+{
+    AssertLockHeld(cs_vSend);
+
+    bool fQueueEmpty = vSendMsg.empty();
+    vSendMsg.push_back(msg);
+    nSendSize += msg->size();
     MetricsCounter(
-        "zcash.net.out.bytes", (*it).size(),
-        "command", strSendCommand.c_str());
-    strSendCommand.clear();
+        "zcash.net.out.bytes", msg->size(),
+        "command", strCommand.c_str());
 
     // If write queue empty, attempt "optimistic write"
-    if (it == vSendMsg.begin())
+    if (fQueueEmpty)
         SocketSendData(this);
-
-    LEAVE_CRITICAL_SECTION(cs_vSend);
 }
 
 /* static */ uint64_t CNode::CalculateKeyedNetGroup(const CAddress& ad)
@@ -23,7 +23,11 @@
 
 #include <atomic>
 #include <deque>
+#include <map>
+#include <memory>
+#include <set>
 #include <stdint.h>
+#include <vector>
 
 #ifndef WIN32
 #include <arpa/inet.h>
@@ -82,6 +86,10 @@ static const int NETWORK_UPGRADE_PEER_PREFERENCE_BLOCK_PERIOD = 1728;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default number of threads processing peer messages (-msghandlerthreads) */
+static const int DEFAULT_MESSAGE_HANDLER_THREADS = 1;
+/** Maximum number of threads processing peer messages */
+static const int MAX_MESSAGE_HANDLER_THREADS = 16;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
@@ -103,8 +111,84 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler);
 bool StopNode();
 void SocketSendData(CNode *pnode);
 
+/**
+ * The sockets serviced by ThreadSocketHandler, and the events wanted on each.
+ *
+ * Interest in a socket is registered when it is added and only updated when
+ * it changes, e.g. when a peer's send queue becomes empty or non-empty, so
+ * with epoll each change is a single epoll_ctl call and waiting costs time
+ * proportional to the number of ready sockets rather than the number of
+ * peers. Sockets are then not limited to FD_SETSIZE. Elsewhere, select() is
+ * used over the registered sockets.
+ *
+ * Errors are always reported. A socket must be removed before it is closed,
+ * so that a reused descriptor is never mistaken for it.
+ */
+class CSocketEvents
+{
+public:
+    static const uint32_t RECV = 1;
+    static const uint32_t SEND = 2;
+
+    CSocketEvents();
+    ~CSocketEvents();
+
+    CSocketEvents(const CSocketEvents&) = delete;
+    CSocketEvents& operator=(const CSocketEvents&) = delete;
+
+    /** Start waiting for nEvents (a combination of RECV and SEND) on hSocket. */
+    bool Add(SOCKET hSocket, uint32_t nEvents);
+    /** Change the events waited for on a socket that has been added. */
+    bool Modify(SOCKET hSocket, uint32_t nEvents);
+    /** Stop waiting on hSocket. */
+    void Remove(SOCKET hSocket);
+
+    /**
+     * Wait up to nTimeoutMillis for a registered socket to become ready. On
+     * success, fills recv_set, send_set and error_set with the sockets that
+     * are readable, writable or in error. On failure, returns false and
+     * leaves the sets empty.
+     */
+    bool Wait(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, int nTimeoutMillis);
+
+private:
+#ifdef USE_EPOLL
+    int hEpoll;
+#else
+    CCriticalSection cs;
+    std::map<SOCKET, uint32_t> mapInterest;
+#endif
+};
+
 typedef int64_t NodeId;
 
+/**
+ * A complete serialized network message (header and payload). Queued messages
+ * are immutable and reference counted, so a message serialized once can be
+ * queued for any number of peers. The buffer is taken over from the stream the
+ * message was serialized into. Messages are public, so the buffer is not zeroed
+ * when freed.
+ */
+typedef CPublicSerializeData CSerializedNetMsg;
+typedef std::shared_ptr<const CSerializedNetMsg> CSerializedNetMsgRef;
+
+/** Fill in the size and checksum of the message in ss, and move it into a shared buffer, leaving ss empty. */
+CSerializedNetMsgRef FinalizeNetMsg(CPublicDataStream& ss);
+
+/**
+ * Serialize a message once, for sending to one or more peers with
+ * CNode::PushSerializedMessage. Only use this for messages whose encoding
+ * does not depend on the peer's protocol version.
+ */
+template<typename... Args>
+CSerializedNetMsgRef SerializeNetMsg(const char* pszCommand, const Args&... args)
+{
+    CPublicDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CMessageHeader(Params().MessageStart(), pszCommand, 0);
+    (ss << ... << args);
+    return FinalizeNetMsg(ss);
+}
+
 struct CombinerAll
 {
     typedef bool result_type;
@@ -265,17 +349,26 @@ public:
     // socket
     std::atomic<uint64_t> nServices;
     SOCKET hSocket;
-    CDataStream ssSend;
+    CPublicDataStream ssSend;
     std::string strSendCommand; // Current command being assembled in ssSend
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<CSerializeData> vSendMsg;
+    std::deque<CSerializedNetMsgRef> vSendMsg;
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
+    // Whether vSendMsg is non-empty, and whether the receive buffer is full;
+    // together they decide the socket events we wait for.
+    std::atomic_bool fWantSend;
+    std::atomic_bool fPauseRecv;
+    // Socket events registered with the socket handler, guarded by cs_hSocket.
+    uint32_t nSocketEvents;
     CCriticalSection cs_vRecv;
 
     CCriticalSection cs_sendProcessing;
+    // Set while a message handler thread is processing this peer, so that
+    // each peer's messages are handled by one thread at a time.
+    std::atomic_bool fInMessageHandler;
 
     std::deque<CInv> vRecvGetData;
     std::deque<CNetMessage> vRecvMsg;
@@ -341,13 +434,18 @@ protected:
 
     // Basic fuzz-testing
     void Fuzz(int nChance); // modifies ssSend
+    // Append msg to vSendMsg, attempting an optimistic write if the queue was empty.
+    void QueueSendMsg(const CSerializedNetMsgRef& msg, const std::string& strCommand) EXCLUSIVE_LOCKS_REQUIRED(cs_vSend);
 
 public:
     uint256 hashContinue;
     std::atomic<int> nStartingHeight;
 
     // flood relay
-    std::vector<CAddress> vAddrToSend;
+    // vAddrToSend is filled by the handler threads of other peers when they
+    // relay addresses, so it has its own lock.
+    CCriticalSection cs_vAddrToSend;
+    std::vector<CAddress> vAddrToSend GUARDED_BY(cs_vAddrToSend);
     bool fGetAddr;
     std::set<uint256> setKnown;
     int64_t nNextAddrSend;
@@ -448,6 +546,12 @@ public:
     // requires LOCK(cs_vRecvMsg)
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes);
 
+    // Re-register the socket events for fWantSend and fPauseRecv, if they changed.
+    void UpdateSocketEvents();
+
+    // requires LOCK(cs_vRecvMsg)
+    void UpdateRecvPause();
+
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int nVersionIn)
     {
@@ -499,6 +603,7 @@ public:
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
         if (addr.IsValid() && !IsAddressKnown(addr)) {
+            LOCK(cs_vAddrToSend);
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand.randrange(vAddrToSend.size())] = addr;
             } else {
@@ -557,6 +662,9 @@ public:
     // TODO: Document the precondition of this function.  Is cs_vSend locked?
     void EndMessage() UNLOCK_FUNCTION(cs_vSend);
 
+    // Queue a message created with SerializeNetMsg, sharing its buffer.
+    void PushSerializedMessage(const char* pszCommand, const CSerializedNetMsgRef& msg);
+
     void PushVersion();
 
 
@@ -60,8 +60,8 @@ uint256 CBlock::BuildAuthDataMerkleTree() const
     tree.reserve(expectedSize);
 
     // Add the leaves to the tree. v1-v4 transactions will append empty leaves.
-    for (auto &tx : vtx) {
-        tree.push_back(tx.GetAuthDigest());
+    for (const auto& tx : vtx) {
+        tree.push_back(tx->GetAuthDigest());
     }
     // Append empty leaves until we get a perfect tree.
     tree.insert(tree.end(), perfectSize - vtx.size(), uint256());
@@ -97,7 +97,7 @@ std::string CBlock::ToString() const
         vtx.size());
     for (unsigned int i = 0; i < vtx.size(); i++)
     {
-        s << "  " << vtx[i].ToString() << "\n";
+        s << "  " << vtx[i]->ToString() << "\n";
     }
     return s.str();
 }
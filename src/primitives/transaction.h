@@ -17,6 +17,7 @@
 #include "consensus/upgrades.h"
 
 #include <array>
+#include <memory>
 #include <variant>
 
 #include "zcash/NoteEncryption.hpp"
@@ -908,4 +909,13 @@ struct CMutableTransaction
     uint256 GetAuthDigest() const;
 };
 
+/**
+ * A shared reference to an immutable transaction. Blocks, the mempool, relay
+ * and block templates hold transactions through these, so that a transaction
+ * received from a peer is not copied as it moves between them.
+ */
+typedef std::shared_ptr<const CTransaction> CTransactionRef;
+static inline CTransactionRef MakeTransactionRef() { return std::make_shared<const CTransaction>(); }
+template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
+
 #endif // BITCOIN_PRIMITIVES_TRANSACTION_H
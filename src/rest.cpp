@@ -5,6 +5,8 @@
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
 #include "chainparams.h"
+#include "compactblock.h"
+#include "experimental_features.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
@@ -24,6 +26,7 @@
 using namespace std;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const long MAX_REST_BLOCKS_COUNT = 1000; //allow a max of 1000 blocks to be fetched by /rest/blocks/ at once
 
 enum RetFormat {
     RF_UNDEF,
@@ -117,6 +120,34 @@ static bool CheckWarmup(HTTPRequest* req)
     return true;
 }
 
+/**
+ * Set range to the bytes of the serialized block stored at pos, for sending
+ * straight from the block file. A compressed block is decompressed, and its
+ * bytes are sent from memory instead. Returns false if the block cannot be
+ * found; the range has neither a descriptor nor data if it could not be
+ * opened.
+ */
+static bool OpenBlockRange(const CDiskBlockPos& pos, HTTPRequest::FileRange& range, int fdFile = -1)
+{
+    unsigned int nSize;
+    bool fCompressed;
+    FILE* file = OpenRawBlock(pos, Params().MessageStart(), nSize, fCompressed);
+    if (!file)
+        return false;
+    if (!fCompressed) {
+        range = {fdFile >= 0 ? fdFile : dup(fileno(file)), (int64_t)pos.nPos, nSize};
+        fclose(file);
+        return true;
+    }
+    fclose(file);
+
+    auto rawBlock = std::make_shared<std::vector<uint8_t>>();
+    if (!ReadRawBlockFromDisk(*rawBlock, pos, Params().MessageStart()))
+        return false;
+    range = {-1, 0, (int64_t)rawBlock->size(), std::move(rawBlock)};
+    return true;
+}
+
 static bool rest_headers(HTTPRequest* req,
                          const std::string& strURIPart)
 {
@@ -214,8 +245,9 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
-    CBlock block;
     CBlockIndex* pblockindex = NULL;
+    CDiskBlockPos blockPos;
+    CBlockFileReader reader;
     {
         LOCK(cs_main);
         if (mapBlockIndex.count(hash) == 0)
@@ -224,29 +256,46 @@ static bool rest_block(HTTPRequest* req,
         pblockindex = mapBlockIndex[hash];
         if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
-
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
-            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        blockPos = pblockindex->GetBlockPos();
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-    ssBlock << block;
-
+    // The binary and hex formats are served from the bytes stored in the
+    // block file, without deserializing and reserializing the block.
     switch (rf) {
     case RF_BINARY: {
-        string binaryBlock = ssBlock.str();
+        std::vector<HTTPRequest::FileRange> ranges(1);
+        if (!OpenBlockRange(blockPos, ranges[0]))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        if (ranges[0].fd < 0 && !ranges[0].data)
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Failed to read block file");
         req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryBlock);
+        req->WriteReplyFromFiles(HTTP_OK, ranges);
         return true;
     }
 
     case RF_HEX: {
-        string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        std::vector<uint8_t> rawBlock;
+        if (!ReadRawBlockFromDisk(rawBlock, hash, blockPos, Params().MessageStart()))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        string strHex = HexStr(rawBlock.begin(), rawBlock.end()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
     }
 
+    case RF_JSON:
+        break;
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+
+    switch (rf) {
     case RF_JSON: {
         UniValue objBlock;
         {
@@ -278,6 +327,120 @@ static bool rest_block_notxdetails(HTTPRequest* req, const std::string& strURIPa
     return rest_block(req, strURIPart, false);
 }
 
+static bool rest_blocks(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No start height and count specified. Use /rest/blocks/<start>/<count>.bin.");
+    if (rf != RF_BINARY)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin)");
+
+    int32_t nStart;
+    if (!ParseInt32(path[0], &nStart) || nStart < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid start height: " + path[0]);
+    int32_t nCount;
+    if (!ParseInt32(path[1], &nCount) || nCount < 1 || nCount > MAX_REST_BLOCKS_COUNT)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + path[1]);
+
+    // Look up the blocks under cs_main, then send them straight from the
+    // block files without holding it. The files are kept until they are open.
+    std::vector<CDiskBlockPos> positions;
+    CBlockFileReader reader;
+    {
+        LOCK(cs_main);
+        if (nStart > chainActive.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, "Start height out of range: " + path[0]);
+        for (int nHeight = nStart; nHeight <= chainActive.Height() && positions.size() < (size_t)nCount; nHeight++) {
+            const CBlockIndex* pindex = chainActive[nHeight];
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+                return RESTERR(req, HTTP_NOT_FOUND, strprintf("Block at height %d not available (pruned data)", nHeight));
+            positions.push_back(pindex->GetBlockPos());
+        }
+    }
+
+    // Consecutive blocks in the same block file are sent from one descriptor,
+    // so a request holds about one descriptor per file rather than per block.
+    std::vector<HTTPRequest::FileRange> ranges;
+    auto closeRanges = [&ranges]() {
+        for (size_t i = 0; i < ranges.size(); i++) {
+            if (ranges[i].fd >= 0 && (i == 0 || ranges[i].fd != ranges[i - 1].fd))
+                close(ranges[i].fd);
+        }
+    };
+    int nLastFile = -1;
+    int fdLastFile = -1;
+    for (const CDiskBlockPos& pos : positions) {
+        HTTPRequest::FileRange range;
+        if (!OpenBlockRange(pos, range, pos.nFile == nLastFile ? fdLastFile : -1)) {
+            closeRanges();
+            return RESTERR(req, HTTP_NOT_FOUND, "Block not found at " + pos.ToString());
+        }
+        if (range.fd < 0 && !range.data) {
+            closeRanges();
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Failed to read block file");
+        }
+        // A compressed block is served from memory.
+        const bool fFromBlockFile = !range.data;
+        nLastFile = fFromBlockFile ? pos.nFile : -1;
+        fdLastFile = fFromBlockFile ? range.fd : -1;
+        ranges.push_back(range);
+    }
+
+    req->WriteHeader("Content-Type", "application/octet-stream");
+    req->WriteReplyFromFiles(HTTP_OK, ranges);
+    return true;
+}
+
+static bool rest_compactblocks(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    if (!fExperimentalLightWalletd)
+        return RESTERR(req, HTTP_NOT_FOUND, "Compact blocks require -lightwalletd");
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No start height and count specified. Use /rest/compactblocks/<start>/<count>.bin.");
+    if (rf != RF_BINARY)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin)");
+
+    int32_t nStart;
+    if (!ParseInt32(path[0], &nStart) || nStart < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid start height: " + path[0]);
+    int32_t nCount;
+    if (!ParseInt32(path[1], &nCount) || nCount < 1 || nCount > MAX_REST_BLOCKS_COUNT)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + path[1]);
+
+    // Each CompactBlock message is preceded by its length as a varint, as in
+    // protobuf's length-delimited stream format.
+    std::vector<uint8_t> out;
+    {
+        LOCK(cs_main);
+        if (nStart > chainActive.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, "Start height out of range: " + path[0]);
+        std::vector<uint8_t> compactBlock;
+        for (int nHeight = nStart; nHeight <= chainActive.Height() && nHeight - nStart < nCount; nHeight++) {
+            if (!GetCompactBlock(chainActive[nHeight], compactBlock, Params().GetConsensus()))
+                return RESTERR(req, HTTP_NOT_FOUND, strprintf("Block at height %d not available", nHeight));
+            WriteCompactBlockLength(out, compactBlock.size());
+            out.insert(out.end(), compactBlock.begin(), compactBlock.end());
+        }
+    }
+
+    req->WriteHeader("Content-Type", "application/octet-stream");
+    req->WriteReply(HTTP_OK, std::string(out.begin(), out.end()));
+    return true;
+}
+
 // A bit of a hack - dependency on a function defined in rpc/blockchain.cpp
 UniValue getblockchaininfo(const UniValue& params, bool fHelp);
 
@@ -613,6 +776,8 @@ static const struct {
       {"/rest/tx/", rest_tx},
       {"/rest/block/notxdetails/", rest_block_notxdetails},
       {"/rest/block/", rest_block_extended},
+      {"/rest/blocks/", rest_blocks},
+      {"/rest/compactblocks/", rest_compactblocks},
       {"/rest/chaininfo", rest_chaininfo},
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
@@ -10,6 +10,10 @@
 #include "checkpoints.h"
 #include "consensus/validation.h"
 #include "experimental_features.h"
+#include "index/coinstatsindex.h"
+#include "index/insightspentindex.h"
+#include "index/insighttimestampindex.h"
+#include "index/txindex.h"
 #include "key_io.h"
 #include "main.h"
 #include "metrics.h"
@@ -19,6 +23,10 @@
 #include "sync.h"
 #include "util/system.h"
 
+#ifdef ENABLE_WALLET
+#include "wallet/wallet.h"
+#endif
+
 #include <stdint.h>
 
 #include <univalue.h>
@@ -151,7 +159,7 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
     KeyIO keyIO(Params());
     UniValue deltas(UniValue::VARR);
     for (unsigned int i = 0; i < block.vtx.size(); i++) {
-        const CTransaction &tx = block.vtx[i];
+        const CTransaction &tx = *block.vtx[i];
         const uint256 txhash = tx.GetHash();
 
         UniValue entry(UniValue::VOBJ);
@@ -248,16 +256,16 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     }
     result.pushKV("chainhistoryroot", blockindex->hashChainHistoryRoot.GetHex());
     UniValue txs(UniValue::VARR);
-    for (const CTransaction&tx : block.vtx)
+    for (const CTransactionRef& tx : block.vtx)
     {
         if(txDetails)
         {
             UniValue objTx(UniValue::VOBJ);
-            TxToJSON(tx, uint256(), objTx);
+            TxToJSON(*tx, uint256(), objTx);
             txs.push_back(objTx);
         }
         else
-            txs.push_back(tx.GetHash().GetHex());
+            txs.push_back(tx->GetHash().GetHex());
     }
     result.pushKV("tx", txs);
     result.pushKV("time", block.GetBlockTime());
@@ -318,8 +326,7 @@ UniValue getblockcount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockcount", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainTipSnapshot()->nHeight;
 }
 
 UniValue getbestblockhash(const UniValue& params, bool fHelp)
@@ -335,8 +342,7 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getbestblockhash", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    return GetChainTipSnapshot()->hash.GetHex();
 }
 
 UniValue getdifficulty(const UniValue& params, bool fHelp)
@@ -507,6 +513,11 @@ UniValue getblockdeltas(const UniValue& params, bool fHelp)
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
 
+    if (g_spentindex && !g_spentindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf(
+            "The spent index is still syncing. Current height: %d", g_spentindex->GetBestHeight()));
+    }
+
     LOCK(cs_main);
 
     if (mapBlockIndex.count(hash) == 0)
@@ -575,6 +586,10 @@ UniValue getblockhashes(const UniValue& params, bool fHelp)
     }
 
     std::vector<std::pair<uint256, unsigned int> > blockHashes;
+    if (g_timestampindex && !g_timestampindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf(
+            "The timestamp index is still syncing. Current height: %d", g_timestampindex->GetBestHeight()));
+    }
     {
         LOCK(cs_main);
         if (!GetTimestampIndex(high, low, fActiveOnly, blockHashes)) {
@@ -839,29 +854,85 @@ UniValue getblock(const UniValue& params, bool fHelp)
 
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() != 0)
+    if (fHelp || params.size() > 2)
         throw runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" height )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time, unless hash_type is muhash.\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"  (string, optional, default=\"hash_serialized\") Which UTXO set hash should be calculated.\n"
+            "                  \"hash_serialized\" scans the chain state. \"muhash\" reads the statistics from the\n"
+            "                  coinstats index, which requires -coinstatsindex.\n"
+            "2. height       (numeric, optional) The height of the block of the active chain to report the\n"
+            "                  statistics as of (default: the chain tip). Requires hash_type muhash.\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"transactions\": n,      (numeric) The number of transactions (only with hash_type hash_serialized)\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
-            "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
-            "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
+            "  \"bytes_serialized\": n,  (numeric) The serialized size (only with hash_type hash_serialized)\n"
+            "  \"hash_serialized\": \"hash\",   (string) The serialized hash (only with hash_type hash_serialized)\n"
+            "  \"muhash\": \"hash\",    (string) The MuHash3072 of the unspent outputs (only with hash_type muhash)\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"muhash\" 1000")
             + HelpExampleRpc("gettxoutsetinfo", "")
+            + HelpExampleRpc("gettxoutsetinfo", "\"muhash\", 1000")
         );
 
+    std::string hashType = "hash_serialized";
+    if (params.size() > 0 && !params[0].isNull()) {
+        hashType = params[0].get_str();
+    }
+    if (hashType != "hash_serialized" && hashType != "muhash") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("%s is not a valid hash_type", hashType));
+    }
+    bool fHeight = params.size() > 1 && !params[1].isNull();
+
     UniValue ret(UniValue::VOBJ);
 
     CCoinsStats stats;
+    if (hashType == "muhash") {
+        if (!g_coinstatsindex) {
+            throw JSONRPCError(RPC_MISC_ERROR, "hash_type muhash requires -coinstatsindex");
+        }
+        if (!g_coinstatsindex->BlockUntilSyncedToCurrentChain()) {
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf(
+                "The coinstats index is still syncing. Current height: %d", g_coinstatsindex->GetBestHeight()));
+        }
+
+        const CBlockIndex* pindex;
+        {
+            LOCK(cs_main);
+            // The index may not have caught up with a block connected since
+            // we waited on it, so default to its own best block.
+            int nHeight = std::min(chainActive.Height(), g_coinstatsindex->GetBestHeight());
+            if (fHeight) {
+                nHeight = params[1].get_int();
+                if (nHeight < 0 || nHeight > chainActive.Height()) {
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+                }
+            }
+            pindex = chainActive[nHeight];
+        }
+        if (!pindex || !g_coinstatsindex->LookUpStats(pindex, stats)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set statistics from the coinstats index");
+        }
+        ret.pushKV("height", (int64_t)stats.nHeight);
+        ret.pushKV("bestblock", stats.hashBlock.GetHex());
+        ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
+        ret.pushKV("muhash", stats.hashMuHash.GetHex());
+        ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
+        return ret;
+    }
+
+    if (fHeight) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Querying a specific height requires hash_type muhash");
+    }
+
     FlushStateToDisk();
     if (pcoinsTip->GetStats(stats)) {
         ret.pushKV("height", (int64_t)stats.nHeight);
@@ -875,6 +946,119 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
     return ret;
 }
 
+UniValue dumptxoutset(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrites the chainstate at the chain tip to a snapshot file, which another node can load\n"
+            "with loadtxoutset if its hash is committed to in the chain parameters.\n"
+            "\nArguments:\n"
+            "1. \"path\"     (string, required) The file to write, relative to the data directory if not absolute.\n"
+            "                It must not already exist.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"path\": \"path\",          (string) The absolute path of the snapshot\n"
+            "  \"base_hash\": \"hash\",     (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\": n,        (numeric) The height of that block\n"
+            "  \"entries\": n,            (numeric) The number of chainstate records written\n"
+            "  \"snapshot_hash\": \"hash\"  (string) The hash of the snapshot\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumptxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.dat\"")
+        );
+
+    fs::path path = fs::absolute(params[0].get_str(), GetDataDir());
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("%s already exists", path.string()));
+    }
+
+    CSnapshotMetadata metadata;
+    uint256 hashSnapshot;
+    uint64_t nEntries;
+    if (!DumpChainstateSnapshot(path, metadata, hashSnapshot, nEntries)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to write the snapshot, see debug.log for details");
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("path", path.string());
+    ret.pushKV("base_hash", metadata.hashBlock.GetHex());
+    ret.pushKV("base_height", metadata.nHeight);
+    ret.pushKV("entries", (uint64_t)nEntries);
+    ret.pushKV("snapshot_hash", hashSnapshot.GetHex());
+    return ret;
+}
+
+UniValue loadtxoutset(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "loadtxoutset \"path\"\n"
+            "\nReplaces the chainstate by a snapshot written with dumptxoutset, making its block the\n"
+            "chain tip. The snapshot's hash must match the one committed to in the chain parameters\n"
+            "for its height, and its block must be in the best headers chain. This is only possible\n"
+            "before any blocks have been connected, and without a wallet or any index.\n"
+            "\nWARNING: This is an experimental feature, enabled with -experimentalfeatures -assumeutxo.\n"
+            "The blocks below the snapshot's block are never downloaded or validated, so the snapshot\n"
+            "is trusted for as long as the chainstate is used, and they are not served to peers. Use\n"
+            "-reindex to replace the chainstate by one validated from genesis. If loading is\n"
+            "interrupted, the node must be restarted with -reindex.\n"
+            "\nA node started without -loadsnapshot begins downloading blocks as soon as it has headers,\n"
+            "so prefer starting it with -loadsnapshot=<file>, which holds off block download until the\n"
+            "snapshot is loaded.\n"
+            "\nArguments:\n"
+            "1. \"path\"     (string, required) The snapshot file, relative to the data directory if not absolute.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"base_hash\": \"hash\",     (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\": n,        (numeric) The height of that block\n"
+            "  \"entries\": n,            (numeric) The number of chainstate records loaded\n"
+            "  \"tip_hash\": \"hash\"       (string) The hash of the chain tip after loading\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("loadtxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("loadtxoutset", "\"utxo.dat\"")
+        );
+
+    if (!fExperimentalAssumeUtxo) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Error: loadtxoutset is disabled. Restart with -experimentalfeatures -assumeutxo to enable it.");
+    }
+#ifdef ENABLE_WALLET
+    if (pwalletMain) {
+        throw JSONRPCError(RPC_MISC_ERROR, "A snapshot cannot be loaded with a wallet, restart with -disablewallet");
+    }
+#endif
+    if (g_txindex || g_coinstatsindex || fExperimentalInsightExplorer || fExperimentalLightWalletd) {
+        throw JSONRPCError(RPC_MISC_ERROR, "A snapshot cannot be loaded with an index enabled");
+    }
+    if (fSnapshotPending) {
+        throw JSONRPCError(RPC_MISC_ERROR, "A snapshot is already waiting to be loaded with -loadsnapshot");
+    }
+
+    fs::path path = fs::absolute(params[0].get_str(), GetDataDir());
+    CValidationState state;
+    CSnapshotMetadata metadata;
+    uint64_t nEntries = 0;
+    if (LoadChainstateSnapshot(state, Params(), path, metadata, nEntries)) {
+        ActivateBestChain(state, Params());
+    }
+
+    if (!state.IsValid()) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, state.GetRejectReason());
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("base_hash", metadata.hashBlock.GetHex());
+    ret.pushKV("base_height", metadata.nHeight);
+    ret.pushKV("entries", (uint64_t)nEntries);
+    {
+        LOCK(cs_main);
+        ret.pushKV("tip_hash", chainActive.Tip()->GetBlockHash().GetHex());
+    }
+    return ret;
+}
+
 UniValue gettxout(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 2 || params.size() > 3)
@@ -1110,30 +1294,31 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockchaininfo", "")
         );
 
-    LOCK(cs_main);
+    // Everything reported here comes from the chain tip snapshot or needs
+    // only cs_LastBlockFile, so that this call does not wait for cs_main
+    // while a block is being connected.
+    auto snapshot = GetChainTipSnapshot();
+    CBlockIndex* tip = snapshot->pindex;
 
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("chain",                 Params().NetworkIDString());
-    obj.pushKV("blocks",                (int)chainActive.Height());
-    obj.pushKV("initial_block_download_complete", !IsInitialBlockDownload(Params().GetConsensus()));
-    obj.pushKV("headers",               pindexBestHeader ? pindexBestHeader->nHeight : -1);
-    obj.pushKV("bestblockhash",         chainActive.Tip()->GetBlockHash().GetHex());
-    obj.pushKV("difficulty",            (double)GetNetworkDifficulty());
-    obj.pushKV("verificationprogress",  Checkpoints::GuessVerificationProgress(Params().Checkpoints(), chainActive.Tip()));
-    obj.pushKV("chainwork",             chainActive.Tip()->nChainWork.GetHex());
+    obj.pushKV("blocks",                snapshot->nHeight);
+    obj.pushKV("initial_block_download_complete", !snapshot->fInitialBlockDownload);
+    obj.pushKV("headers",               snapshot->nBestHeaderHeight);
+    obj.pushKV("bestblockhash",         snapshot->hash.GetHex());
+    obj.pushKV("difficulty",            (double)GetNetworkDifficulty(tip));
+    obj.pushKV("verificationprogress",  Checkpoints::GuessVerificationProgress(Params().Checkpoints(), tip));
+    obj.pushKV("chainwork",             tip->nChainWork.GetHex());
     obj.pushKV("pruned",                fPruneMode);
-    obj.pushKV("size_on_disk",          CalculateCurrentUsage());
+    obj.pushKV("size_on_disk",          GetBlockFilesSize());
 
-    if (IsInitialBlockDownload(Params().GetConsensus()))
-        obj.pushKV("estimatedheight",       EstimateNetHeight(Params().GetConsensus(), (int)chainActive.Height(), chainActive.Tip()->GetMedianTimePast()));
+    if (snapshot->fInitialBlockDownload)
+        obj.pushKV("estimatedheight",       EstimateNetHeight(Params().GetConsensus(), snapshot->nHeight, snapshot->nMedianTimePast));
     else
-        obj.pushKV("estimatedheight",       (int)chainActive.Height());
+        obj.pushKV("estimatedheight",       snapshot->nHeight);
 
-    SproutMerkleTree tree;
-    pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), tree);
-    obj.pushKV("commitments",           static_cast<uint64_t>(tree.size()));
+    obj.pushKV("commitments",           snapshot->nSproutCommitments);
 
-    CBlockIndex* tip = chainActive.Tip();
     obj.pushKV("chainSupply", ValuePoolDesc(std::nullopt, tip->nChainTotalSupply, std::nullopt));
     UniValue valuePools(UniValue::VARR);
     valuePools.push_back(ValuePoolDesc("transparent", tip->nChainTransparentValue, std::nullopt));
@@ -1163,13 +1348,9 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
     consensus.pushKV("nextblock", HexInt(CurrentEpochBranchId(tip->nHeight + 1, consensusParams)));
     obj.pushKV("consensus", consensus);
 
-    if (fPruneMode)
+    if (snapshot->nPruneHeight.has_value())
     {
-        CBlockIndex *block = chainActive.Tip();
-        while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA))
-            block = block->pprev;
-
-        obj.pushKV("pruneheight",        block->nHeight);
+        obj.pushKV("pruneheight",        snapshot->nPruneHeight.value());
     }
 
     if (Params().NetworkIDString() == "regtest") {
@@ -1514,6 +1695,64 @@ UniValue z_getsubtreesbyindex(const UniValue& params, bool fHelp)
     return res;
 }
 
+UniValue getcompactblock(const UniValue& params, bool fHelp)
+{
+    std::string disabledMsg = "";
+    if (!fExperimentalLightWalletd) {
+        disabledMsg = experimentalDisabledHelpMsg("getcompactblock", {"lightwalletd"});
+    }
+
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getcompactblock \"hash|height\"\n"
+            + disabledMsg +
+            "\nReturns the lightwalletd compact block for the given block, as a hex-encoded\n"
+            "CompactBlock protobuf message (see compact_formats.proto in the lightwalletd\n"
+            "repository). Only transactions with Sapling spends or outputs, or Orchard\n"
+            "actions, are included, and note ciphertexts are truncated to their first 52 bytes.\n"
+            "\nRequires that lightwalletd indexing be enabled when starting zcashd (pass\n"
+            "-lightwalletd).\n"
+            "\nArguments:\n"
+            "1. \"hash|height\"          (string, required) The block hash or height. Height can be negative where -1 is the last known valid block\n"
+            "\nResult:\n"
+            "\"data\"             (string) The hex-encoded CompactBlock message\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcompactblock", "\"00000000febc373a1da2bd9f887b105ad79ddc26ac26c2b28652d64e5207c5b5\"")
+            + HelpExampleRpc("getcompactblock", "\"00000000febc373a1da2bd9f887b105ad79ddc26ac26c2b28652d64e5207c5b5\"")
+            + HelpExampleCli("getcompactblock", "12800")
+            + HelpExampleRpc("getcompactblock", "12800")
+        );
+
+    if (!fExperimentalLightWalletd) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Error: getcompactblock is disabled.");
+    }
+
+    LOCK(cs_main);
+
+    std::string strHash = params[0].get_str();
+
+    // If height is supplied, find the hash
+    if (strHash.size() < (2 * sizeof(uint256))) {
+        strHash = chainActive[parseHeightArg(strHash, chainActive.Height())]->GetBlockHash().GetHex();
+    }
+
+    uint256 hash(uint256S(strHash));
+
+    if (mapBlockIndex.count(hash) == 0)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+    CBlockIndex* pblockindex = mapBlockIndex[hash];
+
+    std::vector<uint8_t> compactBlock;
+    if (!GetCompactBlock(pblockindex, compactBlock, Params().GetConsensus())) {
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    }
+
+    return HexStr(compactBlock.begin(), compactBlock.end());
+}
+
 UniValue mempoolInfoToJSON()
 {
     UniValue ret(UniValue::VOBJ);
@@ -1630,23 +1869,41 @@ UniValue reconsiderblock(const UniValue& params, bool fHelp)
     return NullUniValue;
 }
 
+UniValue syncwithvalidationinterfacequeue(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw runtime_error(
+            "syncwithvalidationinterfacequeue\n"
+            "\nWaits for the validation interface queue to catch up on everything that was there when this RPC was called.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("syncwithvalidationinterfacequeue","")
+            + HelpExampleRpc("syncwithvalidationinterfacequeue","")
+        );
+
+    SyncWithValidationInterfaceQueue();
+    return NullUniValue;
+}
+
 static const CRPCCommand commands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode  streamReply
+  //  --------------------- ------------------------  -----------------------  ----------  -----------
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
     { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
+    { "blockchain",         "getblock",               &getblock,               true,       true },
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
     { "blockchain",         "getblockheader",         &getblockheader,         true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
     { "blockchain",         "z_gettreestate",         &z_gettreestate,         true  },
-    { "blockchain",         "z_getsubtreesbyindex",   &z_getsubtreesbyindex,   true  },
+    { "blockchain",         "z_getsubtreesbyindex",   &z_getsubtreesbyindex,   true,       true },
+    { "blockchain",         "getcompactblock",        &getcompactblock,        true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,       true },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           true  },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
 
     // insightexplorer
@@ -1656,6 +1913,7 @@ static const CRPCCommand commands[] =
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        true  },
     { "hidden",             "reconsiderblock",        &reconsiderblock,        true  },
+    { "hidden",             "syncwithvalidationinterfacequeue", &syncwithvalidationinterfacequeue, true  },
 };
 
 void RegisterBlockchainRPCCommands(CRPCTable &tableRPC)
@@ -53,16 +53,20 @@ static const CRPCConvertTable rpcCvtTable =
     { "getblockhash",                {{o}, {}} },
     { "getblockheader",              {{s}, {o}} },
     { "getblock",                    {{s}, {o}} },
-    { "gettxoutsetinfo",             {{}, {}} },
+    { "gettxoutsetinfo",             {{}, {s, o}} },
+    { "dumptxoutset",                {{s}, {}} },
+    { "loadtxoutset",                {{s}, {}} },
     { "gettxout",                    {{s, o}, {o}} },
     { "verifychain",                 {{}, {o, o}} },
     { "getblockchaininfo",           {{}, {}} },
     { "getchaintips",                {{}, {}} },
     { "z_gettreestate",              {{s}, {}} },
     { "z_getsubtreesbyindex",        {{s, o}, {o}} },
+    { "getcompactblock",             {{s}, {}} },
     { "getmempoolinfo",              {{}, {}} },
     { "invalidateblock",             {{s}, {}} },
     { "reconsiderblock",             {{s}, {}} },
+    { "syncwithvalidationinterfacequeue", {{}, {}} },
     // mining
     { "getlocalsolps",               {{}, {}} },
     { "getnetworksolps",             {{}, {o, o}} },
@@ -161,7 +165,7 @@ static const CRPCConvertTable rpcCvtTable =
     { "z_listunspent",               {{}, {o, o, o, o, o}} },
     { "fundrawtransaction",          {{s}, {o}} },
     { "zcsamplejoinsplit",           {{}, {}} },
-    { "zcbenchmark",                 {{s, o}, {o}} },
+    { "zcbenchmark",                 {{s, o}, {o, o}} },
     { "z_getnewaddress",             {{}, {s}} },
     { "z_getnewaccount",             {{}, {}} },
     { "z_getaddressforaccount",      {{o}, {o, o}} },
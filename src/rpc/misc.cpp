@@ -6,6 +6,8 @@
 
 #include "clientversion.h"
 #include "deprecation.h"
+#include "index/insightaddressindex.h"
+#include "index/insightspentindex.h"
 #include "init.h"
 #include "key_io.h"
 #include "experimental_features.h"
@@ -20,6 +22,8 @@
 #include "wallet/walletdb.h"
 #endif
 
+#include <algorithm>
+#include <optional>
 #include <stdint.h>
 #include <variant>
 
@@ -77,15 +81,19 @@ UniValue getinfo(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getinfo", "")
         );
 
-#ifdef ENABLE_WALLET
-    LOCK2(cs_main, pwalletMain ? &pwalletMain->cs_wallet : NULL);
-#else
-    LOCK(cs_main);
-#endif
+    // Chain state is read from the tip snapshot; cs_main is only needed for
+    // the wallet fields.
+    auto snapshot = GetChainTipSnapshot();
 
     proxyType proxy;
     GetProxy(NET_IPV4, proxy);
 
+    int nConnections;
+    {
+        LOCK(cs_vNodes);
+        nConnections = (int)vNodes.size();
+    }
+
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("version", CLIENT_VERSION);
     obj.pushKV("build", FormatFullVersion());
@@ -93,18 +101,20 @@ UniValue getinfo(const UniValue& params, bool fHelp)
     obj.pushKV("protocolversion", PROTOCOL_VERSION);
 #ifdef ENABLE_WALLET
     if (pwalletMain) {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
         obj.pushKV("walletversion", pwalletMain->GetVersion());
         obj.pushKV("balance",       ValueFromAmount(pwalletMain->GetBalance(std::nullopt)));
     }
 #endif
-    obj.pushKV("blocks",        (int)chainActive.Height());
+    obj.pushKV("blocks",        snapshot->nHeight);
     obj.pushKV("timeoffset",    0);
-    obj.pushKV("connections",   (int)vNodes.size());
+    obj.pushKV("connections",   nConnections);
     obj.pushKV("proxy",         (proxy.IsValid() ? proxy.proxy.ToStringIPPort() : string()));
-    obj.pushKV("difficulty",    (double)GetDifficulty());
+    obj.pushKV("difficulty",    snapshot->pindex ? GetDifficulty(snapshot->pindex) : 1.0);
     obj.pushKV("testnet",       Params().TestnetToBeDeprecatedFieldRPC());
 #ifdef ENABLE_WALLET
     if (pwalletMain) {
+        LOCK(pwalletMain->cs_wallet);
         obj.pushKV("keypoololdest", pwalletMain->GetOldestKeyPoolTime());
         obj.pushKV("keypoolsize",   (int)pwalletMain->GetKeyPoolSize());
     }
@@ -633,6 +643,69 @@ static bool getAddressesFromParams(
     return true;
 }
 
+// Wait for the address index to catch up with the blocks that are already
+// connected, so that a query sees the chain that it reports. While the index
+// is still being built, its results would be incomplete, so refuse the query.
+static void syncAddressIndex()
+{
+    if (g_addressindex && !g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf(
+            "The address index is still syncing. Current height: %d", g_addressindex->GetBestHeight()));
+    }
+}
+
+// Read the optional "limit" and "cursor" fields used to page through the
+// results of an address index query. Returns false if the query isn't paged.
+template <typename Key>
+static bool getPageFromParams(const UniValue& params, int& limit, std::optional<Key>& after)
+{
+    if (!params[0].isObject()) {
+        return false;
+    }
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (limitValue.isNull()) {
+        if (!cursorValue.isNull()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "A cursor requires a limit");
+        }
+        return false;
+    }
+    limit = limitValue.get_int();
+    if (limit <= 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit must be positive");
+    }
+    if (!cursorValue.isNull()) {
+        const std::string& strCursor = cursorValue.get_str();
+        if (!IsHex(strCursor)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        CDataStream ss(ParseHex(strCursor), SER_DISK, CLIENT_VERSION);
+        Key key;
+        try {
+            ss >> key;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        if (!ss.empty()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        after = key;
+    }
+    if (!fAddressIndex || !g_addressindex) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+    return true;
+}
+
+// The cursor that resumes a paged query after the given index entry.
+template <typename Key>
+static std::string encodeCursor(const Key& key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << key;
+    return HexStr(ss.begin(), ss.end());
+}
+
 // insightexplorer
 UniValue getaddressmempool(const UniValue& params, bool fHelp)
 {
@@ -721,6 +794,10 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "      ,...\n"
             "    ],\n"
             "  \"chainInfo\"  (boolean, optional, default=false) Include chain info with results\n"
+            "  \"limit\"  (number, optional) Return at most this many outputs, ordered by address and then by\n"
+            "             txid and output index instead of by height\n"
+            "  \"cursor\"  (string, optional) Continue after the last output of a previous call with the same\n"
+            "             addresses, from its \"cursor\" result\n"
             "}\n"
             "(or)\n"
             "\"address\"  (string) The base58check encoded address\n"
@@ -750,6 +827,11 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "    ],\n"
             "  \"hash\"              (string)  The block hash\n"
             "  \"height\"            (numeric) The block height\n"
+            "}\n\n"
+            "(or, if limit is given, the above object without \"hash\" and \"height\" unless chainInfo is true,\n"
+            "and with):\n\n"
+            "{\n"
+            "  \"cursor\"            (string, optional) Pass this to get the next page; absent on the last page\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"tmYXBYJj1K7vhejSec5osXK2QsGa5MTisUQ\"], \"chainInfo\": true}'")
@@ -767,19 +849,9 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
     if (!getAddressesFromParams(params, addresses)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
-    std::vector<CAddressUnspentDbEntry> unspentOutputs;
-    for (const auto& it : addresses) {
-        if (!GetAddressUnspent(it.first, it.second, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(),
-        [](const CAddressUnspentDbEntry& a, const CAddressUnspentDbEntry& b) -> bool {
-            return a.second.blockHeight < b.second.blockHeight;
-        });
+    syncAddressIndex();
 
-    UniValue utxos(UniValue::VARR);
-    for (const auto& it : unspentOutputs) {
+    auto utxoToJSON = [](const CAddressUnspentDbEntry& it) {
         UniValue output(UniValue::VOBJ);
         std::string address;
         if (!getAddressFromIndex(it.first.type, it.first.hashBytes, address)) {
@@ -792,14 +864,57 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         output.pushKV("script", HexStr(it.second.script.begin(), it.second.script.end()));
         output.pushKV("satoshis", it.second.satoshis);
         output.pushKV("height", it.second.blockHeight);
-        utxos.push_back(output);
+        return output;
+    };
+
+    int limit = 0;
+    std::optional<CAddressUnspentKey> after;
+    bool fPaged = getPageFromParams(params, limit, after);
+
+    UniValue utxos(UniValue::VARR);
+    std::optional<CAddressUnspentKey> next;
+    if (fPaged) {
+        // Outputs are streamed in index order, so memory use is bounded by
+        // the limit however many outputs the addresses have.
+        if (after && std::find(addresses.begin(), addresses.end(),
+                std::make_pair(after->hashBytes, (int)after->type)) == addresses.end()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        CAddressUnspentCursor cursor(*g_addressindex, addresses, after ? &*after : nullptr);
+        for (; cursor.Valid() && utxos.size() < (size_t)limit; cursor.Next()) {
+            utxos.push_back(utxoToJSON(cursor.GetEntry()));
+            next = cursor.GetEntry().first;
+        }
+        if (!cursor.Valid()) {
+            next = std::nullopt;
+        }
+    } else {
+        std::vector<CAddressUnspentDbEntry> unspentOutputs;
+        for (const auto& it : addresses) {
+            if (!GetAddressUnspent(it.first, it.second, unspentOutputs)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(),
+            [](const CAddressUnspentDbEntry& a, const CAddressUnspentDbEntry& b) -> bool {
+                return a.second.blockHeight < b.second.blockHeight;
+            });
+
+        for (const auto& it : unspentOutputs) {
+            utxos.push_back(utxoToJSON(it));
+        }
     }
 
-    if (!includeChainInfo)
+    if (!fPaged && !includeChainInfo)
         return utxos;
 
     UniValue result(UniValue::VOBJ);
     result.pushKV("utxos", utxos);
+    if (next) {
+        result.pushKV("cursor", encodeCursor(*next));
+    }
+    if (!includeChainInfo)
+        return result;
 
     LOCK(cs_main);  // for chainActive
     result.pushKV("hash", chainActive.Tip()->GetBlockHash().GetHex());
@@ -809,6 +924,7 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
 
 static void getHeightRange(const UniValue& params, int& start, int& end)
 {
+    syncAddressIndex();
     start = 0;
     end = 0;
     if (params[0].isObject()) {
@@ -885,6 +1001,10 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "  \"start\"       (number, optional) The start block height\n"
             "  \"end\"         (number, optional) The end block height\n"
             "  \"chainInfo\"   (boolean, optional, default=false) Include chain info in results, only applies if start and end specified\n"
+            "  \"limit\"       (number, optional) Return at most this many deltas, in the order of the blocks and\n"
+            "                transactions they come from\n"
+            "  \"cursor\"      (string, optional) Continue after the last delta of a previous call with the same\n"
+            "                addresses, start and end, from its \"cursor\" result\n"
             "}\n"
             "(or)\n"
             "\"address\"       (string) The base58check encoded address\n"
@@ -920,6 +1040,11 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "      \"hash\"          (string)  The end block hash\n"
             "      \"height\"        (numeric) The height of the end block\n"
             "    }\n"
+            "}\n\n"
+            "(or, if limit is given, the above object without \"start\" and \"end\" unless chainInfo applies,\n"
+            "and with):\n\n"
+            "{\n"
+            "  \"cursor\"        (string, optional) Pass this to get the next page; absent on the last page\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"tmYXBYJj1K7vhejSec5osXK2QsGa5MTisUQ\"], \"start\": 1000, \"end\": 2000, \"chainInfo\": true}'")
@@ -930,10 +1055,6 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
     int end = 0;
     getHeightRange(params, start, end);
 
-    std::vector<std::pair<uint160, int>> addresses;
-    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
-    getAddressesInHeightRange(params, start, end, addresses, addressIndex);
-
     bool includeChainInfo = false;
     if (params[0].isObject()) {
         UniValue chainInfo = find_value(params[0].get_obj(), "chainInfo");
@@ -942,8 +1063,7 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         }
     }
 
-    UniValue deltas(UniValue::VARR);
-    for (const auto& it : addressIndex) {
+    auto deltaToJSON = [](const CAddressIndexDbEntry& it) {
         std::string address;
         if (!getAddressFromIndex(it.first.type, it.first.hashBytes, address)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
@@ -956,15 +1076,52 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         delta.pushKV("index", (int)it.first.index);
         delta.pushKV("satoshis", it.second);
         delta.pushKV("txid", it.first.txhash.GetHex());
-        deltas.push_back(delta);
-    }
+        return delta;
+    };
 
-    UniValue result(UniValue::VOBJ);
+    int limit = 0;
+    std::optional<CAddressIndexKey> after;
+    bool fPaged = getPageFromParams(params, limit, after);
+
+    UniValue deltas(UniValue::VARR);
+    std::optional<CAddressIndexKey> next;
+    if (fPaged) {
+        std::vector<std::pair<uint160, int>> addresses;
+        if (!getAddressesFromParams(params, addresses)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+        }
+        CAddressIndexCursor cursor(*g_addressindex, addresses, start, end, after ? &*after : nullptr);
+        for (; cursor.Valid() && deltas.size() < (size_t)limit; cursor.Next()) {
+            deltas.push_back(deltaToJSON(cursor.GetEntry()));
+            next = cursor.GetEntry().first;
+        }
+        if (!cursor.Valid()) {
+            next = std::nullopt;
+        }
+    } else {
+        std::vector<std::pair<uint160, int>> addresses;
+        std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+        getAddressesInHeightRange(params, start, end, addresses, addressIndex);
 
-    if (!(includeChainInfo && start > 0 && end > 0)) {
+        for (const auto& it : addressIndex) {
+            deltas.push_back(deltaToJSON(it));
+        }
+    }
+
+    includeChainInfo = includeChainInfo && start > 0 && end > 0;
+    if (!fPaged && !includeChainInfo) {
         return deltas;
     }
 
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("deltas", deltas);
+    if (next) {
+        result.pushKV("cursor", encodeCursor(*next));
+    }
+    if (!includeChainInfo) {
+        return result;
+    }
+
     UniValue startInfo(UniValue::VOBJ);
     UniValue endInfo(UniValue::VOBJ);
     {
@@ -978,7 +1135,6 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
     startInfo.pushKV("height", start);
     endInfo.pushKV("height", end);
 
-    result.pushKV("deltas", deltas);
     result.pushKV("start", startInfo);
     result.pushKV("end", endInfo);
 
@@ -1008,6 +1164,7 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
             "{\n"
             "  \"balance\"  (string) The current balance in " + MINOR_CURRENCY_UNIT + "\n"
             "  \"received\"  (string) The total number of " + MINOR_CURRENCY_UNIT + " received (including change)\n"
+            "  \"txcount\"  (number) The number of transactions involving each address, summed over the addresses\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"tmYXBYJj1K7vhejSec5osXK2QsGa5MTisUQ\"]}'")
@@ -1015,22 +1172,28 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
         );
 
     std::vector<std::pair<uint160, int>> addresses;
-    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
-    // this method doesn't take start and end block height params, so set
-    // to zero (full range, entire blockchain)
-    getAddressesInHeightRange(params, 0, 0, addresses, addressIndex);
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+    syncAddressIndex();
 
     CAmount balance = 0;
     CAmount received = 0;
-    for (const auto& it : addressIndex) {
-        if (it.second > 0) {
-            received += it.second;
+    int64_t txCount = 0;
+    for (const auto& it : addresses) {
+        CAddressBalanceValue value;
+        if (!GetAddressBalance(it.first, it.second, value)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY,
+                "No information available for address");
         }
-        balance += it.second;
+        balance += value.balance;
+        received += value.received;
+        txCount += value.txCount;
     }
     UniValue result(UniValue::VOBJ);
     result.pushKV("balance", balance);
     result.pushKV("received", received);
+    result.pushKV("txcount", txCount);
     return result;
 }
 
@@ -1059,6 +1222,9 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number, optional) The start block height\n"
             "  \"end\" (number, optional) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many txids\n"
+            "  \"cursor\" (string, optional) Continue after the last txid of a previous call with the same\n"
+            "           addresses, start and end, from its \"cursor\" result\n"
             "}\n"
             "(or)\n"
             "\"address\"  (string) The base58check encoded address\n"
@@ -1066,7 +1232,16 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
-            "]\n"
+            "]\n\n"
+            "(or, if limit is given):\n\n"
+            "{\n"
+            "  \"txids\":\n"
+            "    [\n"
+            "      \"transactionid\"  (string) The transaction id\n"
+            "      ,...\n"
+            "    ],\n"
+            "  \"cursor\"  (string, optional) Pass this to get the next page; absent on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"tmYXBYJj1K7vhejSec5osXK2QsGa5MTisUQ\"], \"start\": 1000, \"end\": 2000}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"tmYXBYJj1K7vhejSec5osXK2QsGa5MTisUQ\"], \"start\": 1000, \"end\": 2000}")
@@ -1076,26 +1251,45 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
     int end = 0;
     getHeightRange(params, start, end);
 
-    std::vector<std::pair<uint160, int>> addresses;
-    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
-    getAddressesInHeightRange(params, start, end, addresses, addressIndex);
+    int limit = 0;
+    std::optional<CAddressIndexKey> after;
+    bool fPaged = getPageFromParams(params, limit, after);
 
-    // This is an ordered set, sorted by (height,txindex) so result also sorted by height.
-    std::set<std::tuple<int, int, std::string>> txids;
+    std::vector<std::pair<uint160, int>> addresses;
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+    if (!fAddressIndex || !g_addressindex) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY,
+            "No information available for address");
+    }
 
-    for (const auto& it : addressIndex) {
-        const int height = it.first.blockHeight;
-        const int txindex = it.first.txindex;
-        const std::string txid = it.first.txhash.GetHex();
+    // The cursor merges the entries of all the addresses in (height,txindex)
+    // order, and the entries of one transaction come out together.
+    CAddressIndexCursor cursor(*g_addressindex, addresses, start, end, after ? &*after : nullptr);
+    UniValue txids(UniValue::VARR);
+    std::optional<CAddressIndexKey> last;
+    for (; cursor.Valid(); cursor.Next()) {
+        const CAddressIndexKey& key = cursor.GetEntry().first;
         // Duplicate entries (two addresses in same tx) are suppressed
-        txids.insert(std::make_tuple(height, txindex, txid));
+        if (!last || key.txhash != last->txhash) {
+            if (fPaged && txids.size() == (size_t)limit) {
+                break;
+            }
+            txids.push_back(key.txhash.GetHex());
+        }
+        last = key;
     }
-    UniValue result(UniValue::VARR);
-    for (const auto& it : txids) {
-        // only push the txid, not the height
-        result.push_back(std::get<2>(it));
+
+    if (!fPaged) {
+        return txids;
     }
 
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("txids", txids);
+    if (cursor.Valid() && last) {
+        result.pushKV("cursor", encodeCursor(*last));
+    }
     return result;
 }
 
@@ -1137,6 +1331,10 @@ UniValue getspentinfo(const UniValue& params, bool fHelp)
     CSpentIndexKey key(txid, outputIndex);
     CSpentIndexValue value;
 
+    if (g_spentindex && !g_spentindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf(
+            "The spent index is still syncing. Current height: %d", g_spentindex->GetBestHeight()));
+    }
     {
         LOCK(cs_main);
         if (!GetSpentIndex(key, value)) {
@@ -1194,8 +1392,8 @@ UniValue getmemoryinfo(const UniValue& params, bool fHelp)
 }
 
 static const CRPCCommand commands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode  streamReply
+  //  --------------------- ------------------------  -----------------------  ----------  -----------
     { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
     { "control",            "getmemoryinfo",          &getmemoryinfo,          true  },
     { "util",               "validateaddress",        &validateaddress,        true  }, /* uses wallet if enabled */
@@ -1208,7 +1406,7 @@ static const CRPCCommand commands[] =
     /* Address index */
     { "addressindex",       "getaddresstxids",        &getaddresstxids,        false }, /* insight explorer */
     { "addressindex",       "getaddressbalance",      &getaddressbalance,      false }, /* insight explorer */
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false }, /* insight explorer */
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false,      true }, /* insight explorer */
     { "addressindex",       "getaddressutxos",        &getaddressutxos,        false }, /* insight explorer */
     { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  }, /* insight explorer */
     { "blockchain",         "getspentinfo",           &getspentinfo,           false }, /* insight explorer */
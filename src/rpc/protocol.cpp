@@ -54,6 +54,65 @@ string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValu
     return reply.write() + "\n";
 }
 
+/**
+ * Append the compact serialization of value to buf, handing buf to flush and
+ * clearing it whenever it reaches nChunkSize bytes. The output is identical to
+ * value.write(), but objects and arrays are written element by element rather
+ * than each being built as a separate string.
+ */
+static void JSONWriteStream(const UniValue& value, std::string& buf, size_t nChunkSize,
+                            const std::function<void(const std::string&)>& flush)
+{
+    switch (value.getType()) {
+    case UniValue::VOBJ: {
+        const std::vector<std::string>& keys = value.getKeys();
+        const std::vector<UniValue>& values = value.getValues();
+        buf += '{';
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (i > 0)
+                buf += ',';
+            buf += UniValue(keys[i]).write();
+            buf += ':';
+            JSONWriteStream(values[i], buf, nChunkSize, flush);
+        }
+        buf += '}';
+        break;
+    }
+    case UniValue::VARR: {
+        const std::vector<UniValue>& values = value.getValues();
+        buf += '[';
+        for (size_t i = 0; i < values.size(); i++) {
+            if (i > 0)
+                buf += ',';
+            JSONWriteStream(values[i], buf, nChunkSize, flush);
+        }
+        buf += ']';
+        break;
+    }
+    default:
+        buf += value.write();
+        break;
+    }
+
+    if (buf.size() >= nChunkSize) {
+        flush(buf);
+        buf.clear();
+    }
+}
+
+void JSONRPCReplyStream(const UniValue& result, const UniValue& id, size_t nChunkSize,
+                        const std::function<void(const std::string&)>& flush)
+{
+    std::string buf;
+    buf.reserve(2 * nChunkSize);
+    buf += "{\"result\":";
+    JSONWriteStream(result, buf, nChunkSize, flush);
+    buf += ",\"error\":null,\"id\":";
+    buf += id.write();
+    buf += "}\n";
+    flush(buf);
+}
+
 UniValue JSONRPCError(int code, const string& message)
 {
     UniValue error(UniValue::VOBJ);
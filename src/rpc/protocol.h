@@ -9,6 +9,7 @@
 
 #include "fs.h"
 
+#include <functional>
 #include <list>
 #include <map>
 #include <stdint.h>
@@ -82,6 +83,17 @@ enum RPCErrorCode
 std::string JSONRPCRequest(const std::string& strMethod, const UniValue& params, const UniValue& id);
 UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const UniValue& id);
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
+
+/** Size of the pieces in which streamed JSON-RPC replies are written */
+static const size_t JSONRPC_STREAM_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * Write the successful reply that JSONRPCReply(result, NullUniValue, id)
+ * would return, without building it in memory. The serialized reply is
+ * passed to flush in pieces of roughly nChunkSize bytes.
+ */
+void JSONRPCReplyStream(const UniValue& result, const UniValue& id, size_t nChunkSize,
+                        const std::function<void(const std::string&)>& flush);
 UniValue JSONRPCError(int code, const std::string& message);
 
 /** Generate a new RPC authentication cookie and write it to disk */
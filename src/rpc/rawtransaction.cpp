@@ -8,6 +8,8 @@
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "index/insightspentindex.h"
+#include "index/txindex.h"
 #include "init.h"
 #include "key_io.h"
 #include "keystore.h"
@@ -521,16 +523,27 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
             + HelpExampleCli("getrawtransaction", "\"mytxid\" 1 \"myblockhash\"")
         );
 
+    bool fTxIndexReady = false;
+    if (g_txindex) {
+        fTxIndexReady = g_txindex->BlockUntilSyncedToCurrentChain();
+    }
+
+    bool fVerbose = false;
+    if (params.size() > 1)
+        fVerbose = (params[1].get_int() != 0);
+
+    // Only the verbose result includes spent information.
+    if (fVerbose && g_spentindex && !g_spentindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf(
+            "The spent index is still syncing. Current height: %d", g_spentindex->GetBestHeight()));
+    }
+
     LOCK(cs_main);
 
     bool in_active_chain = true;
     uint256 hash = ParseHashV(params[0], "parameter 1");
     CBlockIndex* blockindex = nullptr;
 
-    bool fVerbose = false;
-    if (params.size() > 1)
-        fVerbose = (params[1].get_int() != 0);
-
     if (params.size() > 2) {
         uint256 blockhash = ParseHashV(params[2], "parameter 3");
         if (!blockhash.IsNull()) {
@@ -553,9 +566,13 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
             }
             errmsg = "No such transaction found in the provided block";
         } else {
-            errmsg = fTxIndex
-              ? "No such mempool or blockchain transaction"
-              : "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
+            if (!g_txindex) {
+                errmsg = "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
+            } else if (!fTxIndexReady) {
+                errmsg = "No such mempool transaction. Blockchain transactions are still in the process of being indexed";
+            } else {
+                errmsg = "No such mempool or blockchain transaction";
+            }
         }
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, errmsg + ". Use gettransaction for wallet transactions.");
     }
@@ -640,8 +657,8 @@ UniValue gettxoutproof(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
     unsigned int ntxFound = 0;
-    for (const CTransaction&tx : block.vtx)
-        if (setTxids.count(tx.GetHash()))
+    for (const CTransactionRef& tx : block.vtx)
+        if (setTxids.count(tx->GetHash()))
             ntxFound++;
     if (ntxFound != setTxids.size())
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "(Not all) transactions not found in specified block");
@@ -17,7 +17,12 @@
 #include "util/strencodings.h"
 #include "asyncrpcqueue.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include <univalue.h>
 
@@ -45,6 +50,37 @@ static std::vector<RPCTimerInterface*> timerInterfaces;
  * @note Can be changed to std::unique_ptr when C++11 */
 static std::map<std::string, boost::shared_ptr<RPCTimerBase> > deadlineTimers;
 
+/**
+ * Threads that execute elements of JSON-RPC batches on behalf of the HTTP
+ * worker that received the batch. They are shared by all batches; the number
+ * of them used by any one batch is limited by -rpcbatchconcurrency.
+ */
+static struct CRPCBatchExecutor
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    std::deque<std::function<void()>> queue;
+    std::vector<std::thread> threads;
+    bool running = false;
+    int nConcurrency = DEFAULT_RPC_BATCH_CONCURRENCY;
+
+    void Run()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                cond.wait(lock, [this] { return !running || !queue.empty(); });
+                if (!running)
+                    break;
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            task();
+        }
+    }
+} g_rpcBatchExecutor;
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -343,20 +379,34 @@ bool StartRPC()
     fRPCRunning = true;
     g_rpcSignals.Started();
 
-    // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
-    getAsyncRPCQueue()->addWorker();
-/*
-    int n = GetArg("-rpcasyncthreads", 1);
-    if (n<1) {
+    // Launch the async rpc workers. Operations select and lock their inputs
+    // under cs_wallet before proving, so multiple workers can safely run
+    // concurrently and share the Sapling prover thread pool. The option
+    // values are checked by AppInit2.
+    int n = GetArg("-rpcasyncthreads", DEFAULT_RPC_ASYNC_THREADS);
+    if (n < 1) {
         LogPrintf("ERROR: Invalid value %d for -rpcasyncthreads.  Must be at least 1.\n", n);
-        strerr = strprintf(_("An error occurred while setting up the Async RPC threads, invalid parameter value of %d (must be at least 1)."), n);
-        uiInterface.ThreadSafeMessageBox(strerr, "", CClientUIInterface::MSG_ERROR);
-        StartShutdown();
-        return;
+        return false;
     }
     for (int i = 0; i < n; i++)
         getAsyncRPCQueue()->addWorker();
-*/
+
+    // Launch the threads that execute batch elements concurrently.
+    int nBatchThreads = GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS);
+    int nBatchConcurrency = GetArg("-rpcbatchconcurrency", DEFAULT_RPC_BATCH_CONCURRENCY);
+    if (nBatchThreads < 0 || nBatchConcurrency < 1) {
+        LogPrintf("ERROR: Invalid value for -rpcbatchthreads or -rpcbatchconcurrency.\n");
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_rpcBatchExecutor.cs);
+        g_rpcBatchExecutor.running = true;
+        g_rpcBatchExecutor.nConcurrency = nBatchConcurrency;
+    }
+    for (int i = 0; i < nBatchThreads; i++) {
+        g_rpcBatchExecutor.threads.emplace_back(&TraceThread<std::function<void()>>, "rpcbatch",
+            std::function<void()>(std::bind(&CRPCBatchExecutor::Run, &g_rpcBatchExecutor)));
+    }
     return true;
 }
 
@@ -365,6 +415,11 @@ void InterruptRPC()
     LogPrint("rpc", "Interrupting RPC\n");
     // Interrupt e.g. running longpolls
     fRPCRunning = false;
+    {
+        std::lock_guard<std::mutex> lock(g_rpcBatchExecutor.cs);
+        g_rpcBatchExecutor.running = false;
+    }
+    g_rpcBatchExecutor.cond.notify_all();
 }
 
 void StopRPC()
@@ -376,6 +431,12 @@ void StopRPC()
     // Tells async queue to cancel all operations and shutdown.
     LogPrintf("%s: waiting for async rpc workers to stop\n", __func__);
     getAsyncRPCQueue()->closeAndWait();
+
+    for (auto& thread : g_rpcBatchExecutor.threads) {
+        thread.join();
+    }
+    g_rpcBatchExecutor.threads.clear();
+    g_rpcBatchExecutor.queue.clear();
 }
 
 bool IsRPCRunning()
@@ -457,11 +518,69 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
+/** Progress of one JSON-RPC batch that is being executed by several threads. */
+struct CRPCBatch
+{
+    std::vector<UniValue> vReq;
+    std::vector<UniValue> vResult;
+    std::atomic<size_t> nNext{0};
+    std::mutex cs;
+    std::condition_variable cond;
+    size_t nDone = 0;
+
+    CRPCBatch(const std::vector<UniValue>& vReqIn) : vReq(vReqIn), vResult(vReqIn.size()) {}
+
+    /** Execute elements of the batch until none are left to claim. */
+    void Work()
+    {
+        size_t reqIdx;
+        while ((reqIdx = nNext++) < vReq.size()) {
+            vResult[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+            std::lock_guard<std::mutex> lock(cs);
+            if (++nDone == vReq.size())
+                cond.notify_all();
+        }
+    }
+};
+
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
     UniValue ret(UniValue::VARR);
-    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+
+    size_t nHelpers = 0;
+    if (vReq.size() > 1) {
+        std::lock_guard<std::mutex> lock(g_rpcBatchExecutor.cs);
+        if (g_rpcBatchExecutor.running) {
+            nHelpers = std::min<size_t>(g_rpcBatchExecutor.nConcurrency - 1, vReq.size() - 1);
+            nHelpers = std::min(nHelpers, g_rpcBatchExecutor.threads.size());
+        }
+    }
+    if (nHelpers == 0) {
+        for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
+            ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+
+        return ret.write() + "\n";
+    }
+
+    // Hand the batch to up to nHelpers executor threads, and work on it here
+    // as well so that it completes even if every executor thread is busy.
+    // Results are stored by index, so the reply preserves request order.
+    auto batch = std::make_shared<CRPCBatch>(vReq.getValues());
+    {
+        std::lock_guard<std::mutex> lock(g_rpcBatchExecutor.cs);
+        for (size_t i = 0; i < nHelpers; i++)
+            g_rpcBatchExecutor.queue.emplace_back([batch]() { batch->Work(); });
+    }
+    g_rpcBatchExecutor.cond.notify_all();
+
+    batch->Work();
+    {
+        std::unique_lock<std::mutex> lock(batch->cs);
+        batch->cond.wait(lock, [&batch] { return batch->nDone == batch->vReq.size(); });
+    }
+
+    for (UniValue& result : batch->vResult)
+        ret.push_back(std::move(result));
 
     return ret.write() + "\n";
 }
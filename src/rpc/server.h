@@ -23,6 +23,13 @@
 class AsyncRPCQueue;
 class CRPCCommand;
 
+/** Default number of async RPC worker threads (-rpcasyncthreads) */
+static const int DEFAULT_RPC_ASYNC_THREADS = 1;
+/** Default number of threads shared by all JSON-RPC batches (-rpcbatchthreads) */
+static const int DEFAULT_RPC_BATCH_THREADS = 4;
+/** Default maximum number of elements of one batch executed at once (-rpcbatchconcurrency) */
+static const int DEFAULT_RPC_BATCH_CONCURRENCY = 4;
+
 namespace RPCServer
 {
     void OnStarted(std::function<void ()> slot);
@@ -126,6 +133,8 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    //! Send the (potentially very large) result as a streamed HTTP reply
+    bool streamReply = false;
 };
 
 /**
@@ -30,7 +30,7 @@ use crate::{
     },
     streams::{
         from_auto_file, from_blake2b_writer, from_buffered_file, from_data, from_hash_writer,
-        from_size_computer, CppStream,
+        from_public_data, from_size_computer, CppStream,
     },
     test_harness_ffi::{
         test_only_invalid_sapling_bundle, test_only_replace_sapling_nullifier,
@@ -48,6 +48,7 @@ pub(crate) mod ffi {
 
         #[cxx_name = "RustDataStream"]
         type RustStream = crate::streams::ffi::RustStream;
+        type CPublicDataStream = crate::streams::ffi::CPublicDataStream;
         type CAutoFile = crate::streams::ffi::CAutoFile;
         type CBufferedFile = crate::streams::ffi::CBufferedFile;
         type CHashWriter = crate::streams::ffi::CHashWriter;
@@ -59,6 +60,7 @@ pub(crate) mod ffi {
         type CppStream<'a>;
 
         fn from_data(stream: Pin<&mut RustStream>) -> Box<CppStream<'_>>;
+        fn from_public_data(stream: Pin<&mut CPublicDataStream>) -> Box<CppStream<'_>>;
         fn from_auto_file(file: Pin<&mut CAutoFile>) -> Box<CppStream<'_>>;
         fn from_buffered_file(file: Pin<&mut CBufferedFile>) -> Box<CppStream<'_>>;
         fn from_hash_writer(writer: Pin<&mut CHashWriter>) -> Box<CppStream<'_>>;
@@ -16,6 +16,7 @@ mod ffi {
     #[namespace = "init"]
     extern "Rust" {
         fn rayon_threadpool();
+        fn sapling_prover_threadpool(num_threads: usize);
         fn zksnark_params(sprout_path: String, load_proving_keys: bool);
     }
 }
@@ -29,6 +30,10 @@ fn rayon_threadpool() {
         .expect("Only initialized once");
 }
 
+fn sapling_prover_threadpool(num_threads: usize) {
+    crate::sapling::init_prover_pool(num_threads);
+}
+
 /// Loads the zk-SNARK parameters into memory and saves paths as necessary.
 /// Only called once.
 ///
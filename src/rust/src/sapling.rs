@@ -5,12 +5,16 @@
 use std::convert::{TryFrom, TryInto};
 use std::io;
 use std::mem;
+use std::sync::{Mutex, OnceLock};
+use std::time::Instant;
 
 use bellman::groth16::Proof;
 use bls12_381::Bls12;
 use group::GroupEncoding;
 use memuse::DynamicUsage;
+use rand::{rngs::StdRng, SeedableRng};
 use rand_core::{OsRng, RngCore};
+use rayon::prelude::*;
 use sapling::keys::EphemeralSecretKey;
 use sapling::{
     builder::BundleType,
@@ -370,6 +374,185 @@ impl OutputProver for StaticTxProver {
     }
 }
 
+/// The thread pool on which the proofs for a Sapling bundle are created. If it has
+/// not been configured, proofs are created on the global Rayon thread pool.
+static PROVER_POOL: OnceLock<rayon::ThreadPool> = OnceLock::new();
+
+/// Configures the Sapling prover thread pool. `num_threads == 0` uses one thread per
+/// logical CPU.
+pub(crate) fn init_prover_pool(num_threads: usize) {
+    let pool = rayon::ThreadPoolBuilder::new()
+        .num_threads(num_threads)
+        .thread_name(|i| format!("zc-sapling-prover-{}", i))
+        .build()
+        .expect("Failed to build the Sapling prover thread pool");
+    PROVER_POOL.set(pool).expect("Only initialized once");
+}
+
+const METRIC_PROOFS_QUEUED: &str = "zcashd.sapling.prover.queue.proofs";
+const METRIC_PROOF_SECONDS: &str = "zcashd.sapling.prover.proof.seconds";
+const METRIC_BUNDLE_SECONDS: &str = "zcashd.sapling.prover.bundle.seconds";
+const METRIC_LABEL_KIND: &str = "kind";
+
+/// Runs `prove`, recording its latency and removing it from the prover queue depth.
+fn timed_proof<T>(kind: &'static str, prove: impl FnOnce() -> T) -> T {
+    let start = Instant::now();
+    let proof = prove();
+    metrics::histogram!(
+        METRIC_PROOF_SECONDS,
+        start.elapsed().as_secs_f64(),
+        METRIC_LABEL_KIND => kind,
+    );
+    metrics::decrement_gauge!(METRIC_PROOFS_QUEUED, 1.0);
+    proof
+}
+
+/// A prover that creates every spend and output proof of a bundle up front, in
+/// parallel on the prover thread pool, and then hands them out in the order in which
+/// `Bundle::create_proofs` asks for them.
+///
+/// Each proof gets its own RNG, seeded in order from the caller's RNG, so the proven
+/// bundle depends only on that randomness and not on how the proofs were scheduled.
+struct ParallelProver {
+    spend_proofs: Mutex<std::vec::IntoIter<Proof<Bls12>>>,
+    output_proofs: Mutex<std::vec::IntoIter<Proof<Bls12>>>,
+}
+
+impl ParallelProver {
+    fn new<R: RngCore>(
+        bundle: &sapling::builder::UnauthorizedBundle<ZatBalance>,
+        rng: &mut R,
+    ) -> Self {
+        let mut next_seed = || {
+            let mut seed = [0; 32];
+            rng.fill_bytes(&mut seed);
+            seed
+        };
+        let spends: Vec<_> = bundle
+            .shielded_spends()
+            .iter()
+            .map(|spend| (spend.zkproof().clone(), next_seed()))
+            .collect();
+        let outputs: Vec<_> = bundle
+            .shielded_outputs()
+            .iter()
+            .map(|output| (output.zkproof().clone(), next_seed()))
+            .collect();
+
+        // Proofs from concurrent builders (e.g. multiple async RPC workers) all
+        // queue on the shared prover pool, so track the outstanding total.
+        metrics::increment_gauge!(METRIC_PROOFS_QUEUED, (spends.len() + outputs.len()) as f64);
+        let start = Instant::now();
+
+        let prove = move || {
+            rayon::join(
+                || {
+                    spends
+                        .into_par_iter()
+                        .map(|(circuit, seed)| {
+                            timed_proof("spend", || {
+                                <StaticTxProver as SpendProver>::create_proof(
+                                    &StaticTxProver,
+                                    circuit,
+                                    &mut StdRng::from_seed(seed),
+                                )
+                            })
+                        })
+                        .collect::<Vec<_>>()
+                },
+                || {
+                    outputs
+                        .into_par_iter()
+                        .map(|(circuit, seed)| {
+                            timed_proof("output", || {
+                                <StaticTxProver as OutputProver>::create_proof(
+                                    &StaticTxProver,
+                                    circuit,
+                                    &mut StdRng::from_seed(seed),
+                                )
+                            })
+                        })
+                        .collect::<Vec<_>>()
+                },
+            )
+        };
+        let (spend_proofs, output_proofs) = match PROVER_POOL.get() {
+            Some(pool) => pool.install(prove),
+            None => prove(),
+        };
+        metrics::histogram!(METRIC_BUNDLE_SECONDS, start.elapsed().as_secs_f64());
+
+        ParallelProver {
+            spend_proofs: Mutex::new(spend_proofs.into_iter()),
+            output_proofs: Mutex::new(output_proofs.into_iter()),
+        }
+    }
+}
+
+impl SpendProver for ParallelProver {
+    type Proof = Proof<Bls12>;
+
+    fn prepare_circuit(
+        proof_generation_key: ProofGenerationKey,
+        diversifier: Diversifier,
+        rseed: Rseed,
+        value: NoteValue,
+        alpha: jubjub::Fr,
+        rcv: ValueCommitTrapdoor,
+        anchor: bls12_381::Scalar,
+        merkle_path: MerklePath,
+    ) -> Option<circuit::Spend> {
+        <StaticTxProver as SpendProver>::prepare_circuit(
+            proof_generation_key,
+            diversifier,
+            rseed,
+            value,
+            alpha,
+            rcv,
+            anchor,
+            merkle_path,
+        )
+    }
+
+    fn create_proof<R: RngCore>(&self, _: circuit::Spend, _: &mut R) -> Self::Proof {
+        self.spend_proofs
+            .lock()
+            .unwrap()
+            .next()
+            .expect("A proof was created for every spend")
+    }
+
+    fn encode_proof(proof: Self::Proof) -> sapling::bundle::GrothProofBytes {
+        SpendParameters::encode_proof(proof)
+    }
+}
+
+impl OutputProver for ParallelProver {
+    type Proof = Proof<Bls12>;
+
+    fn prepare_circuit(
+        esk: &EphemeralSecretKey,
+        payment_address: PaymentAddress,
+        rcm: jubjub::Fr,
+        value: NoteValue,
+        rcv: ValueCommitTrapdoor,
+    ) -> circuit::Output {
+        <StaticTxProver as OutputProver>::prepare_circuit(esk, payment_address, rcm, value, rcv)
+    }
+
+    fn create_proof<R: RngCore>(&self, _: circuit::Output, _: &mut R) -> Self::Proof {
+        self.output_proofs
+            .lock()
+            .unwrap()
+            .next()
+            .expect("A proof was created for every output")
+    }
+
+    fn encode_proof(proof: Self::Proof) -> sapling::bundle::GrothProofBytes {
+        OutputParameters::encode_proof(proof)
+    }
+}
+
 pub(crate) struct SaplingBuilder {
     builder: sapling::builder::Builder,
     extsks: Vec<ExtendedSpendingKey>,
@@ -461,12 +644,14 @@ impl SaplingBuilder {
 
     fn build(self) -> Result<SaplingUnauthorizedBundle, String> {
         let Self { builder, extsks } = self;
-        let prover = crate::sapling::StaticTxProver;
-        let rng = OsRng;
+        let mut rng = OsRng;
         let bundle = builder
             .build::<StaticTxProver, StaticTxProver, _, ZatBalance>(&extsks, rng)
             .map_err(|e| format!("Failed to build Sapling bundle: {}", e))?
-            .map(|(bundle, _)| bundle.create_proofs(&prover, &prover, rng, ()));
+            .map(|(bundle, _)| {
+                let prover = ParallelProver::new(&bundle, &mut rng);
+                bundle.create_proofs(&prover, &prover, rng, ())
+            });
         Ok(SaplingUnauthorizedBundle {
             bundle,
             signing_keys: extsks.into_iter().map(|extsk| extsk.expsk.ask).collect(),
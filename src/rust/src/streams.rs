@@ -12,6 +12,18 @@ pub(crate) mod ffi {
         unsafe fn read_u8(self: Pin<&mut RustStream>, pch: *mut u8, nSize: usize) -> Result<()>;
         unsafe fn write_u8(self: Pin<&mut RustStream>, pch: *const u8, nSize: usize) -> Result<()>;
 
+        type CPublicDataStream;
+        unsafe fn read_u8(
+            self: Pin<&mut CPublicDataStream>,
+            pch: *mut u8,
+            nSize: usize,
+        ) -> Result<()>;
+        unsafe fn write_u8(
+            self: Pin<&mut CPublicDataStream>,
+            pch: *const u8,
+            nSize: usize,
+        ) -> Result<()>;
+
         type CAutoFile;
         unsafe fn read_u8(self: Pin<&mut CAutoFile>, pch: *mut u8, nSize: usize) -> Result<()>;
         unsafe fn write_u8(self: Pin<&mut CAutoFile>, pch: *const u8, nSize: usize) -> Result<()>;
@@ -39,6 +51,7 @@ pub(crate) mod ffi {
     }
 
     impl UniquePtr<RustStream> {}
+    impl UniquePtr<CPublicDataStream> {}
     impl UniquePtr<CAutoFile> {}
     impl UniquePtr<CBufferedFile> {}
     impl UniquePtr<CHashWriter> {}
@@ -50,6 +63,10 @@ pub(crate) fn from_data(stream: Pin<&mut ffi::RustStream>) -> Box<CppStream<'_>>
     Box::new(CppStream::Data(stream))
 }
 
+pub(crate) fn from_public_data(stream: Pin<&mut ffi::CPublicDataStream>) -> Box<CppStream<'_>> {
+    Box::new(CppStream::PublicData(stream))
+}
+
 pub(crate) fn from_auto_file(file: Pin<&mut ffi::CAutoFile>) -> Box<CppStream<'_>> {
     Box::new(CppStream::AutoFile(file))
 }
@@ -72,6 +89,7 @@ pub(crate) fn from_size_computer(sc: Pin<&mut ffi::CSizeComputer>) -> Box<CppStr
 
 pub(crate) enum CppStream<'a> {
     Data(Pin<&'a mut ffi::RustStream>),
+    PublicData(Pin<&'a mut ffi::CPublicDataStream>),
     AutoFile(Pin<&'a mut ffi::CAutoFile>),
     BufferedFile(Pin<&'a mut ffi::CBufferedFile>),
     Hash(Pin<&'a mut ffi::CHashWriter>),
@@ -87,6 +105,9 @@ impl<'a> io::Read for CppStream<'a> {
             CppStream::Data(inner) => unsafe { inner.as_mut().read_u8(pch, len) }
                 .map(|()| buf.len())
                 .map_err(|e| io::Error::new(io::ErrorKind::Other, e)),
+            CppStream::PublicData(inner) => unsafe { inner.as_mut().read_u8(pch, len) }
+                .map(|()| buf.len())
+                .map_err(|e| io::Error::new(io::ErrorKind::Other, e)),
             CppStream::AutoFile(inner) => unsafe { inner.as_mut().read_u8(pch, len) }
                 .map(|()| buf.len())
                 .map_err(|e| io::Error::new(io::ErrorKind::Other, e)),
@@ -117,6 +138,9 @@ impl<'a> io::Write for CppStream<'a> {
             CppStream::Data(inner) => unsafe { inner.as_mut().write_u8(pch, len) }
                 .map(|()| buf.len())
                 .map_err(|e| io::Error::new(io::ErrorKind::Other, e)),
+            CppStream::PublicData(inner) => unsafe { inner.as_mut().write_u8(pch, len) }
+                .map(|()| buf.len())
+                .map_err(|e| io::Error::new(io::ErrorKind::Other, e)),
             CppStream::AutoFile(inner) => unsafe { inner.as_mut().write_u8(pch, len) }
                 .map(|()| buf.len())
                 .map_err(|e| io::Error::new(io::ErrorKind::Other, e)),
@@ -13,7 +13,10 @@
 //
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
+#include <functional>
+#include <list>
 #include <map>
+#include <mutex>
 
 //
 // Simple class for background tasks that should be run
@@ -70,6 +73,9 @@ public:
     size_t getQueueInfo(boost::chrono::system_clock::time_point &first,
                         boost::chrono::system_clock::time_point &last) const;
 
+    // Returns true if there are threads actively running in serviceQueue()
+    bool AreThreadsServicingQueue() const;
+
 private:
     std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
     boost::condition_variable newTaskScheduled;
@@ -80,4 +86,40 @@ private:
     bool shouldStop() { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
 };
 
+//
+// Class used by CScheduler clients which may schedule multiple jobs
+// which are required to be run serially. Jobs may not be run on the
+// same thread, but no two jobs will be executed at the same time,
+// they run in the order they were added, and memory is release-acquire
+// consistent between jobs.
+//
+class SingleThreadedSchedulerClient
+{
+public:
+    explicit SingleThreadedSchedulerClient(CScheduler *pschedulerIn) : m_pscheduler(pschedulerIn) {}
+
+    // Add a callback to be executed. Callbacks are executed serially
+    // and memory is release-acquire consistent between callback executions.
+    // Practically, this means that callbacks can behave as if they are executed
+    // in order by a single thread.
+    void AddToProcessQueue(std::function<void(void)> func);
+
+    // Processes all remaining queue members on the calling thread, blocking
+    // until the queue is empty. Must be called only after the CScheduler has
+    // no remaining processing threads!
+    void EmptyQueue();
+
+    size_t CallbacksPending();
+
+private:
+    CScheduler *m_pscheduler;
+
+    std::mutex m_cs_callbacks_pending;
+    std::list<std::function<void(void)>> m_callbacks_pending;
+    bool m_are_callbacks_running = false;
+
+    void MaybeScheduleProcessQueue();
+    void ProcessQueue();
+};
+
 #endif
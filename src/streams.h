@@ -410,6 +410,14 @@ public:
         d.insert(d.end(), begin(), end());
         clear();
     }
+
+    /** Move the unread data into d, replacing its contents, without copying it. */
+    void MoveAndClear(vector_type &d) {
+        vch.erase(vch.begin(), vch.begin() + nReadPos);
+        d.swap(vch);
+        vector_type().swap(vch);
+        nReadPos = 0;
+    }
 };
 
 class CDataStream : public CBaseDataStream<CSerializeData>
@@ -444,6 +452,34 @@ public:
 
 };
 
+/**
+ * The standard allocator under a distinct type, so that a stream's storage can
+ * be told apart from std::vector<char>. Unlike zero_after_free_allocator, it
+ * does not zero memory when freeing it.
+ */
+template <typename T>
+struct public_data_allocator : public std::allocator<T> {
+    public_data_allocator() noexcept {}
+    template <typename U>
+    public_data_allocator(const public_data_allocator<U>& a) noexcept : std::allocator<T>(a) {}
+    template <typename _Other>
+    struct rebind {
+        typedef public_data_allocator<_Other> other;
+    };
+};
+
+/**
+ * Storage for serialized data that is public, such as P2P messages, so it is
+ * not zeroed when freed.
+ */
+typedef std::vector<char, public_data_allocator<char> > CPublicSerializeData;
+
+/**
+ * A data stream for public data, whose buffer is neither zeroed when freed nor
+ * copied when moved out with MoveAndClear.
+ */
+typedef CBaseDataStream<CPublicSerializeData> CPublicDataStream;
+
 /**
  * Concrete instantiation of a data stream, enabling them to be passed into Rust code.
  *
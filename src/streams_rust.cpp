@@ -8,6 +8,10 @@ rust::Box<stream::CppStream> ToRustStream(RustDataStream& stream) {
     return stream::from_data(stream);
 }
 
+rust::Box<stream::CppStream> ToRustStream(CPublicDataStream& stream) {
+    return stream::from_public_data(stream);
+}
+
 rust::Box<stream::CppStream> ToRustStream(CAutoFile& file) {
     return stream::from_auto_file(file);
 }
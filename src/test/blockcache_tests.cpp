@@ -0,0 +1,128 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "blockcache.h"
+#include "streams.h"
+#include "version.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+static CBlockCache::BlockRef MakeBlock(int n)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].scriptSig = CScript() << n << OP_0;
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = n;
+
+    auto block = std::make_shared<CBlock>();
+    block->vtx.push_back(MakeTransactionRef(mtx));
+    block->nNonce = InsecureRand256();
+    return block;
+}
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockcache_lru)
+{
+    std::vector<CBlockCache::BlockRef> blocks;
+    for (int i = 0; i < 4; i++) {
+        blocks.push_back(MakeBlock(i));
+    }
+
+    // Size the cache to hold three of the blocks.
+    CBlockCache measure(1 << 20);
+    measure.Add(blocks[0]);
+    size_t nBlockUsage = measure.DynamicMemoryUsage();
+    BOOST_CHECK(nBlockUsage > 0);
+
+    CBlockCache cache(nBlockUsage * 3 + nBlockUsage / 2);
+    BOOST_CHECK(!cache.Get(blocks[0]->GetHash()));
+    for (int i = 0; i < 3; i++) {
+        cache.Add(blocks[i]);
+    }
+    BOOST_CHECK_EQUAL(cache.Size(), 3);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), nBlockUsage * 3);
+    BOOST_CHECK(cache.Get(blocks[1]->GetHash()) == blocks[1]);
+
+    // Adding a block that is already cached does not change the usage.
+    cache.Add(blocks[2]);
+    BOOST_CHECK_EQUAL(cache.Size(), 3);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), nBlockUsage * 3);
+
+    // Block 0 is now the least recently used, and is evicted first.
+    cache.Add(blocks[3]);
+    BOOST_CHECK_EQUAL(cache.Size(), 3);
+    BOOST_CHECK(!cache.Get(blocks[0]->GetHash()));
+    for (int i = 1; i < 4; i++) {
+        BOOST_CHECK(cache.Get(blocks[i]->GetHash()) == blocks[i]);
+    }
+
+    // Shrinking the cache evicts the least recently used blocks.
+    cache.SetMaxUsage(nBlockUsage);
+    BOOST_CHECK_EQUAL(cache.Size(), 1);
+    BOOST_CHECK(cache.Get(blocks[3]->GetHash()) == blocks[3]);
+
+    // A size of zero disables the cache.
+    cache.SetMaxUsage(0);
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), 0);
+    cache.Add(blocks[0]);
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+    BOOST_CHECK(!cache.RecordMiss(blocks[0]->GetHash()));
+    BOOST_CHECK(!cache.RecordMiss(blocks[0]->GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_raw)
+{
+    CBlockCache::BlockRef block = MakeBlock(1);
+    CBlockCache cache(1 << 20);
+    BOOST_CHECK(!cache.GetRaw(block->GetHash()));
+
+    cache.Add(block);
+    size_t nBlockUsage = cache.DynamicMemoryUsage();
+    CBlockCache::RawBlockRef raw = cache.GetRaw(block->GetHash());
+    BOOST_REQUIRE(raw);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << *block;
+    BOOST_CHECK(*raw == std::vector<uint8_t>(ss.begin(), ss.end()));
+
+    // The serialized block is kept and counted.
+    BOOST_CHECK(cache.DynamicMemoryUsage() > nBlockUsage);
+    BOOST_CHECK(cache.GetRaw(block->GetHash()) == raw);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_admission)
+{
+    CBlockCache cache(1 << 20);
+    std::vector<uint256> hashes;
+    for (size_t i = 0; i < BLOCK_CACHE_RECENT_MISSES + 1; i++) {
+        hashes.push_back(InsecureRand256());
+    }
+
+    // A block is admitted when it is read from disk a second time.
+    BOOST_CHECK(!cache.RecordMiss(hashes[0]));
+    BOOST_CHECK(cache.RecordMiss(hashes[0]));
+    // Admitting it forgets the earlier miss.
+    BOOST_CHECK(!cache.RecordMiss(hashes[0]));
+
+    // Blocks read once each in a scan over more blocks than are remembered
+    // are not admitted when the scan is repeated.
+    CBlockCache scan(1 << 20);
+    for (const uint256& hash : hashes) {
+        BOOST_CHECK(!scan.RecordMiss(hash));
+    }
+    for (const uint256& hash : hashes) {
+        BOOST_CHECK(!scan.RecordMiss(hash));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
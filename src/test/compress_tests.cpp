@@ -4,6 +4,7 @@
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
 #include "compressor.h"
+#include "util/lz4.h"
 #include "util/system.h"
 #include "test/test_bitcoin.h"
 
@@ -63,4 +64,70 @@ BOOST_AUTO_TEST_CASE(compress_amounts)
         BOOST_CHECK(TestDecode(i));
 }
 
+static bool TestLZ4RoundTrip(const std::vector<unsigned char>& data) {
+    std::vector<unsigned char> compressed;
+    CompressLZ4(data.data(), data.size(), compressed);
+    std::vector<unsigned char> out(data.size());
+    return DecompressLZ4(compressed.data(), compressed.size(), out.data(), out.size()) && out == data;
+}
+
+BOOST_AUTO_TEST_CASE(lz4_round_trip)
+{
+    BOOST_CHECK(TestLZ4RoundTrip({}));
+    BOOST_CHECK(TestLZ4RoundTrip({0x42}));
+    BOOST_CHECK(TestLZ4RoundTrip(std::vector<unsigned char>(100000, 0)));
+
+    for (int i = 0; i < 100; i++) {
+        // Random data with repeated runs, as in transactions reusing scripts.
+        std::vector<unsigned char> data;
+        size_t nSize = InsecureRandRange(100000);
+        while (data.size() < nSize) {
+            if (data.size() > 8 && InsecureRandBool()) {
+                size_t nOffset = 1 + InsecureRandRange(std::min<size_t>(data.size(), 70000));
+                size_t nLength = InsecureRandRange(300);
+                for (size_t j = 0; j < nLength; j++)
+                    data.push_back(data[data.size() - nOffset]);
+            } else {
+                size_t nLength = InsecureRandRange(50);
+                for (size_t j = 0; j < nLength; j++)
+                    data.push_back(InsecureRandBits(8));
+            }
+        }
+        BOOST_CHECK(TestLZ4RoundTrip(data));
+    }
+
+    // Repetitive data compresses well.
+    std::vector<unsigned char> data;
+    for (int i = 0; i < 1000; i++)
+        data.insert(data.end(), {0x76, 0xa9, 0x14, (unsigned char)i, 0x88, 0xac});
+    std::vector<unsigned char> compressed;
+    CompressLZ4(data.data(), data.size(), compressed);
+    BOOST_CHECK(compressed.size() < data.size() / 2);
+}
+
+BOOST_AUTO_TEST_CASE(lz4_decompress)
+{
+    // One literal, an overlapping match of 14 bytes at offset 1, and five
+    // final literals, as produced by the reference LZ4 implementation.
+    const std::vector<unsigned char> block = {0x1a, 'a', 0x01, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a'};
+    std::vector<unsigned char> out(20);
+    BOOST_CHECK(DecompressLZ4(block.data(), block.size(), out.data(), out.size()));
+    BOOST_CHECK(out == std::vector<unsigned char>(20, 'a'));
+
+    // The output must be exactly the expected size.
+    BOOST_CHECK(!DecompressLZ4(block.data(), block.size(), out.data(), 19));
+    out.resize(21);
+    BOOST_CHECK(!DecompressLZ4(block.data(), block.size(), out.data(), out.size()));
+    out.resize(20);
+
+    // Truncated blocks, and matches reaching before the start of the output,
+    // are rejected.
+    for (size_t i = 0; i < block.size(); i++)
+        BOOST_CHECK(!DecompressLZ4(block.data(), i, out.data(), out.size()));
+    const std::vector<unsigned char> badOffset = {0x1a, 'a', 0x02, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a'};
+    BOOST_CHECK(!DecompressLZ4(badOffset.data(), badOffset.size(), out.data(), out.size()));
+    const std::vector<unsigned char> zeroOffset = {0x1a, 'a', 0x00, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a'};
+    BOOST_CHECK(!DecompressLZ4(zeroOffset.data(), zeroOffset.size(), out.data(), out.size()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
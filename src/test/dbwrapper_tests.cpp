@@ -11,6 +11,8 @@
 #include <boost/assign/std/vector.hpp> // for 'operator+=()'
 #include <boost/assert.hpp>
 #include <boost/test/unit_test.hpp>
+
+#include <thread>
                     
 using namespace std;
 using namespace boost::assign; // bring 'operator+=()' into scope
@@ -43,6 +45,35 @@ BOOST_AUTO_TEST_CASE(dbwrapper)
     }
 }
 
+// Test that a snapshot is not changed by later writes
+BOOST_AUTO_TEST_CASE(dbwrapper_snapshot)
+{
+    path ph = temp_directory_path() / unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false);
+    char key = 'k';
+    char key2 = 'l';
+    uint256 in = InsecureRand256();
+    uint256 in2 = InsecureRand256();
+    uint256 res;
+    BOOST_CHECK(dbw.Write(key, in));
+
+    CDBWrapper snapshot(dbw, CDBWrapper::SnapshotTag());
+    BOOST_CHECK(dbw.Write(key, in2));
+    BOOST_CHECK(dbw.Write(key2, in2));
+
+    BOOST_CHECK(snapshot.Read(key, res));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+    BOOST_CHECK(!snapshot.Exists(key2));
+    boost::scoped_ptr<CDBIterator> it(snapshot.NewIterator());
+    it->SeekToFirst();
+    BOOST_CHECK(it->Valid());
+    it->Next();
+    BOOST_CHECK(!it->Valid());
+
+    BOOST_CHECK(dbw.Read(key, res));
+    BOOST_CHECK_EQUAL(res.ToString(), in2.ToString());
+}
+
 // Test batch operations
 BOOST_AUTO_TEST_CASE(dbwrapper_batch)
 {
@@ -229,6 +260,86 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_level_stats)
+{
+    string header =
+        "                               Compactions\n"
+        "Level  Files Size(MB) Time(sec) Read(MB) Write(MB)\n"
+        "--------------------------------------------------\n";
+    vector<CDBLevelStats> vStats;
+    BOOST_CHECK(dbwrapper_private::ParseLevelStats(header, vStats));
+    BOOST_CHECK(vStats.empty());
+
+    BOOST_CHECK(dbwrapper_private::ParseLevelStats(header +
+        "  0        2        1         0        0         1\n"
+        "  2       17       31         3       40        38\n", vStats));
+    BOOST_REQUIRE_EQUAL(vStats.size(), 2);
+    BOOST_CHECK_EQUAL(vStats[0].nLevel, 0);
+    BOOST_CHECK_EQUAL(vStats[0].nFiles, 2);
+    BOOST_CHECK_EQUAL(vStats[1].nLevel, 2);
+    BOOST_CHECK_EQUAL(vStats[1].nFiles, 17);
+    BOOST_CHECK_EQUAL(vStats[1].dSizeMB, 31);
+    BOOST_CHECK_EQUAL(vStats[1].dCompactionSeconds, 3);
+    BOOST_CHECK_EQUAL(vStats[1].dReadMB, 40);
+    BOOST_CHECK_EQUAL(vStats[1].dWriteMB, 38);
+
+    BOOST_CHECK(!dbwrapper_private::ParseLevelStats("Level  Files\n", vStats));
+    BOOST_CHECK(!dbwrapper_private::ParseLevelStats(header + "  0        2\n", vStats));
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_compact_after_ibd)
+{
+    path ph = temp_directory_path() / unique_path();
+    {
+        CDBWrapper dbw(ph / "heavy", (1 << 20), false, true, CDBTuning::WriteHeavy("test"));
+        BOOST_CHECK_EQUAL(dbw.GetTuning().strName, "test");
+
+        CDBWrapper dbwDefault(ph / "default", (1 << 20), false, true);
+        BOOST_CHECK_EQUAL(dbwDefault.GetTuning().strName, "default");
+        BOOST_CHECK(!dbwDefault.GetTuning().fCompactAfterIBD);
+
+        vector<uint256> values;
+        for (uint32_t i = 0; i < 1000; i++) {
+            values.push_back(InsecureRand256());
+            BOOST_CHECK(dbw.Write(i, values.back()));
+            BOOST_CHECK(dbwDefault.Write(i, values.back()));
+        }
+
+        // The writes are still in the write buffer.
+        vector<CDBLevelStats> vStats;
+        BOOST_CHECK(dbw.GetLevelStats(vStats));
+        BOOST_CHECK(vStats.empty());
+
+        // Only the database that asked for it is compacted into tables.
+        dbcompaction.CompactAfterIBD();
+        BOOST_CHECK(dbw.GetLevelStats(vStats));
+        int nFiles = 0;
+        for (const CDBLevelStats& stats : vStats) {
+            nFiles += stats.nFiles;
+        }
+        BOOST_CHECK(nFiles > 0);
+        BOOST_CHECK(dbwDefault.GetLevelStats(vStats));
+        BOOST_CHECK(vStats.empty());
+
+        for (uint32_t i = 0; i < values.size(); i++) {
+            uint256 res;
+            BOOST_CHECK(dbw.Read(i, res));
+            BOOST_CHECK(res == values[i]);
+        }
 
+        // Other databases can be opened and closed while one is compacted.
+        for (uint32_t i = 0; i < 1000; i++) {
+            BOOST_CHECK(dbw.Write(i + 1000, InsecureRand256()));
+        }
+        std::thread compaction([] { dbcompaction.CompactAfterIBD(); });
+        for (int i = 0; i < 10; i++) {
+            CDBWrapper dbwOther(ph / "other", (1 << 20), false, true);
+            BOOST_CHECK(dbwOther.Write(i, i));
+            dbcompaction.UpdateMetrics();
+        }
+        compaction.join();
+    }
+    remove_all(ph);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -333,13 +333,13 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
         // will be closer to the tip, and blocks will appear slower.
         pblock->nTime = chainActive.Tip()->GetMedianTimePast() + 6*chainparams.GetConsensus().PoWTargetSpacing(i);
         pblock->nBits = GetNextWorkRequired(chainActive.Tip(), pblock, chainparams.GetConsensus());
-        CMutableTransaction txCoinbase(pblock->vtx[0]);
+        CMutableTransaction txCoinbase(*pblock->vtx[0]);
         txCoinbase.nVersion = 1;
         txCoinbase.vin[0].scriptSig = CScript() << (chainActive.Height()+1) << OP_0;
         txCoinbase.vout[0].scriptPubKey = CScript();
         txCoinbase.vout[0].nValue = MinerSubsidy(height);
-        pblock->vtx[0] = CTransaction(txCoinbase);
-        txFirst.push_back(new CTransaction(pblock->vtx[0]));
+        pblock->vtx[0] = MakeTransactionRef(txCoinbase);
+        txFirst.push_back(new CTransaction(*pblock->vtx[0]));
         pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 
         if (i < sizeof(blockinfo)/sizeof(*blockinfo)) {
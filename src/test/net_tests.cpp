@@ -143,4 +143,25 @@ BOOST_AUTO_TEST_CASE(caddrdb_read_corrupted)
     BOOST_CHECK(addrman2.size() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(serialize_net_msg)
+{
+    uint64_t nonce = 0x0123456789abcdef;
+    CSerializedNetMsgRef msg = SerializeNetMsg("ping", nonce);
+    BOOST_CHECK_EQUAL(msg->size(), CMessageHeader::HEADER_SIZE + sizeof(nonce));
+
+    CDataStream ss(msg->data(), msg->data() + msg->size(), SER_NETWORK, PROTOCOL_VERSION);
+    CMessageHeader hdr(Params().MessageStart());
+    ss >> hdr;
+    BOOST_CHECK(hdr.IsValid(Params().MessageStart()));
+    BOOST_CHECK_EQUAL(hdr.GetCommand(), "ping");
+    BOOST_CHECK_EQUAL(hdr.nMessageSize, sizeof(nonce));
+
+    uint256 hash = Hash(ss.begin(), ss.end());
+    BOOST_CHECK(memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) == 0);
+
+    uint64_t nonce2;
+    ss >> nonce2;
+    BOOST_CHECK_EQUAL(nonce, nonce2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
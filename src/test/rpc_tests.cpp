@@ -7,6 +7,9 @@
 #include "rpc/client.h"
 
 #include "experimental_features.h"
+#include "index/insightaddressindex.h"
+#include "index/insightspentindex.h"
+#include "index/insighttimestampindex.h"
 #include "key_io.h"
 #include "main.h"
 #include "netbase.h"
@@ -328,10 +331,14 @@ BOOST_AUTO_TEST_CASE(rpc_insightexplorer)
 
     fExperimentalInsightExplorer = true;
     // During startup of the real system, fExperimentalInsightExplorer ("-insightexplorer")
-    // automatically enables the next four, but not here, must explicitly enable.
+    // automatically enables the next three, and starts the indexes, but not here,
+    // must explicitly enable.
     fAddressIndex = true;
     fSpentIndex = true;
     fTimestampIndex = true;
+    g_addressindex.reset(new AddressIndex(1 << 20, true));
+    g_spentindex.reset(new SpentIndex(1 << 20, true));
+    g_timestampindex.reset(new TimestampIndex(1 << 20, true));
 
     // must be a legal mainnet address
     const string addr = "t1T3G72ToPuCDTiCEytrU1VUBRHsNupEBut";
@@ -385,6 +392,9 @@ BOOST_AUTO_TEST_CASE(rpc_insightexplorer)
     fAddressIndex = false;
     fSpentIndex = false;
     fTimestampIndex = false;
+    g_addressindex.reset();
+    g_spentindex.reset();
+    g_timestampindex.reset();
 }
 
 BOOST_AUTO_TEST_SUITE_END()
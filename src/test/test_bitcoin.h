@@ -43,7 +43,6 @@ struct BasicTestingSetup {
  * Included are data directory, coins database, script check threads setup.
  */
 struct TestingSetup: public BasicTestingSetup {
-    CCoinsViewDB *pcoinsdbview;
     fs::path orig_current_path;
     fs::path pathTemp;
     boost::thread_group threadGroup;
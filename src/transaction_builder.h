@@ -30,6 +30,9 @@
 class OrchardWallet;
 namespace orchard { class UnauthorizedBundle; }
 
+/** Default for -saplingproverthreads (0 = one thread per core). */
+static const int DEFAULT_SAPLING_PROVER_THREADS = 0;
+
 uint256 ProduceShieldedSignatureHash(
     uint32_t consensusBranchId,
     const CTransaction& tx,
@@ -10,10 +10,16 @@
 #include "hash.h"
 #include "main.h"
 #include "pow.h"
+#include "streams.h"
 #include "uint256.h"
 #include "zcash/History.hpp"
 
 #include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <set>
+#include <tuple>
 
 #include <boost/thread.hpp>
 
@@ -31,7 +37,18 @@ static const char DB_SAPLING_NULLIFIER = 'S';
 static const char DB_ORCHARD_NULLIFIER = 'O';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
-static const char DB_TXINDEX = 't';
+// The transaction and insight explorer indexes were kept in the block index
+// database before they moved to databases of their own under indexes/. Their
+// entries may still be present until they have been copied over.
+static const char DB_TXINDEX_LEGACY = 't';
+static const char DB_ADDRESSINDEX_LEGACY = 'd';
+static const char DB_ADDRESSUNSPENTINDEX_LEGACY = 'u';
+static const char DB_ADDRESSBALANCE_LEGACY = 'v';
+static const char DB_SPENTINDEX_LEGACY = 'p';
+static const char DB_TIMESTAMPINDEX_LEGACY = 'T';
+static const char DB_BLOCKHASHINDEX_LEGACY = 'h';
+//! The block the legacy index entries are in sync with
+static const char DB_LEGACY_INDEX_BEST_BLOCK = 'L';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -41,6 +58,8 @@ static const char DB_BEST_ORCHARD_ANCHOR = 'y';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_RECOMPRESS_FILE = 'K';
+static const char DB_SNAPSHOT = 'U';
 
 static const char DB_MMR_LENGTH = 'M';
 static const char DB_MMR_NODE = 'm';
@@ -49,17 +68,15 @@ static const char DB_MMR_ROOT = 'r';
 static const char DB_SUBTREE_LATEST = 'e';
 static const char DB_SUBTREE_DATA = 'n';
 
-// insightexplorer
-static const char DB_ADDRESSINDEX = 'd';
-static const char DB_ADDRESSUNSPENTINDEX = 'u';
-static const char DB_SPENTINDEX = 'p';
-static const char DB_TIMESTAMPINDEX = 'T';
-static const char DB_BLOCKHASHINDEX = 'h';
+// lightwalletd compact blocks
+static const char DB_COMPACT_BLOCK = 'c';
 
 CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
+// Coins are cached above the database and flushed to it in large batches.
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, CDBTuning::WriteHeavy("chainstate"))
 {
 }
 
@@ -401,13 +418,314 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
     return db.WriteBatch(batch);
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+// Pass the key and cursor of every entry with the given prefix to fn, in the
+// order of their serialized keys.
+template <typename Key, typename Fn>
+static bool ForEachWithPrefix(const CDBWrapper& db, char prefix, Fn fn)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper&>(db).NewIterator());
+    for (pcursor->Seek(prefix); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, Key> key;
+        if (!pcursor->GetKey(key) || key.first != prefix)
+            break;
+        if (!fn(key.second, *pcursor))
+            return false;
+    }
+    return true;
+}
+
+template <typename... Args>
+static CSnapshotRecord MakeSnapshotRecord(CSnapshotRecord::Type type, const Args&... args)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    // Expand the fields in order.
+    int dummy[] = {0, ((void)(ss << args), 0)...};
+    (void)dummy;
+    CSnapshotRecord record;
+    record.nType = type;
+    record.vchData.assign(ss.begin(), ss.end());
+    return record;
+}
+
+template <typename Tree>
+static bool ForEachTreeRecord(const CDBWrapper& db, char prefix, CSnapshotRecord::Type type,
+                              const std::function<bool(const CSnapshotRecord&)>& fn)
+{
+    return ForEachWithPrefix<uint256>(db, prefix, [&](const uint256& root, CDBIterator& it) {
+        Tree tree;
+        if (!it.GetValue(tree))
+            throw std::runtime_error("CCoinsViewDB::ForEachSnapshotRecord(): unreadable tree");
+        return fn(MakeSnapshotRecord(type, root, tree));
+    });
+}
+
+bool CCoinsViewDB::ForEachSnapshotRecord(const std::function<bool(const CSnapshotRecord&)>& fn) const
+{
+    if (!fn(MakeSnapshotRecord(CSnapshotRecord::BEST_BLOCK, GetBestBlock())))
+        return false;
+    for (ShieldedType type : {SPROUT, SAPLING, ORCHARD}) {
+        if (!fn(MakeSnapshotRecord(CSnapshotRecord::BEST_ANCHOR, (uint8_t) type, GetBestAnchor(type))))
+            return false;
+    }
+
+    bool fContinue = ForEachWithPrefix<uint256>(db, DB_COINS, [&](const uint256& txid, CDBIterator& it) {
+        CCoins coins;
+        if (!it.GetValue(coins))
+            throw std::runtime_error("CCoinsViewDB::ForEachSnapshotRecord(): unreadable coins");
+        std::vector<std::pair<uint32_t, CTxOut>> vUnspent;
+        for (uint32_t i = 0; i < coins.vout.size(); i++) {
+            if (!coins.vout[i].IsNull())
+                vUnspent.emplace_back(i, coins.vout[i]);
+        }
+        return fn(MakeSnapshotRecord(CSnapshotRecord::COINS, txid, coins.nVersion, coins.nHeight, coins.fCoinBase, vUnspent));
+    });
+    if (!fContinue)
+        return false;
+
+    if (!ForEachTreeRecord<SproutMerkleTree>(db, DB_SPROUT_ANCHOR, CSnapshotRecord::SPROUT_TREE, fn) ||
+        !ForEachTreeRecord<SaplingMerkleTree>(db, DB_SAPLING_ANCHOR, CSnapshotRecord::SAPLING_TREE, fn) ||
+        !ForEachTreeRecord<OrchardMerkleFrontier>(db, DB_ORCHARD_ANCHOR, CSnapshotRecord::ORCHARD_TREE, fn))
+        return false;
+
+    for (const std::pair<char, ShieldedType>& nullifiers : {
+            std::make_pair(DB_NULLIFIER, SPROUT),
+            std::make_pair(DB_SAPLING_NULLIFIER, SAPLING),
+            std::make_pair(DB_ORCHARD_NULLIFIER, ORCHARD)}) {
+        fContinue = ForEachWithPrefix<uint256>(db, nullifiers.first, [&](const uint256& nf, CDBIterator&) {
+            return fn(MakeSnapshotRecord(CSnapshotRecord::NULLIFIER, (uint8_t) nullifiers.second, nf));
+        });
+        if (!fContinue)
+            return false;
+    }
+
+    // Epochs are keyed little-endian, so sort them numerically.
+    std::set<uint32_t> setEpochs;
+    ForEachWithPrefix<uint32_t>(db, DB_MMR_LENGTH, [&](const uint32_t& epochId, CDBIterator&) {
+        setEpochs.insert(epochId);
+        return true;
+    });
+    for (uint32_t epochId : setEpochs) {
+        HistoryIndex length = GetHistoryLength(epochId);
+        if (!fn(MakeSnapshotRecord(CSnapshotRecord::HISTORY, epochId, length, GetHistoryRoot(epochId))))
+            return false;
+        for (HistoryIndex i = 0; i < length; i++) {
+            if (!fn(MakeSnapshotRecord(CSnapshotRecord::HISTORY_NODE, epochId, i, GetHistoryAt(epochId, i))))
+                return false;
+        }
+    }
+
+    for (ShieldedType type : {SAPLING, ORCHARD}) {
+        auto latestSubtree = GetLatestSubtree(type);
+        if (!latestSubtree.has_value())
+            continue;
+        for (libzcash::SubtreeIndex i = 0; i <= latestSubtree->index; i++) {
+            auto subtreeData = GetSubtreeData(type, i);
+            if (!subtreeData.has_value())
+                throw std::runtime_error("CCoinsViewDB::ForEachSnapshotRecord(): missing subtree");
+            if (!fn(MakeSnapshotRecord(CSnapshotRecord::SUBTREE, (uint8_t) type, i, subtreeData.value())))
+                return false;
+        }
+        if (!fn(MakeSnapshotRecord(CSnapshotRecord::LATEST_SUBTREE, (uint8_t) type, latestSubtree.value())))
+            return false;
+    }
+    return true;
+}
+
+static char NullifierPrefix(uint8_t type)
+{
+    switch (type) {
+        case SPROUT: return DB_NULLIFIER;
+        case SAPLING: return DB_SAPLING_NULLIFIER;
+        case ORCHARD: return DB_ORCHARD_NULLIFIER;
+        default: throw std::runtime_error("Unknown shielded type");
+    }
+}
+
+static char BestAnchorPrefix(uint8_t type)
+{
+    switch (type) {
+        case SPROUT: return DB_BEST_SPROUT_ANCHOR;
+        case SAPLING: return DB_BEST_SAPLING_ANCHOR;
+        case ORCHARD: return DB_BEST_ORCHARD_ANCHOR;
+        default: throw std::runtime_error("Unknown shielded type");
+    }
+}
+
+bool CCoinsViewDB::LoadSnapshot(CAutoFile& file, uint64_t& nEntries) {
+    // Forget the best block first and write it last, so that the database is
+    // never taken to be at the snapshot's base block unless the whole
+    // snapshot has been written.
+    if (!db.Erase(DB_BEST_BLOCK, true))
+        return false;
+
+    CDBBatch batch(db);
+    size_t nBatched = 0;
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+    for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+        std::vector<unsigned char> key = pcursor->GetKeyBytes();
+        batch.Erase(CFlatData(key));
+        if (++nBatched % 10000 == 0) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+    }
+
+    std::optional<uint256> bestBlock;
+    nEntries = 0;
+    while (true) {
+        CSnapshotRecord record;
+        file >> record;
+        if (record.nType == CSnapshotRecord::END)
+            break;
+        nEntries++;
+        CDataStream ss(record.vchData, SER_DISK, CLIENT_VERSION);
+        switch (record.nType) {
+        case CSnapshotRecord::BEST_BLOCK: {
+            uint256 hash;
+            ss >> hash;
+            bestBlock = hash;
+            break;
+        }
+        case CSnapshotRecord::BEST_ANCHOR: {
+            uint8_t type;
+            uint256 root;
+            ss >> type >> root;
+            batch.Write(BestAnchorPrefix(type), root);
+            break;
+        }
+        case CSnapshotRecord::COINS: {
+            uint256 txid;
+            CCoins coins;
+            std::vector<std::pair<uint32_t, CTxOut>> vUnspent;
+            ss >> txid >> coins.nVersion >> coins.nHeight >> coins.fCoinBase >> vUnspent;
+            if (vUnspent.empty())
+                return error("CCoinsViewDB::LoadSnapshot(): snapshot has coins with no unspent outputs");
+            coins.vout.resize(vUnspent.back().first + 1);
+            for (const auto& output : vUnspent) {
+                coins.vout.at(output.first) = output.second;
+            }
+            batch.Write(make_pair(DB_COINS, txid), coins);
+            break;
+        }
+        case CSnapshotRecord::SPROUT_TREE: {
+            uint256 root;
+            SproutMerkleTree tree;
+            ss >> root >> tree;
+            batch.Write(make_pair(DB_SPROUT_ANCHOR, root), tree);
+            break;
+        }
+        case CSnapshotRecord::SAPLING_TREE: {
+            uint256 root;
+            SaplingMerkleTree tree;
+            ss >> root >> tree;
+            batch.Write(make_pair(DB_SAPLING_ANCHOR, root), tree);
+            break;
+        }
+        case CSnapshotRecord::ORCHARD_TREE: {
+            uint256 root;
+            OrchardMerkleFrontier tree;
+            ss >> root >> tree;
+            batch.Write(make_pair(DB_ORCHARD_ANCHOR, root), tree);
+            break;
+        }
+        case CSnapshotRecord::NULLIFIER: {
+            uint8_t type;
+            uint256 nf;
+            ss >> type >> nf;
+            batch.Write(make_pair(NullifierPrefix(type), nf), true);
+            break;
+        }
+        case CSnapshotRecord::HISTORY: {
+            uint32_t epochId;
+            HistoryIndex length;
+            uint256 root;
+            ss >> epochId >> length >> root;
+            batch.Write(make_pair(DB_MMR_LENGTH, epochId), length);
+            batch.Write(make_pair(DB_MMR_ROOT, epochId), root);
+            break;
+        }
+        case CSnapshotRecord::HISTORY_NODE: {
+            uint32_t epochId;
+            HistoryIndex index;
+            HistoryNode node;
+            ss >> epochId >> index >> node;
+            batch.Write(make_pair(DB_MMR_NODE, make_pair(epochId, index)), node);
+            break;
+        }
+        case CSnapshotRecord::SUBTREE: {
+            uint8_t type;
+            libzcash::SubtreeIndex index;
+            libzcash::SubtreeData subtreeData;
+            ss >> type >> index >> subtreeData;
+            batch.Write(make_pair(DB_SUBTREE_DATA, make_pair(type, index)), subtreeData);
+            break;
+        }
+        case CSnapshotRecord::LATEST_SUBTREE: {
+            uint8_t type;
+            libzcash::LatestSubtree latestSubtree;
+            ss >> type >> latestSubtree;
+            batch.Write(make_pair(DB_SUBTREE_LATEST, type), latestSubtree);
+            break;
+        }
+        default:
+            return error("CCoinsViewDB::LoadSnapshot(): unknown snapshot record type %d", record.nType);
+        }
+        if (++nBatched % 10000 == 0) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+    }
+    if (!bestBlock)
+        return error("CCoinsViewDB::LoadSnapshot(): snapshot has no best block");
+    batch.Write(DB_BEST_BLOCK, *bestBlock);
+    LogPrintf("%s: loaded %u chainstate records\n", __func__, nEntries);
+    return db.WriteBatch(batch, true);
+}
+
+CSnapshotMetadata::CSnapshotMetadata(const CBlockIndex* pindex) :
+    nVersion(CURRENT_VERSION),
+    hashBlock(pindex->GetBlockHash()),
+    nHeight(pindex->nHeight),
+    nChainTx(pindex->nChainTx),
+    hashFinalSaplingRoot(pindex->hashFinalSaplingRoot),
+    hashFinalOrchardRoot(pindex->hashFinalOrchardRoot),
+    hashChainHistoryRoot(pindex->hashChainHistoryRoot),
+    hashAuthDataRoot(pindex->hashAuthDataRoot),
+    nChainTotalSupply(pindex->nChainTotalSupply),
+    nChainTransparentValue(pindex->nChainTransparentValue),
+    nChainSproutValue(pindex->nChainSproutValue),
+    nChainSaplingValue(pindex->nChainSaplingValue),
+    nChainOrchardValue(pindex->nChainOrchardValue),
+    nChainLockboxValue(pindex->nChainLockboxValue)
+{
+}
+
+static CDBTuning BlockTreeTuning()
+{
+    // The block index is read in full at startup, and is written a block at
+    // a time along with the address, spent and timestamp indexes.
+    CDBTuning tuning("blocktree");
+    tuning.fCompactAfterIBD = true;
+    return tuning;
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, BlockTreeTuning()) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) const {
     return Read(make_pair(DB_BLOCK_FILES, nFile), info);
 }
 
+bool CBlockTreeDB::WriteSnapshot(const CSnapshotMetadata& metadata) {
+    return Write(DB_SNAPSHOT, metadata, true);
+}
+
+bool CBlockTreeDB::ReadSnapshot(CSnapshotMetadata& metadata) const {
+    return Read(DB_SNAPSHOT, metadata);
+}
+
 bool CBlockTreeDB::WriteReindexing(bool fReindexing) {
     if (fReindexing)
         return Write(DB_REINDEX_FLAG, '1');
@@ -424,6 +742,14 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) const {
     return Read(DB_LAST_BLOCK, nFile);
 }
 
+bool CBlockTreeDB::WriteRecompressFile(int nFile) {
+    return Write(DB_RECOMPRESS_FILE, nFile, true);
+}
+
+bool CBlockTreeDB::ReadRecompressFile(int &nFile) const {
+    return Read(DB_RECOMPRESS_FILE, nFile);
+}
+
 bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
@@ -511,161 +837,38 @@ bool CBlockTreeDB::ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex
     return Read(make_pair(DB_BLOCK_INDEX, blockhash), dbindex);
 }
 
-bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) const {
-    return Read(make_pair(DB_TXINDEX, txid), pos);
-}
-
-bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<uint256,CDiskTxPos> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(make_pair(DB_TXINDEX, it->first), it->second);
-    return WriteBatch(batch);
-}
-
-// START insightexplorer
-// https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-81e4f16a1b5d5b7ca25351a63d07cb80R183
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDbEntry> &vect)
-{
-    CDBBatch batch(*this);
-    for (std::vector<CAddressUnspentDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
-        } else {
-            batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &unspentOutputs)
-{
+bool CBlockTreeDB::HasLegacyIndexEntries(const std::vector<char>& prefixes) {
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (!(pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash))
-            break;
-        CAddressUnspentValue nValue;
-        if (!pcursor->GetValue(nValue))
-            return error("failed to get address unspent value");
-        unspentOutputs.push_back(make_pair(key.second, nValue));
-        pcursor->Next();
-    }
-    return true;
-}
-
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<CAddressIndexDbEntry> &vect) {
-    CDBBatch batch(*this);
-    for (std::vector<CAddressIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<CAddressIndexDbEntry> &vect) {
-    CDBBatch batch(*this);
-    for (std::vector<CAddressIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressIndex(
-        uint160 addressHash, int type,
-        std::vector<CAddressIndexDbEntry> &addressIndex,
-        int start, int end)
-{
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    if (start > 0 && end > 0) {
-        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
-    } else {
-        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
-    }
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressIndexKey> key;
-        if (!(pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash))
-            break;
-        if (end > 0 && key.second.blockHeight > end)
-            break;
-        CAmount nValue;
-        if (!pcursor->GetValue(nValue))
-            return error("failed to get address index value");
-        addressIndex.push_back(make_pair(key.second, nValue));
-        pcursor->Next();
-    }
-    return true;
-}
-
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) const {
-    return Read(make_pair(DB_SPENTINDEX, key), value);
-}
-
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect) {
-    CDBBatch batch(*this);
-    for (std::vector<CSpentIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(make_pair(DB_SPENTINDEX, it->first));
-        } else {
-            batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
+    for (char prefix : prefixes) {
+        pcursor->Seek(prefix);
+        if (pcursor->Valid()) {
+            std::vector<unsigned char> key = pcursor->GetKeyBytes();
+            if (!key.empty() && key[0] == (unsigned char)prefix)
+                return true;
         }
     }
-    return WriteBatch(batch);
+    return false;
 }
 
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
-    batch.Write(make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
+bool CBlockTreeDB::HasLegacyIndexEntries() {
+    return HasLegacyIndexEntries({
+        DB_TXINDEX_LEGACY,
+        DB_ADDRESSINDEX_LEGACY, DB_ADDRESSUNSPENTINDEX_LEGACY, DB_ADDRESSBALANCE_LEGACY,
+        DB_SPENTINDEX_LEGACY,
+        DB_TIMESTAMPINDEX_LEGACY, DB_BLOCKHASHINDEX_LEGACY});
 }
 
-bool CBlockTreeDB::ReadTimestampIndex(unsigned int high, unsigned int low,
-    const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
-{
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, CTimestampIndexKey> key;
-        if (!(pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high)) {
-            break;
-        }
-        if (fActiveOnly) {
-            CBlockIndex* pblockindex = mapBlockIndex[key.second.blockHash];
-            if (chainActive.Contains(pblockindex)) {
-                hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-            }
-        } else {
-            hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-        }
-        pcursor->Next();
-    }
-    return true;
+bool CBlockTreeDB::WriteLegacyIndexBestBlock(const uint256& hash) {
+    return Write(DB_LEGACY_INDEX_BEST_BLOCK, hash);
 }
 
-bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex,
-    const CTimestampBlockIndexValue &logicalts)
-{
-    CDBBatch batch(*this);
-    batch.Write(make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
-    return WriteBatch(batch);
+bool CBlockTreeDB::ReadLegacyIndexBestBlock(uint256& hash) const {
+    return Read(DB_LEGACY_INDEX_BEST_BLOCK, hash);
 }
 
-bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) const
-{
-    CTimestampBlockIndexValue(lts);
-    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
-        return false;
-
-    ltimestamp = lts.ltimestamp;
-    return true;
+bool CBlockTreeDB::EraseLegacyIndexBestBlock() {
+    return Erase(DB_LEGACY_INDEX_BEST_BLOCK);
 }
-// END insightexplorer
 
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
@@ -779,3 +982,22 @@ bool CBlockTreeDB::LoadBlockIndexGuts(
 
     return true;
 }
+
+CCompactBlockDB::CCompactBlockDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "compact", nCacheSize, fMemory, fWipe) {
+}
+
+bool CCompactBlockDB::WriteCompactBlock(int nHeight, const uint256 &hash, const std::vector<uint8_t> &data) {
+    return Write(std::make_pair(DB_COMPACT_BLOCK, nHeight), std::make_pair(hash, data));
+}
+
+bool CCompactBlockDB::ReadCompactBlock(int nHeight, const uint256 &hash, std::vector<uint8_t> &data) const {
+    std::pair<uint256, std::vector<uint8_t>> entry;
+    if (!Read(std::make_pair(DB_COMPACT_BLOCK, nHeight), entry) || entry.first != hash)
+        return false;
+    data = std::move(entry.second);
+    return true;
+}
+
+bool CCompactBlockDB::EraseCompactBlock(int nHeight) {
+    return Erase(std::make_pair(DB_COMPACT_BLOCK, nHeight));
+}
@@ -11,7 +11,10 @@
 #include "dbwrapper.h"
 #include "chain.h"
 
+#include <functional>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -19,6 +22,7 @@
 #include <boost/function.hpp>
 #include "zcash/History.hpp"
 
+class CAutoFile;
 class CBlockIndex;
 
 // START insightexplorer
@@ -27,6 +31,7 @@ struct CAddressUnspentValue;
 struct CAddressIndexKey;
 struct CAddressIndexIteratorKey;
 struct CAddressIndexIteratorHeightKey;
+struct CAddressBalanceValue;
 struct CSpentIndexKey;
 struct CSpentIndexValue;
 struct CTimestampIndexKey;
@@ -73,6 +78,111 @@ struct CDiskTxPos : public CDiskBlockPos
     }
 };
 
+/**
+ * The chainstate at a block, as written at the start of a snapshot by
+ * dumptxoutset. The entries of the chainstate database follow it in key
+ * order, so a snapshot holds the coins, the nullifier sets, the note
+ * commitment tree anchors and subtrees, and the history tree, as of the block.
+ * The block index values that are kept in memory and computed from a block's
+ * ancestors are included for the base block, so that a node loading the
+ * snapshot can connect the blocks after it without having its ancestors.
+ */
+struct CSnapshotMetadata
+{
+    //! Version 1 snapshots held raw coin database entries, and are not supported.
+    static const int CURRENT_VERSION = 2;
+
+    int nVersion;
+    uint256 hashBlock;
+    int nHeight;
+    unsigned int nChainTx;
+    uint256 hashFinalSaplingRoot;
+    uint256 hashFinalOrchardRoot;
+    uint256 hashChainHistoryRoot;
+    uint256 hashAuthDataRoot;
+    std::optional<CAmount> nChainTotalSupply;
+    std::optional<CAmount> nChainTransparentValue;
+    std::optional<CAmount> nChainSproutValue;
+    std::optional<CAmount> nChainSaplingValue;
+    std::optional<CAmount> nChainOrchardValue;
+    std::optional<CAmount> nChainLockboxValue;
+
+    CSnapshotMetadata() : nVersion(CURRENT_VERSION), nHeight(0), nChainTx(0) {}
+    explicit CSnapshotMetadata(const CBlockIndex* pindex);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nVersion);
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(nChainTx);
+        READWRITE(hashFinalSaplingRoot);
+        READWRITE(hashFinalOrchardRoot);
+        READWRITE(hashChainHistoryRoot);
+        READWRITE(hashAuthDataRoot);
+        READWRITE(nChainTotalSupply);
+        READWRITE(nChainTransparentValue);
+        READWRITE(nChainSproutValue);
+        READWRITE(nChainSaplingValue);
+        READWRITE(nChainOrchardValue);
+        READWRITE(nChainLockboxValue);
+    }
+};
+
+/** A chainstate database entry in a snapshot. An entry with an empty key ends the snapshot. */
+/**
+ * A record of a chainstate snapshot. Records hold the logical contents of the
+ * chainstate, serialized independently of how the coin database stores them,
+ * so that the snapshot hashes committed to in the chain parameters do not
+ * depend on the database's layout.
+ */
+struct CSnapshotRecord
+{
+    enum Type : uint8_t {
+        //! Ends the snapshot
+        END = 0,
+        //! uint256 hash of the block the chainstate is at
+        BEST_BLOCK = 1,
+        //! ShieldedType, uint256 root of the note commitment tree at that block
+        BEST_ANCHOR = 2,
+        //! uint256 txid, int nVersion, int nHeight, bool fCoinBase, and a
+        //! vector of (uint32_t index, CTxOut) for the unspent outputs
+        COINS = 3,
+        //! uint256 root and the Sprout, Sapling or Orchard tree with that root
+        SPROUT_TREE = 4,
+        SAPLING_TREE = 5,
+        ORCHARD_TREE = 6,
+        //! ShieldedType, uint256 nullifier
+        NULLIFIER = 7,
+        //! uint32_t epoch, HistoryIndex length, uint256 root of its history tree
+        HISTORY = 8,
+        //! uint32_t epoch, HistoryIndex index, HistoryNode
+        HISTORY_NODE = 9,
+        //! ShieldedType, SubtreeIndex, SubtreeData of a completed subtree
+        SUBTREE = 10,
+        //! ShieldedType, LatestSubtree
+        LATEST_SUBTREE = 11,
+    };
+
+    uint8_t nType;
+    //! The record's fields, serialized in the order given for its type
+    std::vector<unsigned char> vchData;
+
+    CSnapshotRecord() : nType(END) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nType);
+        if (nType != END) {
+            READWRITE(vchData);
+        }
+    }
+};
+
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB : public CCoinsView
 {
@@ -81,6 +191,8 @@ protected:
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    //! A read-only view of @p base's coins as they are now, unchanged by later flushes to it.
+    CCoinsViewDB(const CCoinsViewDB& base, const CDBWrapper::SnapshotTag& tag) : db(base.db, tag) {}
     ~CCoinsViewDB() {}
 
     bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
@@ -113,6 +225,14 @@ public:
                     SubtreeCache &cacheSaplingSubtrees,
                     SubtreeCache &cacheOrchardSubtrees);
     bool GetStats(CCoinsStats &stats) const;
+    /**
+     * Pass the records of a snapshot of the database to fn, in the order of
+     * their types, then of the transaction ids, roots and nullifiers as
+     * serialized, and of epochs and indexes. Stops early if fn returns false.
+     */
+    bool ForEachSnapshotRecord(const std::function<bool(const CSnapshotRecord&)>& fn) const;
+    //! Replace the contents of the database by the records read from a snapshot
+    bool LoadSnapshot(CAutoFile& file, uint64_t& nEntries);
 };
 
 /** Access to the block database (blocks/index/) */
@@ -128,33 +248,47 @@ public:
     bool EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &info) const;
     bool ReadLastBlockFile(int &nFile) const;
+    //! The first block file the block recompression thread has not finished with
+    bool WriteRecompressFile(int nFile);
+    bool ReadRecompressFile(int &nFile) const;
+    //! The snapshot the chainstate was loaded from, if any
+    bool WriteSnapshot(const CSnapshotMetadata& metadata);
+    bool ReadSnapshot(CSnapshotMetadata& metadata) const;
     bool WriteReindexing(bool fReindexing);
     bool ReadReindexing(bool &fReindexing) const;
     bool ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex &dbindex) const;
-    bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) const;
-    bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
-
-    // START insightexplorer
-    bool UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDbEntry> &vect);
-    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &vect);
-    bool WriteAddressIndex(const std::vector<CAddressIndexDbEntry> &vect);
-    bool EraseAddressIndex(const std::vector<CAddressIndexDbEntry> &vect);
-    bool ReadAddressIndex(uint160 addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0);
-    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) const;
-    bool UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect);
-    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
-    bool ReadTimestampIndex(unsigned int high, unsigned int low,
-            const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
-    bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex,
-            const CTimestampBlockIndexValue &logicalts);
-    bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS) const;
-    // END insightexplorer
-
-    bool WriteFlag(const std::string &name, bool fValue);
+    //! Whether there are entries of the indexes that used to be kept in this
+    //! database (all of them, or those under the given key prefixes) left
+    bool HasLegacyIndexEntries(const std::vector<char>& prefixes);
+    bool HasLegacyIndexEntries();
+    //! The block that those entries are in sync with
+    bool WriteLegacyIndexBestBlock(const uint256& hash);
+    bool ReadLegacyIndexBestBlock(uint256& hash) const;
+    bool EraseLegacyIndexBestBlock();
+
+        bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue) const;
     bool LoadBlockIndexGuts(
         std::function<CBlockIndex*(const uint256&)> insertBlockIndex,
         const CChainParams& chainParams);
 };
 
+/**
+ * Access to the lightwalletd compact block store (blocks/compact/). Entries are
+ * keyed by height and record the hash of the block they were built from, so a
+ * stale entry left behind by a reorg or an unclean shutdown is never served.
+ */
+class CCompactBlockDB : public CDBWrapper
+{
+public:
+    CCompactBlockDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+private:
+    CCompactBlockDB(const CCompactBlockDB&);
+    void operator=(const CCompactBlockDB&);
+public:
+    bool WriteCompactBlock(int nHeight, const uint256 &hash, const std::vector<uint8_t> &data);
+    bool ReadCompactBlock(int nHeight, const uint256 &hash, std::vector<uint8_t> &data) const;
+    bool EraseCompactBlock(int nHeight);
+};
+
 #endif // BITCOIN_TXDB_H
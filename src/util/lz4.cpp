@@ -0,0 +1,159 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "util/lz4.h"
+
+#include "crypto/common.h"
+
+#include <algorithm>
+#include <string.h>
+
+// An LZ4 block is a sequence of (literals, match) pairs. Each starts with a
+// token byte holding the literal length in its high nibble and the match
+// length minus MINMATCH in its low nibble, either of which is continued in
+// extra bytes if it is 15. The literals follow, then the match offset as two
+// little-endian bytes. The last sequence has literals only.
+static const size_t MINMATCH = 4;
+// The last match must start at least MFLIMIT bytes before the end of the
+// block, and the last LASTLITERALS bytes are always literals.
+static const size_t MFLIMIT = 12;
+static const size_t LASTLITERALS = 5;
+static const size_t MAX_DISTANCE = 65535;
+static const int HASH_LOG = 12;
+// After this many bytes without a match, the compressor starts skipping
+// ahead, so that incompressible data such as note ciphertexts is passed over
+// quickly.
+static const int SKIP_TRIGGER = 6;
+
+static inline uint32_t HashSequence(uint32_t seq)
+{
+    return (seq * 2654435761U) >> (32 - HASH_LOG);
+}
+
+static void WriteLength(std::vector<unsigned char>& out, size_t len)
+{
+    while (len >= 255) {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back(len);
+}
+
+static void WriteSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t nLiterals, size_t nOffset, size_t nMatch)
+{
+    size_t nMatchCode = nMatch - MINMATCH;
+    out.push_back((std::min<size_t>(nLiterals, 15) << 4) | std::min<size_t>(nMatchCode, 15));
+    if (nLiterals >= 15) WriteLength(out, nLiterals - 15);
+    out.insert(out.end(), literals, literals + nLiterals);
+    out.push_back(nOffset & 0xff);
+    out.push_back(nOffset >> 8);
+    if (nMatchCode >= 15) WriteLength(out, nMatchCode - 15);
+}
+
+void CompressLZ4(const unsigned char* data, size_t len, std::vector<unsigned char>& out)
+{
+    out.clear();
+    out.reserve(len + len / 255 + 16);
+
+    const unsigned char* const end = data + len;
+    const unsigned char* anchor = data;
+    if (len > MFLIMIT) {
+        const unsigned char* const mflimit = end - MFLIMIT;
+        const unsigned char* const matchlimit = end - LASTLITERALS;
+        // Positions plus one of the last sequence seen with each hash.
+        std::vector<uint32_t> table(1 << HASH_LOG, 0);
+
+        const unsigned char* ip = data;
+        size_t nMisses = 0;
+        while (ip < mflimit) {
+            uint32_t seq = ReadLE32(ip);
+            uint32_t& entry = table[HashSequence(seq)];
+            const unsigned char* match = entry ? data + entry - 1 : NULL;
+            entry = ip - data + 1;
+            if (!match || (size_t)(ip - match) > MAX_DISTANCE || ReadLE32(match) != seq) {
+                ip += 1 + (nMisses++ >> SKIP_TRIGGER);
+                continue;
+            }
+            nMisses = 0;
+
+            // Extend the match backwards over pending literals, and forwards
+            // up to the bytes that must be left as literals.
+            while (ip > anchor && match > data && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+            const unsigned char* mend = ip + MINMATCH;
+            while (mend < matchlimit && *mend == match[mend - ip]) {
+                mend++;
+            }
+
+            WriteSequence(out, anchor, ip - anchor, ip - match, mend - ip);
+            ip = mend;
+            anchor = mend;
+            if (ip < mflimit) {
+                table[HashSequence(ReadLE32(ip - 2))] = ip - 2 - data + 1;
+            }
+        }
+    }
+
+    // The last literals.
+    size_t nLiterals = end - anchor;
+    out.push_back(std::min<size_t>(nLiterals, 15) << 4);
+    if (nLiterals >= 15) WriteLength(out, nLiterals - 15);
+    out.insert(out.end(), anchor, end);
+}
+
+static bool ReadLength(const unsigned char*& ip, const unsigned char* iend, size_t& len)
+{
+    unsigned char s;
+    do {
+        if (ip == iend) return false;
+        s = *ip++;
+        len += s;
+    } while (s == 255);
+    return true;
+}
+
+bool DecompressLZ4(const unsigned char* data, size_t len, unsigned char* out, size_t nOutSize)
+{
+    const unsigned char* ip = data;
+    const unsigned char* const iend = data + len;
+    unsigned char* op = out;
+    unsigned char* const oend = out + nOutSize;
+
+    while (true) {
+        if (ip == iend) return false;
+        unsigned char token = *ip++;
+
+        size_t nLiterals = token >> 4;
+        if (nLiterals == 15 && !ReadLength(ip, iend, nLiterals)) return false;
+        if (nLiterals > (size_t)(iend - ip) || nLiterals > (size_t)(oend - op)) return false;
+        memcpy(op, ip, nLiterals);
+        op += nLiterals;
+        ip += nLiterals;
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return false;
+        size_t nOffset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (nOffset == 0 || nOffset > (size_t)(op - out)) return false;
+
+        size_t nMatch = token & 15;
+        if (nMatch == 15 && !ReadLength(ip, iend, nMatch)) return false;
+        nMatch += MINMATCH;
+        if (nMatch > (size_t)(oend - op)) return false;
+
+        const unsigned char* match = op - nOffset;
+        if (nOffset >= nMatch) {
+            memcpy(op, match, nMatch);
+            op += nMatch;
+        } else {
+            // The match overlaps the bytes it produces, repeating them.
+            for (size_t i = 0; i < nMatch; i++) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return op == oend;
+}
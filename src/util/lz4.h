@@ -0,0 +1,25 @@
+// Copyright (c) 2026 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef ZCASH_UTIL_LZ4_H
+#define ZCASH_UTIL_LZ4_H
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Compress data in the LZ4 block format, replacing the contents of out. The
+ * compressor is a simple greedy one: it trades some ratio for speed, and the
+ * output can be decoded by any LZ4 block decoder.
+ */
+void CompressLZ4(const unsigned char* data, size_t len, std::vector<unsigned char>& out);
+
+/**
+ * Decompress an LZ4 block into out, which must be exactly nOutSize bytes.
+ * Returns false if the block is malformed or does not decompress to exactly
+ * nOutSize bytes. Never reads or writes outside the given buffers.
+ */
+bool DecompressLZ4(const unsigned char* data, size_t len, unsigned char* out, size_t nOutSize);
+
+#endif // ZCASH_UTIL_LZ4_H
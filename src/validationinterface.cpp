@@ -7,14 +7,20 @@
 #include "validationinterface.h"
 
 #include "chainparams.h"
+#include "consensus/validation.h"
 #include "init.h"
 #include "main.h"
+#include "scheduler.h"
 #include "txmempool.h"
 #include "ui_interface.h"
 
 #include <boost/thread.hpp>
 
 #include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
 
 #include <rust/metrics.h>
@@ -30,6 +36,86 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
+/**
+ * Forwards the callbacks of a listener registered with
+ * RegisterValidationInterfaceAsync to its own queue on the background
+ * scheduler. Arguments that the caller may free are copied.
+ */
+class CAsyncValidationInterface : public CValidationInterface
+{
+private:
+    CValidationInterface* pinner;
+    SingleThreadedSchedulerClient queue;
+
+    //! The copy shares the block's transactions, so only the header and vtx are copied.
+    static std::shared_ptr<const CBlock> CopyBlock(const CBlock *pblock) {
+        return pblock ? std::make_shared<const CBlock>(*pblock) : nullptr;
+    }
+
+public:
+    CAsyncValidationInterface(CValidationInterface* pinnerIn, CScheduler* pscheduler) :
+        pinner(pinnerIn), queue(pscheduler) {}
+
+    //! Wait until the callbacks queued so far have run
+    void Sync(bool fSchedulerRunning) {
+        if (!fSchedulerRunning) {
+            queue.EmptyQueue();
+            return;
+        }
+        std::promise<void> promise;
+        queue.AddToProcessQueue([&promise] { promise.set_value(); });
+        promise.get_future().wait();
+    }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindex) override {
+        queue.AddToProcessQueue([this, pindex] { pinner->UpdatedBlockTip(pindex); });
+    }
+    BatchScanner* GetBatchScanner() override {
+        return pinner->GetBatchScanner();
+    }
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock, const int nHeight) override {
+        auto block = CopyBlock(pblock);
+        queue.AddToProcessQueue([this, tx, block, nHeight] { pinner->SyncTransaction(tx, block.get(), nHeight); });
+    }
+    void EraseFromWallet(const uint256 &hash) override {
+        queue.AddToProcessQueue([this, hash] { pinner->EraseFromWallet(hash); });
+    }
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, std::optional<MerkleFrontiers> added) override {
+        auto block = CopyBlock(pblock);
+        queue.AddToProcessQueue([this, pindex, block, added] { pinner->ChainTip(pindex, block.get(), added); });
+    }
+    void UpdatedTransaction(const uint256 &hash) override {
+        queue.AddToProcessQueue([this, hash] { pinner->UpdatedTransaction(hash); });
+    }
+    void ResendWalletTransactions(int64_t nBestBlockTime) override {
+        queue.AddToProcessQueue([this, nBestBlockTime] { pinner->ResendWalletTransactions(nBestBlockTime); });
+    }
+    void BlockChecked(const CBlock& block, const CValidationState& state) override {
+        auto pblock = CopyBlock(&block);
+        queue.AddToProcessQueue([this, pblock, state] { pinner->BlockChecked(*pblock, state); });
+    }
+    void GetAddressForMining(std::optional<MinerAddress>& minerAddress) override {
+        pinner->GetAddressForMining(minerAddress);
+    }
+    void BlockConnected(const CBlockIndex *pindex) override {
+        queue.AddToProcessQueue([this, pindex] { pinner->BlockConnected(pindex); });
+    }
+    void BlockDisconnected(const CBlockIndex *pindex) override {
+        queue.AddToProcessQueue([this, pindex] { pinner->BlockDisconnected(pindex); });
+    }
+    void TransactionAddedToMempool(const CTransaction &tx, uint64_t nMempoolSequence) override {
+        queue.AddToProcessQueue([this, tx, nMempoolSequence] { pinner->TransactionAddedToMempool(tx, nMempoolSequence); });
+    }
+    void TransactionRemovedFromMempool(const CTransaction &tx, uint64_t nMempoolSequence) override {
+        queue.AddToProcessQueue([this, tx, nMempoolSequence] { pinner->TransactionRemovedFromMempool(tx, nMempoolSequence); });
+    }
+};
+
+static std::mutex cs_asyncInterfaces;
+static CScheduler* g_pscheduler = nullptr;
+static std::map<CValidationInterface*, std::shared_ptr<CAsyncValidationInterface>> g_asyncInterfaces;
+
 void RegisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
     g_signals.GetBatchScanner.connect(boost::bind(&CValidationInterface::GetBatchScanner, pwalletIn));
@@ -40,9 +126,82 @@ void RegisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
     g_signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
     g_signals.AddressForMining.connect(boost::bind(&CValidationInterface::GetAddressForMining, pwalletIn, _1));
+    g_signals.BlockConnected.connect(boost::bind(&CValidationInterface::BlockConnected, pwalletIn, _1));
+    g_signals.BlockDisconnected.connect(boost::bind(&CValidationInterface::BlockDisconnected, pwalletIn, _1));
+    g_signals.TransactionAddedToMempool.connect(boost::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1, _2));
+    g_signals.TransactionRemovedFromMempool.connect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1, _2));
+}
+
+void RegisterValidationInterfaceAsync(CValidationInterface* pwalletIn) {
+    std::shared_ptr<CAsyncValidationInterface> pasync;
+    {
+        std::unique_lock<std::mutex> lock(cs_asyncInterfaces);
+        if (!g_pscheduler) {
+            lock.unlock();
+            RegisterValidationInterface(pwalletIn);
+            return;
+        }
+        assert(g_asyncInterfaces.count(pwalletIn) == 0);
+        pasync = std::make_shared<CAsyncValidationInterface>(pwalletIn, g_pscheduler);
+        g_asyncInterfaces.emplace(pwalletIn, pasync);
+    }
+    RegisterValidationInterface(pasync.get());
+}
+
+void RegisterBackgroundSignalScheduler(CScheduler& scheduler) {
+    std::unique_lock<std::mutex> lock(cs_asyncInterfaces);
+    assert(!g_pscheduler);
+    g_pscheduler = &scheduler;
+}
+
+void UnregisterBackgroundSignalScheduler() {
+    std::unique_lock<std::mutex> lock(cs_asyncInterfaces);
+    g_pscheduler = nullptr;
+}
+
+void SyncWithValidationInterfaceQueue() {
+    AssertLockNotHeld(cs_main);
+    std::vector<std::shared_ptr<CAsyncValidationInterface>> vAsync;
+    {
+        std::unique_lock<std::mutex> lock(cs_asyncInterfaces);
+        for (const auto& entry : g_asyncInterfaces)
+            vAsync.push_back(entry.second);
+    }
+    for (const auto& pasync : vAsync)
+        pasync->Sync(true);
+}
+
+//! Run the callbacks still queued for an asynchronous listener that has been
+//! disconnected.
+static void DrainAsyncInterface(const std::shared_ptr<CAsyncValidationInterface>& pasync) {
+    bool fSchedulerRunning;
+    {
+        std::unique_lock<std::mutex> lock(cs_asyncInterfaces);
+        fSchedulerRunning = g_pscheduler && g_pscheduler->AreThreadsServicingQueue();
+    }
+    pasync->Sync(fSchedulerRunning);
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
+    std::shared_ptr<CAsyncValidationInterface> pasync;
+    {
+        std::unique_lock<std::mutex> lock(cs_asyncInterfaces);
+        auto it = g_asyncInterfaces.find(pwalletIn);
+        if (it != g_asyncInterfaces.end()) {
+            pasync = std::move(it->second);
+            g_asyncInterfaces.erase(it);
+        }
+    }
+    if (pasync) {
+        UnregisterValidationInterface(pasync.get());
+        DrainAsyncInterface(pasync);
+        return;
+    }
+
+    g_signals.TransactionRemovedFromMempool.disconnect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1, _2));
+    g_signals.TransactionAddedToMempool.disconnect(boost::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1, _2));
+    g_signals.BlockDisconnected.disconnect(boost::bind(&CValidationInterface::BlockDisconnected, pwalletIn, _1));
+    g_signals.BlockConnected.disconnect(boost::bind(&CValidationInterface::BlockConnected, pwalletIn, _1));
     g_signals.AddressForMining.disconnect(boost::bind(&CValidationInterface::GetAddressForMining, pwalletIn, _1));
     g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
     g_signals.Broadcast.disconnect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
@@ -55,6 +214,10 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
 }
 
 void UnregisterAllValidationInterfaces() {
+    g_signals.TransactionRemovedFromMempool.disconnect_all_slots();
+    g_signals.TransactionAddedToMempool.disconnect_all_slots();
+    g_signals.BlockDisconnected.disconnect_all_slots();
+    g_signals.BlockConnected.disconnect_all_slots();
     g_signals.AddressForMining.disconnect_all_slots();
     g_signals.BlockChecked.disconnect_all_slots();
     g_signals.Broadcast.disconnect_all_slots();
@@ -64,6 +227,15 @@ void UnregisterAllValidationInterfaces() {
     g_signals.SyncTransaction.disconnect_all_slots();
     g_signals.GetBatchScanner.disconnect_all_slots();
     g_signals.UpdatedBlockTip.disconnect_all_slots();
+
+    std::map<CValidationInterface*, std::shared_ptr<CAsyncValidationInterface>> asyncInterfaces;
+    {
+        std::unique_lock<std::mutex> lock(cs_asyncInterfaces);
+        asyncInterfaces.swap(g_asyncInterfaces);
+    }
+    for (auto& entry : asyncInterfaces) {
+        DrainAsyncInterface(entry.second);
+    }
 }
 
 void AddTxToBatches(
@@ -339,7 +511,8 @@ void ThreadNotifyWallets(CBlockIndex *pindexLastTip)
                     blockData.pindex->nHeight + 1);
             }
             // ... and transactions that got confirmed:
-            for (const CTransaction &tx : block.vtx) {
+            for (const CTransactionRef& ptx : block.vtx) {
+                const CTransaction& tx = *ptx;
                 AddTxToBatches(
                     batchScanners,
                     tx,
@@ -392,7 +565,8 @@ void ThreadNotifyWallets(CBlockIndex *pindexLastTip)
 
                 // Batch transactions that went from 1-confirmed to 0-confirmed
                 // or conflicted.
-                for (const CTransaction &tx : block.vtx) {
+                for (const CTransactionRef& ptx : block.vtx) {
+                    const CTransaction& tx = *ptx;
                     AddTxToBatches(batchScanners, tx, block.GetHash(), pindexScan->nHeight);
                 }
 
@@ -441,7 +615,8 @@ void ThreadNotifyWallets(CBlockIndex *pindexLastTip)
 
             // Let wallets know transactions went from 1-confirmed to
             // 0-confirmed or conflicted:
-            for (const CTransaction &tx : block.vtx) {
+            for (const CTransactionRef& ptx : block.vtx) {
+                const CTransaction& tx = *ptx;
                 SyncWithWallets(batchScanners, tx, NULL, pindexLastTip->nHeight);
             }
             // Update cached incremental witnesses
@@ -503,7 +678,8 @@ void ThreadNotifyWallets(CBlockIndex *pindexLastTip)
                     SyncWithWallets(batchScanners, tx, NULL, blockData.pindex->nHeight + 1);
                 }
                 // ... and about transactions that got confirmed:
-                for (const CTransaction &tx : block.vtx) {
+                for (const CTransactionRef& ptx : block.vtx) {
+                    const CTransaction& tx = *ptx;
                     SyncWithWallets(batchScanners, tx, &block, blockData.pindex->nHeight);
                 }
                 // Update cached incremental witnesses
@@ -516,7 +692,7 @@ void ThreadNotifyWallets(CBlockIndex *pindexLastTip)
                 // Notify UI to display prev block's coinbase if it was ours.
                 static uint256 hashPrevBestCoinBase;
                 GetMainSignals().UpdatedTransaction(hashPrevBestCoinBase);
-                hashPrevBestCoinBase = block.vtx[0].GetHash();
+                hashPrevBestCoinBase = block.vtx[0]->GetHash();
 
                 // This block is done!
                 pindexLastTip = blockData.pindex;
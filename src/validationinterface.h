@@ -25,6 +25,7 @@ class CBlock;
 class CBlockIndex;
 struct CBlockLocator;
 class CReserveScript;
+class CScheduler;
 class CTransaction;
 class CValidationInterface;
 class CValidationState;
@@ -82,6 +83,26 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
 
+/**
+ * Register a listener whose callbacks run on the background scheduler, in the
+ * order they were fired, instead of on the thread that fires them. This keeps
+ * slow listeners out of the time that cs_main is held. GetBatchScanner and
+ * AddressForMining return values to the caller, so they are still called
+ * synchronously. Without a background scheduler, this is the same as
+ * RegisterValidationInterface. Unregister with UnregisterValidationInterface.
+ */
+void RegisterValidationInterfaceAsync(CValidationInterface* pwalletIn);
+/** Register the scheduler that runs the callbacks of asynchronous listeners */
+void RegisterBackgroundSignalScheduler(CScheduler& scheduler);
+/** Unregister the background scheduler, after its threads have stopped */
+void UnregisterBackgroundSignalScheduler();
+/**
+ * Wait until every callback that was queued for an asynchronous listener
+ * before this call has run. Must not be called with cs_main held, or while
+ * the background scheduler's threads are stopped.
+ */
+void SyncWithValidationInterfaceQueue();
+
 class CValidationInterface {
 protected:
     virtual void UpdatedBlockTip(const CBlockIndex *pindex) {}
@@ -92,10 +113,15 @@ protected:
     virtual void UpdatedTransaction(const uint256 &hash) {}
     virtual void ResendWalletTransactions(int64_t nBestBlockTime) {}
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
+    virtual void BlockConnected(const CBlockIndex *pindex) {}
+    virtual void BlockDisconnected(const CBlockIndex *pindex) {}
+    virtual void TransactionAddedToMempool(const CTransaction &tx, uint64_t nMempoolSequence) {}
+    virtual void TransactionRemovedFromMempool(const CTransaction &tx, uint64_t nMempoolSequence) {}
     virtual void GetAddressForMining(std::optional<MinerAddress>&) {};
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
+    friend class CAsyncValidationInterface;
 };
 
 // aggregate_non_null_values is a combiner which places any non-nullptr values
@@ -160,6 +186,22 @@ struct CMainSignals {
     boost::signals2::signal<void (int64_t nBestBlockTime)> Broadcast;
     /** Notifies listeners of a block validation result */
     boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
+    /**
+     * Notifies listeners that a block was connected to or disconnected from
+     * the active chain. Unlike ChainTip, these are called synchronously from
+     * ConnectTip and DisconnectTip with cs_main held, so listeners must not
+     * block.
+     */
+    boost::signals2::signal<void (const CBlockIndex *)> BlockConnected;
+    boost::signals2::signal<void (const CBlockIndex *)> BlockDisconnected;
+    /**
+     * Notifies listeners that a transaction was added to or removed from the
+     * mempool, including removals of transactions mined in a block. The
+     * mempool sequence number increases by one with each of these events.
+     * These are called with mempool.cs held, so listeners must not block.
+     */
+    boost::signals2::signal<void (const CTransaction &, uint64_t nMempoolSequence)> TransactionAddedToMempool;
+    boost::signals2::signal<void (const CTransaction &, uint64_t nMempoolSequence)> TransactionRemovedFromMempool;
     /** Notifies listeners that an address for mining is required (coinbase) */
     boost::signals2::signal<void (std::optional<MinerAddress>&)> AddressForMining;
 };
@@ -134,28 +134,36 @@ void AsyncRPCOperation_sendmany::main() {
 // 1. #1159 Currently there is no limit set on the number of elements, which could
 //     make the tx too large.
 // 2. #1360 Note selection is not optimal.
-// 3. #1277 Spendable notes are not locked, so an operation running in parallel
-//    could also try to use them.
-// 4. #3615 There is no padding of inputs or outputs, which may leak information.
+// 3. #3615 There is no padding of inputs or outputs, which may leak information.
 //
-// At least #4 differs from the Rust transaction builder.
+// Input selection and locking happen atomically under cs_wallet, so that
+// operations running on other async RPC workers cannot select the same
+// inputs. Proving is then done without holding any wallet locks.
+//
+// At least #3 differs from the Rust transaction builder.
 tl::expected<uint256, InputSelectionError>
 AsyncRPCOperation_sendmany::main_impl(CWallet& wallet) {
-    auto spendable = builder_.FindAllSpendableInputs(wallet, ztxoSelector_, mindepth_);
-
-    auto preparedTx = builder_.PrepareTransaction(
-            wallet,
-            ztxoSelector_,
-            spendable,
-            recipients_,
-            chainActive,
-            strategy_,
-            fee_,
-            anchordepth_);
+    auto preparedTx = [&]() {
+        LOCK2(cs_main, wallet.cs_wallet);
+        auto spendable = builder_.FindAllSpendableInputs(wallet, ztxoSelector_, mindepth_);
+
+        auto preparedTx = builder_.PrepareTransaction(
+                wallet,
+                ztxoSelector_,
+                spendable,
+                recipients_,
+                chainActive,
+                strategy_,
+                fee_,
+                anchordepth_);
+        if (preparedTx.has_value()) {
+            preparedTx.value().LockSpendable(wallet);
+        }
+        return preparedTx;
+    }();
 
     return preparedTx
         .map([&](const TransactionEffects& effects) {
-            effects.LockSpendable(wallet);
             try {
                 const auto& spendable = effects.GetSpendable();
                 const auto& payments = effects.GetPayments();
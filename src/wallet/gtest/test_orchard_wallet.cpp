@@ -114,8 +114,8 @@ TEST(TransactionBuilder, OrchardToOrchard) {
 
     // Append the bundle to the wallet's commitment tree.
     CBlock fakeBlock;
-    fakeBlock.vtx.resize(2);
-    fakeBlock.vtx[1] = txRecv;
+    fakeBlock.vtx.push_back(MakeTransactionRef());
+    fakeBlock.vtx.push_back(MakeTransactionRef(txRecv));
     ASSERT_TRUE(wallet.AppendNoteCommitments(2, fakeBlock));
 
     // Now we can get spend info for the note.
@@ -87,7 +87,7 @@ TEST(WalletRPCTests, PrepareTransaction)
         // Fake-mine the transaction
         EXPECT_EQ(-1, chainActive.Height());
         CBlock block;
-        block.vtx.push_back(wtx);
+        block.vtx.push_back(MakeTransactionRef(wtx));
         block.hashMerkleRoot = BlockMerkleRoot(block);
         auto blockHash = block.GetHash();
         CBlockIndex fakeIndex {block};
@@ -285,7 +285,7 @@ TEST(WalletRPCTests, RPCZsendmanyTaddrToSapling)
     // Fake-mine the transaction
     EXPECT_EQ(-1, chainActive.Height());
     CBlock block;
-    block.vtx.push_back(wtx);
+    block.vtx.push_back(MakeTransactionRef(wtx));
     block.hashMerkleRoot = BlockMerkleRoot(block);
     auto blockHash = block.GetHash();
     CBlockIndex fakeIndex {block};
@@ -449,7 +449,7 @@ TEST(WalletRPCTests, ZIP317Fee)
         // Fake-mine the transaction
         EXPECT_EQ(-1, chainActive.Height());
         CBlock block;
-        block.vtx.push_back(wtx);
+        block.vtx.push_back(MakeTransactionRef(wtx));
         block.hashMerkleRoot = BlockMerkleRoot(block);
         auto blockHash = block.GetHash();
         CBlockIndex fakeIndex {block};
@@ -108,7 +108,7 @@ static std::pair<JSOutPoint, SaplingOutPoint> CreateValidBlock(TestWallet& walle
     auto saplingNotes = SetSaplingNoteData(wtx, 0);
     wallet.LoadWalletTx(wtx);
 
-    block.vtx.push_back(wtx);
+    block.vtx.push_back(MakeTransactionRef(wtx));
     wallet.IncrementNoteWitnesses(Params().GetConsensus(), &index, &block, frontiers, true);
 
     return std::make_pair(jsoutpt, saplingNotes[0]);
@@ -232,7 +232,7 @@ TEST(WalletTests, FindUnspentSproutNotes) {
     // Fake-mine the transaction
     EXPECT_EQ(-1, chainActive.Height());
     CBlock block;
-    block.vtx.push_back(wtx);
+    block.vtx.push_back(MakeTransactionRef(wtx));
     block.hashMerkleRoot = BlockMerkleRoot(block);
     auto blockHash = block.GetHash();
     CBlockIndex fakeIndex {block};
@@ -272,7 +272,7 @@ TEST(WalletTests, FindUnspentSproutNotes) {
     // Fake-mine a spend transaction
     EXPECT_EQ(0, chainActive.Height());
     CBlock block2;
-    block2.vtx.push_back(wtx2);
+    block2.vtx.push_back(MakeTransactionRef(wtx2));
     block2.hashMerkleRoot = BlockMerkleRoot(block2);
     block2.hashPrevBlock = blockHash;
     auto blockHash2 = block2.GetHash();
@@ -335,7 +335,7 @@ TEST(WalletTests, FindUnspentSproutNotes) {
     // Fake-mine the new transaction
     EXPECT_EQ(1, chainActive.Height());
     CBlock block3;
-    block3.vtx.push_back(wtx3);
+    block3.vtx.push_back(MakeTransactionRef(wtx3));
     block3.hashMerkleRoot = BlockMerkleRoot(block3);
     block3.hashPrevBlock = blockHash2;
     auto blockHash3 = block3.GetHash();
@@ -381,6 +381,120 @@ TEST(WalletTests, FindUnspentSproutNotes) {
     mapBlockIndex.erase(blockHash3);
 }
 
+TEST(WalletTests, GetFilteredNotesUsesNoteIndex) {
+    SelectParams(CBaseChainParams::TESTNET);
+
+    CWallet wallet(Params());
+    LOCK2(cs_main, wallet.cs_wallet);
+
+    auto sk1 = libzcash::SproutSpendingKey::random();
+    auto sk2 = libzcash::SproutSpendingKey::random();
+    wallet.AddSproutSpendingKey(sk1);
+    wallet.AddSproutSpendingKey(sk2);
+
+    for (const auto& sk : {sk1, sk2}) {
+        auto wtx = GetValidSproutReceive(sk, 10, true);
+        auto note = GetSproutNote(sk, wtx, 0, 1);
+
+        mapSproutNoteData_t noteData;
+        JSOutPoint jsoutpt {wtx.GetHash(), 0, 1};
+        SproutNoteData nd {sk.address(), note.nullifier(sk)};
+        noteData[jsoutpt] = nd;
+
+        wtx.SetSproutNoteData(noteData);
+        wallet.LoadWalletTx(wtx);
+        // Reloading a transaction must not duplicate its notes.
+        wallet.LoadWalletTx(wtx);
+    }
+
+    std::vector<SproutNoteEntry> sproutEntries;
+    std::vector<SaplingNoteEntry> saplingEntries;
+    std::vector<OrchardNoteMetadata> orchardEntries;
+    wallet.GetFilteredNotes(sproutEntries, saplingEntries, orchardEntries, std::nullopt, std::nullopt, -1);
+    EXPECT_EQ(2, sproutEntries.size());
+    sproutEntries.clear();
+
+    auto noteFilter = NoteFilter::ForPaymentAddresses(std::vector<libzcash::PaymentAddress>({sk2.address()}));
+    wallet.GetFilteredNotes(sproutEntries, saplingEntries, orchardEntries, noteFilter, std::nullopt, -1);
+    ASSERT_EQ(1, sproutEntries.size());
+    EXPECT_EQ(sk2.address(), sproutEntries[0].address);
+    EXPECT_EQ(0, saplingEntries.size());
+}
+
+TEST(WalletTests, NoteIndexTracksSpends) {
+    SelectParams(CBaseChainParams::TESTNET);
+
+    CWallet wallet(Params());
+    LOCK2(cs_main, wallet.cs_wallet);
+
+    auto sk = libzcash::SproutSpendingKey::random();
+    wallet.AddSproutSpendingKey(sk);
+
+    auto wtx = GetValidSproutReceive(sk, 10, true);
+    auto note = GetSproutNote(sk, wtx, 0, 1);
+    auto nullifier = note.nullifier(sk);
+
+    mapSproutNoteData_t noteData;
+    JSOutPoint jsoutpt {wtx.GetHash(), 0, 1};
+    SproutNoteData nd {sk.address(), nullifier};
+    noteData[jsoutpt] = nd;
+    wtx.SetSproutNoteData(noteData);
+
+    // Fake-mine the note at height 0, and its spend at height 1.
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(wtx));
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    auto blockHash = block.GetHash();
+    CBlockIndex fakeIndex {block};
+    mapBlockIndex.insert(std::make_pair(blockHash, &fakeIndex));
+    chainActive.SetTip(&fakeIndex);
+    wtx.SetMerkleBranch(block);
+    wallet.LoadWalletTx(wtx);
+
+    auto wtx2 = GetValidSproutSpend(sk, note, 5);
+    CBlock block2;
+    block2.vtx.push_back(MakeTransactionRef(wtx2));
+    block2.hashMerkleRoot = BlockMerkleRoot(block2);
+    block2.hashPrevBlock = blockHash;
+    auto blockHash2 = block2.GetHash();
+    CBlockIndex fakeIndex2 {block2};
+    mapBlockIndex.insert(std::make_pair(blockHash2, &fakeIndex2));
+    fakeIndex2.nHeight = 1;
+    fakeIndex2.pprev = &fakeIndex;
+    chainActive.SetTip(&fakeIndex2);
+    wtx2.SetMerkleBranch(block2);
+    wallet.LoadWalletTx(wtx2);
+    wallet.UpdateNoteIndexForBlock(&block2);
+    EXPECT_TRUE(wallet.IsSproutSpent(nullifier, std::nullopt));
+
+    std::vector<SproutNoteEntry> sproutEntries;
+    std::vector<SaplingNoteEntry> saplingEntries;
+    std::vector<OrchardNoteMetadata> orchardEntries;
+    wallet.GetFilteredNotes(sproutEntries, saplingEntries, orchardEntries, std::nullopt, std::nullopt, 0);
+    EXPECT_EQ(0, sproutEntries.size());
+    // The spent note is still indexed for queries that include spent notes,
+    // and for queries as of a height before it was spent.
+    wallet.GetFilteredNotes(sproutEntries, saplingEntries, orchardEntries, std::nullopt, std::nullopt, 0, INT_MAX, false);
+    EXPECT_EQ(1, sproutEntries.size());
+    sproutEntries.clear();
+    wallet.GetFilteredNotes(sproutEntries, saplingEntries, orchardEntries, std::nullopt, 0, 1);
+    EXPECT_EQ(1, sproutEntries.size());
+    sproutEntries.clear();
+
+    // Disconnecting the spend makes the note unspent again.
+    chainActive.SetTip(&fakeIndex);
+    wallet.UpdateNoteIndexForBlock(&block2);
+    EXPECT_FALSE(wallet.IsSproutSpent(nullifier, std::nullopt));
+    wallet.GetFilteredNotes(sproutEntries, saplingEntries, orchardEntries, std::nullopt, std::nullopt, 0);
+    ASSERT_EQ(1, sproutEntries.size());
+    EXPECT_EQ(jsoutpt, sproutEntries[0].jsop);
+
+    // Tear down
+    chainActive.SetTip(NULL);
+    mapBlockIndex.erase(blockHash);
+    mapBlockIndex.erase(blockHash2);
+}
+
 
 TEST(WalletTests, SetSproutNoteAddrsInCWalletTx) {
     auto sk = libzcash::SproutSpendingKey::random();
@@ -722,7 +836,7 @@ TEST(WalletTests, GetConflictedSaplingNotes) {
         // Fake-mine the transaction
         EXPECT_EQ(-1, chainActive.Height());
         CBlock block;
-        block.vtx.push_back(wtx);
+        block.vtx.push_back(MakeTransactionRef(wtx));
         block.hashMerkleRoot = BlockMerkleRoot(block);
         auto blockHash = block.GetHash();
         CBlockIndex fakeIndex {block};
@@ -843,7 +957,7 @@ TEST(WalletTests, GetConflictedOrchardNotes) {
 
     EXPECT_EQ(-1, chainActive.Height());
     CBlock block;
-    block.vtx.push_back(wtx);
+    block.vtx.push_back(MakeTransactionRef(wtx));
     block.hashMerkleRoot = BlockMerkleRoot(block);
     auto blockHash = block.GetHash();
     CBlockIndex fakeIndex {block};
@@ -960,7 +1074,7 @@ TEST(WalletTests, SproutNullifierIsSpent) {
     // Fake-mine the transaction
     EXPECT_EQ(-1, chainActive.Height());
     CBlock block;
-    block.vtx.push_back(wtx2);
+    block.vtx.push_back(MakeTransactionRef(wtx2));
     block.hashMerkleRoot = BlockMerkleRoot(block);
     auto blockHash = block.GetHash();
     CBlockIndex fakeIndex {block};
@@ -1014,7 +1128,7 @@ TEST(WalletTests, SaplingNullifierIsSpent) {
     // Fake-mine the transaction
     EXPECT_EQ(-1, chainActive.Height());
     CBlock block;
-    block.vtx.push_back(wtx);
+    block.vtx.push_back(MakeTransactionRef(wtx));
     block.hashMerkleRoot = BlockMerkleRoot(block);
     auto blockHash = block.GetHash();
     CBlockIndex fakeIndex {block};
@@ -1109,7 +1223,7 @@ TEST(WalletTests, NavigateFromSaplingNullifierToNote) {
     // Fake-mine the transaction
     EXPECT_EQ(-1, chainActive.Height());
     CBlock block;
-    block.vtx.push_back(wtx);
+    block.vtx.push_back(MakeTransactionRef(wtx));
     block.hashMerkleRoot = BlockMerkleRoot(block);
     auto blockHash = block.GetHash();
     CBlockIndex fakeIndex {block};
@@ -1238,7 +1352,7 @@ TEST(WalletTests, SpentSaplingNoteIsFromMe) {
         // Fake-mine the transaction
         EXPECT_EQ(-1, chainActive.Height());
         CBlock block;
-        block.vtx.push_back(wtx);
+        block.vtx.push_back(MakeTransactionRef(wtx));
         block.hashMerkleRoot = BlockMerkleRoot(block);
         auto blockHash = block.GetHash();
         CBlockIndex fakeIndex {block};
@@ -1303,7 +1417,7 @@ TEST(WalletTests, SpentSaplingNoteIsFromMe) {
         // Fake-mine this tx into the next block
         EXPECT_EQ(0, chainActive.Height());
         CBlock block2;
-        block2.vtx.push_back(wtx2);
+        block2.vtx.push_back(MakeTransactionRef(wtx2));
         block2.hashMerkleRoot = BlockMerkleRoot(block2);
         block2.hashPrevBlock = blockHash;
         auto blockHash2 = block2.GetHash();
@@ -1379,7 +1493,7 @@ TEST(WalletTests, CachedWitnessesEmptyChain) {
     EXPECT_FALSE((bool) saplingWitnesses[0]);
 
     CBlock block;
-    block.vtx.push_back(wtx);
+    block.vtx.push_back(MakeTransactionRef(wtx));
     CBlockIndex index(block);
     MerkleFrontiers frontiers;
     const auto& params = Params().GetConsensus();
@@ -1485,7 +1599,7 @@ TEST(WalletTests, CachedWitnessesChainTip) {
         // Second block
         CBlock block2;
         block2.hashPrevBlock = block1.GetHash();
-        block2.vtx.push_back(wtx);
+        block2.vtx.push_back(MakeTransactionRef(wtx));
         CBlockIndex index2(block2);
         index2.nHeight = 2;
         MerkleFrontiers frontiers2 = {
@@ -2099,7 +2213,7 @@ TEST(WalletTests, UpdatedSaplingNoteData) {
     // Fake-mine the transaction
     EXPECT_EQ(-1, chainActive.Height());
     CBlock block;
-    block.vtx.push_back(wtx);
+    block.vtx.push_back(MakeTransactionRef(wtx));
     block.hashMerkleRoot = BlockMerkleRoot(block);
     auto blockHash = block.GetHash();
     CBlockIndex fakeIndex {block};
@@ -2267,7 +2381,7 @@ TEST(WalletTests, MarkAffectedSaplingTransactionsDirty) {
     MerkleFrontiers frontiers;
     SproutMerkleTree sproutTree;
     CBlock block;
-    block.vtx.push_back(wtx);
+    block.vtx.push_back(MakeTransactionRef(wtx));
     block.hashMerkleRoot = BlockMerkleRoot(block);
     auto blockHash = block.GetHash();
     CBlockIndex fakeIndex {block};
@@ -2412,6 +2526,41 @@ TEST(WalletTests, SaplingNoteLocking) {
     EXPECT_FALSE(wallet.IsLockedNote(sop2));
 }
 
+TEST(WalletTests, OrchardNoteLocking) {
+    SelectParams(CBaseChainParams::REGTEST);
+    TestWallet wallet(Params());
+    LOCK(wallet.cs_wallet);
+
+    OrchardOutPoint oop1 {uint256(), 1};
+    OrchardOutPoint oop2 {uint256(), 2};
+
+    // Test selective locking
+    wallet.LockNote(oop1);
+    EXPECT_TRUE(wallet.IsLockedNote(oop1));
+    EXPECT_FALSE(wallet.IsLockedNote(oop2));
+
+    // Test selective unlocking
+    wallet.UnlockNote(oop1);
+    EXPECT_FALSE(wallet.IsLockedNote(oop1));
+
+    // Test multiple locking
+    wallet.LockNote(oop1);
+    wallet.LockNote(oop2);
+    EXPECT_TRUE(wallet.IsLockedNote(oop1));
+    EXPECT_TRUE(wallet.IsLockedNote(oop2));
+
+    // Test list
+    auto v = wallet.ListLockedOrchardNotes();
+    EXPECT_EQ(v.size(), 2);
+    EXPECT_TRUE(std::find(v.begin(), v.end(), oop1) != v.end());
+    EXPECT_TRUE(std::find(v.begin(), v.end(), oop2) != v.end());
+
+    // Test unlock all
+    wallet.UnlockAllOrchardNotes();
+    EXPECT_FALSE(wallet.IsLockedNote(oop1));
+    EXPECT_FALSE(wallet.IsLockedNote(oop2));
+}
+
 TEST(WalletTests, GenerateUnifiedAddress) {
     (void) RegtestActivateSapling();
     TestWallet wallet(Params());
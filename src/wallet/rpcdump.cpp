@@ -79,6 +79,19 @@ std::string DecodeDumpString(const std::string &str) {
     return ret.str();
 }
 
+// Rescan for transactions involving newly-imported transparent scripts. With
+// -addressindexrescan, only the blocks that the address index associates with
+// the scripts are read; otherwise, or if a script is not indexed, the whole
+// chain is scanned.
+static void RescanImportedScripts(const std::vector<CScript>& scripts)
+{
+    if (GetBoolArg("-addressindexrescan", DEFAULT_ADDRESSINDEX_RESCAN) &&
+        pwalletMain->ScanForWalletTransactionsWithAddressIndex(scripts, true).has_value()) {
+        return;
+    }
+    pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true, false);
+}
+
 UniValue importprivkey(const UniValue& params, bool fHelp)
 {
     if (!EnsureWalletIsAvailable(fHelp))
@@ -148,7 +161,7 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
         pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
 
         if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true, false);
+            RescanImportedScripts({GetScriptForDestination(vchAddress)});
         }
     }
 
@@ -238,21 +251,28 @@ UniValue importaddress(const UniValue& params, bool fHelp)
     const auto& chainparams = Params();
     KeyIO keyIO(chainparams);
     CTxDestination dest = keyIO.DecodeDestination(params[0].get_str());
+    std::vector<CScript> importedScripts;
     if (IsValidDestination(dest)) {
         if (fP2SH) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Cannot use the p2sh flag with an address - use a script instead");
         }
         ImportAddress(dest, strLabel);
+        importedScripts.push_back(GetScriptForDestination(dest));
     } else if (IsHex(params[0].get_str())) {
         std::vector<unsigned char> data(ParseHex(params[0].get_str()));
-        ImportScript(CScript(data.begin(), data.end()), strLabel, fP2SH);
+        CScript script(data.begin(), data.end());
+        ImportScript(script, strLabel, fP2SH);
+        importedScripts.push_back(script);
+        if (fP2SH) {
+            importedScripts.push_back(GetScriptForDestination(CScriptID(script)));
+        }
     } else {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Zcash address or script");
     }
 
     if (fRescan)
     {
-        pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true, false);
+        RescanImportedScripts(importedScripts);
         pwalletMain->ReacceptWalletTransactions();
     }
 
@@ -308,7 +328,9 @@ UniValue importpubkey(const UniValue& params, bool fHelp)
 
     if (fRescan)
     {
-        pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true, false);
+        // Outputs paying directly to the public key are not in the address
+        // index; see -addressindexrescan.
+        RescanImportedScripts({GetScriptForDestination(pubKey.GetID())});
         pwalletMain->ReacceptWalletTransactions();
     }
 
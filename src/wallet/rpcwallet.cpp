@@ -3151,6 +3151,20 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             sample_times.push_back(benchmark_create_sapling_spend());
         } else if (benchmarktype == "createsaplingoutput") {
             sample_times.push_back(benchmark_create_sapling_output());
+        } else if (benchmarktype == "createsaplingbundle") {
+            // Number of Sapling spends and outputs in the bundle that we will prove
+            int nSpends = 50;
+            int nOutputs = 2;
+            if (params.size() >= 3) {
+                nSpends = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                nOutputs = params[3].get_int();
+            }
+            if (nSpends < 0 || nOutputs < 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of spends or outputs");
+            }
+            sample_times.push_back(benchmark_create_sapling_bundle(nSpends, nOutputs));
         } else if (benchmarktype == "verifysaplingspend") {
             sample_times.push_back(benchmark_verify_sapling_spend());
         } else if (benchmarktype == "verifysaplingoutput") {
@@ -1723,7 +1723,7 @@ void TestWTxStatus(const Consensus::Params consensusParams, const int delta) {
     auto FakeMine = [&](const int height, bool has_trx) {
         BOOST_CHECK_EQUAL(height, chainActive.Height());
         CBlock block;
-        if (has_trx) block.vtx.push_back(wtx);
+        if (has_trx) block.vtx.push_back(MakeTransactionRef(wtx));
         block.hashMerkleRoot = BlockMerkleRoot(block);
         auto blockHash = block.GetHash();
         CBlockIndex fakeIndex {block};
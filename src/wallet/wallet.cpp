@@ -14,6 +14,7 @@
 #include "consensus/validation.h"
 #include "consensus/consensus.h"
 #include "fs.h"
+#include "index/insightaddressindex.h"
 #include "init.h"
 #include "key_io.h"
 #include "main.h"
@@ -1434,6 +1435,7 @@ void CWallet::ChainTip(const CBlockIndex *pindex,
     const auto& consensus = Params().GetConsensus();
     if (added.has_value()) {
         ChainTipAdded(pindex, pblock, added.value(), true);
+        UpdateNoteIndexForBlock(pblock);
         // Prevent migration transactions from being created when node is syncing after launch,
         // and also when node wakes up from suspension/hibernation and incoming blocks are old.
         // We do not call IsInitialBlockDownload() because during IBD that locks on cs_main,
@@ -1447,6 +1449,7 @@ void CWallet::ChainTip(const CBlockIndex *pindex,
     } else {
         DecrementNoteWitnesses(consensus, pindex);
         UpdateSaplingNullifierNoteMapForBlock(pblock);
+        UpdateNoteIndexForBlock(pblock);
     }
 
     auto hash = tfm::format("%s", pindex->GetBlockHash().ToString());
@@ -2250,139 +2253,162 @@ SpendableInputs CWallet::FindSpendableInputs(
     bool selectOrchard{selector.SelectsOrchard()};
 
     SpendableInputs unspent;
-    for (auto const& [wtxid, wtx] : mapWallet) {
-        bool isCoinbase = wtx.IsCoinBase();
-        auto nDepth = wtx.GetDepthInMainChain(asOfHeight);
-
-        // Filter the transactions before checking for coins
-        if (!CheckFinalTx(wtx)) continue;
-        if (nDepth < 0 || nDepth < minDepth) continue;
-
-        if (selectTransparent && (
-            (
-                // Only select coinbase transparent utxos if spend restrictions are met.
-                isCoinbase &&
-                selector.transparentCoinbasePolicy != TransparentCoinbasePolicy::Disallow &&
-                wtx.GetBlocksToMaturity(asOfHeight) <= 0
-            ) || (
-                // Only select non-coinbase transparent utxos if we are allowed to.
-                !isCoinbase &&
-                selector.transparentCoinbasePolicy != TransparentCoinbasePolicy::Require
-            )
-        )) {
-            for (int i = 0; i < wtx.vout.size(); i++) {
-                const auto& output = wtx.vout[i];
-                isminetype mine = IsMine(output);
 
-                // skip spent utxos
-                if (IsSpent(wtxid, i, asOfHeight)) continue;
-                // skip utxos that don't belong to the wallet
-                if (mine == ISMINE_NO) continue;
-                // skip utxos that for which we don't have the spending keys, if
-                // spending keys are required
-                bool isSpendable = (mine & ISMINE_SPENDABLE) != ISMINE_NO || (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO;
-                if (selector.RequireSpendingKeys() && !isSpendable) continue;
-                // skip locked utxos
-                if (IsLockedCoin(wtxid, i)) continue;
-                // skip zero-valued utxos
-                if (output.nValue == 0) continue;
-
-                // check to see if the coin conforms to the payment source
-                CTxDestination address;
-                bool hasDestination = ExtractDestination(output.scriptPubKey, address);
-                bool isSelectable =
-                    hasDestination && this->SelectorMatchesAddress(selector, address);
-                if (isSelectable) {
-                    unspent.utxos.emplace_back(
-                            &wtx,
-                            i,
-                            hasDestination ? std::optional(address) : std::nullopt,
-                            nDepth,
-                            true,
-                            isCoinbase);
+    // Shielded notes are located through the note index, so a scan of the
+    // whole wallet is only needed when transparent funds are selected.
+    if (selectTransparent) {
+        for (auto const& [wtxid, wtx] : mapWallet) {
+            bool isCoinbase = wtx.IsCoinBase();
+            auto nDepth = wtx.GetDepthInMainChain(asOfHeight);
+
+            // Filter the transactions before checking for coins
+            if (!CheckFinalTx(wtx)) continue;
+            if (nDepth < 0 || nDepth < minDepth) continue;
+
+            if (
+                (
+                    // Only select coinbase transparent utxos if spend restrictions are met.
+                    isCoinbase &&
+                    selector.transparentCoinbasePolicy != TransparentCoinbasePolicy::Disallow &&
+                    wtx.GetBlocksToMaturity(asOfHeight) <= 0
+                ) || (
+                    // Only select non-coinbase transparent utxos if we are allowed to.
+                    !isCoinbase &&
+                    selector.transparentCoinbasePolicy != TransparentCoinbasePolicy::Require
+                )
+            ) {
+                for (int i = 0; i < wtx.vout.size(); i++) {
+                    const auto& output = wtx.vout[i];
+                    isminetype mine = IsMine(output);
+
+                    // skip spent utxos
+                    if (IsSpent(wtxid, i, asOfHeight)) continue;
+                    // skip utxos that don't belong to the wallet
+                    if (mine == ISMINE_NO) continue;
+                    // skip utxos that for which we don't have the spending keys, if
+                    // spending keys are required
+                    bool isSpendable = (mine & ISMINE_SPENDABLE) != ISMINE_NO || (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO;
+                    if (selector.RequireSpendingKeys() && !isSpendable) continue;
+                    // skip locked utxos
+                    if (IsLockedCoin(wtxid, i)) continue;
+                    // skip zero-valued utxos
+                    if (output.nValue == 0) continue;
+
+                    // check to see if the coin conforms to the payment source
+                    CTxDestination address;
+                    bool hasDestination = ExtractDestination(output.scriptPubKey, address);
+                    bool isSelectable =
+                        hasDestination && this->SelectorMatchesAddress(selector, address);
+                    if (isSelectable) {
+                        unspent.utxos.emplace_back(
+                                &wtx,
+                                i,
+                                hasDestination ? std::optional(address) : std::nullopt,
+                                nDepth,
+                                true,
+                                isCoinbase);
+                    }
                 }
             }
         }
+    }
 
-        if (selectSprout) {
-            for (auto const& [jsop, nd] : wtx.mapSproutNoteData) {
-                SproutPaymentAddress pa = nd.address;
+    // Filter the transactions before checking for notes
+    auto filterTx = [&](const CWalletTx& wtx) {
+        if (!CheckFinalTx(wtx)) return false;
+        auto nDepth = wtx.GetDepthInMainChain(asOfHeight);
+        return nDepth >= 0 && nDepth >= minDepth;
+    };
 
-                // skip note which has been spent
-                if (nd.nullifier.has_value() && IsSproutSpent(nd.nullifier.value(), asOfHeight)) continue;
-                // skip notes which don't match the source
-                if (!this->SelectorMatchesAddress(selector, pa)) continue;
-                // skip notes for which we don't have the spending key
-                if (selector.RequireSpendingKeys() && !this->HaveSproutSpendingKey(pa)) continue;
-                // skip locked notes
-                if (IsLockedNote(jsop)) continue;
+    if (selectSprout) {
+        for (const JSOutPoint& jsop : GetIndexedSproutNotes(SproutAddressesForSelector(selector), true, asOfHeight)) {
+            const CWalletTx& wtx = mapWallet.at(jsop.hash);
+            if (!filterTx(wtx)) continue;
 
-                // Get cached decryptor
-                ZCNoteDecryption decryptor;
-                if (!GetNoteDecryptor(pa, decryptor)) {
-                    // Note decryptors are created when the wallet is loaded, so it should always exist
-                    throw std::runtime_error(strprintf(
-                                "Could not find note decryptor for payment address %s",
-                                keyIO.EncodePaymentAddress(pa)));
-                }
+            const SproutNoteData& nd = wtx.mapSproutNoteData.at(jsop);
+            SproutPaymentAddress pa = nd.address;
 
-                // determine amount of funds in the note
-                int i = jsop.js; // Index into CTransaction.vJoinSplit
-                auto hSig = ZCJoinSplit::h_sig(
-                    wtx.vJoinSplit[i].randomSeed,
-                    wtx.vJoinSplit[i].nullifiers,
-                    wtx.joinSplitPubKey);
+            // skip note which has been spent
+            if (nd.nullifier.has_value() && IsSproutSpent(nd.nullifier.value(), asOfHeight)) continue;
+            // skip notes which don't match the source
+            if (!this->SelectorMatchesAddress(selector, pa)) continue;
+            // skip notes for which we don't have the spending key
+            if (selector.RequireSpendingKeys() && !this->HaveSproutSpendingKey(pa)) continue;
+            // skip locked notes
+            if (IsLockedNote(jsop)) continue;
 
-                try {
-                    int j = jsop.n; // Index into JSDescription.ciphertexts
-                    SproutNotePlaintext plaintext = SproutNotePlaintext::decrypt(
-                            decryptor,
-                            wtx.vJoinSplit[i].ciphertexts[j],
-                            wtx.vJoinSplit[i].ephemeralKey,
-                            hSig,
-                            (unsigned char) j);
+            // Get cached decryptor
+            ZCNoteDecryption decryptor;
+            if (!GetNoteDecryptor(pa, decryptor)) {
+                // Note decryptors are created when the wallet is loaded, so it should always exist
+                throw std::runtime_error(strprintf(
+                            "Could not find note decryptor for payment address %s",
+                            keyIO.EncodePaymentAddress(pa)));
+            }
 
-                    unspent.sproutNoteEntries.push_back(SproutNoteEntry {
-                        jsop, pa, plaintext.note(pa), plaintext.memo(), nDepth });
+            // determine amount of funds in the note
+            int i = jsop.js; // Index into CTransaction.vJoinSplit
+            auto hSig = ZCJoinSplit::h_sig(
+                wtx.vJoinSplit[i].randomSeed,
+                wtx.vJoinSplit[i].nullifiers,
+                wtx.joinSplitPubKey);
 
-                } catch (const note_decryption_failed &err) {
-                    // Couldn't decrypt with this spending key
-                    throw std::runtime_error(strprintf(
-                            "Could not decrypt note for payment address %s",
-                            keyIO.EncodePaymentAddress(pa)));
-                } catch (const std::exception &exc) {
-                    // Unexpected failure
-                    throw std::runtime_error(strprintf(
-                            "Error while decrypting note for payment address %s: %s",
-                            keyIO.EncodePaymentAddress(pa), exc.what()));
-                }
+            try {
+                int j = jsop.n; // Index into JSDescription.ciphertexts
+                SproutNotePlaintext plaintext = SproutNotePlaintext::decrypt(
+                        decryptor,
+                        wtx.vJoinSplit[i].ciphertexts[j],
+                        wtx.vJoinSplit[i].ephemeralKey,
+                        hSig,
+                        (unsigned char) j);
+
+                unspent.sproutNoteEntries.push_back(SproutNoteEntry {
+                    jsop, pa, plaintext.note(pa), plaintext.memo(), wtx.GetDepthInMainChain(asOfHeight) });
+
+            } catch (const note_decryption_failed &err) {
+                // Couldn't decrypt with this spending key
+                throw std::runtime_error(strprintf(
+                        "Could not decrypt note for payment address %s",
+                        keyIO.EncodePaymentAddress(pa)));
+            } catch (const std::exception &exc) {
+                // Unexpected failure
+                throw std::runtime_error(strprintf(
+                        "Error while decrypting note for payment address %s: %s",
+                        keyIO.EncodePaymentAddress(pa), exc.what()));
             }
         }
+    }
 
-        if (selectSapling) {
-            for (auto const& [op, nd] : wtx.mapSaplingNoteData) {
-                auto optDecrypted = wtx.DecryptSaplingNote(Params(), op);
+    if (selectSapling) {
+        for (const SaplingOutPoint& op : GetIndexedSaplingNotes(SaplingIvksForSelector(selector), true, asOfHeight)) {
+            const CWalletTx& wtx = mapWallet.at(op.hash);
+            if (!filterTx(wtx)) continue;
 
-                // The transaction would not have entered the wallet unless
-                // its plaintext had been successfully decrypted previously.
-                assert(optDecrypted != std::nullopt);
-                SaplingNotePlaintext notePt;
-                SaplingPaymentAddress pa;
-                std::tie(notePt, pa) = optDecrypted.value();
+            const SaplingNoteData& nd = wtx.mapSaplingNoteData.at(op);
 
-                // skip notes which have been spent
-                if (nd.nullifier.has_value() && IsSaplingSpent(nd.nullifier.value(), asOfHeight)) continue;
-                // skip notes which do not match the source
-                if (!this->SelectorMatchesAddress(selector, pa)) continue;
-                // skip notes if we don't have the spending key
-                if (selector.RequireSpendingKeys() && !this->HaveSaplingSpendingKeyForAddress(pa)) continue;
-                // skip locked notes
-                if (IsLockedNote(op)) continue;
+            // skip notes which have been spent (checked before paying for
+            // note decryption)
+            if (nd.nullifier.has_value() && IsSaplingSpent(nd.nullifier.value(), asOfHeight)) continue;
+            // skip locked notes
+            if (IsLockedNote(op)) continue;
 
-                auto note = notePt.note(nd.ivk).value();
-                unspent.saplingNoteEntries.push_back(SaplingNoteEntry {
-                    op, pa, note, notePt.memo(), nDepth });
-            }
+            auto optDecrypted = wtx.DecryptSaplingNote(Params(), op);
+
+            // The transaction would not have entered the wallet unless
+            // its plaintext had been successfully decrypted previously.
+            assert(optDecrypted != std::nullopt);
+            SaplingNotePlaintext notePt;
+            SaplingPaymentAddress pa;
+            std::tie(notePt, pa) = optDecrypted.value();
+
+            // skip notes which do not match the source
+            if (!this->SelectorMatchesAddress(selector, pa)) continue;
+            // skip notes if we don't have the spending key
+            if (selector.RequireSpendingKeys() && !this->HaveSaplingSpendingKeyForAddress(pa)) continue;
+
+            auto note = notePt.note(nd.ivk).value();
+            unspent.saplingNoteEntries.push_back(SaplingNoteEntry {
+                op, pa, note, notePt.memo(), wtx.GetDepthInMainChain(asOfHeight) });
         }
     }
 
@@ -2433,6 +2459,7 @@ SpendableInputs CWallet::FindSpendableInputs(
                 if (IsOrchardSpent(noteMeta.GetOutPoint(), asOfHeight)) {
                     continue;
                 }
+                if (IsLockedNote(noteMeta.GetOutPoint())) continue;
 
                 auto mit = mapWallet.find(noteMeta.GetOutPoint().hash);
 
@@ -2568,6 +2595,303 @@ void CWallet::AddToSpends(const uint256& wtxid)
     // AddNotesIfInvolvingMe and LoadCaches
 }
 
+void CWallet::AddToNoteIndex(const CWalletTx& wtx)
+{
+    LOCK(cs_wallet);
+    // Notes enter the index as unspent; UpdateNoteIndexWithTx or
+    // UpdateNoteIndex classify them once the wallet's spends are known.
+    for (const auto& [jsop, nd] : wtx.mapSproutNoteData) {
+        auto& entries = mapSproutNotesByAddress[nd.address];
+        if (!entries.spent.count(jsop)) entries.unspent.insert(jsop);
+    }
+    for (const auto& [op, nd] : wtx.mapSaplingNoteData) {
+        auto& entries = mapSaplingNotesByIvk[nd.ivk];
+        if (!entries.spent.count(op)) entries.unspent.insert(op);
+    }
+}
+
+void CWallet::EraseFromNoteIndex(const CWalletTx& wtx)
+{
+    LOCK(cs_wallet);
+    for (const auto& [jsop, nd] : wtx.mapSproutNoteData) {
+        auto it = mapSproutNotesByAddress.find(nd.address);
+        if (it != mapSproutNotesByAddress.end()) {
+            it->second.unspent.erase(jsop);
+            it->second.spent.erase(jsop);
+            if (it->second.unspent.empty() && it->second.spent.empty()) {
+                mapSproutNotesByAddress.erase(it);
+            }
+        }
+    }
+    for (const auto& [op, nd] : wtx.mapSaplingNoteData) {
+        auto it = mapSaplingNotesByIvk.find(nd.ivk);
+        if (it != mapSaplingNotesByIvk.end()) {
+            it->second.unspent.erase(op);
+            it->second.spent.erase(op);
+            if (it->second.unspent.empty() && it->second.spent.empty()) {
+                mapSaplingNotesByIvk.erase(it);
+            }
+        }
+    }
+}
+
+std::optional<int> CWallet::GetNoteSpendHeight(const TxNullifiers& spends, const uint256& nullifier) const
+{
+    AssertLockHeld(cs_main);
+    std::optional<int> spendHeight;
+    auto range = spends.equal_range(nullifier);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto mit = mapWallet.find(it->second);
+        if (mit == mapWallet.end()) continue;
+        const CBlockIndex* pindex = nullptr;
+        int nDepth = mit->second.GetDepthInMainChain(pindex, std::nullopt);
+        if (nDepth < 0) continue;
+        if (nDepth == 0) {
+            if (!spendHeight.has_value()) spendHeight = -1;
+        } else if (!spendHeight.has_value() || spendHeight.value() == -1 || pindex->nHeight < spendHeight.value()) {
+            spendHeight = pindex->nHeight;
+        }
+    }
+    return spendHeight;
+}
+
+void CWallet::UpdateNoteIndexForSproutNote(const JSOutPoint& jsop)
+{
+    AssertLockHeld(cs_wallet);
+    auto mit = mapWallet.find(jsop.hash);
+    if (mit == mapWallet.end()) return;
+    auto ndit = mit->second.mapSproutNoteData.find(jsop);
+    if (ndit == mit->second.mapSproutNoteData.end()) return;
+    const SproutNoteData& nd = ndit->second;
+
+    auto& entries = mapSproutNotesByAddress[nd.address];
+    std::optional<int> spendHeight;
+    if (nd.nullifier.has_value()) {
+        spendHeight = GetNoteSpendHeight(mapTxSproutNullifiers, nd.nullifier.value());
+    }
+    if (spendHeight.has_value()) {
+        entries.unspent.erase(jsop);
+        entries.spent[jsop] = spendHeight.value();
+    } else {
+        entries.spent.erase(jsop);
+        entries.unspent.insert(jsop);
+    }
+}
+
+void CWallet::UpdateNoteIndexForSaplingNote(const SaplingOutPoint& op)
+{
+    AssertLockHeld(cs_wallet);
+    auto mit = mapWallet.find(op.hash);
+    if (mit == mapWallet.end()) return;
+    auto ndit = mit->second.mapSaplingNoteData.find(op);
+    if (ndit == mit->second.mapSaplingNoteData.end()) return;
+    const SaplingNoteData& nd = ndit->second;
+
+    auto& entries = mapSaplingNotesByIvk[nd.ivk];
+    // A note without a witness has no known nullifier, and so cannot be spent.
+    std::optional<int> spendHeight;
+    if (nd.nullifier.has_value()) {
+        spendHeight = GetNoteSpendHeight(mapTxSaplingNullifiers, nd.nullifier.value());
+    }
+    if (spendHeight.has_value()) {
+        entries.unspent.erase(op);
+        entries.spent[op] = spendHeight.value();
+    } else {
+        entries.spent.erase(op);
+        entries.unspent.insert(op);
+    }
+}
+
+void CWallet::UpdateNoteIndexWithTx(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    for (const auto& [jsop, nd] : wtx.mapSproutNoteData) {
+        UpdateNoteIndexForSproutNote(jsop);
+    }
+    for (const auto& [op, nd] : wtx.mapSaplingNoteData) {
+        UpdateNoteIndexForSaplingNote(op);
+    }
+    for (const JSDescription& jsdesc : wtx.vJoinSplit) {
+        for (const uint256& nullifier : jsdesc.nullifiers) {
+            auto it = mapSproutNullifiersToNotes.find(nullifier);
+            if (it != mapSproutNullifiersToNotes.end()) {
+                UpdateNoteIndexForSproutNote(it->second);
+            }
+        }
+    }
+    for (const auto& spend : wtx.GetSaplingSpends()) {
+        auto it = mapSaplingNullifiersToNotes.find(spend.nullifier());
+        if (it != mapSaplingNullifiersToNotes.end()) {
+            UpdateNoteIndexForSaplingNote(it->second);
+        }
+    }
+}
+
+/**
+ * Reclassify the notes received or spent by the wallet transactions in a
+ * block that has been connected or disconnected.
+ */
+void CWallet::UpdateNoteIndexForBlock(const CBlock *pblock)
+{
+    LOCK2(cs_main, cs_wallet);
+
+    for (const CTransactionRef& ptx : pblock->vtx) {
+        auto mit = mapWallet.find(ptx->GetHash());
+        if (mit != mapWallet.end()) {
+            UpdateNoteIndexWithTx(mit->second);
+        }
+    }
+}
+
+void CWallet::UpdateNoteIndex()
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    for (const auto& [hash, wtx] : mapWallet) {
+        for (const auto& [jsop, nd] : wtx.mapSproutNoteData) {
+            UpdateNoteIndexForSproutNote(jsop);
+        }
+        for (const auto& [op, nd] : wtx.mapSaplingNoteData) {
+            UpdateNoteIndexForSaplingNote(op);
+        }
+    }
+}
+
+template<typename OutPoint>
+static void CollectIndexedNotes(
+        const NoteIndexEntries<OutPoint>& entries,
+        bool ignoreSpent,
+        int spentAsOfHeight,
+        std::set<OutPoint>& result)
+{
+    result.insert(entries.unspent.begin(), entries.unspent.end());
+    for (const auto& [op, spendHeight] : entries.spent) {
+        // Notes whose spends are unmined, or mined above the height being
+        // queried (including blocks disconnected since the index was last
+        // updated), are left for the caller to check.
+        if (!ignoreSpent || spendHeight == -1 || spendHeight > spentAsOfHeight) {
+            result.insert(op);
+        }
+    }
+}
+
+std::set<JSOutPoint> CWallet::GetIndexedSproutNotes(
+        const std::optional<std::set<libzcash::SproutPaymentAddress>>& addrs,
+        bool ignoreSpent,
+        const std::optional<int>& asOfHeight) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    int spentAsOfHeight = std::min(chainActive.Height(), asOfHeight.value_or(chainActive.Height()));
+    std::set<JSOutPoint> result;
+    if (addrs.has_value()) {
+        for (const auto& addr : addrs.value()) {
+            auto it = mapSproutNotesByAddress.find(addr);
+            if (it != mapSproutNotesByAddress.end()) {
+                CollectIndexedNotes(it->second, ignoreSpent, spentAsOfHeight, result);
+            }
+        }
+    } else {
+        for (const auto& [addr, entries] : mapSproutNotesByAddress) {
+            CollectIndexedNotes(entries, ignoreSpent, spentAsOfHeight, result);
+        }
+    }
+    return result;
+}
+
+std::set<SaplingOutPoint> CWallet::GetIndexedSaplingNotes(
+        const std::optional<std::set<libzcash::SaplingIncomingViewingKey>>& ivks,
+        bool ignoreSpent,
+        const std::optional<int>& asOfHeight) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    int spentAsOfHeight = std::min(chainActive.Height(), asOfHeight.value_or(chainActive.Height()));
+    std::set<SaplingOutPoint> result;
+    if (ivks.has_value()) {
+        for (const auto& ivk : ivks.value()) {
+            auto it = mapSaplingNotesByIvk.find(ivk);
+            if (it != mapSaplingNotesByIvk.end()) {
+                CollectIndexedNotes(it->second, ignoreSpent, spentAsOfHeight, result);
+            }
+        }
+    } else {
+        for (const auto& [ivk, entries] : mapSaplingNotesByIvk) {
+            CollectIndexedNotes(entries, ignoreSpent, spentAsOfHeight, result);
+        }
+    }
+    return result;
+}
+
+std::optional<std::set<libzcash::SproutPaymentAddress>> CWallet::SproutAddressesForSelector(
+        const ZTXOSelector& selector) const
+{
+    return examine(selector.GetPattern(), match {
+        [&](const libzcash::SproutPaymentAddress& addr) -> std::optional<std::set<SproutPaymentAddress>> {
+            return std::set<SproutPaymentAddress>{addr};
+        },
+        [&](const libzcash::SproutViewingKey& vk) -> std::optional<std::set<SproutPaymentAddress>> {
+            return std::set<SproutPaymentAddress>{vk.address()};
+        },
+        [&](const auto& pattern) -> std::optional<std::set<SproutPaymentAddress>> {
+            // No other pattern matches Sprout notes.
+            return std::set<SproutPaymentAddress>{};
+        },
+    });
+}
+
+std::optional<std::set<libzcash::SaplingIncomingViewingKey>> CWallet::SaplingIvksForSelector(
+        const ZTXOSelector& selector) const
+{
+    typedef std::optional<std::set<SaplingIncomingViewingKey>> IvkSet;
+
+    // Notes received by either the external or the internal (change) part of
+    // a full viewing key are decrypted by the corresponding IVK.
+    auto ivksForDfvk = [](const SaplingDiversifiableFullViewingKey& dfvk) -> IvkSet {
+        return std::set<SaplingIncomingViewingKey>{dfvk.ToIncomingViewingKey(), dfvk.GetChangeIVK()};
+    };
+    auto ivksForUfvk = [&](const std::optional<ZcashdUnifiedFullViewingKey>& ufvk) -> IvkSet {
+        if (!ufvk.has_value()) return std::nullopt;
+        auto saplingKey = ufvk->GetSaplingKey();
+        if (!saplingKey.has_value()) return std::set<SaplingIncomingViewingKey>{};
+        return ivksForDfvk(saplingKey.value());
+    };
+
+    return examine(selector.GetPattern(), match {
+        [&](const libzcash::SaplingPaymentAddress& addr) -> IvkSet {
+            SaplingIncomingViewingKey ivk;
+            if (GetSaplingIncomingViewingKey(addr, ivk)) {
+                return std::set<SaplingIncomingViewingKey>{ivk};
+            }
+            return std::nullopt;
+        },
+        [&](const libzcash::SaplingExtendedFullViewingKey& extfvk) -> IvkSet {
+            return ivksForDfvk(extfvk);
+        },
+        [&](const libzcash::UnifiedAddress& ua) -> IvkSet {
+            auto saplingReceiver = ua.GetSaplingReceiver();
+            if (!saplingReceiver.has_value()) return std::set<SaplingIncomingViewingKey>{};
+            auto meta = GetUFVKMetadataForReceiver(saplingReceiver.value());
+            if (!meta.has_value()) return std::set<SaplingIncomingViewingKey>{};
+            return ivksForUfvk(GetUnifiedFullViewingKey(meta.value().GetUFVKId()));
+        },
+        [&](const libzcash::UnifiedFullViewingKey& ufvk) -> IvkSet {
+            auto saplingKey = ufvk.GetSaplingKey();
+            if (!saplingKey.has_value()) return std::set<SaplingIncomingViewingKey>{};
+            return ivksForDfvk(saplingKey.value());
+        },
+        [&](const AccountZTXOPattern& acct) -> IvkSet {
+            if (!acct.IncludesSapling()) return std::set<SaplingIncomingViewingKey>{};
+            return ivksForUfvk(GetUnifiedFullViewingKeyByAccount(acct.GetAccountId()));
+        },
+        [&](const auto& pattern) -> IvkSet {
+            // Transparent and Sprout patterns never match Sapling notes.
+            return std::set<SaplingIncomingViewingKey>{};
+        },
+    });
+}
+
 void CWallet::ClearNoteWitnessCache()
 {
     LOCK(cs_wallet);
@@ -2790,7 +3114,8 @@ void CWallet::IncrementNoteWitnesses(
 
     // 1) Loop over the block txs and gather the note commitments ordered.
     // If the tx is from this wallet, witness it and append the next block note commitments on top.
-    for (const CTransaction& tx : pblock->vtx) {
+    for (const CTransactionRef& ptx : pblock->vtx) {
+        const CTransaction& tx = *ptx;
         if (tx.vJoinSplit.empty() && tx.GetSaplingSpendsCount() == 0 && tx.GetSaplingOutputsCount() == 0) continue;
         auto hash = tx.GetHash();
         auto txInWallet = mapWallet.find(hash);
@@ -3291,7 +3616,8 @@ void CWallet::UpdateSaplingNullifierNoteMapWithTx(CWalletTx& wtx) {
 void CWallet::UpdateSaplingNullifierNoteMapForBlock(const CBlock *pblock) {
     LOCK(cs_wallet);
 
-    for (const CTransaction& tx : pblock->vtx) {
+    for (const CTransactionRef& ptx : pblock->vtx) {
+        const CTransaction& tx = *ptx;
         auto hash = tx.GetHash();
         bool txIsOurs = mapWallet.count(hash);
         if (txIsOurs) {
@@ -3300,13 +3626,14 @@ void CWallet::UpdateSaplingNullifierNoteMapForBlock(const CBlock *pblock) {
     }
 }
 
-void CWallet::LoadWalletTx(const CWalletTx& wtxIn) {
+void CWallet::LoadWalletTx(CWalletTx wtxIn) {
     uint256 hash = wtxIn.GetHash();
-    mapWallet[hash] = wtxIn;
     CWalletTx& wtx = mapWallet[hash];
+    wtx = std::move(wtxIn);
     wtx.BindWallet(this);
     wtxOrdered.insert(make_pair(wtx.nOrderPos, &wtx));
-    UpdateNullifierNoteMapWithTx(mapWallet[hash]);
+    UpdateNullifierNoteMapWithTx(wtx);
+    AddToNoteIndex(wtx);
     AddToSpends(hash);
 }
 
@@ -3393,6 +3720,13 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, CWalletDB* pwalletdb)
             }
         }
 
+        // Note data is only ever extended, so re-adding is sufficient to
+        // keep the note index in sync with a merged transaction. The
+        // transaction may also have spent, or been mined after spending,
+        // notes that are already indexed.
+        AddToNoteIndex(wtx);
+        UpdateNoteIndexWithTx(wtx);
+
         //// debug print
         LogPrintf("AddToWallet %s  %s%s\n", wtxIn.GetHash().ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
 
@@ -3714,8 +4048,12 @@ void CWallet::EraseFromWallet(const uint256 &hash)
         return;
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
+        auto it = mapWallet.find(hash);
+        if (it != mapWallet.end()) {
+            EraseFromNoteIndex(it->second);
+            mapWallet.erase(it);
             CWalletDB(strWalletFile).EraseTx(hash);
+        }
     }
     return;
 }
@@ -4571,9 +4909,9 @@ void CWallet::WitnessNoteCommitment(std::vector<uint256> commitments,
                 strprintf("Can't read block %d from disk (%s)", pindex->nHeight, pindex->GetBlockHash().GetHex()));
         }
 
-        for (const CTransaction& tx : block.vtx)
+        for (const CTransactionRef& tx : block.vtx)
         {
-            for (const JSDescription& jsdesc : tx.vJoinSplit)
+            for (const JSDescription& jsdesc : tx->vJoinSplit)
             {
                 for (const uint256 &note_commitment : jsdesc.commitments)
                 {
@@ -4709,17 +5047,17 @@ std::optional<int> CWallet::ScanForWalletTransactions(
                 throw std::runtime_error(
                     strprintf("Can't read block %d from disk (%s)", pindex->nHeight, pindex->GetBlockHash().GetHex()));
             }
-            for (CTransaction& tx : block.vtx) {
+            for (const CTransactionRef& tx : block.vtx) {
                 CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
-                ssTx << tx;
+                ssTx << *tx;
                 std::vector<unsigned char> txBytes(ssTx.begin(), ssTx.end());
-                batchScanner.AddTransaction(tx, txBytes, pindex->GetBlockHash(), pindex->nHeight);
+                batchScanner.AddTransaction(*tx, txBytes, pindex->GetBlockHash(), pindex->nHeight);
             }
             batchScanner.Flush();
-            for (CTransaction& tx : block.vtx)
+            for (const CTransactionRef& tx : block.vtx)
             {
-                if (batchScanner.AddToWalletIfInvolvingMe(consensus, tx, &block, pindex->nHeight, fUpdate)) {
-                    myTxHashes.push_back(tx.GetHash());
+                if (batchScanner.AddToWalletIfInvolvingMe(consensus, *tx, &block, pindex->nHeight, fUpdate)) {
+                    myTxHashes.push_back(tx->GetHash());
                     myTransactionsFound++;
                 }
             }
@@ -4768,6 +5106,81 @@ std::optional<int> CWallet::ScanForWalletTransactions(
     return myTransactionsFound;
 }
 
+/**
+ * Scan only the blocks that the address index (-insightexplorer) associates
+ * with the given P2PKH or P2SH scripts, rather than the whole chain. This is
+ * used to rescan for newly-imported transparent addresses.
+ *
+ * Returns std::nullopt if the address index is unavailable or a script is of
+ * a type it does not index; the caller should then fall back to
+ * ScanForWalletTransactions.
+ */
+std::optional<int> CWallet::ScanForWalletTransactionsWithAddressIndex(
+        const std::vector<CScript>& scripts,
+        bool fUpdate)
+{
+    if (!fAddressIndex || !g_addressindex) {
+        return std::nullopt;
+    }
+
+    const auto& consensus = Params().GetConsensus();
+    int myTransactionsFound = 0;
+
+    LOCK2(cs_main, cs_wallet);
+
+    // The address index is written in the background; until it has caught
+    // up with the active chain it would miss transactions.
+    if (!g_addressindex->IsSynced() || g_addressindex->GetBestHeight() != chainActive.Height()) {
+        return std::nullopt;
+    }
+
+    // Blocks are visited in height order, and transactions in block order,
+    // so that funding transactions are seen before the ones spending them.
+    std::map<int, std::set<uint256>> txidsByHeight;
+    for (const CScript& script : scripts) {
+        CScript::ScriptType type = script.GetType();
+        if (type == CScript::UNKNOWN) {
+            return std::nullopt;
+        }
+        std::vector<CAddressIndexDbEntry> addressIndex;
+        if (!GetAddressIndex(script.AddressHash(), type, addressIndex)) {
+            return std::nullopt;
+        }
+        for (const auto& entry : addressIndex) {
+            txidsByHeight[entry.first.blockHeight].insert(entry.first.txhash);
+        }
+    }
+
+    LogPrintf("Rescanning %d blocks from the address index for %d imported scripts\n",
+              txidsByHeight.size(), scripts.size());
+
+    for (const auto& [nHeight, txids] : txidsByHeight) {
+        if (ShutdownRequested()) return std::nullopt;
+
+        CBlockIndex* pindex = chainActive[nHeight];
+        if (pindex == nullptr) {
+            continue;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, consensus)) {
+            throw std::runtime_error(
+                strprintf("Can't read block %d from disk (%s)", pindex->nHeight, pindex->GetBlockHash().GetHex()));
+        }
+        for (const CTransactionRef& ptx : block.vtx) {
+            const CTransaction& tx = *ptx;
+            if (txids.count(tx.GetHash()) == 0) {
+                continue;
+            }
+            if (AddToWalletIfInvolvingMe(consensus, tx, &block, nHeight, TryDecryptShieldedOutputs(tx), fUpdate)) {
+                myTransactionsFound++;
+            }
+        }
+    }
+
+    return myTransactionsFound;
+}
+
 void CWallet::ReacceptWalletTransactions()
 {
     // If transactions aren't being broadcasted, don't let them into local mempool either
@@ -6426,6 +6839,37 @@ std::vector<SaplingOutPoint> CWallet::ListLockedSaplingNotes()
     return vOutputs;
 }
 
+void CWallet::LockNote(const OrchardOutPoint& output)
+{
+    AssertLockHeld(cs_wallet);
+    setLockedOrchardNotes.insert(output);
+}
+
+void CWallet::UnlockNote(const OrchardOutPoint& output)
+{
+    AssertLockHeld(cs_wallet);
+    setLockedOrchardNotes.erase(output);
+}
+
+void CWallet::UnlockAllOrchardNotes()
+{
+    AssertLockHeld(cs_wallet);
+    setLockedOrchardNotes.clear();
+}
+
+bool CWallet::IsLockedNote(const OrchardOutPoint& output) const
+{
+    AssertLockHeld(cs_wallet);
+    return (setLockedOrchardNotes.count(output) > 0);
+}
+
+std::vector<OrchardOutPoint> CWallet::ListLockedOrchardNotes()
+{
+    AssertLockHeld(cs_wallet);
+    std::vector<OrchardOutPoint> vOutputs(setLockedOrchardNotes.begin(), setLockedOrchardNotes.end());
+    return vOutputs;
+}
+
 /** @} */ // end of Actions
 
 class CAffectedKeysVisitor {
@@ -6555,6 +6999,9 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
                                                               "If the transaction is less than 1000 bytes then the fee rate is applied as though it were 1000 bytes. When this option is not set, "
                                                               "the ZIP 317 fee calculation is used."),
                                                             CURRENCY_UNIT));
+    strUsage += HelpMessageOpt("-addressindexrescan", strprintf(_("When -insightexplorer is enabled, rescan for addresses imported with importaddress, importpubkey or importprivkey by "
+                                                                    "looking up their transactions in the address index instead of reading every block. Outputs that pay directly "
+                                                                    "to a public key are not indexed and will not be found (default: %u)"), DEFAULT_ADDRESSINDEX_RESCAN));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the block chain for missing wallet transactions on startup"));
     strUsage += HelpMessageOpt("-salvagewallet", _("Attempt to recover private keys from a corrupt wallet on startup (implies -rescan)"));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf(_("Spend unconfirmed change when sending transactions (default: %u)"), DEFAULT_SPEND_ZEROCONF_CHANGE));
@@ -6716,6 +7163,11 @@ bool CWallet::InitLoadWallet(const CChainParams& params, bool clearWitnessCaches
                 return UIError(_("Prune: last wallet synchronisation goes beyond pruned data. You need to -reindex (download the whole blockchain again in case of pruned node)"));
         }
 
+        // Likewise, the blocks below a snapshot's base are not available.
+        if (pindexSnapshotBase && pindexRescan->nHeight < pindexSnapshotBase->nHeight) {
+            return UIError(_("The chainstate was loaded from a snapshot, and the wallet cannot be synchronised with it. You need to start with -disablewallet, or -reindex (download the whole blockchain again)"));
+        }
+
         // If a rescan would begin at a point before NU5 activation height, reset
         // the Orchard wallet state to empty.
         if (pindexRescan->nHeight <= Params().GetConsensus().GetActivationHeight(Consensus::UPGRADE_NU5)) {
@@ -6760,6 +7212,12 @@ bool CWallet::InitLoadWallet(const CChainParams& params, bool clearWitnessCaches
             }
         }
     }
+    {
+        // Notes were indexed as unspent while the wallet was loaded, before
+        // all of its spends were known.
+        LOCK2(cs_main, walletInstance->cs_wallet);
+        walletInstance->UpdateNoteIndex();
+    }
     walletInstance->SetBroadcastTransactions(GetBoolArg("-walletbroadcast", DEFAULT_WALLETBROADCAST));
 
     pwalletMain = walletInstance;
@@ -6881,7 +7339,7 @@ void CMerkleTx::SetMerkleBranch(const CBlock& block)
 
     // Locate the transaction
     for (nIndex = 0; nIndex < (int)block.vtx.size(); nIndex++)
-        if (block.vtx[nIndex] == *(CTransaction*)this)
+        if (*block.vtx[nIndex] == *(CTransaction*)this)
             break;
     if (nIndex == (int)block.vtx.size())
     {
@@ -7022,117 +7480,136 @@ void CWallet::GetFilteredNotes(
     LOCK2(cs_main, cs_wallet);
 
     KeyIO keyIO(Params());
-    for (auto & p : mapWallet) {
-        CWalletTx wtx = p.second;
 
-        // Filter the transactions before checking for notes
-        if (!CheckFinalTx(wtx) ||
-            wtx.GetDepthInMainChain(asOfHeight) < minDepth ||
-            wtx.GetDepthInMainChain(asOfHeight) > maxDepth) {
-            continue;
+    // Narrow the candidate notes using the note index. Sapling notes are
+    // indexed by IVK; if any filter address has no known IVK, fall back to
+    // examining every indexed Sapling note.
+    std::optional<std::set<SproutPaymentAddress>> sproutFilter;
+    std::optional<std::set<SaplingIncomingViewingKey>> saplingIvkFilter;
+    if (noteFilter.has_value()) {
+        sproutFilter = noteFilter.value().GetSproutAddresses();
+        saplingIvkFilter = std::set<SaplingIncomingViewingKey>();
+        for (const auto& addr : noteFilter.value().GetSaplingAddresses()) {
+            SaplingIncomingViewingKey ivk;
+            if (!GetSaplingIncomingViewingKey(addr, ivk)) {
+                saplingIvkFilter = std::nullopt;
+                break;
+            }
+            saplingIvkFilter.value().insert(ivk);
         }
+    }
 
+    // Filter the transactions before checking for notes
+    auto filterTx = [&](const CWalletTx& wtx) {
+        if (!CheckFinalTx(wtx)) return false;
+        auto nDepth = wtx.GetDepthInMainChain(asOfHeight);
+        if (nDepth < minDepth || nDepth > maxDepth) return false;
         // Filter coinbase transactions that don't have Sapling outputs
         if (wtx.IsCoinBase() && wtx.mapSaplingNoteData.empty() && true/* TODO ORCHARD */) {
-            continue;
+            return false;
         }
+        return true;
+    };
 
-        for (auto & pair : wtx.mapSproutNoteData) {
-            JSOutPoint jsop = pair.first;
-            SproutNoteData nd = pair.second;
-            SproutPaymentAddress pa = nd.address;
+    for (const JSOutPoint& jsop : GetIndexedSproutNotes(sproutFilter, ignoreSpent, asOfHeight)) {
+        const CWalletTx& wtx = mapWallet.at(jsop.hash);
+        if (!filterTx(wtx)) {
+            continue;
+        }
 
-            // skip notes which do not conform to the filter, if supplied
-            if (noteFilter.has_value() && !noteFilter.value().HasSproutAddress(pa)) {
-                continue;
-            }
+        const SproutNoteData& nd = wtx.mapSproutNoteData.at(jsop);
+        SproutPaymentAddress pa = nd.address;
 
-            // skip note which has been spent
-            if (ignoreSpent && nd.nullifier && IsSproutSpent(*nd.nullifier, asOfHeight)) {
-                continue;
-            }
+        // skip note which has been spent
+        if (ignoreSpent && nd.nullifier && IsSproutSpent(*nd.nullifier, asOfHeight)) {
+            continue;
+        }
 
-            // skip notes which cannot be spent
-            if (requireSpendingKey && !HaveSproutSpendingKey(pa)) {
-                continue;
-            }
+        // skip notes which cannot be spent
+        if (requireSpendingKey && !HaveSproutSpendingKey(pa)) {
+            continue;
+        }
 
-            // skip locked notes
-            if (ignoreLocked && IsLockedNote(jsop)) {
-                continue;
-            }
+        // skip locked notes
+        if (ignoreLocked && IsLockedNote(jsop)) {
+            continue;
+        }
 
-            int i = jsop.js; // Index into CTransaction.vJoinSplit
-            int j = jsop.n; // Index into JSDescription.ciphertexts
+        int i = jsop.js; // Index into CTransaction.vJoinSplit
+        int j = jsop.n; // Index into JSDescription.ciphertexts
 
-            // Get cached decryptor
-            ZCNoteDecryption decryptor;
-            if (!GetNoteDecryptor(pa, decryptor)) {
-                // Note decryptors are created when the wallet is loaded, so it should always exist
-                throw std::runtime_error(strprintf("Could not find note decryptor for payment address %s", keyIO.EncodePaymentAddress(pa)));
-            }
+        // Get cached decryptor
+        ZCNoteDecryption decryptor;
+        if (!GetNoteDecryptor(pa, decryptor)) {
+            // Note decryptors are created when the wallet is loaded, so it should always exist
+            throw std::runtime_error(strprintf("Could not find note decryptor for payment address %s", keyIO.EncodePaymentAddress(pa)));
+        }
 
-            // determine amount of funds in the note
-            auto hSig = ZCJoinSplit::h_sig(
-                wtx.vJoinSplit[i].randomSeed,
-                wtx.vJoinSplit[i].nullifiers,
-                wtx.joinSplitPubKey);
-            try {
-                SproutNotePlaintext plaintext = SproutNotePlaintext::decrypt(
-                        decryptor,
-                        wtx.vJoinSplit[i].ciphertexts[j],
-                        wtx.vJoinSplit[i].ephemeralKey,
-                        hSig,
-                        (unsigned char) j);
+        // determine amount of funds in the note
+        auto hSig = ZCJoinSplit::h_sig(
+            wtx.vJoinSplit[i].randomSeed,
+            wtx.vJoinSplit[i].nullifiers,
+            wtx.joinSplitPubKey);
+        try {
+            SproutNotePlaintext plaintext = SproutNotePlaintext::decrypt(
+                    decryptor,
+                    wtx.vJoinSplit[i].ciphertexts[j],
+                    wtx.vJoinSplit[i].ephemeralKey,
+                    hSig,
+                    (unsigned char) j);
 
-                sproutEntriesRet.push_back(SproutNoteEntry {
-                    jsop, pa, plaintext.note(pa), plaintext.memo(), wtx.GetDepthInMainChain(asOfHeight) });
+            sproutEntriesRet.push_back(SproutNoteEntry {
+                jsop, pa, plaintext.note(pa), plaintext.memo(), wtx.GetDepthInMainChain(asOfHeight) });
 
-            } catch (const note_decryption_failed &err) {
-                // Couldn't decrypt with this spending key
-                throw std::runtime_error(strprintf("Could not decrypt note for payment address %s", keyIO.EncodePaymentAddress(pa)));
-            } catch (const std::exception &exc) {
-                // Unexpected failure
-                throw std::runtime_error(strprintf("Error while decrypting note for payment address %s: %s", keyIO.EncodePaymentAddress(pa), exc.what()));
-            }
+        } catch (const note_decryption_failed &err) {
+            // Couldn't decrypt with this spending key
+            throw std::runtime_error(strprintf("Could not decrypt note for payment address %s", keyIO.EncodePaymentAddress(pa)));
+        } catch (const std::exception &exc) {
+            // Unexpected failure
+            throw std::runtime_error(strprintf("Error while decrypting note for payment address %s: %s", keyIO.EncodePaymentAddress(pa), exc.what()));
         }
+    }
 
-        for (auto & pair : wtx.mapSaplingNoteData) {
-            SaplingOutPoint op = pair.first;
-            SaplingNoteData nd = pair.second;
+    for (const SaplingOutPoint& op : GetIndexedSaplingNotes(saplingIvkFilter, ignoreSpent, asOfHeight)) {
+        const CWalletTx& wtx = mapWallet.at(op.hash);
+        if (!filterTx(wtx)) {
+            continue;
+        }
 
-            auto optDecrypted = wtx.DecryptSaplingNote(Params(), op);
+        const SaplingNoteData& nd = wtx.mapSaplingNoteData.at(op);
 
-            // The transaction would not have entered the wallet unless
-            // its plaintext had been successfully decrypted previously.
-            assert(optDecrypted != std::nullopt);
-            SaplingNotePlaintext notePt;
-            SaplingPaymentAddress pa;
-            std::tie(notePt, pa) = optDecrypted.value();
+        // Check spentness before paying for note decryption.
+        if (ignoreSpent && nd.nullifier.has_value() && IsSaplingSpent(nd.nullifier.value(), asOfHeight)) {
+            continue;
+        }
 
-            // skip notes which do not conform to the filter, if supplied
-            if (noteFilter.has_value() && !noteFilter.value().HasSaplingAddress(pa)) {
-                continue;
-            }
+        auto optDecrypted = wtx.DecryptSaplingNote(Params(), op);
 
-            if (ignoreSpent && nd.nullifier.has_value() && IsSaplingSpent(nd.nullifier.value(), asOfHeight)) {
-                continue;
-            }
+        // The transaction would not have entered the wallet unless
+        // its plaintext had been successfully decrypted previously.
+        assert(optDecrypted != std::nullopt);
+        SaplingNotePlaintext notePt;
+        SaplingPaymentAddress pa;
+        std::tie(notePt, pa) = optDecrypted.value();
 
-            // skip notes which cannot be spent
-            if (requireSpendingKey && !HaveSaplingSpendingKeyForAddress(pa)) {
-                continue;
-            }
+        // skip notes which do not conform to the filter, if supplied
+        if (noteFilter.has_value() && !noteFilter.value().HasSaplingAddress(pa)) {
+            continue;
+        }
 
-            // skip locked notes
-            if (ignoreLocked && IsLockedNote(op)) {
-                continue;
-            }
+        // skip notes which cannot be spent
+        if (requireSpendingKey && !HaveSaplingSpendingKeyForAddress(pa)) {
+            continue;
+        }
 
-            auto note = notePt.note(nd.ivk).value();
-            saplingEntriesRet.push_back(SaplingNoteEntry {
-                op, pa, note, notePt.memo(), wtx.GetDepthInMainChain(asOfHeight) });
+        // skip locked notes
+        if (ignoreLocked && IsLockedNote(op)) {
+            continue;
         }
+
+        auto note = notePt.note(nd.ivk).value();
+        saplingEntriesRet.push_back(SaplingNoteEntry {
+            op, pa, note, notePt.memo(), wtx.GetDepthInMainChain(asOfHeight) });
     }
 
     std::vector<OrchardNoteMetadata> orchardNotes;
@@ -7161,6 +7638,11 @@ void CWallet::GetFilteredNotes(
             continue;
         }
 
+        // skip locked notes
+        if (ignoreLocked && IsLockedNote(noteMeta.GetOutPoint())) {
+            continue;
+        }
+
         auto wtx = GetWalletTx(noteMeta.GetOutPoint().hash);
         if (wtx) {
             auto confirmations = wtx->GetDepthInMainChain(asOfHeight);
@@ -67,6 +67,8 @@ static const CAmount MIN_CHANGE = CENT;
 //! Default for -spendzeroconfchange
 static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
 static const bool DEFAULT_WALLETBROADCAST = true;
+//! Default for -addressindexrescan
+static const bool DEFAULT_ADDRESSINDEX_RESCAN = false;
 //! Size of witness cache
 //  Should be large enough that we can expect not to reorg beyond our cache
 //  unless there is some exceptional network disruption.
@@ -1212,6 +1214,21 @@ enum class AccountChangeAddressFailure {
     NoSuchAccount,
 };
 
+/**
+ * The notes received at one key of the wallet's note index. A note is moved to
+ * `spent` once a non-conflicted wallet transaction spends its nullifier, and
+ * back to `unspent` if that spend is disconnected or conflicted.
+ */
+template<typename OutPoint>
+struct NoteIndexEntries {
+    std::set<OutPoint> unspent;
+    /**
+     * Spent notes, mapped to the height of the block containing their
+     * earliest mined spend, or -1 if all of their spends are unmined.
+     */
+    std::map<OutPoint, int> spent;
+};
+
 /**
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
@@ -1269,11 +1286,76 @@ private:
     std::vector<CTransaction> pendingSaplingMigrationTxs;
     AsyncRPCOperationId saplingMigrationOperationId;
 
+    /**
+     * Secondary index over the shielded notes held in mapWallet, so that note
+     * selection only has to visit the notes that could match a query rather
+     * than every transaction in the wallet. Sprout notes are keyed by their
+     * payment address and Sapling notes by the IVK that decrypted them.
+     *
+     * Spentness is tracked as of the chain tip, so that queries for unspent
+     * notes do not have to visit every historical note. Depth, locks and
+     * spentness as of `asOfHeight` still have to be checked by the caller.
+     */
+    std::map<libzcash::SproutPaymentAddress, NoteIndexEntries<JSOutPoint>> mapSproutNotesByAddress;
+    std::map<libzcash::SaplingIncomingViewingKey, NoteIndexEntries<SaplingOutPoint>> mapSaplingNotesByIvk;
+
     void AddToTransparentSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSproutSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    void AddToNoteIndex(const CWalletTx& wtx);
+    void EraseFromNoteIndex(const CWalletTx& wtx);
+
+    /**
+     * Returns the height of the block containing the earliest mined
+     * non-conflicted spend of `nullifier` in `spends`, -1 if its only such
+     * spends are unmined, or `std::nullopt` if it is unspent.
+     */
+    std::optional<int> GetNoteSpendHeight(const TxNullifiers& spends, const uint256& nullifier) const;
+    void UpdateNoteIndexForSproutNote(const JSOutPoint& jsop);
+    void UpdateNoteIndexForSaplingNote(const SaplingOutPoint& op);
+    /**
+     * Moves the notes received by `wtx`, and the notes that it spends, between
+     * the unspent and spent parts of the note index.
+     */
+    void UpdateNoteIndexWithTx(const CWalletTx& wtx);
+
+    /**
+     * Returns the indexed Sprout notes sent to any of `addrs`, or every indexed
+     * Sprout note if `addrs` is `std::nullopt`. Results are in outpoint order.
+     * If `ignoreSpent` is set, notes spent as of `asOfHeight` (or the chain
+     * tip) in a mined block are left out.
+     */
+    std::set<JSOutPoint> GetIndexedSproutNotes(
+            const std::optional<std::set<libzcash::SproutPaymentAddress>>& addrs,
+            bool ignoreSpent,
+            const std::optional<int>& asOfHeight) const;
+    /**
+     * Returns the indexed Sapling notes decrypted by any of `ivks`, or every
+     * indexed Sapling note if `ivks` is `std::nullopt`, with spent notes left
+     * out as for `GetIndexedSproutNotes`. Results are in outpoint order.
+     */
+    std::set<SaplingOutPoint> GetIndexedSaplingNotes(
+            const std::optional<std::set<libzcash::SaplingIncomingViewingKey>>& ivks,
+            bool ignoreSpent,
+            const std::optional<int>& asOfHeight) const;
+
+    /**
+     * Returns the Sprout payment addresses that notes selected by `selector`
+     * can have been sent to, or `std::nullopt` if they cannot be determined
+     * without examining each note.
+     */
+    std::optional<std::set<libzcash::SproutPaymentAddress>> SproutAddressesForSelector(
+            const ZTXOSelector& selector) const;
+    /**
+     * Returns a superset of the Sapling IVKs that can have decrypted notes
+     * selected by `selector`, or `std::nullopt` if they cannot be determined
+     * without examining each note.
+     */
+    std::optional<std::set<libzcash::SaplingIncomingViewingKey>> SaplingIvksForSelector(
+            const ZTXOSelector& selector) const;
+
 public:
     /*
      * Size of the incremental witness cache for the notes in our wallet.
@@ -1534,6 +1616,7 @@ public:
     std::set<COutPoint> setLockedCoins;
     std::set<JSOutPoint> setLockedSproutNotes;
     std::set<SaplingOutPoint> setLockedSaplingNotes;
+    std::set<OrchardOutPoint> setLockedOrchardNotes;
 
     int64_t nTimeFirstKey;
 
@@ -1671,6 +1754,12 @@ public:
     void UnlockAllSaplingNotes();
     std::vector<SaplingOutPoint> ListLockedSaplingNotes();
 
+    bool IsLockedNote(const OrchardOutPoint& output) const;
+    void LockNote(const OrchardOutPoint& output);
+    void UnlockNote(const OrchardOutPoint& output);
+    void UnlockAllOrchardNotes();
+    std::vector<OrchardOutPoint> ListLockedOrchardNotes();
+
     /**
      * keystore implementation
      * Generate a new key
@@ -1896,7 +1985,10 @@ public:
     void UpdateNullifierNoteMapWithTx(const CWalletTx& wtx);
     void UpdateSaplingNullifierNoteMapWithTx(CWalletTx& wtx);
     void UpdateSaplingNullifierNoteMapForBlock(const CBlock* pblock);
-    void LoadWalletTx(const CWalletTx& wtxIn);
+    void UpdateNoteIndexForBlock(const CBlock* pblock);
+    /** Classifies every note in the note index; used once the wallet is loaded. */
+    void UpdateNoteIndex();
+    void LoadWalletTx(CWalletTx wtxIn);
     bool AddToWallet(const CWalletTx& wtxIn, CWalletDB* pwalletdb);
     BatchScanner* GetBatchScanner();
     bool AddToWalletIfInvolvingMe(
@@ -1916,6 +2008,9 @@ public:
         CBlockIndex* pindexStart,
         bool fUpdate,
         bool isInitScan);
+    std::optional<int> ScanForWalletTransactionsWithAddressIndex(
+        const std::vector<CScript>& scripts,
+        bool fUpdate);
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime);
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime);
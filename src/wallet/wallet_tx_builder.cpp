@@ -1129,7 +1129,6 @@ TransactionBuilderResult TransactionEffects::ApproveAndBuild(
     return result;
 }
 
-// TODO: Lock Orchard notes (#6226)
 void TransactionEffects::LockSpendable(CWallet& wallet) const
 {
     LOCK2(cs_main, wallet.cs_wallet);
@@ -1143,9 +1142,11 @@ void TransactionEffects::LockSpendable(CWallet& wallet) const
     for (auto note : spendable.saplingNoteEntries) {
         wallet.LockNote(note.op);
     }
+    for (const auto& note : spendable.orchardNoteMetadata) {
+        wallet.LockNote(note.GetOutPoint());
+    }
 }
 
-// TODO: Unlock Orchard notes (#6226)
 void TransactionEffects::UnlockSpendable(CWallet& wallet) const
 {
     LOCK2(cs_main, wallet.cs_wallet);
@@ -1159,4 +1160,7 @@ void TransactionEffects::UnlockSpendable(CWallet& wallet) const
     for (auto note : spendable.saplingNoteEntries) {
         wallet.UnlockNote(note.op);
     }
+    for (const auto& note : spendable.orchardNoteMetadata) {
+        wallet.UnlockNote(note.GetOutPoint());
+    }
 }
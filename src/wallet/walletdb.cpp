@@ -24,6 +24,7 @@
 #include <boost/thread.hpp>
 #include <atomic>
 #include <string>
+#include <thread>
 
 using namespace std;
 
@@ -361,6 +362,118 @@ public:
     }
 };
 
+/**
+ * Decode and check a "tx" record whose type has already been read from ssKey.
+ * This does not touch the wallet, so it is safe to call from multiple threads.
+ */
+static bool
+DecodeWalletTx(CDataStream& ssKey, CDataStream& ssValue, CWalletTx& wtx,
+               bool& fUpgraded, string& strErr)
+{
+    uint256 hash;
+    ssKey >> hash;
+    ssValue >> wtx;
+    CValidationState state;
+    auto verifier = ProofVerifier::Strict();
+    if (!(
+        CheckTransaction(wtx, state, verifier) &&
+        (wtx.GetHash() == hash) &&
+        state.IsValid())
+    ) {
+        return false;
+    }
+
+    // Undo serialize changes in 31600
+    if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+    {
+        if (!ssValue.empty())
+        {
+            char fTmp;
+            char fUnused;
+            std::string unused_string;
+            ssValue >> fTmp >> fUnused >> unused_string;
+            strErr = strprintf("LoadWallet() upgrading tx ver=%d %d %s",
+                               wtx.fTimeReceivedIsTxTime, fTmp, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = fTmp;
+        }
+        else
+        {
+            strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = 0;
+        }
+        fUpgraded = true;
+    }
+    return true;
+}
+
+static void
+LoadDecodedWalletTx(CWallet* pwallet, CWalletTx&& wtx, bool fUpgraded, CWalletScanState& wss)
+{
+    if (fUpgraded)
+        wss.vWalletUpgrade.push_back(wtx.GetHash());
+
+    if (wtx.nOrderPos == -1)
+        wss.fAnyUnordered = true;
+
+    pwallet->LoadWalletTx(std::move(wtx));
+}
+
+/**
+ * A "tx" record read from the wallet database during LoadWallet, along with
+ * the result of decoding it.
+ */
+struct CWalletTxRecord
+{
+    CDataStream ssKey;
+    CDataStream ssValue;
+    CWalletTx wtx;
+    bool fValid;
+    bool fUpgraded;
+    string strErr;
+
+    CWalletTxRecord(CDataStream&& ssKeyIn, CDataStream&& ssValueIn) :
+        ssKey(std::move(ssKeyIn)), ssValue(std::move(ssValueIn)), fValid(false), fUpgraded(false) {}
+
+    void Decode()
+    {
+        try {
+            string strType;
+            ssKey >> strType;
+            fValid = DecodeWalletTx(ssKey, ssValue, wtx, fUpgraded, strErr);
+        } catch (...) {
+            fValid = false;
+        }
+        // The raw record is no longer needed; release it to bound peak memory.
+        ssKey = CDataStream(SER_DISK, CLIENT_VERSION);
+        ssValue = CDataStream(SER_DISK, CLIENT_VERSION);
+    }
+};
+
+/**
+ * Decode wallet transaction records on all available cores. Deserializing
+ * transactions (including their note witness caches) and running
+ * CheckTransaction dominate the time taken to load large wallets.
+ */
+static void DecodeWalletTxRecords(std::vector<CWalletTxRecord>& records)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < records.size(); i = next++) {
+            records[i].Decode();
+        }
+    };
+
+    size_t nThreads = std::min<size_t>(std::max(GetNumCores(), 1), records.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
 bool
 ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
              CWalletScanState &wss, string& strType, string& strErr)
@@ -386,45 +499,12 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         }
         else if (strType == "tx")
         {
-            uint256 hash;
-            ssKey >> hash;
             CWalletTx wtx;
-            ssValue >> wtx;
-            CValidationState state;
-            auto verifier = ProofVerifier::Strict();
-            if (!(
-                CheckTransaction(wtx, state, verifier) &&
-                (wtx.GetHash() == hash) &&
-                state.IsValid())
-            ) {
+            bool fUpgraded = false;
+            if (!DecodeWalletTx(ssKey, ssValue, wtx, fUpgraded, strErr)) {
                 return false;
             }
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
-            {
-                if (!ssValue.empty())
-                {
-                    char fTmp;
-                    char fUnused;
-                    std::string unused_string;
-                    ssValue >> fTmp >> fUnused >> unused_string;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d %s",
-                                       wtx.fTimeReceivedIsTxTime, fTmp, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                }
-                else
-                {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
-
-            if (wtx.nOrderPos == -1)
-                wss.fAnyUnordered = true;
-
-            pwallet->LoadWalletTx(wtx);
+            LoadDecodedWalletTx(pwallet, std::move(wtx), fUpgraded, wss);
         }
         else if (strType == "watchs")
         {
@@ -919,6 +999,19 @@ static bool IsKeyType(string strType)
             strType == "mkey" || strType == "ckey");
 }
 
+static bool IsTxRecord(const CDataStream& ssKey)
+{
+    try {
+        CDataStream ssType(ssKey);
+        string strType;
+        ssType >> strType;
+        return strType == "tx";
+    } catch (...) {
+        // Let ReadKeyValue report the malformed key.
+        return false;
+    }
+}
+
 DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
 {
     pwallet->vchDefaultKey = CPubKey();
@@ -944,6 +1037,10 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             return DB_CORRUPT;
         }
 
+        // Transaction records are collected and decoded in parallel once
+        // the cursor has been exhausted.
+        std::vector<CWalletTxRecord> vTxRecords;
+
         while (true)
         {
             // Read next record
@@ -958,6 +1055,11 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
                 return DB_CORRUPT;
             }
 
+            if (IsTxRecord(ssKey)) {
+                vTxRecords.emplace_back(std::move(ssKey), std::move(ssValue));
+                continue;
+            }
+
             // Try to be tolerant of single corrupt records:
             string strType, strErr;
             if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr))
@@ -984,6 +1086,21 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
         }
         pcursor->close();
 
+        DecodeWalletTxRecords(vTxRecords);
+        for (auto& record : vTxRecords) {
+            if (record.fValid) {
+                LoadDecodedWalletTx(pwallet, std::move(record.wtx), record.fUpgraded, wss);
+            } else {
+                // Rescan if there is a bad transaction record:
+                fNoncriticalErrors = true;
+                LogPrintf("LoadWallet: Malformed transaction data encountered; starting with -rescan.");
+                SoftSetBoolArg("-rescan", true);
+            }
+            if (!record.strErr.empty())
+                LogPrintf("LoadWallet: %s", record.strErr);
+        }
+        vTxRecords.clear();
+
         // Load unified address/account/key caches based on what was loaded
         if (!pwallet->LoadCaches()) {
             // We can be more permissive of certain kinds of failures during
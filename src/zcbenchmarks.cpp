@@ -342,7 +342,7 @@ double benchmark_increment_sprout_note_witnesses(size_t nTxs)
     for (int i = 0; i < nTxs; ++i) {
         auto wtx = CreateSproutTxWithNoteData(sproutSpendingKey);
         wallet.LoadWalletTx(wtx);
-        block1.vtx.push_back(wtx);
+        block1.vtx.push_back(MakeTransactionRef(wtx));
     }
 
     CBlockIndex index1(block1);
@@ -357,7 +357,7 @@ double benchmark_increment_sprout_note_witnesses(size_t nTxs)
     {
         auto sproutTx = CreateSproutTxWithNoteData(sproutSpendingKey);
         wallet.LoadWalletTx(sproutTx);
-        block2.vtx.push_back(sproutTx);
+        block2.vtx.push_back(MakeTransactionRef(sproutTx));
     }
 
     CBlockIndex index2(block2);
@@ -401,7 +401,7 @@ double benchmark_increment_sapling_note_witnesses(size_t nTxs)
     for (int i = 0; i < nTxs; ++i) {
         auto wtx = CreateSaplingTxWithNoteData(Params(), wallet, saplingSpendingKey);
         wallet.LoadWalletTx(wtx);
-        block1.vtx.push_back(wtx);
+        block1.vtx.push_back(MakeTransactionRef(wtx));
     }
 
     CBlockIndex index1(block1);
@@ -416,7 +416,7 @@ double benchmark_increment_sapling_note_witnesses(size_t nTxs)
     {
         auto saplingTx = CreateSaplingTxWithNoteData(Params(), wallet, saplingSpendingKey);
         wallet.LoadWalletTx(saplingTx);
-        block1.vtx.push_back(saplingTx);
+        block1.vtx.push_back(MakeTransactionRef(saplingTx));
     }
 
     CBlockIndex index2(block2);
@@ -810,6 +810,62 @@ double benchmark_create_sapling_output()
     return t;
 }
 
+double benchmark_create_sapling_bundle(size_t nSpends, size_t nOutputs)
+{
+    auto extsk = GetTestMasterSaplingSpendingKey();
+    auto address = extsk.ToXFVK().DefaultAddress();
+
+    CDataStream ssExtSk(SER_NETWORK, PROTOCOL_VERSION);
+    ssExtSk << extsk;
+
+    // Place every spent note in the same tree, so that all spends share an anchor.
+    SaplingMerkleTree tree;
+    std::vector<SaplingNote> notes;
+    std::vector<SaplingWitness> witnesses;
+    for (size_t i = 0; i < nSpends; i++) {
+        SaplingNote note(address, 1000, libzcash::Zip212Enabled::BeforeZip212);
+        auto cmu = note.cmu().value();
+        tree.append(cmu);
+        for (auto& witness : witnesses) {
+            witness.append(cmu);
+        }
+        witnesses.push_back(tree.witness());
+        notes.push_back(note);
+    }
+    auto anchor = tree.root().GetRawBytes();
+
+    auto nHeight = Params().GetConsensus().vUpgrades[Consensus::UPGRADE_SAPLING].nActivationHeight;
+    auto builder = sapling::new_builder(*Params().RustNetwork(), nHeight, anchor, false);
+    for (size_t i = 0; i < nSpends; i++) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << witnesses[i].path();
+        std::array<unsigned char, 1065> witnessChars;
+        std::move(ss.begin(), ss.end(), witnessChars.begin());
+
+        builder->add_spend(
+            {reinterpret_cast<uint8_t*>(ssExtSk.data()), ssExtSk.size()},
+            address.GetRawBytes(),
+            notes[i].value(),
+            notes[i].rcm().GetRawBytes(),
+            witnessChars);
+    }
+    for (size_t i = 0; i < nOutputs; i++) {
+        builder->add_recipient(
+            uint256().GetRawBytes(),
+            address.GetRawBytes(),
+            1,
+            libzcash::Memo::ToBytes(std::nullopt));
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+
+    auto result = sapling::build_bundle(std::move(builder));
+
+    double t = timer_stop(tv_start);
+    return t;
+}
+
 // Verify Sapling spend from testnet
 // txid: abbd823cbd3d4e3b52023599d81a96b74817e95ce5bb58354f979156bd22ecc8
 // position: 0
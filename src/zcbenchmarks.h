@@ -24,6 +24,7 @@ extern double benchmark_loadwallet();
 extern double benchmark_listunspent();
 extern double benchmark_create_sapling_spend();
 extern double benchmark_create_sapling_output();
+extern double benchmark_create_sapling_bundle(size_t nSpends, size_t nOutputs);
 extern double benchmark_verify_sapling_spend();
 extern double benchmark_verify_sapling_output();
 
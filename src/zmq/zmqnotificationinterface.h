@@ -8,6 +8,7 @@
 
 #include "validationinterface.h"
 #include "consensus/validation.h"
+#include "sync.h"
 #include <string>
 #include <map>
 
@@ -29,12 +30,28 @@ protected:
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock, const int nHeight);
     void UpdatedBlockTip(const CBlockIndex *pindex);
     void BlockChecked(const CBlock& block, const CValidationState& state);
+    void BlockConnected(const CBlockIndex *pindex);
+    void BlockDisconnected(const CBlockIndex *pindex);
+    void TransactionAddedToMempool(const CTransaction &tx, uint64_t nMempoolSequence);
+    void TransactionRemovedFromMempool(const CTransaction &tx, uint64_t nMempoolSequence);
 
 private:
     CZMQNotificationInterface();
 
+    //! Call func on each notifier, and shut down the notifiers for which it fails
+    template <typename Function>
+    void TryForEachAndRemoveFailed(const Function& func);
+
     void *pcontext;
+    /**
+     * Validation callbacks arrive from several threads, some holding cs_main
+     * or mempool.cs, so the notifiers are used under cs_notifiers and must
+     * not take cs_main themselves.
+     */
+    CCriticalSection cs_notifiers;
     std::list<CZMQAbstractNotifier*> notifiers;
+    size_t nMaxQueue;
+    unsigned int nRawTxBatch;
 };
 
 #endif // BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
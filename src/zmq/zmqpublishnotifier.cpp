@@ -6,8 +6,17 @@
 #include "chainparams.h"
 #include "zmqpublishnotifier.h"
 #include "main.h"
+#include "metrics.h"
 #include "util/system.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
 static const char *MSG_HASHBLOCK = "hashblock";
@@ -15,18 +24,16 @@ static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 static const char *MSG_CHECKEDBLOCK = "checkedblock";
+static const char *MSG_SEQUENCE  = "sequence";
 
 // Internal function to send multipart message
-static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
+static int zmq_send_multipart(void *sock, const std::vector<std::pair<const void*, size_t>>& parts)
 {
-    va_list args;
-    va_start(args, size);
-
-    while (1)
+    for (size_t i = 0; i < parts.size(); i++)
     {
         zmq_msg_t msg;
 
-        int rc = zmq_msg_init_size(&msg, size);
+        int rc = zmq_msg_init_size(&msg, parts[i].second);
         if (rc != 0)
         {
             zmqError("Unable to initialize ZMQ msg");
@@ -34,11 +41,9 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
         }
 
         void *buf = zmq_msg_data(&msg);
-        memcpy(buf, data, size);
+        memcpy(buf, parts[i].first, parts[i].second);
 
-        data = va_arg(args, const void*);
-
-        rc = zmq_msg_send(&msg, sock, data ? ZMQ_SNDMORE : 0);
+        rc = zmq_msg_send(&msg, sock, i + 1 < parts.size() ? ZMQ_SNDMORE : 0);
         if (rc == -1)
         {
             zmqError("Unable to send ZMQ msg");
@@ -47,13 +52,150 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
         }
 
         zmq_msg_close(&msg);
+    }
+    return 0;
+}
+
+struct CZMQQueuedMessage
+{
+    void *psocket;
+    const char *command;
+    std::vector<unsigned char> data;
+    uint32_t nSequence;
+};
+
+/**
+ * Owns the queue of messages waiting to be published, and the thread that
+ * publishes them. ZMQ sockets must only be used from one thread at a time, so
+ * after StartZMQPublisher only the publisher thread sends on them.
+ */
+class CZMQPublisher
+{
+private:
+    std::mutex cs;
+    std::condition_variable cond;
+    std::deque<CZMQQueuedMessage> queue;
+    std::thread thread;
+    bool fRunning = false;
+    //! Socket the publisher thread is sending on, with cs released
+    void *psocketSending = nullptr;
+    size_t nMaxQueue = DEFAULT_ZMQ_QUEUE_SIZE;
+    unsigned int nRawTxBatch = DEFAULT_ZMQ_RAWTX_BATCH;
+
+    void ThreadPublish();
+
+public:
+    void Start(size_t nMaxQueueIn, unsigned int nRawTxBatchIn);
+    void Stop();
+    //! Queue msg, giving it the next sequence number from *pnSequence
+    void Push(CZMQQueuedMessage&& msg, uint32_t *pnSequence);
+    //! Drop the messages queued for psocket, and wait until it is not in use
+    void ForgetSocket(void *psocket);
+};
+
+static CZMQPublisher zmqPublisher;
+
+void CZMQPublisher::Start(size_t nMaxQueueIn, unsigned int nRawTxBatchIn)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    assert(!fRunning);
+    nMaxQueue = std::max(nMaxQueueIn, (size_t)1);
+    nRawTxBatch = std::max(nRawTxBatchIn, 1u);
+    fRunning = true;
+    thread = std::thread(&TraceThread<std::function<void()>>, "zmqpub", std::function<void()>([this] { ThreadPublish(); }));
+}
+
+void CZMQPublisher::Stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (!fRunning)
+            return;
+        fRunning = false;
+    }
+    cond.notify_all();
+    thread.join();
+}
 
-        if (!data)
+void CZMQPublisher::Push(CZMQQueuedMessage&& msg, uint32_t *pnSequence)
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        // Sequence numbers are assigned in queue order, and are used up even
+        // if the message is dropped, so that subscribers can detect the gap.
+        msg.nSequence = (*pnSequence)++;
+        if (!fRunning)
+            return;
+        if (queue.size() >= nMaxQueue) {
+            LogPrint("zmq", "zmq: Queue full, dropping %s message %d\n", msg.command, msg.nSequence);
+            MetricsIncrementCounter("zcash.zmq.dropped");
+            return;
+        }
+        queue.push_back(std::move(msg));
+    }
+    cond.notify_all();
+}
+
+void CZMQPublisher::ForgetSocket(void *psocket)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    queue.erase(
+        std::remove_if(queue.begin(), queue.end(),
+            [psocket](const CZMQQueuedMessage& msg) { return msg.psocket == psocket; }),
+        queue.end());
+    cond.wait(lock, [this, psocket] { return psocketSending != psocket; });
+}
+
+void CZMQPublisher::ThreadPublish()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        // Keep publishing after Stop until the queue is drained.
+        cond.wait(lock, [this] { return !fRunning || !queue.empty(); });
+        if (queue.empty())
             break;
 
-        size = va_arg(args, size_t);
+        std::vector<CZMQQueuedMessage> batch;
+        batch.push_back(std::move(queue.front()));
+        queue.pop_front();
+        if (nRawTxBatch > 1 && strcmp(batch[0].command, MSG_RAWTX) == 0) {
+            while (batch.size() < nRawTxBatch &&
+                   !queue.empty() &&
+                   queue.front().psocket == batch[0].psocket &&
+                   strcmp(queue.front().command, MSG_RAWTX) == 0) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+        psocketSending = batch[0].psocket;
+        lock.unlock();
+
+        /* send the command, the data of each message, and the LE 4byte
+           sequence number of the first message */
+        std::vector<std::pair<const void*, size_t>> parts;
+        parts.emplace_back(batch[0].command, strlen(batch[0].command));
+        for (const CZMQQueuedMessage& msg : batch)
+            parts.emplace_back(msg.data.data(), msg.data.size());
+        unsigned char msgseq[sizeof(uint32_t)];
+        WriteLE32(&msgseq[0], batch[0].nSequence);
+        parts.emplace_back(msgseq, sizeof(msgseq));
+        if (zmq_send_multipart(batch[0].psocket, parts) == -1)
+            LogPrint("zmq", "zmq: Failed to publish %s message %d\n", batch[0].command, batch[0].nSequence);
+
+        lock.lock();
+        psocketSending = nullptr;
+        cond.notify_all();
     }
-    return 0;
+}
+
+void StartZMQPublisher(size_t nMaxQueue, unsigned int nRawTxBatch)
+{
+    zmqPublisher.Start(nMaxQueue, nRawTxBatch);
+}
+
+void StopZMQPublisher()
+{
+    zmqPublisher.Stop();
 }
 
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
@@ -116,6 +258,7 @@ void CZMQAbstractPublishNotifier::Shutdown()
 
     if (count == 1)
     {
+        zmqPublisher.ForgetSocket(psocket);
         LogPrint("zmq", "Close socket at address %s\n", address);
         int linger = 0;
         zmq_setsockopt(psocket, ZMQ_LINGER, &linger, sizeof(linger));
@@ -129,15 +272,8 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
 {
     assert(psocket);
 
-    /* send three parts, command & data & a LE 4byte sequence number */
-    unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), (void*)0);
-    if (rc == -1)
-        return false;
-
-    /* increment memory only sequence number after sending */
-    nSequence++;
+    const unsigned char *begin = static_cast<const unsigned char*>(data);
+    zmqPublisher.Push({psocket, command, std::vector<unsigned char>(begin, begin + size), 0}, &nSequence);
 
     return true;
 }
@@ -166,21 +302,35 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    // The network serialization of a block is the same as the bytes stored
+    // in the block file, so send those without deserializing the block, or
+    // the cached serialization of a block that was just connected. Blocks
+    // this close to the tip are never pruned, so it is read without taking
+    // cs_main (which notifiers must not take, see CZMQNotificationInterface).
+    // Recompression may move the block meanwhile. It does not delete the
+    // file the block was in while a reader is registered, and a position read
+    // while it was being updated is caught by checking the block's hash.
+    CBlockFileReader reader;
+    std::vector<uint8_t> block;
+    if (!ReadRawBlockFromDisk(block, pindex->GetBlockHash(), pindex->GetBlockPos(), Params().MessageStart()))
     {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        {
-            zmqError("Can't read block from disk");
+        zmqError("Can't read block from disk");
+        return false;
+    }
+    try {
+        CDataStream ss(block, SER_NETWORK, PROTOCOL_VERSION);
+        CBlockHeader header;
+        ss >> header;
+        if (header.GetHash() != pindex->GetBlockHash()) {
+            zmqError("Block on disk doesn't match its hash");
             return false;
         }
-
-        ss << block;
+    } catch (const std::exception&) {
+        zmqError("Can't read block from disk");
+        return false;
     }
 
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWBLOCK, block.data(), block.size());
 }
 
 bool CZMQPublishCheckedBlockNotifier::NotifyBlock(const CBlock& block)
@@ -188,10 +338,7 @@ bool CZMQPublishCheckedBlockNotifier::NotifyBlock(const CBlock& block)
     LogPrint("zmq", "zmq: Publish checkedblock %s\n", block.GetHash().GetHex());
 
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        ss << block;
-    }
+    ss << block;
 
     return SendMessage(MSG_CHECKEDBLOCK, &(*ss.begin()), ss.size());
 }
@@ -204,3 +351,43 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+static bool SendSequenceMessage(CZMQAbstractPublishNotifier& notifier, const uint256& hash, char label, std::optional<uint64_t> nMempoolSequence = std::nullopt)
+{
+    /* 32-byte hash in display order, a label, and for mempool events the
+       LE 8byte mempool sequence number */
+    unsigned char data[sizeof(uint256) + 1 + sizeof(uint64_t)];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    data[sizeof(uint256)] = label;
+    size_t size = sizeof(uint256) + 1;
+    if (nMempoolSequence.has_value()) {
+        WriteLE64(&data[size], nMempoolSequence.value());
+        size += sizeof(uint64_t);
+    }
+    return notifier.SendMessage(MSG_SEQUENCE, data, size);
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockConnect(const CBlockIndex *pindex)
+{
+    LogPrint("zmq", "zmq: Publish sequence block connect %s\n", pindex->GetBlockHash().GetHex());
+    return SendSequenceMessage(*this, pindex->GetBlockHash(), 'C');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockDisconnect(const CBlockIndex *pindex)
+{
+    LogPrint("zmq", "zmq: Publish sequence block disconnect %s\n", pindex->GetBlockHash().GetHex());
+    return SendSequenceMessage(*this, pindex->GetBlockHash(), 'D');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyTransactionAcceptance(const CTransaction &transaction, uint64_t nMempoolSequence)
+{
+    LogPrint("zmq", "zmq: Publish sequence mempool acceptance %s\n", transaction.GetHash().GetHex());
+    return SendSequenceMessage(*this, transaction.GetHash(), 'A', nMempoolSequence);
+}
+
+bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const CTransaction &transaction, uint64_t nMempoolSequence)
+{
+    LogPrint("zmq", "zmq: Publish sequence mempool removal %s\n", transaction.GetHash().GetHex());
+    return SendSequenceMessage(*this, transaction.GetHash(), 'R', nMempoolSequence);
+}
@@ -10,14 +10,32 @@
 
 class CBlockIndex;
 
+/** Default for -zmqqueuesize, the number of messages that may wait to be published */
+static const size_t DEFAULT_ZMQ_QUEUE_SIZE = 10000;
+/** Default for -zmqpubrawtxbatch, the maximum number of transactions in one rawtx message */
+static const unsigned int DEFAULT_ZMQ_RAWTX_BATCH = 1;
+
+/**
+ * Start the thread that publishes queued messages. Messages are queued by the
+ * notifiers from the validation callbacks, so that publishing never adds to
+ * the time cs_main or mempool.cs is held. When nMaxQueue messages are waiting,
+ * further messages are dropped; their sequence numbers are still used, so
+ * subscribers can detect the gap. If nRawTxBatch > 1, up to that many rawtx
+ * messages that are waiting back to back on the same socket are published as
+ * one multipart message.
+ */
+void StartZMQPublisher(size_t nMaxQueue, unsigned int nRawTxBatch);
+/** Publish the remaining queued messages, then stop the publisher thread. */
+void StopZMQPublisher();
+
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence; //! upcounting per message sequence number
+    uint32_t nSequence = 0; //! upcounting per message sequence number
 
 public:
 
-    /* send zmq multipart message
+    /* queue zmq multipart message for the publisher thread
        parts:
           * command
           * data
@@ -59,4 +77,13 @@ public:
     bool NotifyBlock(const CBlock &block);
 };
 
+class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnect(const CBlockIndex *pindex);
+    bool NotifyBlockDisconnect(const CBlockIndex *pindex);
+    bool NotifyTransactionAcceptance(const CTransaction &transaction, uint64_t nMempoolSequence);
+    bool NotifyTransactionRemoval(const CTransaction &transaction, uint64_t nMempoolSequence);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H